@@ -0,0 +1,531 @@
+#include <backend/Analytics.hpp>
+#include <backend/Calendar.hpp>
+#include <backend/Compression.hpp>
+#include <backend/Encryption.hpp>
+#include <backend/Dependency.hpp>
+#include <backend/Environment.hpp>
+#include <backend/Exchange.hpp>
+#include <backend/Instance.hpp>
+#include <backend/Interval.hpp>
+#include <backend/Planner.hpp>
+#include <backend/Recurrence.hpp>
+#include <backend/Schedule.hpp>
+#include <backend/Search.hpp>
+#include <backend/Storage.hpp>
+#include <backend/TaskScan.hpp>
+#include <backend/Time.hpp>
+#include <backend/User.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <ghc/filesystem.hpp>
+#include <nowide/fstream.hpp>
+
+// Allocation counting, the benchmark is the only user of the global operator new in this executable
+static std::atomic_uint64_t g_alloc_count{0}, g_alloc_bytes{0};
+
+void *operator new(std::size_t size) {
+	g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+	g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+	if (void *p = std::malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc{};
+}
+void *operator new[](std::size_t size) { return operator new(size); }
+// Not inlined, otherwise GCC sees std::free of a pointer from operator new and warns (-Wmismatched-new-delete)
+#if defined(__GNUC__) || defined(__clang__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+BENCH_NOINLINE void operator delete(void *p) noexcept { std::free(p); }
+BENCH_NOINLINE void operator delete[](void *p) noexcept { std::free(p); }
+BENCH_NOINLINE void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+BENCH_NOINLINE void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+
+using BenchClock = std::chrono::steady_clock;
+
+struct BenchResult {
+	std::string name;
+	uint32_t tasks{};
+	uint64_t iterations{};
+	double ns_per_op{}, allocs_per_op{}, alloc_bytes_per_op{}, bytes_written_per_op{};
+	std::string skipped;
+};
+
+struct BenchConfig {
+	std::vector<uint32_t> sizes{100, 1000, 10000, 100000};
+	std::chrono::milliseconds min_time{200};
+	uint64_t max_iterations = 1000000;
+	std::string json_path;
+	std::string filter;
+};
+
+class Bench {
+public:
+	explicit Bench(BenchConfig config) : m_config{std::move(config)} {}
+
+	// Run op() repeatedly, timing the whole batch
+	void Run(const char *name, uint32_t tasks, const std::function<void(uint64_t)> &op) {
+		Run(name, tasks, nullptr, op);
+	}
+	// Run setup() (untimed) and op() (timed) for each iteration
+	void Run(const char *name, uint32_t tasks, const std::function<void(uint64_t)> &setup,
+	         const std::function<void(uint64_t)> &op, uint64_t max_iterations = 0) {
+		if (!m_config.filter.empty() && std::string{name}.find(m_config.filter) == std::string::npos)
+			return;
+		if (!max_iterations)
+			max_iterations = m_config.max_iterations;
+
+		BenchResult result = make_result(name, tasks);
+		BenchClock::duration elapsed{};
+		uint64_t bytes_written_0 = m_bytes_written ? m_bytes_written() : 0;
+		uint64_t allocs = 0, alloc_bytes = 0, iterations = 0;
+		while (iterations < max_iterations && elapsed < m_config.min_time) {
+			// Grow the batch so that the clock overhead is amortized for fast operations
+			uint64_t batch =
+			    setup ? 1 : std::min<uint64_t>(std::max<uint64_t>(iterations, 1), max_iterations - iterations);
+			if (setup)
+				setup(iterations);
+			uint64_t alloc_count_0 = g_alloc_count.load(std::memory_order_relaxed),
+			         alloc_bytes_0 = g_alloc_bytes.load(std::memory_order_relaxed);
+			auto begin = BenchClock::now();
+			for (uint64_t i = 0; i < batch; ++i)
+				op(iterations + i);
+			elapsed += BenchClock::now() - begin;
+			allocs += g_alloc_count.load(std::memory_order_relaxed) - alloc_count_0;
+			alloc_bytes += g_alloc_bytes.load(std::memory_order_relaxed) - alloc_bytes_0;
+			iterations += batch;
+		}
+		result.iterations = iterations;
+		result.ns_per_op = double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / iterations;
+		result.allocs_per_op = double(allocs) / iterations;
+		result.alloc_bytes_per_op = double(alloc_bytes) / iterations;
+		if (m_bytes_written)
+			result.bytes_written_per_op = double(m_bytes_written() - bytes_written_0) / iterations;
+		Print(result);
+		m_results.push_back(std::move(result));
+	}
+
+	void Skip(const char *name, uint32_t tasks, const char *reason) {
+		if (!m_config.filter.empty() && std::string{name}.find(m_config.filter) == std::string::npos)
+			return;
+		BenchResult result = make_result(name, tasks);
+		result.skipped = reason;
+		Print(result);
+		m_results.push_back(std::move(result));
+	}
+
+	// Count the file bytes written by the following runs with a total bytes written counter, nullptr to stop
+	void SetBytesWrittenCounter(std::function<uint64_t()> counter) { m_bytes_written = std::move(counter); }
+
+	bool WriteJSON() const {
+		if (m_config.json_path.empty())
+			return true;
+		std::string json = "{\n  \"scan_path\": \"";
+		json += backend::StrFromTaskScanPath(backend::GetTaskScanPath());
+		json += "\",\n  \"timestamp\": " +
+		        std::to_string(std::chrono::duration_cast<std::chrono::seconds>(
+		                           std::chrono::system_clock::now().time_since_epoch())
+		                           .count()) +
+		        ",\n  \"benchmarks\": [";
+		for (std::size_t i = 0; i < m_results.size(); ++i) {
+			const auto &r = m_results[i];
+			char buf[512];
+			snprintf(buf, sizeof(buf),
+			         "%s\n    {\"name\": \"%s\", \"tasks\": %u, \"iterations\": %" PRIu64
+			         ", \"ns_per_op\": %.3f, \"allocs_per_op\": %.3f, \"alloc_bytes_per_op\": %.3f, "
+			         "\"bytes_written_per_op\": %.3f, \"skipped\": %s%s%s}",
+			         i ? "," : "", r.name.c_str(), r.tasks, r.iterations, r.ns_per_op, r.allocs_per_op,
+			         r.alloc_bytes_per_op, r.bytes_written_per_op, r.skipped.empty() ? "" : "\"",
+			         r.skipped.empty() ? "null" : r.skipped.c_str(), r.skipped.empty() ? "" : "\"");
+			json += buf;
+		}
+		json += "\n  ]\n}\n";
+
+		if (m_config.json_path == "-") {
+			fputs(json.c_str(), stdout);
+			return true;
+		}
+		nowide::ofstream out{m_config.json_path, std::ios::binary};
+		if (!out.is_open())
+			return false;
+		out.write(json.data(), (std::streamsize)json.size());
+		return true;
+	}
+
+private:
+	BenchConfig m_config;
+	std::vector<BenchResult> m_results;
+	std::function<uint64_t()> m_bytes_written;
+
+	static BenchResult make_result(const char *name, uint32_t tasks) {
+		BenchResult result;
+		result.name = name;
+		result.tasks = tasks;
+		return result;
+	}
+
+	void Print(const BenchResult &r) const {
+		// Keep stdout clean for "--json -"
+		FILE *out = m_config.json_path == "-" ? stderr : stdout;
+		if (!r.skipped.empty()) {
+			fprintf(out, "%-24s %8u  skipped: %s\n", r.name.c_str(), r.tasks, r.skipped.c_str());
+			return;
+		}
+		fprintf(out, "%-24s %8u %12.1f ns/op %10.2f allocs/op %12.1f B/op %10" PRIu64 " iters", r.name.c_str(),
+		        r.tasks, r.ns_per_op, r.allocs_per_op, r.alloc_bytes_per_op, r.iterations);
+		if (r.bytes_written_per_op > 0)
+			fprintf(out, " %12.1f written B/op", r.bytes_written_per_op);
+		fputc('\n', out);
+	}
+};
+
+std::vector<backend::Task> MakeTasks(uint32_t count, std::mt19937 *rng) {
+	std::vector<backend::Task> tasks(count);
+	backend::TimeInt now = backend::GetTimeIntNow();
+	for (uint32_t i = 0; i < count; ++i) {
+		auto &task = tasks[i];
+		task.id = i + 1;
+		task.property.name = "Task " + std::to_string(i);
+		// One task per 10 minutes, spread around now
+		task.property.begin_time = now - count * 5 + i * 10;
+		task.property.remind_time = task.property.begin_time - (*rng)() % 60;
+		task.property.priority = backend::TaskPriority((*rng)() % 3);
+		task.property.type = backend::TaskType((*rng)() % 5);
+		task.property.done = (*rng)() % 2;
+	}
+	return tasks;
+}
+
+void BenchFunctions(Bench *bench, const std::vector<backend::Task> &tasks, const std::string &key) {
+	auto count = (uint32_t)tasks.size();
+
+	std::string raw = backend::Schedule::StrFromTasks(tasks);
+	bench->Run("StrFromTasks", count, [&](uint64_t) { backend::Schedule::StrFromTasks(tasks); });
+	bench->Run("TasksFromStr", count, [&](uint64_t) { backend::Schedule::TasksFromStr(raw); });
+
+	std::vector<std::string> task_strs;
+	task_strs.reserve(count);
+	for (const auto &task : tasks)
+		task_strs.push_back(backend::StrFromTask(task));
+	bench->Run("StrFromTask", count, [&](uint64_t i) { backend::StrFromTask(tasks[i % count]); });
+	bench->Run("TaskFromStr", count, [&](uint64_t i) { backend::TaskFromStr(task_strs[i % count]); });
+
+	std::string encrypted = backend::Encrypt(raw, key);
+	bench->Run("Encrypt", count, [&](uint64_t) { backend::Encrypt(raw, key); });
+	bench->Run("Decrypt", count, [&](uint64_t) { backend::Decrypt(encrypted, key); });
+	std::string compressed = backend::Compress(raw);
+	bench->Run("Compress", count, [&](uint64_t) { backend::Compress(raw); });
+	bench->Run("Decompress", count, [&](uint64_t) { backend::Decompress(compressed); });
+
+	// Export to a temporary file, rewound for each op, then import the exported text
+	if (std::FILE *file = std::tmpfile()) {
+		constexpr std::pair<const char *, backend::ExchangeFormat> kFormats[] = {
+		    {"CSV", backend::ExchangeFormat::kCSV},
+		    {"JSONL", backend::ExchangeFormat::kJSONL},
+		    {"ICal", backend::ExchangeFormat::kICal}};
+		for (const auto &[name, format] : kFormats) {
+			bench->Run((std::string{"Export"} + name).c_str(), count, [&](uint64_t) {
+				std::rewind(file);
+				backend::Writer writer{file};
+				backend::ExportTasks(&writer, tasks, format);
+			});
+			std::string text(std::ftell(file), '\0');
+			std::rewind(file);
+			text.resize(std::fread(text.data(), 1, text.size(), file));
+			bench->Run((std::string{"Import"} + name).c_str(), count,
+			           [&](uint64_t) { backend::ImportTasks(text, format); });
+		}
+		std::fclose(file);
+	}
+
+	// Search names sharing the trigrams of "task" with all the others, or matching few
+	bench->Run("SearchIndexBuild", count, [&](uint64_t) { backend::TaskSearchIndex{}.Update(tasks); });
+	{
+		backend::TaskSearchIndex index;
+		index.Update(tasks);
+		std::vector<backend::Task> renamed = tasks;
+		bench->Run("SearchIndexUpdate", count, [&](uint64_t i) {
+			renamed[i % count].property.name.back() ^= 1;
+			index.Update(renamed);
+		});
+		index.Update(tasks);
+		std::string query = "sk " + std::to_string(count / 2);
+		bench->Run("Search(prefix)", count, [&](uint64_t) { index.Search("task", 20); });
+		bench->Run("Search(substring)", count, [&](uint64_t) { index.Search(query, 20); });
+		bench->Run("Search(short)", count, [&](uint64_t) { index.Search("k", 20); });
+	}
+
+	// One Task in a hundred repeats, expanded over a week in the middle of the Tasks
+	{
+		std::vector<backend::Task> recurring = tasks;
+		constexpr backend::RecurrenceFrequency kFrequencies[] = {
+		    backend::RecurrenceFrequency::kDaily, backend::RecurrenceFrequency::kWeekly,
+		    backend::RecurrenceFrequency::kMonthly};
+		for (uint32_t i = 0; i < count; i += 100)
+			recurring[i].property.recurrence.frequency = kFrequencies[i / 100 % std::size(kFrequencies)];
+		backend::TimeInt since = tasks[count / 2].property.begin_time, until = since + 7 * 24 * 60;
+		bench->Run("ExpandTaskOccurrences", count,
+		           [&](uint64_t) { backend::ExpandTaskOccurrences(recurring, since, until); });
+		bench->Run("GetRecurringTasksAt", count,
+		           [&](uint64_t i) { backend::GetRecurringTasksAt(recurring, since + (backend::TimeInt)i, true); });
+	}
+
+	// Tasks of up to 40 minutes, overlapping their neighbours (one per 10 minutes)
+	{
+		std::vector<backend::Task> spans = tasks;
+		std::mt19937 rng{count};
+		for (auto &task : spans)
+			task.property.duration = rng() % 41;
+		bench->Run("IntervalIndexBuild", count, [&](uint64_t) { backend::TaskIntervalIndex{}.Build(spans); });
+		backend::TaskIntervalIndex index;
+		index.Build(spans);
+		backend::TimeInt first = spans.front().property.begin_time;
+		bench->Run("QueryOverlaps", count, [&](uint64_t i) {
+			backend::TimeInt begin = first + (backend::TimeInt)(i % count) * 10;
+			index.QueryOverlaps(begin, begin + 60);
+		});
+		bench->Run("FindFreeSlot", count, [&](uint64_t i) {
+			index.FindFreeSlot(first + (backend::TimeInt)(i % count) * 10, 15);
+		});
+	}
+
+	// Hundreds of flexible Tasks planned against the Tasks spread over a year, most of whose time is busy
+	{
+		constexpr uint32_t kYearMinutes = 366 * 24 * 60, kFlexibleCount = 300;
+		std::vector<backend::Task> busy = tasks;
+		std::mt19937 rng{count};
+		backend::TimeInt since = backend::GetTimeIntNow(), spacing = std::max<uint32_t>(kYearMinutes / count, 1);
+		for (uint32_t i = 0; i < count; ++i) {
+			busy[i].property.begin_time = since + i * spacing;
+			busy[i].property.duration = spacing - rng() % (spacing / 4 + 1);
+		}
+		std::vector<backend::FlexibleTask> flexible(kFlexibleCount);
+		for (uint32_t i = 0; i < kFlexibleCount; ++i) {
+			auto &property = flexible[i].property;
+			property.name = "Flexible " + std::to_string(i);
+			property.priority = backend::TaskPriority(rng() % 3);
+			property.duration = 30 + rng() % 211;
+			flexible[i].deadline = since + rng() % kYearMinutes;
+		}
+		backend::PlanOptions options{since, since + kYearMinutes};
+		bench->Run("PlanTasks", count, [&](uint64_t) { backend::PlanTasks(busy, flexible, options); });
+	}
+
+	// Each Task of up to an hour after up to two of the 50 Tasks before it
+	{
+		std::vector<backend::Task> chained = tasks;
+		std::mt19937 rng{count};
+		for (uint32_t i = 0; i < count; ++i) {
+			chained[i].property.duration = rng() % 61;
+			for (uint32_t j = rng() % 3; j && i; --j)
+				chained[i].property.dependencies.push_back(chained[i - 1 - rng() % std::min(i, 50u)].id);
+		}
+		bench->Run("DependencyGraphBuild", count, [&](uint64_t) { backend::TaskDependencyGraph{}.Update(chained); });
+		backend::TaskDependencyGraph graph;
+		graph.Update(chained);
+		bench->Run("DependencyToggleDone", count, [&](uint64_t i) {
+			auto &property = chained[i * 7919 % count].property;
+			property.done = !property.done;
+			graph.Update(chained);
+		});
+		bench->Run("GetCriticalPath", count, [&](uint64_t) { graph.GetCriticalPath(); });
+	}
+
+	// Counts of the days spanned by the Tasks, and of a month in the middle of them
+	{
+		std::vector<backend::Task> counted = tasks;
+		bench->Run("CalendarIndexBuild", count, [&](uint64_t) { backend::TaskCalendarIndex{}.Update(counted); });
+		backend::TaskCalendarIndex index;
+		index.Update(counted);
+		bench->Run("CalendarToggleDone", count, [&](uint64_t i) {
+			auto &property = counted[i * 7919 % count].property;
+			property.done = !property.done;
+			index.Update(counted);
+		});
+		backend::TimeInfo info = backend::ToTimeInfo(counted[count / 2].property.begin_time);
+		int64_t first_day = backend::DaysFromCivil(info.year, info.month, 1);
+		backend::TimeInt now = counted[count / 2].property.begin_time;
+		bench->Run("GetDayCounts(month)", count,
+		           [&](uint64_t) { index.GetDayCounts(counted, first_day, first_day + 31, now); });
+		bench->Run("GetRangeCounts(year)", count,
+		           [&](uint64_t) { index.GetRangeCounts(counted, first_day, first_day + 366, now); });
+	}
+
+	// Report of all the Tasks, half of them done around their end times
+	{
+		std::vector<backend::Task> reported = tasks;
+		std::mt19937 rng{count};
+		for (auto &task : reported)
+			if (task.property.done)
+				task.property.done_time = task.property.begin_time + rng() % 120;
+		bench->Run("TaskReportColumns", count, [&](uint64_t) { backend::TaskReportColumnsFromTasks(reported); });
+		backend::TaskReportColumns columns = backend::TaskReportColumnsFromTasks(reported);
+		backend::TaskReportOptions options;
+		options.now = reported[count / 2].property.begin_time;
+		bench->Run("AnalyzeTasks", count, [&](uint64_t) { backend::AnalyzeTasks(columns, options); });
+		options.thread_count = 1;
+		bench->Run("AnalyzeTasks(1 thread)", count, [&](uint64_t) { backend::AnalyzeTasks(columns, options); });
+	}
+
+	bench->Run("ToTimeStr", count,
+	           [&](uint64_t i) { backend::ToTimeStr(tasks[i % count].property.begin_time); });
+	bench->Run("ToTimeInfo", count,
+	           [&](uint64_t i) { backend::ToTimeInfo(tasks[i % count].property.begin_time); });
+}
+
+void BenchSchedule(Bench *bench, const std::shared_ptr<backend::Instance> &instance,
+                   const std::vector<backend::Task> &tasks, std::mt19937 *rng) {
+	auto count = (uint32_t)tasks.size();
+	const char *kScheduleBenchNames[] = {"TaskInsert", "TaskErase",     "TaskEdit",
+	                                     "TaskEditKey", "TaskToggleDone", "GetTasks(cold)",
+	                                     "GetTasks(warm)", "Acquire(warm)",  "Acquire(cold)"};
+
+	if (count == 0)
+		return;
+	std::string raw = backend::Schedule::StrFromTasks(tasks);
+	if (raw.size() > backend::kMaxSharedScheduleMemory) {
+		for (const char *name : kScheduleBenchNames)
+			bench->Skip(name, count, backend::GetErrorMessage(backend::Error::kSHMSizeExceed));
+		return;
+	}
+
+	std::string username = "bench" + std::to_string(count);
+	auto [user, error] = backend::User::Register(instance, username, "bench");
+	if (!user) {
+		fprintf(stderr, "ERROR: %s\n", backend::GetErrorMessage(error));
+		return;
+	}
+
+	// Store the schedule partitions directly, they are loaded into SHM by the first Acquire
+	std::string file_path = ghc::filesystem::path{instance->GetScheduleDirPath()}.append(username).string();
+	backend::TaskPartitionStore{file_path + backend::kPartitionDirExtension, file_path}.Store(
+	    backend::PartitionTasks(tasks), user->GetKey());
+
+	std::shared_ptr<backend::Schedule> schedule;
+	std::tie(schedule, error) = backend::Schedule::Acquire(user);
+	if (!schedule) {
+		fprintf(stderr, "ERROR: %s\n", backend::GetErrorMessage(error));
+		return;
+	}
+
+	// The edits count the partition bytes they write
+	bench->SetBytesWrittenCounter([&schedule]() { return schedule->GetMetrics().bytes_written; });
+
+	// Insert new tasks after the existing ones, then erase them to restore the schedule
+	{
+		std::vector<uint32_t> inserted_ids;
+		backend::TaskProperty property = tasks.empty() ? backend::TaskProperty{} : tasks.back().property;
+		property.name = "Inserted";
+		bench->Run("TaskInsert", count, nullptr, [&](uint64_t) {
+			++property.begin_time;
+			inserted_ids.push_back(std::get<uint32_t>(schedule->TaskInsert(property)));
+		});
+		bench->Run(
+		    "TaskErase", count, nullptr,
+		    [&](uint64_t i) { schedule->TaskErase(inserted_ids[inserted_ids.size() - 1 - i]); }, inserted_ids.size());
+	}
+
+	std::uniform_int_distribution<uint32_t> id_dist{1, count};
+	bench->Run("TaskEdit", count, [&](uint64_t i) {
+		backend::TaskProperty property{};
+		property.remind_time = (backend::TimeInt)i;
+		schedule->TaskEdit(id_dist(*rng), property, backend::TaskPropertyMask::kRemindTime);
+	});
+	{
+		// Move a task back and forth, keeping its key unique
+		uint32_t id = id_dist(*rng);
+		backend::TaskProperty property = tasks[id - 1].property;
+		bench->Run("TaskEditKey", count, [&](uint64_t i) {
+			backend::TaskProperty edit{};
+			edit.begin_time = property.begin_time + (i & 1u ? 0 : 1);
+			schedule->TaskEdit(id, edit, backend::TaskPropertyMask::kBeginTime);
+		});
+	}
+	bench->Run("TaskToggleDone", count, [&](uint64_t) { schedule->TaskToggleDone(id_dist(*rng)); });
+	bench->SetBytesWrittenCounter(nullptr);
+
+	// A TaskToggleDone bumps the shared version so that the next GetTasks reloads from SHM
+	bench->Run(
+	    "GetTasks(cold)", count, [&](uint64_t) { schedule->TaskToggleDone(1); },
+	    [&](uint64_t) { schedule->GetTasks(); });
+	schedule->GetTasks();
+	bench->Run("GetTasks(warm)", count, [&](uint64_t) { schedule->GetTasks(); });
+
+	// While a token is held, Acquire returns it from the process registry
+	bench->Run("Acquire(warm)", count, [&](uint64_t) { backend::Schedule::Acquire(user); });
+	// Without any other holder, the SHM is released and Acquire has to decrypt the partitions again
+	schedule = nullptr;
+	bench->Run("Acquire(cold)", count, [&](uint64_t) { backend::Schedule::Acquire(user); });
+}
+
+bool ParseArgs(int argc, char **argv, BenchConfig *config) {
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		auto next = [&]() -> const char * { return i + 1 < argc ? argv[++i] : nullptr; };
+		const char *value;
+		if (arg == "--json" && (value = next())) {
+			config->json_path = value;
+		} else if (arg == "--filter" && (value = next())) {
+			config->filter = value;
+		} else if (arg == "--min-time" && (value = next())) {
+			config->min_time = std::chrono::milliseconds{std::strtoul(value, nullptr, 10)};
+		} else if (arg == "--sizes" && (value = next())) {
+			config->sizes.clear();
+			for (const char *p = value; *p;) {
+				char *end;
+				config->sizes.push_back(std::strtoul(p, &end, 10));
+				p = *end ? end + 1 : end;
+			}
+		} else {
+			printf("Usage: %s [--json FILE|-] [--sizes N,N,...] [--min-time MS] [--filter NAME]\n", argv[0]);
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+	BenchConfig config;
+	if (!ParseArgs(argc, argv, &config))
+		return EXIT_FAILURE;
+
+	// Temporary Instance directory
+	std::mt19937 rng{std::random_device{}()};
+	auto dir_path = ghc::filesystem::temp_directory_path() / ("schedulite-bench-" + std::to_string(rng()));
+	auto instance = backend::Instance::Create(dir_path.string());
+	if (!instance) {
+		fprintf(stderr, "ERROR: Failed to create instance at \"%s\"\n", dir_path.string().c_str());
+		return EXIT_FAILURE;
+	}
+
+	Bench bench{config};
+	for (uint32_t size : config.sizes) {
+		auto tasks = MakeTasks(size, &rng);
+		BenchFunctions(&bench, tasks, std::string(32, 'k'));
+		BenchSchedule(&bench, instance, tasks, &rng);
+	}
+
+	std::error_code ec;
+	ghc::filesystem::remove_all(dir_path, ec);
+
+	if (!bench.WriteJSON()) {
+		fprintf(stderr, "ERROR: Failed to write \"%s\"\n", config.json_path.c_str());
+		return EXIT_FAILURE;
+	}
+	return 0;
+}
@@ -0,0 +1,460 @@
+#include <backend/Environment.hpp>
+#include <backend/Instance.hpp>
+#include <backend/Metrics.hpp>
+#include <backend/Schedule.hpp>
+#include <backend/Storage.hpp>
+#include <backend/User.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _WIN32
+
+int main() {
+	fprintf(stderr, "ScheduliteBackendStress requires fork() and is not available on Windows\n");
+	return EXIT_FAILURE;
+}
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ghc/filesystem.hpp>
+#include <nowide/fstream.hpp>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+using StressClock = std::chrono::steady_clock;
+
+enum class StressOp : uint32_t { kInsert, kErase, kEdit, kDone, kCount };
+constexpr const char *kStressOpNames[] = {"insert", "erase", "edit", "done"};
+
+struct StressConfig {
+	std::string path;
+	uint32_t writers = 4, readers = 4, initial_tasks = 1000;
+	std::chrono::milliseconds duration{5000};
+	uint32_t mix[(uint32_t)StressOp::kCount] = {40, 20, 30, 10};
+	std::string json_path;
+};
+
+// Shared between the processes through an anonymous shared mapping
+struct StressControl {
+	enum Phase : uint32_t { kPrepare, kRun, kWritersDone };
+	std::atomic_uint32_t phase, ready;
+};
+
+// Result reported by each child through a pipe
+struct StressResult {
+	uint64_t ops, errors;
+	uint64_t elapsed_ns;
+	backend::HistogramSnapshot lock_wait, latency;
+	uint64_t final_hash;
+	uint32_t final_count;
+	bool failed;
+};
+
+uint64_t HashStr(std::string_view str) {
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : str)
+		hash = (hash ^ (uint8_t)c) * 1099511628211ull;
+	return hash;
+}
+
+std::shared_ptr<backend::Schedule> OpenSchedule(const StressConfig &config) {
+	auto instance = backend::Instance::Create(config.path);
+	if (!instance)
+		return nullptr;
+	auto [user, error] = backend::User::Login(instance, "stress", "stress");
+	if (!user)
+		return nullptr;
+	return std::get<std::shared_ptr<backend::Schedule>>(backend::Schedule::Acquire(user));
+}
+
+void WaitPhase(const StressControl *control, uint32_t phase) {
+	while (control->phase.load(std::memory_order_acquire) < phase)
+		std::this_thread::yield();
+}
+
+// The IPC lock wait of the last operation, only recorded by a backend with metrics
+void RecordLockWait(backend::Histogram *histogram) {
+#ifdef SCHEDULITE_ENABLE_METRICS
+	histogram->Record(backend::Schedule::GetThreadLastLockWait());
+#else
+	(void)histogram;
+#endif
+}
+
+void RunWriter(const StressConfig &config, uint32_t index, StressControl *control, StressResult *result) {
+	auto schedule = OpenSchedule(config);
+	control->ready.fetch_add(1, std::memory_order_acq_rel);
+	if (!schedule) {
+		result->failed = true;
+		return;
+	}
+	std::mt19937 rng{index * 7919u + 1};
+	uint32_t mix_total = 0;
+	for (uint32_t m : config.mix)
+		mix_total += m;
+	std::vector<uint32_t> ids;
+	for (uint32_t id = 1; id <= config.initial_tasks; ++id)
+		ids.push_back(id);
+	backend::TimeInt time_base = backend::GetTimeIntNow() + index * 1000000u;
+	backend::Histogram lock_wait, latency;
+
+	WaitPhase(control, StressControl::kRun);
+	auto begin = StressClock::now(), deadline = begin + config.duration;
+	for (auto now = begin; now < deadline;) {
+		uint32_t r = rng() % std::max(mix_total, 1u), op = 0;
+		while (op + 1 < (uint32_t)StressOp::kCount && r >= config.mix[op])
+			r -= config.mix[op++];
+		uint32_t id = ids.empty() ? 0 : ids[rng() % ids.size()];
+
+		backend::Error error = backend::Error::kSuccess;
+		auto op_begin = StressClock::now();
+		switch ((StressOp)op) {
+		case StressOp::kInsert: {
+			backend::TaskProperty property{};
+			property.name = "W" + std::to_string(index) + "-" + std::to_string(result->ops);
+			property.begin_time = property.remind_time = time_base + (uint32_t)result->ops;
+			uint32_t new_id;
+			std::tie(new_id, error) = schedule->TaskInsert(property);
+			if (error == backend::Error::kSuccess)
+				ids.push_back(new_id);
+		} break;
+		case StressOp::kErase:
+			error = schedule->TaskErase(id);
+			break;
+		case StressOp::kEdit: {
+			backend::TaskProperty property{};
+			property.remind_time = (backend::TimeInt)rng();
+			property.priority = backend::TaskPriority(rng() % 3);
+			error = schedule->TaskEdit(id, property,
+			                           backend::TaskPropertyMask::kRemindTime | backend::TaskPropertyMask::kPriority);
+		} break;
+		default:
+			error = schedule->TaskToggleDone(id);
+			break;
+		}
+		now = StressClock::now();
+		latency.Record(now - op_begin);
+		RecordLockWait(&lock_wait);
+		++result->ops;
+		// Erasing another writer's task (or an already erased one) is expected to fail
+		if (error != backend::Error::kSuccess)
+			++result->errors;
+	}
+	result->elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(StressClock::now() - begin).count();
+	result->lock_wait = lock_wait.GetSnapshot();
+	result->latency = latency.GetSnapshot();
+}
+
+void RunReader(const StressConfig &config, StressControl *control, StressResult *result) {
+	auto schedule = OpenSchedule(config);
+	control->ready.fetch_add(1, std::memory_order_acq_rel);
+	if (!schedule) {
+		result->failed = true;
+		return;
+	}
+
+	backend::Histogram lock_wait, latency;
+	WaitPhase(control, StressControl::kRun);
+	auto begin = StressClock::now();
+	while (control->phase.load(std::memory_order_acquire) < StressControl::kWritersDone) {
+		auto op_begin = StressClock::now();
+		schedule->GetTasks();
+		latency.Record(StressClock::now() - op_begin);
+		RecordLockWait(&lock_wait);
+		++result->ops;
+	}
+	result->elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(StressClock::now() - begin).count();
+	result->lock_wait = lock_wait.GetSnapshot();
+	result->latency = latency.GetSnapshot();
+
+	// Final view after every writer has finished
+	const auto &tasks = schedule->GetTasks();
+	result->final_hash = HashStr(backend::Schedule::StrFromTasks(tasks));
+	result->final_count = tasks.size();
+}
+
+bool ReadAll(int fd, void *data, std::size_t size) {
+	auto *p = (char *)data;
+	while (size) {
+		ssize_t n = read(fd, p, size);
+		if (n <= 0)
+			return false;
+		p += n;
+		size -= n;
+	}
+	return true;
+}
+void WriteAll(int fd, const void *data, std::size_t size) {
+	auto *p = (const char *)data;
+	while (size) {
+		ssize_t n = write(fd, p, size);
+		if (n <= 0)
+			return;
+		p += n;
+		size -= n;
+	}
+}
+
+struct Child {
+	pid_t pid;
+	int fd;
+	bool writer;
+};
+
+Child Spawn(const StressConfig &config, uint32_t index, bool writer, StressControl *control) {
+	int fds[2];
+	if (pipe(fds) != 0)
+		return {-1, -1, writer};
+	pid_t pid = fork();
+	if (pid == 0) {
+		close(fds[0]);
+		// Value-initialized, so zeroed
+		auto result = std::make_unique<StressResult>();
+		if (writer)
+			RunWriter(config, index, control, result.get());
+		else
+			RunReader(config, control, result.get());
+		WriteAll(fds[1], result.get(), sizeof(StressResult));
+		// Skip the destructors of the objects inherited from the parent (they would release its SHM reference)
+		_exit(result->failed ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+	close(fds[1]);
+	return {pid, fds[0], writer};
+}
+
+bool ParseArgs(int argc, char **argv, StressConfig *config) {
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg = argv[i];
+		auto next = [&]() -> const char * { return i + 1 < argc ? argv[++i] : nullptr; };
+		const char *value;
+		if (arg == "--path" && (value = next())) {
+			config->path = value;
+		} else if (arg == "--writers" && (value = next())) {
+			config->writers = std::strtoul(value, nullptr, 10);
+		} else if (arg == "--readers" && (value = next())) {
+			config->readers = std::strtoul(value, nullptr, 10);
+		} else if (arg == "--tasks" && (value = next())) {
+			config->initial_tasks = std::strtoul(value, nullptr, 10);
+		} else if (arg == "--duration" && (value = next())) {
+			config->duration = std::chrono::milliseconds{std::strtoul(value, nullptr, 10)};
+		} else if (arg == "--json" && (value = next())) {
+			config->json_path = value;
+		} else if (arg == "--mix" && (value = next())) {
+			// insert:40,erase:20,edit:30,done:10
+			std::fill(std::begin(config->mix), std::end(config->mix), 0);
+			for (const char *p = value; *p;) {
+				const char *colon = std::strchr(p, ':');
+				if (!colon)
+					return false;
+				std::string_view name{p, std::size_t(colon - p)};
+				char *end;
+				uint32_t weight = std::strtoul(colon + 1, &end, 10);
+				auto it = std::find(std::begin(kStressOpNames), std::end(kStressOpNames), name);
+				if (it == std::end(kStressOpNames))
+					return false;
+				config->mix[it - std::begin(kStressOpNames)] = weight;
+				p = *end ? end + 1 : end;
+			}
+		} else {
+			return false;
+		}
+	}
+	return true;
+}
+
+struct Summary {
+	uint64_t ops = 0, errors = 0, elapsed_ns = 0;
+	backend::HistogramSnapshot lock_wait{}, latency{};
+
+	void Add(const StressResult &r) {
+		ops += r.ops;
+		errors += r.errors;
+		elapsed_ns = std::max(elapsed_ns, r.elapsed_ns);
+		lock_wait.Merge(r.lock_wait);
+		latency.Merge(r.latency);
+	}
+	double Throughput() const { return elapsed_ns ? double(ops) * 1e9 / double(elapsed_ns) : 0.0; }
+	void Print(const char *name) const {
+		printf("%-8s %10" PRIu64 " ops %8" PRIu64 " errors %12.1f ops/s\n", name, ops, errors, Throughput());
+		printf("  lock wait  p50 %10" PRIu64 " ns  p99 %10" PRIu64 " ns  p999 %10" PRIu64 " ns  max %10" PRIu64
+		       " ns\n",
+		       lock_wait.GetPercentile(0.5), lock_wait.GetPercentile(0.99), lock_wait.GetPercentile(0.999),
+		       lock_wait.max);
+		printf("  op         p50 %10" PRIu64 " ns  p99 %10" PRIu64 " ns  p999 %10" PRIu64 " ns  max %10" PRIu64
+		       " ns\n",
+		       latency.GetPercentile(0.5), latency.GetPercentile(0.99), latency.GetPercentile(0.999), latency.max);
+	}
+	std::string JSON(const char *name) const {
+		char buf[1024];
+		snprintf(buf, sizeof(buf),
+		         "\"%s\": {\"ops\": %" PRIu64 ", \"errors\": %" PRIu64 ", \"ops_per_sec\": %.3f, "
+		         "\"lock_wait_ns\": {\"p50\": %" PRIu64 ", \"p99\": %" PRIu64 ", \"p999\": %" PRIu64
+		         ", \"max\": %" PRIu64 "}, "
+		         "\"op_ns\": {\"p50\": %" PRIu64 ", \"p99\": %" PRIu64 ", \"p999\": %" PRIu64 ", \"max\": %" PRIu64
+		         "}}",
+		         name, ops, errors, Throughput(), lock_wait.GetPercentile(0.5), lock_wait.GetPercentile(0.99),
+		         lock_wait.GetPercentile(0.999), lock_wait.max, latency.GetPercentile(0.5), latency.GetPercentile(0.99),
+		         latency.GetPercentile(0.999), latency.max);
+		return buf;
+	}
+};
+
+} // namespace
+
+int main(int argc, char **argv) {
+	StressConfig config;
+	if (!ParseArgs(argc, argv, &config)) {
+		printf("Usage: %s [--path DIR] [--writers N] [--readers M] [--tasks N] [--duration MS]\n"
+		       "       [--mix insert:40,erase:20,edit:30,done:10] [--json FILE|-]\n",
+		       argv[0]);
+		return EXIT_FAILURE;
+	}
+	bool temp_path = config.path.empty();
+	if (temp_path)
+		config.path =
+		    (ghc::filesystem::temp_directory_path() / ("schedulite-stress-" + std::to_string(getpid()))).string();
+
+	// Prepare the user and the initial schedule file
+	auto instance = backend::Instance::Create(config.path);
+	if (!instance) {
+		fprintf(stderr, "ERROR: Failed to create instance at \"%s\"\n", config.path.c_str());
+		return EXIT_FAILURE;
+	}
+	auto [user, error] = backend::User::Register(instance, "stress", "stress");
+	if (error == backend::Error::kUserAlreadyExist)
+		std::tie(user, error) = backend::User::Login(instance, "stress", "stress");
+	if (!user) {
+		fprintf(stderr, "ERROR: %s\n", backend::GetErrorMessage(error));
+		return EXIT_FAILURE;
+	}
+	std::string file_path = ghc::filesystem::path{instance->GetScheduleDirPath()}.append("stress").string();
+	{
+		std::vector<backend::Task> tasks(config.initial_tasks);
+		backend::TimeInt now = backend::GetTimeIntNow();
+		for (uint32_t i = 0; i < config.initial_tasks; ++i) {
+			tasks[i].id = i + 1;
+			tasks[i].property.name = "Initial " + std::to_string(i);
+			tasks[i].property.begin_time = tasks[i].property.remind_time = now + i;
+		}
+		backend::TaskPartitionStore{file_path + backend::kPartitionDirExtension, file_path}.Store(
+		    backend::PartitionTasks(tasks), user->GetKey());
+	}
+	// Keep the SHM alive across the whole run
+	std::shared_ptr<backend::Schedule> schedule;
+	std::tie(schedule, error) = backend::Schedule::Acquire(user);
+	if (!schedule) {
+		fprintf(stderr, "ERROR: %s\n", backend::GetErrorMessage(error));
+		return EXIT_FAILURE;
+	}
+
+	auto *control = (StressControl *)mmap(nullptr, sizeof(StressControl), PROT_READ | PROT_WRITE,
+	                                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (control == MAP_FAILED) {
+		perror("mmap");
+		return EXIT_FAILURE;
+	}
+	new (control) StressControl{};
+	control->phase.store(StressControl::kPrepare);
+
+	std::vector<Child> children;
+	for (uint32_t i = 0; i < config.writers; ++i)
+		children.push_back(Spawn(config, i, true, control));
+	for (uint32_t i = 0; i < config.readers; ++i)
+		children.push_back(Spawn(config, i, false, control));
+	while (control->ready.load(std::memory_order_acquire) < children.size())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	printf("%u writers, %u readers, %u initial tasks, %lld ms\n", config.writers, config.readers,
+	       config.initial_tasks, (long long)config.duration.count());
+	control->phase.store(StressControl::kRun, std::memory_order_release);
+
+	// Collect writers first, then let the readers take their final view
+	auto results = std::make_unique<StressResult[]>(children.size());
+	bool failed = false;
+	auto collect = [&](bool writer) {
+		for (std::size_t i = 0; i < children.size(); ++i) {
+			if (children[i].writer != writer)
+				continue;
+			int status = 0;
+			if (!ReadAll(children[i].fd, &results[i], sizeof(StressResult)))
+				failed = true;
+			close(children[i].fd);
+			waitpid(children[i].pid, &status, 0);
+			if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+				failed = true;
+		}
+	};
+	collect(true);
+	control->phase.store(StressControl::kWritersDone, std::memory_order_release);
+	collect(false);
+
+	Summary writer_summary, reader_summary;
+	for (std::size_t i = 0; i < children.size(); ++i)
+		(children[i].writer ? writer_summary : reader_summary).Add(results[i]);
+	writer_summary.Print("writers");
+	reader_summary.Print("readers");
+
+	// Verify that SHM, file and every reader agree
+	bool consistent = !failed;
+	const auto &shm_tasks = schedule->GetTasks();
+	uint64_t shm_hash = HashStr(backend::Schedule::StrFromTasks(shm_tasks));
+	uint64_t file_hash = 0;
+	{
+		auto [raw, load_error] =
+		    backend::TaskPartitionStore{file_path + backend::kPartitionDirExtension, file_path}.Load(user->GetKey());
+		if (load_error == backend::Error::kSuccess)
+			file_hash = HashStr(backend::Schedule::StrFromTasks(backend::Schedule::TasksFromStr(raw)));
+	}
+	if (file_hash != shm_hash) {
+		printf("MISMATCH: file and SHM differ\n");
+		consistent = false;
+	}
+	for (std::size_t i = 0; i < children.size(); ++i) {
+		if (!children[i].writer && results[i].final_hash != shm_hash) {
+			printf("MISMATCH: reader %zu sees %u tasks, SHM has %zu\n", i, results[i].final_count, shm_tasks.size());
+			consistent = false;
+		}
+	}
+	printf("final tasks %zu, %s\n", shm_tasks.size(), consistent ? "consistent" : "INCONSISTENT");
+
+	if (!config.json_path.empty()) {
+		std::string json = "{\"writers\": " + std::to_string(config.writers) +
+		                   ", \"readers\": " + std::to_string(config.readers) +
+		                   ", \"initial_tasks\": " + std::to_string(config.initial_tasks) +
+		                   ", \"duration_ms\": " + std::to_string(config.duration.count()) + ", " +
+		                   writer_summary.JSON("writer") + ", " + reader_summary.JSON("reader") +
+		                   ", \"final_tasks\": " + std::to_string(shm_tasks.size()) +
+		                   ", \"consistent\": " + (consistent ? "true" : "false") + "}\n";
+		if (config.json_path == "-")
+			fputs(json.c_str(), stdout);
+		else {
+			nowide::ofstream out{config.json_path, std::ios::binary};
+			out.write(json.data(), (std::streamsize)json.size());
+		}
+	}
+
+	schedule = nullptr;
+	munmap(control, sizeof(StressControl));
+	if (temp_path) {
+		std::error_code ec;
+		ghc::filesystem::remove_all(config.path, ec);
+	}
+	return consistent ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif
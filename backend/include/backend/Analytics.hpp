@@ -0,0 +1,81 @@
+#ifndef SCHEDULITE_ANALYTICS_HPP
+#define SCHEDULITE_ANALYTICS_HPP
+
+#include <backend/Task.hpp>
+#include <backend/Time.hpp>
+
+#include <array>
+#include <cinttypes>
+#include <limits>
+#include <vector>
+
+namespace backend {
+
+/**
+ * @brief Columnar view of the Task data analysed by AnalyzeTasks.
+ */
+struct TaskReportColumns {
+	/** @brief Begin time of each Task. */
+	std::vector<TimeInt> begin_times;
+	/** @brief End time of each Task, its begin time if without a duration. */
+	std::vector<TimeInt> end_times;
+	/** @brief Done time of each Task, 0 if undone or unknown. */
+	std::vector<TimeInt> done_times;
+	/** @brief TaskType of each Task. */
+	std::vector<uint8_t> types;
+	/** @brief TaskPriority of each Task. */
+	std::vector<uint8_t> priorities;
+	/** @brief Done flag (0 or 1) of each Task. */
+	std::vector<uint8_t> dones;
+
+	inline uint32_t size() const { return begin_times.size(); }
+};
+
+/**
+ * Extract the analysed columns from an array of Tasks.
+ * @brief Get TaskReportColumns from Tasks.
+ */
+TaskReportColumns TaskReportColumnsFromTasks(const std::vector<Task> &tasks);
+
+/**
+ * @brief Options of AnalyzeTasks.
+ */
+struct TaskReportOptions {
+	/** @brief Lower bound of the begin times of the analysed Tasks (inclusive). */
+	TimeInt since = 0;
+	/** @brief Upper bound of the begin times of the analysed Tasks (exclusive). */
+	TimeInt until = std::numeric_limits<TimeInt>::max();
+	/** @brief The time the backlog ages are measured at. */
+	TimeInt now = GetTimeIntNow();
+	/** @brief Number of worker threads, 0 for the hardware concurrency. */
+	uint32_t thread_count = 0;
+};
+
+/**
+ * @brief Productivity report of the Tasks beginning in a time range.
+ */
+struct TaskReport {
+	/** @brief Numbers of Tasks by TaskType. */
+	std::array<uint32_t, GetTaskTypeStrings().size()> type_counts;
+	/** @brief Numbers of done Tasks by TaskType. */
+	std::array<uint32_t, GetTaskTypeStrings().size()> type_done_counts;
+	/** @brief Done Tasks by whether done by their end times, and those done before done times were recorded. */
+	uint32_t on_time, late, done_time_unknown;
+	/** @brief Undone high priority Tasks that have begun, with the sum and max of their ages in minutes. */
+	uint32_t backlog, backlog_max_age;
+	uint64_t backlog_age_sum;
+};
+
+/**
+ * Compute a TaskReport in one pass over the columns, branch-free so that the compiler may vectorize it. Large histories
+ * are split into chunks reduced in parallel.
+ * @brief Analyze Tasks.
+ * @param columns Columns of Tasks sorted by TaskKeyLess.
+ * @param options The TaskReportOptions.
+ * @return The TaskReport.
+ */
+TaskReport AnalyzeTasks(const TaskReportColumns &columns, const TaskReportOptions &options = {});
+
+} // namespace backend
+
+#endif
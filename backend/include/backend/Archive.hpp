@@ -0,0 +1,76 @@
+#ifndef SCHEDULITE_ARCHIVE_HPP
+#define SCHEDULITE_ARCHIVE_HPP
+
+#include <backend/Error.hpp>
+#include <backend/Search.hpp>
+#include <backend/Task.hpp>
+
+#include <cinttypes>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace backend {
+
+/**
+ * Cold tier of the done Tasks moved out of a Schedule. The archive file is append-only: each archiving appends one
+ * block of [u32 length][encrypted data] holding the compressed Schedule string of the Tasks archived at once. Nothing
+ * is read until the archive is queried, and each Load only reads the blocks appended since the last one, so a block
+ * still being written (or torn) at the end is left for later.
+ * @brief Archive of Tasks.
+ */
+class TaskArchive {
+public:
+	/**
+	 * Append Tasks to an archive file as one block.
+	 * @param file_path Path of the archive file, created if missing.
+	 * @param key The key for encryption.
+	 * @param p_previous_size Set to the size of the file before the block, for Truncate.
+	 * @return Error code.
+	 */
+	static Error Append(const std::string &file_path, std::string_view key, const std::vector<Task> &tasks,
+	                    uint64_t *p_previous_size);
+	/**
+	 * Truncate an archive file back to a previous size, dropping the blocks appended since.
+	 * @return Error code.
+	 */
+	static Error Truncate(const std::string &file_path, uint64_t size);
+
+	/**
+	 * Load the blocks appended to an archive file since the last Load.
+	 * @param file_path Path of the archive file, a missing one is empty.
+	 * @param key The key for decryption.
+	 * @return Error code.
+	 */
+	Error Load(const std::string &file_path, std::string_view key);
+
+	/**
+	 * Get the loaded Tasks matching a TaskQuery.
+	 * @return The matched Tasks in key order.
+	 */
+	std::vector<Task> Query(const TaskQuery &query) const;
+
+	/**
+	 * Search the loaded Tasks by name, with a TaskSearchIndex updated after each Load that added Tasks.
+	 * @see TaskSearchIndex::Search
+	 */
+	std::vector<Task> Search(std::string_view query, uint32_t limit);
+
+	inline uint32_t GetSize() const { return m_tasks.size(); }
+
+private:
+	// Tasks sorted by TaskKeyLess, with their sequence numbers in the archive as IDs: the TaskSearchIndex needs them
+	// unique, and an archive written before the Schedules kept their next Task ID may repeat IDs
+	std::vector<Task> m_tasks;
+	// Original ID of each sequence number (from 1)
+	std::vector<uint32_t> m_task_ids;
+	TaskSearchIndex m_search_index;
+	bool m_search_outdated{};
+	uint64_t m_loaded_size{};
+
+	Task get_task(std::size_t index) const;
+};
+
+} // namespace backend
+
+#endif
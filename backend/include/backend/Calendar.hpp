@@ -0,0 +1,93 @@
+#ifndef SCHEDULITE_CALENDAR_HPP
+#define SCHEDULITE_CALENDAR_HPP
+
+#include <backend/Task.hpp>
+#include <backend/Time.hpp>
+
+#include <array>
+#include <cinttypes>
+#include <unordered_map>
+#include <vector>
+
+namespace backend {
+
+/** @brief Numbers of Tasks by TaskStatus, then by TaskType. */
+using TaskCounts = std::array<std::array<uint32_t, GetTaskTypeStrings().size()>, GetTaskStatusStrings().size()>;
+
+/**
+ * @brief Task counts of a local day.
+ */
+struct DayTaskCounts {
+	/** @brief Days since 1970/01/01 of the local date, see DaysFromCivil. */
+	int64_t day;
+	TaskCounts counts;
+};
+
+/**
+ * An index of the Task counts of each local day, by whether done and by TaskType, with prefix sums over the days.
+ * Update diffs the Tasks by ID, so only added or changed Tasks are converted to local days, and the prefix sums are
+ * only recomputed from the first day changed. A range of days is counted in O(log d) from the prefix sums and each day
+ * of it in O(d + log d), independent of the number of Tasks; the undone Tasks are told pending or ongoing by their
+ * begin times, which only takes a look at the Tasks of the current day. Recurring Tasks are kept aside and expanded
+ * only inside the queried days.
+ * @brief Calendar index of Task counts by day.
+ */
+class TaskCalendarIndex {
+public:
+	/**
+	 * Bring the index up to date with the Tasks.
+	 * @param tasks All the Tasks of a Schedule, sorted by TaskKeyLess.
+	 */
+	void Update(const std::vector<Task> &tasks);
+
+	/**
+	 * Count the Task occurrences of each day in [first_day, last_day).
+	 * @param tasks The Tasks last passed to Update.
+	 * @param now The time the TaskStatus is told at.
+	 * @return The counts of each day in order, days without Tasks included.
+	 */
+	std::vector<DayTaskCounts> GetDayCounts(const std::vector<Task> &tasks, int64_t first_day, int64_t last_day,
+	                                        TimeInt now) const;
+
+	/**
+	 * Count the Task occurrences of the days in [first_day, last_day) altogether.
+	 * @param tasks The Tasks last passed to Update.
+	 * @param now The time the TaskStatus is told at.
+	 */
+	TaskCounts GetRangeCounts(const std::vector<Task> &tasks, int64_t first_day, int64_t last_day, TimeInt now) const;
+
+	inline uint32_t GetSize() const { return uint32_t(m_entries.size() + m_recurring.size()); }
+
+private:
+	inline static constexpr uint32_t kTypeCount = GetTaskTypeStrings().size();
+	// Counts of the undone Tasks by TaskType, then of the done ones
+	using Counts = std::array<uint32_t, kTypeCount * 2>;
+	using TypeCounts = std::array<uint32_t, kTypeCount>;
+	struct Entry {
+		int64_t day;
+		TimeInt begin_time;
+		TaskType type;
+		bool done;
+		uint32_t generation;
+	};
+	// Tasks that do not recur by ID
+	std::unordered_map<uint32_t, Entry> m_entries;
+	// Days with Tasks in order with their counts, and the sums of the counts before each day (and after the last)
+	std::vector<int64_t> m_days;
+	std::vector<Counts> m_day_counts, m_prefix_counts{Counts{}};
+	// Properties of the recurring Tasks
+	std::vector<TaskProperty> m_recurring;
+	uint32_t m_generation{};
+
+	void add_entry(const Entry &entry, int32_t delta, std::size_t *p_first_changed);
+	static void add_counts(const Counts &counts, int64_t day, int64_t today, const TypeCounts &begun_today,
+	                       TaskCounts *p_counts);
+	Counts sum_counts(int64_t first_day, int64_t last_day) const;
+	TypeCounts get_begun_today(const std::vector<Task> &tasks, int64_t today, TimeInt now) const;
+	template <typename Visit>
+	void for_each_recurrence(int64_t first_day, int64_t last_day, TimeInt now, Visit &&visit) const;
+};
+
+} // namespace backend
+
+#endif
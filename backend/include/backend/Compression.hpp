@@ -0,0 +1,24 @@
+#ifndef SCHEDULITE_COMPRESSION_HPP
+#define SCHEDULITE_COMPRESSION_HPP
+
+#include <string>
+#include <string_view>
+
+namespace backend {
+/**
+ * Compress raw string data with byte-oriented LZ77: runs of literals and back references to earlier matches of at
+ * least 4 bytes, found with a hash of the next 4 bytes. Fast rather than tight, it pays off on repeated Task names.
+ * @return The compressed string.
+ * @param raw The raw string.
+ */
+std::string Compress(std::string_view raw);
+
+/**
+ * Decompress string data.
+ * @return The decompressed string, empty if the data is corrupted.
+ * @param compressed The compressed string.
+ */
+std::string Decompress(std::string_view compressed);
+} // namespace backend
+
+#endif
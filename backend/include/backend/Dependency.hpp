@@ -0,0 +1,106 @@
+#ifndef SCHEDULITE_DEPENDENCY_HPP
+#define SCHEDULITE_DEPENDENCY_HPP
+
+#include <backend/Task.hpp>
+#include <backend/Time.hpp>
+
+#include <cinttypes>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace backend {
+
+/**
+ * @brief A Task found by TaskDependencyGraph, with its times on the dependency chains.
+ */
+struct DependencyResult {
+	/** @brief Index of the Task in the vector last passed to TaskDependencyGraph::Update. */
+	uint32_t index;
+	/** @brief The earliest time the Task can begin, after its begin time and the ends of its undone dependencies. */
+	TimeInt earliest_begin;
+	/** @brief The latest time the Task can begin without delaying the chains of its undone dependents. */
+	TimeInt latest_begin;
+};
+
+/**
+ * @brief A Task with its times on the dependency chains.
+ */
+struct TaskDependencyInfo {
+	Task task;
+	/** @see DependencyResult::earliest_begin */
+	TimeInt earliest_begin;
+	/** @see DependencyResult::latest_begin */
+	TimeInt latest_begin;
+};
+
+/**
+ * A graph of the Task dependencies, whose edges go from each Task to the Tasks depending on it. Update diffs the Tasks
+ * by ID; the topological order is kept incrementally (Pearce-Kelly), so adding an edge only reorders the Tasks between
+ * its ends. The earliest begin time of an undone Task is its begin time or the latest end of its undone dependencies,
+ * the latest begin time is the latest one not delaying its undone dependents (a Task without any ends at its earliest
+ * end), and the difference is the slack. Only the Tasks downstream of a change (like toggling a Task done) have their
+ * earliest begin times recomputed, and only the Tasks upstream of those their latest begin times.
+ * @brief Incremental dependency graph over Tasks.
+ */
+class TaskDependencyGraph {
+public:
+	/**
+	 * Bring the graph up to date with the Tasks. Edges to unknown IDs, and edges closing a cycle, are ignored.
+	 * @param tasks All the Tasks of a Schedule.
+	 */
+	void Update(const std::vector<Task> &tasks);
+
+	/**
+	 * Get the undone Tasks with undone dependencies.
+	 * @return The blocked Tasks in topological order.
+	 */
+	std::vector<DependencyResult> GetBlocked() const;
+
+	/**
+	 * Get the chain of undone Tasks ending the latest, each of which begins right after the end of the one before.
+	 * @return The Tasks on the chain in order, empty if no undone Task is blocked.
+	 */
+	std::vector<DependencyResult> GetCriticalPath() const;
+
+	inline uint32_t GetSize() const { return m_alive; }
+
+private:
+	inline static constexpr uint32_t kNoNode = std::numeric_limits<uint32_t>::max();
+	struct Node {
+		uint32_t id, index, generation, position;
+		bool alive, done;
+		TimeInt begin_time;
+		uint32_t duration;
+		// Dependency IDs of the Task, and the nodes of the edges kept
+		std::vector<uint32_t> dependency_ids, dependencies, dependents;
+		uint64_t earliest_begin, latest_begin;
+	};
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_free_nodes;
+	std::unordered_map<uint32_t, uint32_t> m_id_nodes;
+	// Node of each Task index after the last Update
+	std::vector<uint32_t> m_index_nodes;
+	// Nodes in topological order, removed nodes leave kNoNode until compaction
+	std::vector<uint32_t> m_order;
+	uint32_t m_alive{}, m_generation{};
+
+	// Nodes whose earliest (forward) or latest (backward) begin times are to be recomputed
+	std::vector<uint32_t> m_forward_seeds, m_backward_seeds;
+	// Visit marks of the searches
+	std::vector<uint32_t> m_marks;
+	uint32_t m_mark{};
+
+	uint32_t add_node(const Task &task, uint32_t index);
+	void remove_node(uint32_t node);
+	void update_edges(uint32_t node);
+	bool add_edge(uint32_t from, uint32_t to);
+	void remove_edge(uint32_t from, uint32_t to);
+	void compact_order();
+	void propagate();
+	DependencyResult make_result(uint32_t node) const;
+};
+
+} // namespace backend
+
+#endif
@@ -13,6 +13,10 @@ constexpr const char *kAppDirName = "schedulite";
 constexpr const char *kUserDirName = "user.d";
 /** @brief The application's schedule data directory name. */
 constexpr const char *kScheduleDirName = "sched.d";
+/** @brief Extension of the archive file next to a user's schedule file. */
+constexpr const char *kArchiveFileExtension = ".archive";
+/** @brief Extension of the directory of a user's monthly schedule partitions. */
+constexpr const char *kPartitionDirExtension = ".d";
 /** @brief The max size in bytes of schedule data. */
 constexpr uint32_t kMaxSharedScheduleMemory = 1024 * 1024;
 
@@ -19,6 +19,8 @@ enum class Error : uint8_t {
 
 	kTaskNotFound,
 	kTaskAlreadyExist,
+	kTaskDependencyNotFound,
+	kTaskDependencyCycle,
 
 	kSHMInitializationError,
 	kSHMSizeExceed
@@ -51,6 +53,10 @@ inline constexpr const char *GetErrorMessage(Error error) {
 		return "Task not found";
 	case Error::kTaskAlreadyExist:
 		return "Task with the same name and begin time already exists";
+	case Error::kTaskDependencyNotFound:
+		return "Task dependency not found";
+	case Error::kTaskDependencyCycle:
+		return "Task dependencies form a cycle";
 
 	case Error::kSHMInitializationError:
 		return "Failed to initialize shared memory";
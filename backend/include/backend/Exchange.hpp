@@ -0,0 +1,70 @@
+#ifndef SCHEDULITE_EXCHANGE_HPP
+#define SCHEDULITE_EXCHANGE_HPP
+
+#include <backend/Task.hpp>
+#include <backend/Writer.hpp>
+
+#include <cinttypes>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+namespace backend {
+
+/**
+ * Formats to exchange Tasks with other programs. CSV and TSV have a header line with the columns
+ * id,name,begin_time,remind_time,priority,type,done,status, JSON Lines has one object per line with the same keys, the
+ * times are local "YYYY/MM/DD hh:mm" strings. iCalendar (RFC 5545) Tasks are VTODOs, VEVENTs are imported as well.
+ * @brief Task exchange formats.
+ */
+enum class ExchangeFormat { kCSV, kTSV, kJSONL, kICal };
+
+/**
+ * Get ExchangeFormat from "csv", "tsv", "jsonl" or "ics", the letter case is ignored.
+ * @return Whether the string is a valid format.
+ */
+bool ExchangeFormatFromStr(std::string_view str, ExchangeFormat *p_format);
+/**
+ * Get ExchangeFormat from the extension of a file path (".csv", ".tsv", ".jsonl", ".ics").
+ * @return Whether the extension is recognized.
+ */
+bool ExchangeFormatFromPath(std::string_view path, ExchangeFormat *p_format);
+
+/**
+ * @brief A record rejected by ImportTasks.
+ */
+struct ImportError {
+	/** @brief The line number (from 1) where the record starts. */
+	uint32_t line;
+	/** @brief The reason. */
+	std::string message;
+};
+
+/**
+ * Write Tasks in an ExchangeFormat, streamed through the Writer.
+ * @brief Export Tasks.
+ * @param writer The Writer to write to.
+ * @param tasks The Tasks to be exported.
+ * @param format The ExchangeFormat.
+ * @param time_int_now Time to compute the TaskStatus column.
+ */
+void ExportTasks(Writer *writer, const std::vector<Task> &tasks, ExchangeFormat format,
+                 TimeInt time_int_now = GetTimeIntNow());
+
+/**
+ * Parse TaskProperties from text in an ExchangeFormat. The text is split into chunks at record boundaries, which are
+ * parsed in parallel, so the order of the results follows the text. Properties missing from a record take their
+ * defaults (the remind time defaults to the begin time), records without a name or begin time are rejected.
+ * @brief Import Tasks.
+ * @param data The whole text.
+ * @param format The ExchangeFormat.
+ * @param thread_count Number of worker threads, 0 for the hardware concurrency.
+ * @return The parsed TaskProperties, and the rejected records in line order.
+ */
+std::tuple<std::vector<TaskProperty>, std::vector<ImportError>>
+ImportTasks(std::string_view data, ExchangeFormat format, uint32_t thread_count = 0);
+
+} // namespace backend
+
+#endif
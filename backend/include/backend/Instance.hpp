@@ -1,6 +1,7 @@
 #ifndef SCHEDULITE_INSTANCE_HPP
 #define SCHEDULITE_INSTANCE_HPP
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -27,12 +28,19 @@ public:
 	static std::shared_ptr<Instance> Create(std::string_view app_dir_path);
 
 	/**
-	 * Check the current working directory and create missing directories.
+	 * Check the current working directory and create missing directories. Once checked, the directories are assumed
+	 * to stay until InvalidateDirs, so that this costs no system call.
 	 * @brief Maintain the working directory.
 	 * @return Successful or not.
 	 */
 	bool MaintainDirs() const;
 
+	/**
+	 * Make the next MaintainDirs check the directories again, called when a file operation inside them fails.
+	 * @brief Invalidate the maintained directories.
+	 */
+	inline void InvalidateDirs() const { m_dirs_maintained.store(false, std::memory_order_relaxed); }
+
 	/**
 	 * Fetch the available usernames in the current instance.
 	 * @brief Fetch available usernames.
@@ -66,6 +74,7 @@ public:
 
 private:
 	std::string m_app_dir_path, m_user_dir_path, m_schedule_dir_path, m_identifier;
+	mutable std::atomic_bool m_dirs_maintained{false};
 };
 } // namespace backend
 
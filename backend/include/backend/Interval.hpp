@@ -0,0 +1,76 @@
+#ifndef SCHEDULITE_INTERVAL_HPP
+#define SCHEDULITE_INTERVAL_HPP
+
+#include <backend/Task.hpp>
+#include <backend/Time.hpp>
+
+#include <cinttypes>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace backend {
+
+/**
+ * @brief A Task occurrence found by TaskIntervalIndex.
+ */
+struct IntervalResult {
+	/** @brief Index of the Task in the vector last passed to TaskIntervalIndex::Build. */
+	uint32_t index;
+	/** @brief Begin time of the occurrence. */
+	TimeInt begin_time;
+};
+
+/**
+ * An index over the time spans [begin time, end time) of the undone Tasks with a duration; Tasks without a duration
+ * are points in time and never overlap. The spans are kept in begin time order (the order of Tasks) with a max-end
+ * segment tree and prefix max ends, so that an overlap query takes O((k + 1) log n) for k results and a free slot
+ * search O(log n + k) for k Tasks skipped. Recurring Tasks are kept aside and expanded only around the queried times.
+ * @brief Interval index over Task time spans.
+ */
+class TaskIntervalIndex {
+public:
+	/**
+	 * Rebuild the index from the Tasks in O(n).
+	 * @param tasks Tasks sorted by TaskKeyLess.
+	 */
+	void Build(const std::vector<Task> &tasks);
+
+	/**
+	 * Find the occurrences whose time spans overlap [begin, end).
+	 * @return The occurrences ordered by begin time, then by index.
+	 */
+	std::vector<IntervalResult> QueryOverlaps(TimeInt begin, TimeInt end) const;
+
+	/**
+	 * Find the first time span of a duration beginning at or after a time which overlaps no occurrence.
+	 * @param after Lower bound of the begin time of the slot.
+	 * @param duration Duration of the slot in minutes.
+	 * @param until Upper bound of the end time of the slot.
+	 * @return The begin time of the slot, and whether a slot is found.
+	 */
+	std::tuple<TimeInt, bool> FindFreeSlot(TimeInt after, uint32_t duration,
+	                                       TimeInt until = std::numeric_limits<TimeInt>::max()) const;
+
+	inline uint32_t GetSize() const { return uint32_t(m_spans.size() + m_recurring.size()); }
+
+private:
+	struct Span {
+		TimeInt begin, end;
+		uint32_t index;
+	};
+	// Spans of the Tasks that do not recur in begin time order, max ends over them as a segment tree and as prefixes
+	std::vector<Span> m_spans;
+	std::vector<TimeInt> m_tree_max_ends, m_prefix_max_ends;
+	uint32_t m_tree_leaves{};
+	// Recurring Tasks with their indices
+	std::vector<std::pair<uint32_t, TaskProperty>> m_recurring;
+
+	void collect_ending_after(uint32_t node, uint32_t node_first, uint32_t node_last, uint32_t last, TimeInt time,
+	                          std::vector<IntervalResult> *p_results) const;
+};
+
+} // namespace backend
+
+#endif
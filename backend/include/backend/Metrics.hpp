@@ -0,0 +1,152 @@
+#ifndef SCHEDULITE_METRICS_HPP
+#define SCHEDULITE_METRICS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+
+namespace backend {
+
+/** @brief Whether the backend is compiled with metrics (SCHEDULITE_ENABLE_METRICS). */
+#ifdef SCHEDULITE_ENABLE_METRICS
+constexpr bool kMetricsEnabled = true;
+#else
+constexpr bool kMetricsEnabled = false;
+#endif
+
+/**
+ * Log-linear bucketing of 64-bit values, 8 sub-buckets per power of two (at most 12.5% relative error).
+ * @brief Histogram bucket layout.
+ */
+struct HistogramLayout {
+	static constexpr uint32_t kSubBits = 3, kSubCount = 1u << kSubBits, kBucketCount = (64 - kSubBits + 1) * kSubCount;
+
+	inline static constexpr uint32_t GetIndex(uint64_t value) {
+		if (value < kSubCount)
+			return (uint32_t)value;
+#if defined(__GNUC__) || defined(__clang__)
+		uint32_t msb = 63 - __builtin_clzll(value);
+#else
+		uint32_t msb = 63;
+		while (!(value >> msb))
+			--msb;
+#endif
+		return ((msb - kSubBits + 1) << kSubBits) | (uint32_t)((value >> (msb - kSubBits)) & (kSubCount - 1));
+	}
+	inline static constexpr uint64_t GetLowerBound(uint32_t index) {
+		if (index < kSubCount)
+			return index;
+		uint32_t msb = (index >> kSubBits) + kSubBits - 1;
+		return (uint64_t{1} << msb) | (uint64_t(index & (kSubCount - 1)) << (msb - kSubBits));
+	}
+};
+
+/**
+ * @brief Copy of a Histogram's data.
+ */
+struct HistogramSnapshot {
+	std::array<uint64_t, HistogramLayout::kBucketCount> buckets{};
+	uint64_t count{}, sum{}, max{};
+
+	/**
+	 * Get the approximated value at a percentile.
+	 * @param p Percentile in [0, 1].
+	 */
+	uint64_t GetPercentile(double p) const;
+	/**
+	 * Get the mean value.
+	 */
+	inline double GetMean() const { return count ? double(sum) / double(count) : 0.0; }
+	/**
+	 * Add the data of another HistogramSnapshot, such as one of another process.
+	 */
+	void Merge(const HistogramSnapshot &r);
+};
+
+/**
+ * Thread-safe log-linear histogram, recording takes a few relaxed atomic increments.
+ * @brief Concurrent histogram.
+ */
+class Histogram {
+public:
+	inline void Record(uint64_t value) {
+		m_buckets[HistogramLayout::GetIndex(value)].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		m_sum.fetch_add(value, std::memory_order_relaxed);
+		uint64_t max = m_max.load(std::memory_order_relaxed);
+		while (value > max && !m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+			;
+	}
+	/**
+	 * Record a duration in nanoseconds.
+	 */
+	template <typename Rep, typename Period> inline void Record(std::chrono::duration<Rep, Period> duration) {
+		Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+	}
+	HistogramSnapshot GetSnapshot() const;
+
+private:
+	std::array<std::atomic_uint64_t, HistogramLayout::kBucketCount> m_buckets{};
+	std::atomic_uint64_t m_count{}, m_sum{}, m_max{};
+};
+
+/**
+ * Record the lifetime of the object into a Histogram, does nothing when metrics are compiled out.
+ * @brief Scoped Histogram timer.
+ */
+class HistogramTimer {
+public:
+	inline explicit HistogramTimer(Histogram *histogram) {
+		if constexpr (kMetricsEnabled) {
+			m_histogram = histogram;
+			m_begin = std::chrono::steady_clock::now();
+		}
+	}
+	inline ~HistogramTimer() {
+		if constexpr (kMetricsEnabled)
+			m_histogram->Record(std::chrono::steady_clock::now() - m_begin);
+	}
+	HistogramTimer(const HistogramTimer &) = delete;
+	HistogramTimer &operator=(const HistogramTimer &) = delete;
+
+private:
+	Histogram *m_histogram{};
+	std::chrono::steady_clock::time_point m_begin{};
+};
+
+/**
+ * @brief Per-process metrics of a Schedule, durations are in nanoseconds.
+ */
+struct ScheduleMetrics {
+	/** @brief Whether the metrics are compiled in. */
+	bool enabled{kMetricsEnabled};
+
+	/** @brief Time spent waiting for the IPC mutex. */
+	HistogramSnapshot lock_wait;
+	/** @brief Time the IPC mutex is held. */
+	HistogramSnapshot lock_hold;
+	/** @brief Time spent parsing the Schedule string. */
+	HistogramSnapshot parse;
+	/** @brief Time spent serializing Tasks to the Schedule string. */
+	HistogramSnapshot serialize;
+	/** @brief Time spent encrypting the Schedule string. */
+	HistogramSnapshot encrypt;
+	/** @brief Time spent decrypting the Schedule file. */
+	HistogramSnapshot decrypt;
+	/** @brief Time spent writing the Schedule file. */
+	HistogramSnapshot file_write;
+
+	/** @brief Total bytes written to the Schedule file. */
+	uint64_t bytes_written{};
+	/** @brief Number of times a local Task cache is reloaded from SHM. */
+	uint64_t snapshot_reloads{};
+	/** @brief Current size in bytes of the shared Schedule data. */
+	uint32_t shm_size{};
+	/** @brief Capacity in bytes of the shared Schedule data. */
+	uint32_t shm_capacity{};
+};
+
+} // namespace backend
+
+#endif
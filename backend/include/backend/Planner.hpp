@@ -0,0 +1,71 @@
+#ifndef SCHEDULITE_PLANNER_HPP
+#define SCHEDULITE_PLANNER_HPP
+
+#include <backend/Schedule.hpp>
+#include <backend/Task.hpp>
+#include <backend/Time.hpp>
+
+#include <chrono>
+#include <cinttypes>
+#include <limits>
+#include <vector>
+
+namespace backend {
+
+/**
+ * @brief A Task to be planned, whose begin time is up to the planner.
+ */
+struct FlexibleTask {
+	/**
+	 * @brief The TaskProperty to insert, a duration is required. The begin time is planned, the remind time keeps its
+	 * lead before the begin time.
+	 */
+	TaskProperty property;
+	/** @brief Lower bound of the begin time. */
+	TimeInt earliest = 0;
+	/** @brief Upper bound of the end time, 0 for none. */
+	TimeInt deadline = 0;
+};
+
+/**
+ * @brief Options of PlanTasks.
+ */
+struct PlanOptions {
+	/** @brief Lower bound of the planned begin times. */
+	TimeInt since = 0;
+	/** @brief Upper bound of the planned end times. */
+	TimeInt until = std::numeric_limits<TimeInt>::max();
+	/** @brief Time for the local improvement after the greedy pass, which always completes. */
+	std::chrono::microseconds time_budget{std::chrono::milliseconds{100}};
+};
+
+/**
+ * @brief A plan of FlexibleTasks.
+ */
+struct TaskPlan {
+	/** @brief kInsert TaskOps of the placed FlexibleTasks in begin time order, to be applied by Schedule::TaskBatch. */
+	std::vector<TaskOp> ops;
+	/** @brief Index of the FlexibleTask of each TaskOp. */
+	std::vector<uint32_t> placed;
+	/** @brief Indices of the FlexibleTasks without a free slot before their deadlines. */
+	std::vector<uint32_t> unplaced;
+};
+
+/**
+ * Place FlexibleTasks into the free time left by the busy Task occurrences. A greedy pass places them at the earliest
+ * free slots by priority (higher first), then deadline (earlier first), then duration (longer first). A local
+ * improvement step follows within the time budget: a Task left unplaced may push a placed one it is blocked by to a
+ * later slot, or displace it if it has a lower priority; the placed Tasks are moved as early as possible, and may take
+ * earlier slots from Tasks of lower priorities.
+ * @brief Plan FlexibleTasks.
+ * @param busy The busy Task occurrences, like the result of Schedule::GetOverlappingTasks.
+ * @param tasks The FlexibleTasks.
+ * @param options The PlanOptions.
+ * @return The TaskPlan.
+ */
+TaskPlan PlanTasks(const std::vector<Task> &busy, const std::vector<FlexibleTask> &tasks,
+                   const PlanOptions &options = {});
+
+} // namespace backend
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef SCHEDULITE_RECURRENCE_HPP
+#define SCHEDULITE_RECURRENCE_HPP
+
+#include <backend/Task.hpp>
+#include <backend/Time.hpp>
+
+#include <cinttypes>
+#include <vector>
+
+namespace backend {
+
+/** @brief Max number of occurrences expanded from a Task in one window. */
+constexpr uint32_t kMaxTaskOccurrences = 10000;
+
+/**
+ * Expand the begin times of a Task's occurrences inside a time window. Occurrences keep the local time of day of the
+ * begin time, which is always the first occurrence; monthly and yearly dates that do not exist (like February 30) are
+ * skipped. Only the occurrences near the window are generated, so the cost does not grow with the Task's age for
+ * daily and weekly rules.
+ * @brief Get the occurrence times of a Task.
+ * @param property The TaskProperty, a Task that does not recur occurs once at its begin time.
+ * @param since Lower bound of the begin time (inclusive).
+ * @param until Upper bound of the begin time (exclusive).
+ * @param limit Max number of occurrences.
+ * @return The ascending begin times.
+ */
+std::vector<TimeInt> GetOccurrenceTimes(const TaskProperty &property, TimeInt since, TimeInt until,
+                                        uint32_t limit = kMaxTaskOccurrences);
+
+/**
+ * Make an occurrence of a Task, which keeps the Task ID and recurrence rule, with the begin time moved and the remind
+ * time moved along.
+ * @brief Make a Task occurrence.
+ */
+Task MakeTaskOccurrence(const Task &task, TimeInt begin_time);
+
+/**
+ * Expand the Tasks into their occurrences inside a time window.
+ * @brief Expand Task occurrences.
+ * @param tasks Tasks sorted by TaskKeyLess.
+ * @param since Lower bound of the begin time (inclusive).
+ * @param until Upper bound of the begin time (exclusive).
+ * @return The occurrences in key order.
+ */
+std::vector<Task> ExpandTaskOccurrences(const std::vector<Task> &tasks, TimeInt since, TimeInt until);
+
+/**
+ * @brief TaskStatus of a Task's current or next occurrence.
+ */
+struct TaskOccurrenceStatus {
+	TaskStatus status;
+	/** @brief Begin time of the current or next occurrence, the last one once every occurrence has begun. */
+	TimeInt begin_time;
+	/** @brief Time the status changes next without an edit, 0 if it does not. */
+	TimeInt transition_time;
+};
+
+/**
+ * Get the TaskStatus of a Task from its current or next occurrence. An occurrence of a recurring Task is Ongoing
+ * through its duration (its first minute if it has none) and Pending before it begins; once the last occurrence has
+ * ended, the Task stays Ongoing like one that does not recur. A Task that does not recur has the status of
+ * TaskStatusFromTask.
+ * @brief Get the TaskStatus from the occurrences.
+ * @param property The TaskProperty.
+ * @param time_int The current time.
+ */
+TaskOccurrenceStatus GetTaskOccurrenceStatus(const TaskProperty &property, TimeInt time_int);
+
+/**
+ * Get the occurrences of the undone recurring Tasks to be reminded (or begun) at a time, for the reminder loops whose
+ * column scans only cover the first occurrence.
+ * @brief Get recurring Tasks to remind.
+ * @param tasks All the Tasks of a Schedule.
+ * @param time_int The time to remind at.
+ * @param with_begin_time Whether the occurrences beginning at time_int are included.
+ * @return The occurrences whose remind time (or begin time) is time_int.
+ */
+std::vector<Task> GetRecurringTasksAt(const std::vector<Task> &tasks, TimeInt time_int, bool with_begin_time);
+
+} // namespace backend
+
+#endif
@@ -1,8 +1,17 @@
 #ifndef SCHEDULITE_SCHEDULE_HPP
 #define SCHEDULITE_SCHEDULE_HPP
 
+#include <backend/Analytics.hpp>
+#include <backend/Archive.hpp>
+#include <backend/Calendar.hpp>
+#include <backend/Dependency.hpp>
 #include <backend/Error.hpp>
+#include <backend/Interval.hpp>
+#include <backend/Metrics.hpp>
+#include <backend/Search.hpp>
+#include <backend/Storage.hpp>
 #include <backend/Task.hpp>
+#include <backend/TaskScan.hpp>
 #include <backend/Time.hpp>
 #include <backend/User.hpp>
 
@@ -12,8 +21,10 @@
 #include <tuple>
 #include <vector>
 
+#include <chrono>
 #include <condition_variable>
 #include <future>
+#include <limits>
 #include <mutex>
 #include <optional>
 #include <thread>
@@ -21,13 +32,51 @@
 
 namespace backend {
 
+/**
+ * @brief Refcounted immutable Task vector, shared between threads without copying.
+ */
+using TaskSnapshot = std::shared_ptr<const std::vector<Task>>;
+
+/** @brief Type of a TaskOp. */
+enum class TaskOpType : uint8_t { kInsert, kErase, kEdit, kToggleDone };
+
+/**
+ * @brief A Task operation in a batch.
+ */
+struct TaskOp {
+	/** @brief The operation type. */
+	TaskOpType type;
+	/** @brief The Task ID, ignored by kInsert. */
+	uint32_t id;
+	/** @brief The TaskProperty to insert, or the TaskProperty patch to edit with. */
+	TaskProperty property;
+	/** @brief Specifying the parts to modify by kEdit. */
+	TaskPropertyMask property_edit_mask;
+};
+
+/**
+ * @brief Result of a TaskOp.
+ */
+struct TaskOpResult {
+	/** @brief The ID of the operated (or inserted) Task. */
+	uint32_t id;
+	/** @brief The Error code. */
+	Error error;
+};
+
 /** @brief A Schedule token from a User. */
 class Schedule {
 public:
 	explicit Schedule(const std::shared_ptr<User> &user_ptr);
 
 	/**
-	 * Acquire Schedule token from a User.
+	 * Acquire Schedule token from a User. The Schedules acquired in a process are registered by User identifier, so
+	 * that while a token is alive, acquiring it again returns the same token, sharing its SHM view and caches, without
+	 * any system call. GetUserPtr of a shared token returns the User of its first Acquire, which is equivalent (same
+	 * Instance, name and key) to the User of later Acquires; acquiring a live token with a User of another key fails
+	 * with kUserWrongPassword. The Schedule is initialized outside the registry lock, concurrent Acquires of the same
+	 * Schedule wait for it.
+	 * @brief Acquire Schedule token from a User.
 	 * @param user_ptr The Schedule's parent User.
 	 * @return Schedule token and Error code.
 	 */
@@ -44,9 +93,159 @@ public:
 	 */
 	const std::vector<Task> &GetTasks() const;
 	/**
-	 * Get all the Tasks in the Schedule, and check whether the tasks are updated.
+	 * Get an immutable snapshot of all the Tasks in the Schedule, which is shared with the calling thread's cache
+	 * rather than copied, and stays valid however the Schedule changes afterwards.
+	 * @brief Get a Task snapshot.
+	 * @param p_version Set to the version of the snapshot, which differs from that of any earlier snapshot of another
+	 * content from the same Schedule token; can be nullptr. The token is shared by the Acquires of a User, so callers
+	 * tell changes by comparing with the version they saw last.
+	 */
+	TaskSnapshot GetTaskSnapshot(uint32_t *p_version = nullptr) const;
+	/**
+	 * Get the TaskColumns of the Tasks for the scan kernels, kept by the Schedule token and rebuilt only when the
+	 * Schedule changes.
+	 * @brief Get the TaskColumns of a Task snapshot.
+	 * @param p_tasks Set to the Task snapshot the columns are extracted from.
+	 * @see TaskStatusScan, TimeEqualScan
+	 */
+	std::shared_ptr<const TaskColumns> GetTaskColumns(TaskSnapshot *p_tasks) const;
+	/**
+	 * Get the Tasks matching a TaskQuery, the begin time range is located by binary search.
+	 * @brief Query Tasks in the Schedule.
+	 * @param query The TaskQuery.
+	 * @return The matched Tasks in key order.
+	 */
+	std::vector<Task> QueryTasks(const TaskQuery &query) const;
+	/**
+	 * Locate the Tasks matching a TaskQuery in key-ordered Tasks.
+	 * @param tasks Tasks sorted by TaskKeyLess.
+	 * @param query The TaskQuery.
+	 * @return The index range [first, last) of the matched Tasks.
+	 */
+	static std::tuple<std::size_t, std::size_t> QueryTaskRange(const std::vector<Task> &tasks, const TaskQuery &query);
+
+	/**
+	 * Search Tasks by name with a TaskSearchIndex, which is kept by the Schedule token and updated incrementally when
+	 * the Schedule changes.
+	 * @brief Search Tasks by name.
+	 * @param query The substring to search for, letter case is ignored.
+	 * @param limit Max number of Tasks to return.
+	 * @return The matched Tasks, exact and prefix matches first.
+	 * @see TaskSearchIndex::Search
+	 */
+	std::vector<Task> SearchTasks(std::string_view query, uint32_t limit = kDefaultSearchLimit) const;
+	inline static constexpr uint32_t kDefaultSearchLimit = 20;
+
+	/**
+	 * Get the occurrences of the Tasks inside a time window, recurring Tasks are expanded lazily. The expansions of the
+	 * recently queried windows are cached until the Schedule changes.
+	 * @brief Get Task occurrences.
+	 * @param since Lower bound of the begin time (inclusive).
+	 * @param until Upper bound of the begin time (exclusive).
+	 * @return The occurrences in key order.
+	 * @see ExpandTaskOccurrences
+	 */
+	TaskSnapshot GetTaskOccurrences(TimeInt since, TimeInt until) const;
+
+	/**
+	 * Get the occurrences of the undone Tasks whose time spans overlap [begin, end), with a TaskIntervalIndex kept by
+	 * the Schedule token and rebuilt when the Schedule changes.
+	 * @brief Get overlapping Tasks.
+	 * @return The occurrences ordered by begin time.
+	 * @see TaskIntervalIndex::QueryOverlaps
+	 */
+	std::vector<Task> GetOverlappingTasks(TimeInt begin, TimeInt end) const;
+	/**
+	 * Get the occurrences overlapping a TaskProperty's time span, which would be double-booked by inserting it. The
+	 * occurrences of a recurring TaskProperty are checked up to kConflictMinutes after its begin time.
+	 * @brief Get the conflicts of a TaskProperty.
+	 * @param property The TaskProperty to insert (or to edit to).
+	 * @param id ID of the Task being edited, which does not conflict with itself; 0 for none.
+	 * @return The conflicting occurrences ordered by begin time.
+	 */
+	std::vector<Task> GetTaskConflicts(const TaskProperty &property, uint32_t id = 0) const;
+	inline static constexpr TimeInt kConflictMinutes = 366 * 24 * 60;
+	/**
+	 * Find the first free time slot of a duration, which overlaps no occurrence of the undone Tasks.
+	 * @brief Find a free time slot.
+	 * @param after Lower bound of the begin time of the slot.
+	 * @param duration Duration of the slot in minutes.
+	 * @param until Upper bound of the end time of the slot.
+	 * @return The begin time of the slot, and whether a slot is found.
+	 * @see TaskIntervalIndex::FindFreeSlot
+	 */
+	std::tuple<TimeInt, bool> FindFreeSlot(TimeInt after, uint32_t duration,
+	                                       TimeInt until = std::numeric_limits<TimeInt>::max()) const;
+
+	/**
+	 * Get the undone Tasks waiting for undone dependencies, with a TaskDependencyGraph kept by the Schedule token and
+	 * updated incrementally when the Schedule changes.
+	 * @brief Get blocked Tasks.
+	 * @return The blocked Tasks in topological order.
+	 * @see TaskDependencyGraph::GetBlocked
+	 */
+	std::vector<TaskDependencyInfo> GetBlockedTasks() const;
+	/**
+	 * Get the chain of undone dependent Tasks ending the latest.
+	 * @brief Get the critical path.
+	 * @return The Tasks on the chain in order.
+	 * @see TaskDependencyGraph::GetCriticalPath
+	 */
+	std::vector<TaskDependencyInfo> GetCriticalPath() const;
+
+	/**
+	 * Count the Task occurrences of each local day, with a TaskCalendarIndex kept by the Schedule token and updated
+	 * incrementally when the Schedule changes.
+	 * @brief Get Task counts by day.
+	 * @param first_day First day (inclusive) in days since 1970/01/01, see DaysFromCivil.
+	 * @param last_day Last day (exclusive).
+	 * @return The counts of each day in order.
+	 * @see TaskCalendarIndex::GetDayCounts
+	 */
+	std::vector<DayTaskCounts> GetDayCounts(int64_t first_day, int64_t last_day) const;
+	/**
+	 * Count the Task occurrences of a range of local days altogether, from the prefix sums of the TaskCalendarIndex.
+	 * @brief Get Task counts of days.
+	 * @param first_day First day (inclusive) in days since 1970/01/01, see DaysFromCivil.
+	 * @param last_day Last day (exclusive).
+	 * @see TaskCalendarIndex::GetRangeCounts
+	 */
+	TaskCounts GetRangeCounts(int64_t first_day, int64_t last_day) const;
+
+	/**
+	 * Compute a productivity report of the Tasks beginning in [since, until), from TaskReportColumns kept by the
+	 * Schedule token and rebuilt when the Schedule changes. The columns are shared, so the analysis runs outside the
+	 * lock.
+	 * @brief Get a TaskReport.
+	 * @see AnalyzeTasks
 	 */
-	const std::vector<Task> &GetTasks(bool *p_updated) const;
+	TaskReport GetTaskReport(TimeInt since, TimeInt until) const;
+
+	/**
+	 * Move the done Tasks that ended before a time out of the Schedule into its TaskArchive file, as one appended
+	 * block. Recurring Tasks stay, and the dependencies on the archived Tasks are dropped.
+	 * @brief Archive done Tasks.
+	 * @param before Upper bound of the end time (exclusive) of the Tasks to archive.
+	 * @return Number of archived Tasks and Error code.
+	 */
+	std::tuple<uint32_t, Error> ArchiveTasks(TimeInt before);
+	/**
+	 * Get the archived Tasks matching a TaskQuery. The archive is loaded on the first query, not by Acquire, and only
+	 * the blocks appended since are read afterwards.
+	 * @brief Query archived Tasks.
+	 * @return The matched Tasks in key order, with their IDs when archived, which are not assigned again, and Error
+	 * code.
+	 * @see TaskArchive::Query
+	 */
+	std::tuple<std::vector<Task>, Error> QueryArchivedTasks(const TaskQuery &query) const;
+	/**
+	 * Search the archived Tasks by name, the archive is loaded as by QueryArchivedTasks.
+	 * @brief Search archived Tasks.
+	 * @return The matched Tasks, exact and prefix matches first, and Error code.
+	 * @see TaskArchive::Search
+	 */
+	std::tuple<std::vector<Task>, Error> SearchArchivedTasks(std::string_view query,
+	                                                         uint32_t limit = kDefaultSearchLimit) const;
 
 	/**
 	 * Insert a Task to the Schedule.
@@ -82,34 +281,147 @@ public:
 	 */
 	Error TaskToggleDone(uint32_t id);
 
+	/**
+	 * Apply a sequence of TaskOps as one transaction, with a single lock and a single store. Either all of them are
+	 * applied or none: the following TaskOps are still checked after a failed one, so that every failure is reported.
+	 * @brief Apply Task operations in a batch.
+	 * @param ops The TaskOps, applied in order.
+	 * @return Result of each TaskOp, and Error code of the batch (the first failure).
+	 */
+	std::tuple<std::vector<TaskOpResult>, Error> TaskBatch(const std::vector<TaskOp> &ops);
+
+	/**
+	 * Insert Tasks in bulk as one transaction: the TaskProperties are sorted and merged into the Schedule with a single
+	 * lock and a single store. TaskProperties whose key (name and begin time) already exists, in the Schedule or
+	 * earlier in the list, are skipped.
+	 * @brief Import Tasks.
+	 * @param properties The TaskProperties to be inserted, new IDs are assigned in key order.
+	 * @return Number of inserted Tasks and Error code.
+	 */
+	std::tuple<uint32_t, Error> TaskImport(std::vector<TaskProperty> properties);
+
 	/**
 	 * Get an unique identifier of the Schedule.
 	 * @return Identifier string.
 	 */
 	inline const std::string &GetIdentifier() const { return m_identifier; }
 
+#ifdef SCHEDULITE_ENABLE_METRICS
+	/**
+	 * Get the time the calling thread last spent waiting for a Schedule's IPC mutex, only recorded with metrics.
+	 * @brief Get the calling thread's last lock wait.
+	 */
+	static std::chrono::nanoseconds GetThreadLastLockWait();
+#endif
+
+	/**
+	 * Get the hot-path metrics recorded by this Schedule token in the current process.
+	 * @brief Get Schedule metrics.
+	 * @return ScheduleMetrics, with empty histograms if metrics are compiled out.
+	 */
+	ScheduleMetrics GetMetrics() const;
+
+	/**
+	 * Serialize Tasks to the raw (unencrypted) Schedule string.
+	 * @param tasks The Tasks to be serialized.
+	 * @return The raw Schedule string.
+	 */
+	static std::string StrFromTasks(const std::vector<Task> &tasks);
+
+	/**
+	 * Get Tasks from a raw (unencrypted) Schedule string.
+	 * @param str The raw Schedule string.
+	 * @return The deserialized Tasks, empty if the string is not a valid Schedule string.
+	 */
+	static std::vector<Task> TasksFromStr(std::string_view str);
+
 private:
 	inline static constexpr const char *kStringHeader = "Schedule";
 	inline static constexpr uint32_t kStringHeaderLength = std::string_view(kStringHeader).length();
+	// Followed by the Task encoding version since version 2, a Task ID of 0 never begins a version 1 string
+	inline static constexpr uint32_t kStringVersionLength = 4 + 1;
 
 	std::shared_ptr<User> m_user_ptr;
-	std::string m_file_path, m_identifier;
+	std::string m_file_path, m_archive_file_path, m_identifier;
 
 	struct SyncObject;
 	std::unique_ptr<SyncObject> m_sync_object;
 
+	struct MetricsObject;
+	std::unique_ptr<MetricsObject> m_metrics_object;
+
+	// Monthly partitions of the Schedule file
+	std::unique_ptr<TaskPartitionStore> m_store;
+
 	// Objects to sync local tasks
 	mutable std::mutex m_local_tasks_mutex;
-	mutable std::unordered_map<std::thread::id, std::pair<std::vector<Task>, uint32_t>> m_local_tasks;
+	mutable std::unordered_map<std::thread::id, std::pair<TaskSnapshot, uint32_t>> m_local_tasks;
+
+	// Search index and the Schedule version it is built from
+	mutable std::mutex m_search_mutex;
+	mutable TaskSearchIndex m_search_index;
+	mutable uint32_t m_search_version{};
+
+	// Scan columns and the Schedule version (and Tasks) they are extracted from
+	mutable std::mutex m_columns_mutex;
+	mutable std::shared_ptr<const TaskColumns> m_columns;
+	mutable uint32_t m_columns_version{};
+	mutable TaskSnapshot m_columns_tasks;
+
+	// Interval index and the Schedule version (and Tasks) it is built from
+	mutable std::mutex m_interval_mutex;
+	mutable TaskIntervalIndex m_interval_index;
+	mutable uint32_t m_interval_version{};
+	mutable TaskSnapshot m_interval_tasks;
+
+	// Dependency graph and the Schedule version it is updated to
+	mutable std::mutex m_dependency_mutex;
+	mutable TaskDependencyGraph m_dependency_graph;
+	mutable uint32_t m_dependency_version{};
+
+	// Calendar index and the Schedule version it is updated to
+	mutable std::mutex m_calendar_mutex;
+	mutable TaskCalendarIndex m_calendar_index;
+	mutable uint32_t m_calendar_version{};
+
+	// Report columns and the Schedule version they are built from
+	mutable std::mutex m_report_mutex;
+	mutable std::shared_ptr<const TaskReportColumns> m_report_columns;
+	mutable uint32_t m_report_version{};
+
+	// Archived Tasks, loaded on demand
+	mutable std::mutex m_archive_mutex;
+	mutable TaskArchive m_archive;
+
+	// Occurrences of the recently queried windows, most recent first
+	struct OccurrenceWindow {
+		uint32_t version;
+		TimeInt since, until;
+		TaskSnapshot occurrences;
+	};
+	inline static constexpr uint32_t kOccurrenceCacheSize = 8;
+	mutable std::mutex m_occurrence_mutex;
+	mutable std::vector<OccurrenceWindow> m_occurrence_windows;
+
+	const std::pair<TaskSnapshot, uint32_t> &get_local_tasks() const;
+	// Lock the interval index brought up to date, with the Tasks it indexes
+	std::unique_lock<std::mutex> lock_interval_index(TaskSnapshot *p_tasks) const;
+	std::vector<TaskDependencyInfo> get_dependency_infos(bool critical_path) const;
 
 	Error initialize_shm_locked();
 	std::vector<Task> load_tasks_from_shm() const;
+	std::tuple<std::string, Error> load_tasks_from_file(uint32_t *p_next_id) const;
 	Error store_tasks(const std::vector<Task> &tasks);
+	void store_tasks_to_shm(std::string_view raw);
 
-	static std::string get_string(const std::vector<Task> &tasks);
-	static std::vector<Task> parse_string(std::string_view str);
-
-	static Error insert(std::vector<Task> *tasks, const Task &task);
+	static uint32_t get_max_id(const std::vector<Task> &tasks);
+	// The next Task ID, above the IDs of the archived Tasks too
+	uint32_t get_next_id(const std::vector<Task> &tasks) const;
+	static Error insert(std::vector<Task> *tasks, Task task);
+	static Error erase(std::vector<Task> *tasks, uint32_t id);
+	static Error toggle_done(std::vector<Task> *tasks, uint32_t id);
+	static Error edit(std::vector<Task> *tasks, uint32_t id, const TaskProperty &property,
+	                  TaskPropertyMask property_edit_mask);
 };
 
 } // namespace backend
@@ -0,0 +1,76 @@
+#ifndef SCHEDULITE_SEARCH_HPP
+#define SCHEDULITE_SEARCH_HPP
+
+#include <backend/Task.hpp>
+
+#include <cinttypes>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace backend {
+
+/**
+ * @brief How a Task name matches a search query, better matches are ranked first.
+ */
+enum class SearchMatch : uint8_t { kExact, kPrefix, kWordPrefix, kSubstring };
+
+/**
+ * @brief A Task matched by TaskSearchIndex::Search.
+ */
+struct SearchResult {
+	/** @brief Index of the Task in the vector last passed to TaskSearchIndex::Update. */
+	uint32_t index;
+	/** @brief How the name matches. */
+	SearchMatch match;
+};
+
+/**
+ * An inverted index from the trigrams of Task names (ASCII letters case-folded) to the names containing them, for
+ * substring and prefix search. Update diffs the Tasks by ID, so only added or renamed Tasks are tokenized; names of
+ * removed Tasks are dropped lazily and the postings are compacted once they are mostly dead.
+ * @brief Trigram search index over Task names.
+ */
+class TaskSearchIndex {
+public:
+	/**
+	 * Bring the index up to date with the Tasks.
+	 * @param tasks All the Tasks of a Schedule.
+	 */
+	void Update(const std::vector<Task> &tasks);
+
+	/**
+	 * Find the Tasks whose names contain the query (letter case ignored), ranked by SearchMatch, then by shorter name,
+	 * then by the order of the Tasks.
+	 * @param query The substring to search for, an empty query matches nothing.
+	 * @param limit Max number of results.
+	 * @return The matched Tasks in rank order.
+	 */
+	std::vector<SearchResult> Search(std::string_view query, uint32_t limit) const;
+
+	inline uint32_t GetSize() const { return m_alive; }
+
+private:
+	struct Entry {
+		uint32_t id, index, generation;
+		bool alive;
+		std::string name; // case-folded
+	};
+	std::vector<Entry> m_entries;
+	inline static constexpr uint32_t kNoEntry = std::numeric_limits<uint32_t>::max();
+	std::unordered_map<uint32_t, uint32_t> m_id_entries;
+	// Entry of each Task index after the last Update
+	std::vector<uint32_t> m_index_entries;
+	// Entry indices in ascending order for each trigram, entries of removed names are skipped until compaction
+	std::unordered_map<uint32_t, std::vector<uint32_t>> m_postings;
+	uint32_t m_alive{}, m_generation{};
+
+	void add_entry(uint32_t id, uint32_t index, std::string_view name);
+	void compact();
+};
+
+} // namespace backend
+
+#endif
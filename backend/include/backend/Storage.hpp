@@ -0,0 +1,166 @@
+#ifndef SCHEDULITE_STORAGE_HPP
+#define SCHEDULITE_STORAGE_HPP
+
+#include <backend/Error.hpp>
+#include <backend/Task.hpp>
+#include <backend/Time.hpp>
+
+#include <chrono>
+#include <cinttypes>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+namespace backend {
+
+/**
+ * @brief The Tasks of a Schedule beginning in a month.
+ */
+struct TaskPartition {
+	/** @brief The month of the begin times, see TaskPartitionMonth. */
+	uint32_t month;
+	/** @brief The Tasks serialized by StrFromTask, in key order. */
+	std::string records;
+};
+
+/**
+ * Get the partition month of a begin time, as year * 12 + month - 1 of its UTC date, so that partitions do not depend
+ * on the time zone.
+ * @brief Get the partition month of a time.
+ */
+inline uint32_t TaskPartitionMonth(TimeInt begin_time) {
+	TimeInfo info = CivilFromDays(begin_time / (24 * 60));
+	return uint32_t(info.year * 12 + int(info.month) - 1);
+}
+
+/**
+ * Split Tasks into TaskPartitions by month, whose records concatenated in order are those of the Schedule string.
+ * @param tasks Tasks sorted by TaskKeyLess, so that each month is contiguous.
+ * @return The non-empty TaskPartitions in month order.
+ */
+std::vector<TaskPartition> PartitionTasks(const std::vector<Task> &tasks);
+
+/**
+ * @brief Time spent and bytes written by a TaskPartitionStore operation.
+ */
+struct TaskStoreStats {
+	std::chrono::nanoseconds encrypt{}, decrypt{}, file_write{};
+	uint64_t bytes_written{};
+	/** @brief Number of partition segments written. */
+	uint32_t segments_written{};
+};
+
+/**
+ * Partitioned storage of a Schedule: a directory of one encrypted segment file per TaskPartition, named by its month
+ * and the hash of its records, and an encrypted manifest listing them with the next Task ID of the Schedule. Storing
+ * writes only the segments whose records changed and then replaces the manifest by renaming, which commits the change,
+ * so a torn write leaves the previous state; the segments no longer listed are removed afterwards. On POSIX the
+ * segments and the new manifest are synced before the rename and the directory after it, so that this also holds across
+ * a crash. A single-file Schedule is migrated on Load.
+ *
+ * The directory is created and opened once and kept open, on POSIX as a descriptor that the files are opened relative
+ * to; it is opened again after an I/O failure. The segment list is kept in memory and only read again when another
+ * process replaced the manifest, which is told either by the identity of the manifest file (one fstatat per operation)
+ * or, without checking the manifest, by the caller through InvalidateManifest: a Schedule counts the Stores of all the
+ * processes in its SHM, so that its Stores make no metadata system call besides those of the files written. Load also
+ * checks the manifest with faccessat, once per Schedule loaded to SHM. Not thread-safe, a Schedule calls it under its
+ * IPC mutex.
+ * @brief Partitioned Schedule storage.
+ */
+class TaskPartitionStore {
+public:
+	/**
+	 * @param dir_path Path of the partition directory, created by the first Store.
+	 * @param legacy_file_path Path of the single-file Schedule to migrate.
+	 * @param check_manifest Whether each operation checks if the manifest was replaced, otherwise the caller tells it
+	 * by InvalidateManifest.
+	 */
+	TaskPartitionStore(std::string dir_path, std::string legacy_file_path, bool check_manifest = true);
+	~TaskPartitionStore();
+	TaskPartitionStore(const TaskPartitionStore &) = delete;
+	TaskPartitionStore &operator=(const TaskPartitionStore &) = delete;
+
+	/**
+	 * Load the raw Schedule string from the segments listed by the manifest, or from the single-file Schedule, which
+	 * is then migrated. Segments left unlisted by interrupted Stores are removed.
+	 * @param key The key for decryption.
+	 * @param p_stats Set to the TaskStoreStats, can be nullptr.
+	 * @param p_next_id Set to the stored next Task ID, 0 if none is stored; can be nullptr.
+	 * @return The raw Schedule string, empty if nothing is stored, and Error code.
+	 */
+	std::tuple<std::string, Error> Load(std::string_view key, TaskStoreStats *p_stats = nullptr,
+	                                    uint32_t *p_next_id = nullptr) const;
+
+	/**
+	 * Store TaskPartitions, rewriting only the changed segments.
+	 * @param partitions All the TaskPartitions of the Schedule.
+	 * @param key The key for encryption.
+	 * @param p_stats Set to the TaskStoreStats, can be nullptr.
+	 * @param next_id The next Task ID, which is not derived from the Task IDs since the Tasks with the highest ones may
+	 * have been archived; 0 if not tracked.
+	 * @return Error code.
+	 */
+	Error Store(const std::vector<TaskPartition> &partitions, std::string_view key, TaskStoreStats *p_stats = nullptr,
+	            uint32_t next_id = 0) const;
+
+	/**
+	 * Drop the cached segment list, so that the next operation reads the manifest again. Called when another process
+	 * may have replaced the manifest, if the TaskPartitionStore does not check it.
+	 */
+	inline void InvalidateManifest() const { m_segments_cached = false; }
+
+	inline const std::string &GetDirPath() const { return m_dir_path; }
+
+private:
+	inline static constexpr const char *kManifestFileName = "manifest";
+	inline static constexpr const char *kManifestHeader = "ScheduleManifest";
+	// Followed by the next Task ID since version 2, the month of a segment is never 0
+	inline static constexpr uint32_t kManifestNextIDLength = 4 + 4;
+	inline static constexpr uint32_t kManifestEntryLength = 4 + 8;
+
+	struct Segment {
+		uint32_t month;
+		uint64_t hash;
+	};
+	// Identity of the manifest file, a replaced one differs
+	struct ManifestState {
+		uint64_t inode, size;
+		int64_t modify_time, change_time;
+		inline bool operator==(const ManifestState &r) const {
+			return inode == r.inode && size == r.size && modify_time == r.modify_time && change_time == r.change_time;
+		}
+	};
+
+	std::string m_dir_path, m_manifest_path, m_legacy_file_path;
+	mutable bool m_dir_opened{};
+#ifndef _WIN32
+	mutable int m_dir_fd{-1};
+#endif
+	// The segments and the next Task ID listed by the manifest of m_manifest_state, dropped with the directory
+	mutable std::vector<Segment> m_segments;
+	mutable uint32_t m_next_id{};
+	mutable ManifestState m_manifest_state{};
+	mutable bool m_segments_cached{};
+	bool m_check_manifest;
+
+	bool open_dir() const;
+	void close_dir() const;
+	bool find_manifest(bool *p_found) const;
+	bool sync_dir() const;
+	bool get_manifest_state(ManifestState *p_state) const;
+	void cache_segments(const std::vector<Segment> &segments, uint32_t next_id, const ManifestState &state) const;
+	bool read_dir_file(const std::string &name, std::string *p_data) const;
+	bool write_dir_file(const std::string &name, std::string_view data) const;
+	bool rename_dir_file(const std::string &name, const std::string &new_name) const;
+	void remove_dir_file(const std::string &name) const;
+	static std::string get_segment_name(const Segment &segment);
+	std::tuple<std::vector<Segment>, uint32_t, bool> read_manifest(std::string_view key) const;
+	void remove_unlisted(const std::vector<Segment> &segments) const;
+	Error store(const std::vector<TaskPartition> &partitions, std::string_view key, TaskStoreStats *p_stats,
+	            uint32_t next_id) const;
+};
+
+} // namespace backend
+
+#endif
@@ -1,10 +1,14 @@
 #ifndef SCHEDULITE_TASK_HPP
 #define SCHEDULITE_TASK_HPP
 
+#include <algorithm>
 #include <array>
 #include <cinttypes>
+#include <limits>
 #include <string>
+#include <string_view>
 #include <tuple>
+#include <vector>
 
 #include <backend/Time.hpp>
 
@@ -17,6 +21,36 @@ constexpr TaskType kDefaultTaskType = TaskType::kNone;
 
 enum class TaskStatus { kPending, kOngoing, kDone };
 
+enum class RecurrenceFrequency : uint8_t { kNone, kDaily, kWeekly, kMonthly, kYearly };
+
+/**
+ * A recurrence rule in the manner of iCalendar RRULE, stored once per Task. The Task's begin time is the first
+ * occurrence, occurrences are expanded on demand.
+ * @brief Task recurrence rule.
+ */
+struct TaskRecurrence {
+	/** @brief The frequency, kNone for a Task that does not recur. */
+	RecurrenceFrequency frequency = RecurrenceFrequency::kNone;
+	/** @brief Recur every interval days, weeks, months or years. */
+	uint16_t interval = 1;
+	/** @brief Weekdays of a weekly rule, bit 0 for Sunday; 0 for the weekday of the begin time. */
+	uint8_t by_day = 0;
+	/** @brief Max number of occurrences (excluded ones counted), 0 for unlimited. */
+	uint32_t count = 0;
+	/** @brief Last possible begin time of an occurrence (inclusive), 0 for unlimited. */
+	TimeInt until = 0;
+	/** @brief Sorted begin times of the excluded occurrences. */
+	std::vector<TimeInt> exceptions;
+
+	inline bool IsRecurring() const { return frequency != RecurrenceFrequency::kNone; }
+
+	inline bool operator==(const TaskRecurrence &r) const {
+		return frequency == r.frequency && interval == r.interval && by_day == r.by_day && count == r.count &&
+		       until == r.until && exceptions == r.exceptions;
+	}
+	inline bool operator!=(const TaskRecurrence &r) const { return !operator==(r); }
+};
+
 /**
  * @brief Task property structure.
  */
@@ -33,10 +67,20 @@ struct TaskProperty {
 	TaskType type = kDefaultTaskType;
 	/** @brief Whether the Task is done or not. */
 	bool done = false;
+	/** @brief The recurrence rule. */
+	TaskRecurrence recurrence;
+	/** @brief Duration in minutes, 0 for a Task without an end time. */
+	uint32_t duration = 0;
+	/** @brief IDs of the Tasks to be done before this one, ascending. */
+	std::vector<uint32_t> dependencies;
+	/** @brief Time the Task was marked done, 0 if undone or unknown (set by the Schedule). */
+	TimeInt done_time = 0;
 
 	inline bool operator==(const TaskProperty &r) const {
 		return begin_time == r.begin_time && name == r.name && begin_time == r.begin_time &&
-		       remind_time == r.remind_time && priority == r.priority && type == r.type && done == r.done;
+		       remind_time == r.remind_time && priority == r.priority && type == r.type && done == r.done &&
+		       recurrence == r.recurrence && duration == r.duration && dependencies == r.dependencies &&
+		       done_time == r.done_time;
 	}
 	inline bool operator!=(const TaskProperty &r) const { return !operator==(r); }
 };
@@ -53,7 +97,10 @@ enum class TaskPropertyMask {
 	kPriority = 1 << 3,
 	kType = 1 << 4,
 	kDone = 1 << 5,
-	kAll = (1 << 6) - 1
+	kRecurrence = 1 << 6,
+	kDuration = 1 << 7,
+	kDependencies = 1 << 8,
+	kAll = (1 << 9) - 1
 };
 inline constexpr TaskPropertyMask operator|(TaskPropertyMask l, TaskPropertyMask r) {
 	return (TaskPropertyMask)(int(l) | int(r));
@@ -97,9 +144,24 @@ inline TaskProperty TaskPropertyPatch(const TaskProperty &origin, const TaskProp
 		patched.type = patch.type;
 	if ((patch_mask & TaskPropertyMask::kDone) != TaskPropertyMask::kNone)
 		patched.done = patch.done;
+	if ((patch_mask & TaskPropertyMask::kRecurrence) != TaskPropertyMask::kNone)
+		patched.recurrence = patch.recurrence;
+	if ((patch_mask & TaskPropertyMask::kDuration) != TaskPropertyMask::kNone)
+		patched.duration = patch.duration;
+	if ((patch_mask & TaskPropertyMask::kDependencies) != TaskPropertyMask::kNone)
+		patched.dependencies = patch.dependencies;
 	return patched;
 }
 
+/**
+ * Get the end time of a TaskProperty (exclusive), which equals the begin time if the Task has no duration.
+ * @brief Get the end time of a TaskProperty.
+ */
+inline TimeInt TaskEndTime(const TaskProperty &property) {
+	return (TimeInt)std::min<uint64_t>(uint64_t(property.begin_time) + property.duration,
+	                                   std::numeric_limits<TimeInt>::max());
+}
+
 /**
  * @brief Task structure.
  */
@@ -113,6 +175,20 @@ struct Task {
 	inline bool operator!=(const Task &r) const { return id != r.id || property != r.property; }
 };
 
+/**
+ * @brief Task range query, in the order of Task keys.
+ */
+struct TaskQuery {
+	/** @brief Lower bound of the begin time (inclusive). */
+	TimeInt since = 0;
+	/** @brief Upper bound of the begin time (exclusive). */
+	TimeInt until = std::numeric_limits<TimeInt>::max();
+	/** @brief Number of matched Tasks to skip. */
+	uint32_t offset = 0;
+	/** @brief Max number of Tasks to return. */
+	uint32_t limit = std::numeric_limits<uint32_t>::max();
+};
+
 /**
  * Patch a Task object with a TaskProperty and a mask.
  * @brief Patch a Task object.
@@ -150,18 +226,43 @@ inline bool TaskPropertyKeyEqual(const TaskProperty &l, const TaskProperty &r) {
  */
 inline bool TaskKeyEqual(const Task &l, const Task &r) { return TaskPropertyKeyEqual(l.property, r.property); }
 
+/**
+ * Version of the Task encoding. Version 1 has only the fixed fields and the name; version 2 appends tagged extensions
+ * (tag 1 the recurrence rule, 2 the duration, 3 the dependencies, 4 the done time, see TaskExtensionTag in Task.cpp),
+ * unknown tags are skipped.
+ */
+constexpr uint8_t kTaskStrVersion = 2;
+
 /**
  * Get Task data from an encoded string.
  * @return the Task from string, the deserialized string length (0 if failed)
  * @param str The string to be deserialized.
+ * @param version The Task encoding version of the string.
  */
-std::tuple<Task, uint32_t> TaskFromStr(std::string_view str);
+std::tuple<Task, uint32_t> TaskFromStr(std::string_view str, uint8_t version = kTaskStrVersion);
 /**
- * Serialize Task data to a string.
+ * Serialize Task data to a string of the current encoding version.
  * @param task The task to be serialized.
  */
 std::string StrFromTask(const Task &task);
 
+/**
+ * Convert a TaskRecurrence to a RRULE-like string, for example "FREQ=WEEKLY;INTERVAL=2;BYDAY=MO,FR;COUNT=10", the
+ * times of UNTIL and EXDATE are "YYYY/MM/DD hh:mm". Empty for a Task that does not recur.
+ * @brief Get TaskRecurrence's string.
+ * @param recurrence The TaskRecurrence.
+ * @param with_exceptions Whether to append the exceptions as "EXDATE=time1,time2".
+ */
+std::string StrFromTaskRecurrence(const TaskRecurrence &recurrence, bool with_exceptions = false);
+
+/**
+ * Parse a TaskRecurrence from a string of StrFromTaskRecurrence, a bare frequency ("daily", "weekly", "monthly",
+ * "yearly" or "none") is also accepted. The letter case is ignored.
+ * @brief Get TaskRecurrence from string.
+ * @return The TaskRecurrence, and whether the string is valid.
+ */
+std::tuple<TaskRecurrence, bool> TaskRecurrenceFromStr(std::string_view str);
+
 /**
  * Get TaskStatus based on TaskProperty data and current time.
  * @brief Get TaskStatus from TaskProperty.
@@ -0,0 +1,123 @@
+#ifndef SCHEDULITE_TASKSCAN_HPP
+#define SCHEDULITE_TASKSCAN_HPP
+
+#include <backend/Task.hpp>
+#include <backend/Time.hpp>
+
+#include <cinttypes>
+#include <vector>
+
+namespace backend {
+
+/** @brief Instruction set used by the scan kernels. */
+enum class TaskScanPath { kScalar, kSSE2, kAVX2 };
+
+/**
+ * Get the scan kernel path selected for the running CPU.
+ * @brief Get the selected TaskScanPath.
+ */
+TaskScanPath GetTaskScanPath();
+
+/**
+ * Get String descriptor from TaskScanPath enum.
+ * @brief Get TaskScanPath's string.
+ */
+inline constexpr const char *StrFromTaskScanPath(TaskScanPath path) {
+	switch (path) {
+	case TaskScanPath::kScalar:
+		return "Scalar";
+	case TaskScanPath::kSSE2:
+		return "SSE2";
+	case TaskScanPath::kAVX2:
+		return "AVX2";
+	default:
+		return "Unknown";
+	}
+}
+
+/**
+ * @brief Columnar view of Task data, consumed by the scan kernels.
+ */
+struct TaskColumns {
+	/** @brief Begin time of each Task. */
+	std::vector<TimeInt> begin_times;
+	/** @brief Remind time of each Task. */
+	std::vector<TimeInt> remind_times;
+	/** @brief Done flag (0 or 1) of each Task. */
+	std::vector<uint8_t> dones;
+
+	inline uint32_t size() const { return begin_times.size(); }
+};
+
+/**
+ * Extract the scanned columns from an array of Tasks.
+ * @brief Get TaskColumns from Tasks.
+ */
+TaskColumns TaskColumnsFromTasks(const std::vector<Task> &tasks);
+
+/**
+ * Get the number of 64-bit words needed by a match mask of count elements.
+ */
+inline constexpr uint32_t GetTaskScanMaskSize(uint32_t count) { return (count + 63u) >> 6u; }
+
+/**
+ * Classify a column of Tasks into TaskStatus, equivalent to calling TaskStatusFromTask() on each of them.
+ * @brief Batched TaskStatusFromTask.
+ * @param begin_times Begin time column.
+ * @param dones Done flag column (0 or 1).
+ * @param count Number of elements.
+ * @param time_int_now Current time.
+ * @param statuses Output TaskStatus array of count elements.
+ */
+void TaskStatusScan(const TimeInt *begin_times, const uint8_t *dones, uint32_t count, TimeInt time_int_now,
+                    TaskStatus *statuses);
+
+/**
+ * Compute a bit mask of the elements equal to a value.
+ * @brief Scan for time equality.
+ * @param times Time column.
+ * @param count Number of elements.
+ * @param value The time to match.
+ * @param mask Output mask of GetTaskScanMaskSize(count) words, bit i is set if times[i] == value.
+ */
+void TimeEqualScan(const TimeInt *times, uint32_t count, TimeInt value, uint64_t *mask);
+
+/**
+ * Compute a bit mask of the elements inside a time range.
+ * @brief Scan for time range.
+ * @param times Time column.
+ * @param count Number of elements.
+ * @param begin Range begin (inclusive).
+ * @param end Range end (exclusive).
+ * @param mask Output mask of GetTaskScanMaskSize(count) words, bit i is set if begin <= times[i] < end.
+ */
+void TimeRangeScan(const TimeInt *times, uint32_t count, TimeInt begin, TimeInt end, uint64_t *mask);
+
+/**
+ * Clear the bits of a mask whose Task is done.
+ * @brief Mask out done Tasks.
+ */
+void UndoneMaskScan(const uint8_t *dones, uint32_t count, uint64_t *mask);
+
+/**
+ * Invoke func(index) for every set bit in a mask.
+ * @brief Iterate over a scan mask.
+ */
+template <typename Func> inline void ForEachTaskScanMaskBit(const uint64_t *mask, uint32_t count, Func &&func) {
+	for (uint32_t w = 0, words = GetTaskScanMaskSize(count); w < words; ++w) {
+		for (uint64_t bits = mask[w]; bits; bits &= bits - 1) {
+#if defined(__GNUC__) || defined(__clang__)
+			uint32_t bit = __builtin_ctzll(bits);
+#else
+			uint32_t bit = 0;
+			while (!((bits >> bit) & 1u))
+				++bit;
+#endif
+			func((w << 6u) | bit);
+		}
+	}
+}
+
+} // namespace backend
+
+#endif
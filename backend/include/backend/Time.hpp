@@ -146,6 +146,38 @@ inline TimeInfo GetTimeInfoNow() { return ToTimeInfo(GetTimePointNow()); }
  */
 inline std::string GetTimeStrNow() { return ToTimeStr(GetTimeInfoNow()); }
 
+/**
+ * Count days since 1970/01/01 of a date in the proleptic Gregorian calendar.
+ * @brief Convert a civil date to days.
+ */
+inline constexpr int64_t DaysFromCivil(int64_t year, unsigned month, unsigned day) {
+	year -= month <= 2;
+	const int64_t era = (year >= 0 ? year : year - 399) / 400;
+	const auto yoe = unsigned(year - era * 400);
+	const unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + int64_t(doe) - 719468;
+}
+/**
+ * Get the date of days since 1970/01/01 in the proleptic Gregorian calendar, the hour and minute are 0.
+ * @brief Convert days to a civil date.
+ */
+inline constexpr TimeInfo CivilFromDays(int64_t days) {
+	days += 719468;
+	const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+	const auto doe = unsigned(days - era * 146097);
+	const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	const unsigned mp = (5 * doy + 2) / 153;
+	const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+	const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+	return {int(int64_t(yoe) + era * 400 + (m <= 2)), m, d, 0, 0};
+}
+/**
+ * @brief Get the weekday of days since 1970/01/01, 0 for Sunday.
+ */
+inline constexpr unsigned WeekdayFromDays(int64_t days) { return unsigned(((days + 4) % 7 + 7) % 7); }
+
 } // namespace backend
 
 #endif
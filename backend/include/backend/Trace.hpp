@@ -0,0 +1,69 @@
+#ifndef SCHEDULITE_TRACE_HPP
+#define SCHEDULITE_TRACE_HPP
+
+#include <atomic>
+#include <cinttypes>
+#include <string_view>
+
+namespace backend {
+
+/** @brief Whether tracing is enabled, set once at startup, read by TraceScope with a single load. */
+inline std::atomic_bool g_trace_enabled{false};
+
+/**
+ * Tracing is enabled by setting the environment variable SCHEDULITE_TRACE to an output file path. Spans are recorded
+ * into per-thread ring buffers and appended to the file in the trace-event JSON format at exit, so that a capture can
+ * be opened in chrome://tracing or Perfetto. Multiple processes may share the same file.
+ * @brief Check whether tracing is enabled.
+ */
+inline bool IsTraceEnabled() { return g_trace_enabled.load(std::memory_order_relaxed); }
+
+/**
+ * Name the calling thread in the trace.
+ * @param name Thread name.
+ */
+void SetTraceThreadName(std::string_view name);
+
+/**
+ * Append the spans recorded so far to the trace file, called automatically at exit.
+ * @brief Flush the trace buffers.
+ */
+void FlushTrace();
+
+/**
+ * Record the lifetime of the object as a trace span, does nothing if tracing is disabled.
+ * @brief Scoped trace span.
+ */
+class TraceScope {
+public:
+	/**
+	 * @param name Span name, must have static storage duration.
+	 */
+	inline explicit TraceScope(const char *name) {
+		if (IsTraceEnabled())
+			begin(name);
+	}
+	inline ~TraceScope() {
+		if (m_name)
+			end();
+	}
+	TraceScope(const TraceScope &) = delete;
+	TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+	const char *m_name{};
+	uint64_t m_begin{};
+
+	void begin(const char *name);
+	void end();
+};
+
+} // namespace backend
+
+#define SCHEDULITE_TRACE_CONCAT_IMPL(a, b) a##b
+#define SCHEDULITE_TRACE_CONCAT(a, b) SCHEDULITE_TRACE_CONCAT_IMPL(a, b)
+/** @brief Trace the enclosing scope as a span. */
+#define SCHEDULITE_TRACE_SCOPE(name) \
+	::backend::TraceScope SCHEDULITE_TRACE_CONCAT(schedulite_trace_scope_, __LINE__) { name }
+
+#endif
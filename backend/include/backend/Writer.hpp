@@ -0,0 +1,67 @@
+#ifndef SCHEDULITE_WRITER_HPP
+#define SCHEDULITE_WRITER_HPP
+
+#include <backend/Time.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <string_view>
+
+namespace backend {
+
+/**
+ * Buffered writer to a FILE, formatting numbers and times in place without allocations.
+ * @brief Buffered FILE writer.
+ */
+class Writer {
+public:
+	explicit Writer(std::FILE *file = stdout) : m_file{file} {}
+	~Writer() { Flush(); }
+	Writer(const Writer &) = delete;
+	Writer &operator=(const Writer &) = delete;
+
+	inline void Put(char c) {
+		if (m_size == kBufferSize)
+			Flush();
+		m_buffer[m_size++] = c;
+	}
+	inline void Write(std::string_view str) {
+		if (str.size() > kBufferSize - m_size) {
+			Flush();
+			if (str.size() > kBufferSize) {
+				std::fwrite(str.data(), 1, str.size(), m_file);
+				return;
+			}
+		}
+		std::copy(str.begin(), str.end(), m_buffer.data() + m_size);
+		m_size += str.size();
+	}
+	void WriteUInt(uint32_t n);
+	/**
+	 * Write a TimeInt as "YYYY/MM/DD hh:mm".
+	 */
+	void WriteTime(TimeInt time_int);
+	void Flush();
+
+private:
+	static constexpr std::size_t kBufferSize = 1u << 16u;
+
+	std::FILE *m_file;
+	std::array<char, kBufferSize> m_buffer;
+	std::size_t m_size{};
+
+	// The TimeInfos of the last written hours, reused by the times in the same hour. Two of them, as begin and remind
+	// times alternate between nearby hours
+	struct TimeCache {
+		bool valid{false};
+		TimeInt base{};
+		TimeInfo info{};
+	};
+	std::array<TimeCache, 2> m_time_caches{};
+	uint32_t m_time_cache_victim{};
+};
+
+} // namespace backend
+
+#endif
@@ -0,0 +1,135 @@
+#include <backend/Analytics.hpp>
+
+#include <backend/Trace.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace backend {
+
+namespace {
+// Histories below this size are not worth a thread
+constexpr uint32_t kMinChunkSize = 1u << 16u;
+constexpr uint32_t kChunksPerThread = 4;
+constexpr uint32_t kTypeCount = GetTaskTypeStrings().size();
+
+template <typename Func> void parallel_for(uint32_t count, uint32_t thread_count, Func &&func) {
+	std::atomic_uint32_t next{0};
+	const auto work = [&next, count, &func]() {
+		for (uint32_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;)
+			func(i);
+	};
+	std::vector<std::thread> threads;
+	for (uint32_t t = 1; t < std::min(thread_count, count); ++t)
+		threads.emplace_back([&work]() {
+			SetTraceThreadName("Analytics worker");
+			work();
+		});
+	work();
+	for (auto &thread : threads)
+		thread.join();
+}
+
+void analyze_range(const TaskReportColumns &columns, uint32_t first, uint32_t last, TimeInt now, TaskReport *p_report) {
+	const TimeInt *begin_times = columns.begin_times.data(), *end_times = columns.end_times.data(),
+	              *done_times = columns.done_times.data();
+	const uint8_t *types = columns.types.data(), *priorities = columns.priorities.data(), *dones = columns.dones.data();
+	uint32_t type_counts[kTypeCount]{}, type_done_counts[kTypeCount]{};
+	uint32_t on_time = 0, late = 0, done_time_unknown = 0, backlog = 0, backlog_max_age = 0;
+	uint64_t backlog_age_sum = 0;
+	for (uint32_t i = first; i < last; ++i) {
+		uint32_t done = dones[i], timed = done & uint32_t(done_times[i] != 0),
+		         in_time = uint32_t(done_times[i] <= end_times[i]);
+		on_time += timed & in_time;
+		late += timed & (in_time ^ 1u);
+		done_time_unknown += done ^ timed;
+
+		uint32_t overdue = (done ^ 1u) & uint32_t(priorities[i] == (uint8_t)TaskPriority::kHigh) &
+		                   uint32_t(begin_times[i] <= now),
+		         age = overdue * (now - begin_times[i]);
+		backlog += overdue;
+		backlog_age_sum += age;
+		backlog_max_age = std::max(backlog_max_age, age);
+
+		for (uint32_t type = 0; type < kTypeCount; ++type) {
+			uint32_t match = uint32_t(types[i] == type);
+			type_counts[type] += match;
+			type_done_counts[type] += match & done;
+		}
+	}
+	for (uint32_t type = 0; type < kTypeCount; ++type) {
+		p_report->type_counts[type] += type_counts[type];
+		p_report->type_done_counts[type] += type_done_counts[type];
+	}
+	p_report->on_time += on_time;
+	p_report->late += late;
+	p_report->done_time_unknown += done_time_unknown;
+	p_report->backlog += backlog;
+	p_report->backlog_age_sum += backlog_age_sum;
+	p_report->backlog_max_age = std::max(p_report->backlog_max_age, backlog_max_age);
+}
+} // namespace
+
+TaskReportColumns TaskReportColumnsFromTasks(const std::vector<Task> &tasks) {
+	SCHEDULITE_TRACE_SCOPE("TaskReportColumnsFromTasks");
+	TaskReportColumns columns;
+	columns.begin_times.reserve(tasks.size());
+	columns.end_times.reserve(tasks.size());
+	columns.done_times.reserve(tasks.size());
+	columns.types.reserve(tasks.size());
+	columns.priorities.reserve(tasks.size());
+	columns.dones.reserve(tasks.size());
+	for (const auto &task : tasks) {
+		columns.begin_times.push_back(task.property.begin_time);
+		columns.end_times.push_back(TaskEndTime(task.property));
+		columns.done_times.push_back(task.property.done_time);
+		columns.types.push_back((uint8_t)task.property.type);
+		columns.priorities.push_back((uint8_t)task.property.priority);
+		columns.dones.push_back(task.property.done);
+	}
+	return columns;
+}
+
+TaskReport AnalyzeTasks(const TaskReportColumns &columns, const TaskReportOptions &options) {
+	SCHEDULITE_TRACE_SCOPE("AnalyzeTasks");
+	TaskReport report{};
+	// The Tasks are in begin time order, so those in the range are contiguous
+	const auto &begin_times = columns.begin_times;
+	auto first = uint32_t(std::lower_bound(begin_times.begin(), begin_times.end(), options.since) -
+	                      begin_times.begin()),
+	     last = uint32_t(std::lower_bound(begin_times.begin() + first, begin_times.end(), options.until) -
+	                     begin_times.begin());
+	if (first >= last)
+		return report;
+
+	uint32_t thread_count =
+	    options.thread_count ? options.thread_count : std::max(std::thread::hardware_concurrency(), 1u);
+	auto chunk_count = std::clamp((last - first) / kMinChunkSize, 1u, thread_count * kChunksPerThread);
+	if (chunk_count == 1) {
+		analyze_range(columns, first, last, options.now, &report);
+		return report;
+	}
+	std::vector<TaskReport> reports(chunk_count);
+	parallel_for(chunk_count, thread_count, [&](uint32_t i) {
+		SCHEDULITE_TRACE_SCOPE("AnalyzeTasks chunk");
+		uint64_t count = last - first;
+		analyze_range(columns, first + uint32_t(count * i / chunk_count),
+		              first + uint32_t(count * (i + 1) / chunk_count), options.now, &reports[i]);
+	});
+	for (const TaskReport &chunk_report : reports) {
+		for (uint32_t type = 0; type < kTypeCount; ++type) {
+			report.type_counts[type] += chunk_report.type_counts[type];
+			report.type_done_counts[type] += chunk_report.type_done_counts[type];
+		}
+		report.on_time += chunk_report.on_time;
+		report.late += chunk_report.late;
+		report.done_time_unknown += chunk_report.done_time_unknown;
+		report.backlog += chunk_report.backlog;
+		report.backlog_age_sum += chunk_report.backlog_age_sum;
+		report.backlog_max_age = std::max(report.backlog_max_age, chunk_report.backlog_max_age);
+	}
+	return report;
+}
+
+} // namespace backend
@@ -0,0 +1,111 @@
+#include <backend/Archive.hpp>
+
+#include <backend/Compression.hpp>
+#include <backend/Encryption.hpp>
+#include <backend/Schedule.hpp>
+#include <backend/Trace.hpp>
+
+#include <algorithm>
+
+#include <ghc/filesystem.hpp>
+#include <nowide/fstream.hpp>
+
+namespace backend {
+
+Error TaskArchive::Append(const std::string &file_path, std::string_view key, const std::vector<Task> &tasks,
+                          uint64_t *p_previous_size) {
+	SCHEDULITE_TRACE_SCOPE("TaskArchive::Append");
+	std::string encrypted = Encrypt(Compress(Schedule::StrFromTasks(tasks)), key), block;
+	block.reserve(4 + encrypted.size());
+	for (uint32_t i = 0, size = encrypted.size(); i < 4; ++i)
+		block += char(size >> (i * 8u));
+	block += encrypted;
+	nowide::ofstream out{file_path, std::ios::binary | std::ios::app};
+	if (!out.is_open())
+		return Error::kFileIOError;
+	out.seekp(0, std::ios::end);
+	*p_previous_size = (uint64_t)out.tellp();
+	out.write(block.data(), (std::streamsize)block.size());
+	out.close();
+	return out.fail() ? Error::kFileIOError : Error::kSuccess;
+}
+
+Error TaskArchive::Truncate(const std::string &file_path, uint64_t size) {
+	std::error_code error_code;
+	ghc::filesystem::resize_file(file_path, size, error_code);
+	return error_code ? Error::kFileIOError : Error::kSuccess;
+}
+
+Error TaskArchive::Load(const std::string &file_path, std::string_view key) {
+	SCHEDULITE_TRACE_SCOPE("TaskArchive::Load");
+	std::error_code error_code;
+	uint64_t size =
+	    ghc::filesystem::exists(file_path, error_code) ? ghc::filesystem::file_size(file_path, error_code) : 0;
+	if (error_code)
+		return Error::kFileIOError;
+	if (size < m_loaded_size)
+		*this = TaskArchive{}; // Replaced, load it again
+	if (size == m_loaded_size)
+		return Error::kSuccess;
+
+	std::string data(size - m_loaded_size, '\0');
+	{
+		nowide::ifstream in{file_path, std::ios::binary};
+		if (!in.is_open())
+			return Error::kFileIOError;
+		in.seekg((std::streamoff)m_loaded_size);
+		in.read(data.data(), (std::streamsize)data.size());
+		data.resize(in.gcount());
+	}
+	auto old_size = m_tasks.size();
+	std::string_view view = data;
+	while (view.size() >= 4) {
+		uint32_t length = 0;
+		for (uint32_t i = 0; i < 4; ++i)
+			length |= uint32_t((uint8_t)view[i]) << (i * 8u);
+		if (length > view.size() - 4)
+			break;
+		std::vector<Task> tasks = Schedule::TasksFromStr(Decompress(Decrypt(view.substr(4, length), key)));
+		for (Task &task : tasks) {
+			m_task_ids.push_back(task.id);
+			task.id = m_task_ids.size();
+			m_tasks.push_back(std::move(task));
+		}
+		m_loaded_size += 4 + length;
+		view = view.substr(4 + length);
+	}
+	if (m_tasks.size() != old_size) {
+		std::sort(m_tasks.begin() + (std::ptrdiff_t)old_size, m_tasks.end(), TaskKeyLess);
+		std::inplace_merge(m_tasks.begin(), m_tasks.begin() + (std::ptrdiff_t)old_size, m_tasks.end(), TaskKeyLess);
+		m_search_outdated = true;
+	}
+	return Error::kSuccess;
+}
+
+Task TaskArchive::get_task(std::size_t index) const {
+	Task task = m_tasks[index];
+	task.id = m_task_ids[task.id - 1];
+	return task;
+}
+
+std::vector<Task> TaskArchive::Query(const TaskQuery &query) const {
+	auto [first, last] = Schedule::QueryTaskRange(m_tasks, query);
+	std::vector<Task> tasks;
+	tasks.reserve(last - first);
+	for (std::size_t i = first; i < last; ++i)
+		tasks.push_back(get_task(i));
+	return tasks;
+}
+
+std::vector<Task> TaskArchive::Search(std::string_view query, uint32_t limit) {
+	if (m_search_outdated) {
+		m_search_index.Update(m_tasks);
+		m_search_outdated = false;
+	}
+	std::vector<Task> matched;
+	for (const auto &result : m_search_index.Search(query, limit))
+		matched.push_back(get_task(result.index));
+	return matched;
+}
+
+} // namespace backend
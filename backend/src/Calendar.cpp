@@ -0,0 +1,190 @@
+#include <backend/Calendar.hpp>
+
+#include <backend/Recurrence.hpp>
+#include <backend/Trace.hpp>
+
+#include <algorithm>
+#include <limits>
+
+namespace backend {
+
+namespace {
+inline TimeInt clamp_time(int64_t time) {
+	return (TimeInt)std::clamp<int64_t>(time, 0, std::numeric_limits<TimeInt>::max());
+}
+inline int64_t day_of(TimeInt time) {
+	TimeInfo info = ToTimeInfo(time);
+	return DaysFromCivil(info.year, info.month, info.day);
+}
+// The beginning of a local day, converted without daylight saving time
+inline int64_t day_begin_time(int64_t day) { return ToTimePoint(CivilFromDays(day)).time_since_epoch().count(); }
+// The first minute of a local day, which is within two hours of its beginning without daylight saving time
+inline TimeInt day_first_minute(int64_t day) {
+	int64_t low = day_begin_time(day) - 120, high = low + 240;
+	while (low < high) {
+		int64_t mid = (low + high) >> 1;
+		if (day_of(clamp_time(mid)) < day)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return clamp_time(low);
+}
+} // namespace
+
+void TaskCalendarIndex::add_entry(const Entry &entry, int32_t delta, std::size_t *p_first_changed) {
+	auto it = std::lower_bound(m_days.begin(), m_days.end(), entry.day);
+	auto pos = std::size_t(it - m_days.begin());
+	if (it == m_days.end() || *it != entry.day) {
+		m_days.insert(it, entry.day);
+		m_day_counts.insert(m_day_counts.begin() + (std::ptrdiff_t)pos, Counts{});
+	}
+	m_day_counts[pos][(uint32_t)entry.type + (entry.done ? kTypeCount : 0)] += (uint32_t)delta;
+	*p_first_changed = std::min(*p_first_changed, pos);
+}
+
+void TaskCalendarIndex::Update(const std::vector<Task> &tasks) {
+	SCHEDULITE_TRACE_SCOPE("TaskCalendarIndex::Update");
+	++m_generation;
+	m_recurring.clear();
+	std::size_t first_changed = m_days.size();
+	for (const Task &task : tasks) {
+		const TaskProperty &property = task.property;
+		if (property.recurrence.IsRecurring()) {
+			m_recurring.push_back(property);
+			continue;
+		}
+		auto [it, inserted] = m_entries.try_emplace(task.id);
+		Entry &entry = it->second;
+		entry.generation = m_generation;
+		bool moved = inserted || entry.begin_time != property.begin_time;
+		if (!inserted) {
+			if (!moved && entry.type == property.type && entry.done == property.done)
+				continue;
+			add_entry(entry, -1, &first_changed);
+		}
+		// Only the Tasks moved are converted to local days
+		if (moved)
+			entry.day = day_of(property.begin_time);
+		entry.begin_time = property.begin_time;
+		entry.type = property.type;
+		entry.done = property.done;
+		add_entry(entry, 1, &first_changed);
+	}
+	for (auto it = m_entries.begin(); it != m_entries.end();) {
+		if (it->second.generation == m_generation) {
+			++it;
+			continue;
+		}
+		add_entry(it->second, -1, &first_changed);
+		it = m_entries.erase(it);
+	}
+
+	// Days left without Tasks are dropped, the sums after the first day changed are recomputed
+	std::size_t kept = first_changed;
+	for (std::size_t i = first_changed; i < m_days.size(); ++i) {
+		if (std::all_of(m_day_counts[i].begin(), m_day_counts[i].end(), [](uint32_t count) { return count == 0; }))
+			continue;
+		m_days[kept] = m_days[i];
+		m_day_counts[kept++] = m_day_counts[i];
+	}
+	m_days.resize(kept);
+	m_day_counts.resize(kept);
+	m_prefix_counts.resize(kept + 1);
+	for (std::size_t i = first_changed; i < kept; ++i)
+		for (uint32_t j = 0; j < kTypeCount * 2; ++j)
+			m_prefix_counts[i + 1][j] = m_prefix_counts[i][j] + m_day_counts[i][j];
+}
+
+TaskCalendarIndex::Counts TaskCalendarIndex::sum_counts(int64_t first_day, int64_t last_day) const {
+	Counts counts{};
+	if (first_day >= last_day)
+		return counts;
+	auto first = std::size_t(std::lower_bound(m_days.begin(), m_days.end(), first_day) - m_days.begin());
+	auto last = std::size_t(std::lower_bound(m_days.begin() + (std::ptrdiff_t)first, m_days.end(), last_day) -
+	                        m_days.begin());
+	for (uint32_t j = 0; j < kTypeCount * 2; ++j)
+		counts[j] = m_prefix_counts[last][j] - m_prefix_counts[first][j];
+	return counts;
+}
+
+void TaskCalendarIndex::add_counts(const Counts &counts, int64_t day, int64_t today, const TypeCounts &begun_today,
+                                   TaskCounts *p_counts) {
+	auto &pending = (*p_counts)[(uint32_t)TaskStatus::kPending], &ongoing = (*p_counts)[(uint32_t)TaskStatus::kOngoing],
+	     &done = (*p_counts)[(uint32_t)TaskStatus::kDone];
+	for (uint32_t type = 0; type < kTypeCount; ++type) {
+		uint32_t undone = counts[type], begun = day < today ? undone : (day == today ? begun_today[type] : 0);
+		ongoing[type] += begun;
+		pending[type] += undone - begun;
+		done[type] += counts[kTypeCount + type];
+	}
+}
+
+TaskCalendarIndex::TypeCounts TaskCalendarIndex::get_begun_today(const std::vector<Task> &tasks, int64_t today,
+                                                                 TimeInt now) const {
+	TypeCounts begun{};
+	// The Tasks are in begin time order, so those of the day that have begun are right before now
+	auto last = std::upper_bound(tasks.begin(), tasks.end(), now,
+	                             [](TimeInt time, const Task &task) { return time < task.property.begin_time; });
+	auto first = std::lower_bound(tasks.begin(), last, day_first_minute(today),
+	                              [](const Task &task, TimeInt time) { return task.property.begin_time < time; });
+	for (auto it = first; it != last; ++it)
+		if (!it->property.done && !it->property.recurrence.IsRecurring())
+			++begun[(uint32_t)it->property.type];
+	return begun;
+}
+
+template <typename Visit>
+void TaskCalendarIndex::for_each_recurrence(int64_t first_day, int64_t last_day, TimeInt now, Visit &&visit) const {
+	if (m_recurring.empty() || first_day >= last_day)
+		return;
+	TimeInt since = day_first_minute(first_day), until = day_first_minute(last_day);
+	for (const TaskProperty &property : m_recurring)
+		for (TimeInt time : GetOccurrenceTimes(property, since, until)) {
+			int64_t day = std::clamp(day_of(time), first_day, last_day - 1);
+			visit(day, property.done ? TaskStatus::kDone : (time > now ? TaskStatus::kPending : TaskStatus::kOngoing),
+			      property.type);
+		}
+}
+
+std::vector<DayTaskCounts> TaskCalendarIndex::GetDayCounts(const std::vector<Task> &tasks, int64_t first_day,
+                                                           int64_t last_day, TimeInt now) const {
+	SCHEDULITE_TRACE_SCOPE("TaskCalendarIndex::GetDayCounts");
+	std::vector<DayTaskCounts> results;
+	if (first_day >= last_day)
+		return results;
+	results.resize(last_day - first_day);
+	const int64_t today = day_of(now);
+	TypeCounts begun_today = today >= first_day && today < last_day ? get_begun_today(tasks, today, now) : TypeCounts{};
+	auto pos = std::size_t(std::lower_bound(m_days.begin(), m_days.end(), first_day) - m_days.begin());
+	for (int64_t day = first_day; day < last_day; ++day) {
+		DayTaskCounts &result = results[day - first_day];
+		result.day = day;
+		if (pos < m_days.size() && m_days[pos] == day)
+			add_counts(m_day_counts[pos++], day, today, begun_today, &result.counts);
+	}
+	for_each_recurrence(first_day, last_day, now, [&results, first_day](int64_t day, TaskStatus status, TaskType type) {
+		++results[day - first_day].counts[(uint32_t)status][(uint32_t)type];
+	});
+	return results;
+}
+
+TaskCounts TaskCalendarIndex::GetRangeCounts(const std::vector<Task> &tasks, int64_t first_day, int64_t last_day,
+                                             TimeInt now) const {
+	SCHEDULITE_TRACE_SCOPE("TaskCalendarIndex::GetRangeCounts");
+	TaskCounts counts{};
+	if (first_day >= last_day)
+		return counts;
+	// The days before the current one, the current day and the days after are summed apart
+	const int64_t today = day_of(now), split = std::clamp(today, first_day, last_day);
+	add_counts(sum_counts(first_day, split), today - 1, today, {}, &counts);
+	if (today >= first_day && today < last_day)
+		add_counts(sum_counts(today, today + 1), today, today, get_begun_today(tasks, today, now), &counts);
+	add_counts(sum_counts(std::clamp(today + 1, first_day, last_day), last_day), today + 1, today, {}, &counts);
+	for_each_recurrence(first_day, last_day, now, [&counts](int64_t, TaskStatus status, TaskType type) {
+		++counts[(uint32_t)status][(uint32_t)type];
+	});
+	return counts;
+}
+
+} // namespace backend
@@ -0,0 +1,92 @@
+#include <backend/Compression.hpp>
+
+#include <cinttypes>
+#include <cstring>
+#include <vector>
+
+namespace backend {
+namespace {
+constexpr uint32_t kMinMatchLength = 4, kHashBits = 14, kNoPosition = UINT32_MAX;
+
+inline uint32_t hash4(const char *data) {
+	uint32_t value;
+	std::memcpy(&value, data, 4);
+	return (value * 2654435761u) >> (32 - kHashBits);
+}
+inline void str_append_varint(std::string *str, uint64_t value) {
+	for (; value >= 0x80u; value >>= 7u)
+		(*str) += char(value | 0x80u);
+	(*str) += char(value);
+}
+inline bool varint_from_str(std::string_view str, std::size_t *p_pos, uint64_t *p_value) {
+	*p_value = 0;
+	for (uint32_t shift = 0; *p_pos < str.size() && shift < 64; shift += 7) {
+		auto byte = (uint8_t)str[(*p_pos)++];
+		*p_value |= uint64_t(byte & 0x7fu) << shift;
+		if (!(byte & 0x80u))
+			return true;
+	}
+	return false;
+}
+} // namespace
+
+// [u32 raw size], then repeated [varint literal length][literals][varint match length - 4][varint offset], the last
+// sequence has no match
+std::string Compress(std::string_view raw) {
+	std::string compressed;
+	compressed.reserve(raw.size() / 2 + 16);
+	for (uint32_t i = 0, size = raw.size(); i < 4; ++i)
+		compressed += char(size >> (i * 8u));
+	std::vector<uint32_t> last_positions(1u << kHashBits, kNoPosition);
+	std::size_t anchor = 0, pos = 0;
+	while (pos + kMinMatchLength <= raw.size()) {
+		uint32_t &last = last_positions[hash4(raw.data() + pos)], candidate = last;
+		last = pos;
+		if (candidate == kNoPosition || std::memcmp(raw.data() + candidate, raw.data() + pos, kMinMatchLength) != 0) {
+			++pos;
+			continue;
+		}
+		std::size_t length = kMinMatchLength;
+		while (pos + length < raw.size() && raw[candidate + length] == raw[pos + length])
+			++length;
+		str_append_varint(&compressed, pos - anchor);
+		compressed.append(raw.substr(anchor, pos - anchor));
+		str_append_varint(&compressed, length - kMinMatchLength);
+		str_append_varint(&compressed, pos - candidate);
+		pos += length;
+		anchor = pos;
+	}
+	str_append_varint(&compressed, raw.size() - anchor);
+	compressed.append(raw.substr(anchor));
+	return compressed;
+}
+
+std::string Decompress(std::string_view compressed) {
+	if (compressed.size() < 4)
+		return {};
+	uint32_t raw_size = 0;
+	for (uint32_t i = 0; i < 4; ++i)
+		raw_size |= uint32_t((uint8_t)compressed[i]) << (i * 8u);
+	std::string raw;
+	raw.reserve(raw_size);
+	std::size_t pos = 4;
+	while (true) {
+		uint64_t literal_length, match_length, offset;
+		if (!varint_from_str(compressed, &pos, &literal_length) || literal_length > compressed.size() - pos ||
+		    literal_length > raw_size - raw.size())
+			return {};
+		raw.append(compressed.substr(pos, literal_length));
+		pos += literal_length;
+		if (pos == compressed.size())
+			break;
+		if (!varint_from_str(compressed, &pos, &match_length) || !varint_from_str(compressed, &pos, &offset) ||
+		    offset == 0 || offset > raw.size() || raw_size - raw.size() < kMinMatchLength ||
+		    match_length > raw_size - raw.size() - kMinMatchLength)
+			return {};
+		// Byte by byte, as the match may overlap the bytes it produces
+		for (std::size_t i = 0, from = raw.size() - offset; i < match_length + kMinMatchLength; ++i)
+			raw += raw[from + i];
+	}
+	return raw.size() == raw_size ? raw : std::string{};
+}
+} // namespace backend
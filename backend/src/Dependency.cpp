@@ -0,0 +1,335 @@
+#include <backend/Dependency.hpp>
+
+#include <backend/Trace.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+namespace backend {
+
+namespace {
+inline TimeInt clamp_time(uint64_t time) {
+	return (TimeInt)std::min<uint64_t>(time, std::numeric_limits<TimeInt>::max());
+}
+inline void erase_value(std::vector<uint32_t> *p_values, uint32_t value) {
+	p_values->erase(std::find(p_values->begin(), p_values->end(), value));
+}
+} // namespace
+
+uint32_t TaskDependencyGraph::add_node(const Task &task, uint32_t index) {
+	uint32_t node;
+	if (m_free_nodes.empty()) {
+		node = (uint32_t)m_nodes.size();
+		m_nodes.emplace_back();
+		m_marks.push_back(0);
+	} else {
+		node = m_free_nodes.back();
+		m_free_nodes.pop_back();
+	}
+	// A new node has no dependents yet, so it can come last
+	Node &n = m_nodes[node];
+	n.id = task.id;
+	n.index = index;
+	n.generation = m_generation;
+	n.position = (uint32_t)m_order.size();
+	n.alive = true;
+	n.done = task.property.done;
+	n.begin_time = task.property.begin_time;
+	n.duration = task.property.duration;
+	n.dependency_ids = task.property.dependencies;
+	n.earliest_begin = n.latest_begin = n.begin_time;
+	m_order.push_back(node);
+	m_id_nodes[task.id] = node;
+	++m_alive;
+	m_forward_seeds.push_back(node);
+	return node;
+}
+
+void TaskDependencyGraph::remove_node(uint32_t node) {
+	Node &n = m_nodes[node];
+	while (!n.dependencies.empty())
+		remove_edge(n.dependencies.back(), node);
+	while (!n.dependents.empty())
+		remove_edge(node, n.dependents.back());
+	n.alive = false;
+	n.dependency_ids.clear();
+	m_order[n.position] = kNoNode;
+	m_free_nodes.push_back(node);
+	--m_alive;
+}
+
+void TaskDependencyGraph::remove_edge(uint32_t from, uint32_t to) {
+	erase_value(&m_nodes[from].dependents, to);
+	erase_value(&m_nodes[to].dependencies, from);
+	m_backward_seeds.push_back(from);
+	m_forward_seeds.push_back(to);
+}
+
+bool TaskDependencyGraph::add_edge(uint32_t from, uint32_t to) {
+	if (from == to)
+		return false;
+	const uint32_t lower = m_nodes[to].position, upper = m_nodes[from].position;
+	if (upper > lower) {
+		// Reorder the nodes between: those reached from `to` go after those reaching `from`
+		++m_mark;
+		std::vector<uint32_t> forward, backward, stack{to};
+		m_marks[to] = m_mark;
+		while (!stack.empty()) {
+			uint32_t node = stack.back();
+			stack.pop_back();
+			forward.push_back(node);
+			for (uint32_t dependent : m_nodes[node].dependents) {
+				if (dependent == from)
+					return false;
+				if (m_marks[dependent] != m_mark && m_nodes[dependent].position < upper) {
+					m_marks[dependent] = m_mark;
+					stack.push_back(dependent);
+				}
+			}
+		}
+		stack.assign(1, from);
+		m_marks[from] = m_mark;
+		while (!stack.empty()) {
+			uint32_t node = stack.back();
+			stack.pop_back();
+			backward.push_back(node);
+			for (uint32_t dependency : m_nodes[node].dependencies)
+				if (m_marks[dependency] != m_mark && m_nodes[dependency].position > lower) {
+					m_marks[dependency] = m_mark;
+					stack.push_back(dependency);
+				}
+		}
+		const auto position_less = [this](uint32_t l, uint32_t r) {
+			return m_nodes[l].position < m_nodes[r].position;
+		};
+		std::sort(forward.begin(), forward.end(), position_less);
+		std::sort(backward.begin(), backward.end(), position_less);
+		std::vector<uint32_t> positions;
+		positions.reserve(forward.size() + backward.size());
+		for (uint32_t node : backward)
+			positions.push_back(m_nodes[node].position);
+		for (uint32_t node : forward)
+			positions.push_back(m_nodes[node].position);
+		std::sort(positions.begin(), positions.end());
+		auto position_it = positions.begin();
+		for (const auto *p_nodes : {&backward, &forward})
+			for (uint32_t node : *p_nodes) {
+				m_nodes[node].position = *position_it++;
+				m_order[m_nodes[node].position] = node;
+			}
+	}
+	m_nodes[from].dependents.push_back(to);
+	m_nodes[to].dependencies.push_back(from);
+	m_backward_seeds.push_back(from);
+	m_forward_seeds.push_back(to);
+	return true;
+}
+
+void TaskDependencyGraph::update_edges(uint32_t node) {
+	std::vector<uint32_t> dependencies;
+	for (uint32_t id : m_nodes[node].dependency_ids) {
+		auto it = m_id_nodes.find(id);
+		if (it != m_id_nodes.end())
+			dependencies.push_back(it->second);
+	}
+	std::sort(dependencies.begin(), dependencies.end());
+	std::vector<uint32_t> kept = m_nodes[node].dependencies;
+	std::sort(kept.begin(), kept.end());
+	for (uint32_t dependency : kept)
+		if (!std::binary_search(dependencies.begin(), dependencies.end(), dependency))
+			remove_edge(dependency, node);
+	for (uint32_t dependency : dependencies)
+		if (!std::binary_search(kept.begin(), kept.end(), dependency))
+			add_edge(dependency, node);
+}
+
+void TaskDependencyGraph::compact_order() {
+	SCHEDULITE_TRACE_SCOPE("TaskDependencyGraph::compact_order");
+	m_order.erase(std::remove(m_order.begin(), m_order.end(), kNoNode), m_order.end());
+	for (uint32_t position = 0; position < (uint32_t)m_order.size(); ++position)
+		m_nodes[m_order[position]].position = position;
+}
+
+void TaskDependencyGraph::propagate() {
+	SCHEDULITE_TRACE_SCOPE("TaskDependencyGraph::propagate");
+	using Entry = std::pair<uint32_t, uint32_t>; // position, node
+	++m_mark;
+	const auto push = [this](auto *p_queue, uint32_t node) {
+		if (m_nodes[node].alive && m_marks[node] != m_mark) {
+			m_marks[node] = m_mark;
+			p_queue->emplace(m_nodes[node].position, node);
+		}
+	};
+
+	// Earliest begin times in topological order, a node is only queued by nodes before it, so it is computed once.
+	// The seeds pass their changes on even if their own times are kept
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<>> forward;
+	for (uint32_t node : m_forward_seeds) {
+		if (!m_nodes[node].alive)
+			continue;
+		push(&forward, node);
+		for (uint32_t dependent : m_nodes[node].dependents)
+			push(&forward, dependent);
+		m_backward_seeds.push_back(node);
+		m_backward_seeds.insert(m_backward_seeds.end(), m_nodes[node].dependencies.begin(),
+		                        m_nodes[node].dependencies.end());
+	}
+	m_forward_seeds.clear();
+	while (!forward.empty()) {
+		uint32_t node = forward.top().second;
+		forward.pop();
+		Node &n = m_nodes[node];
+		uint64_t earliest_begin = n.begin_time;
+		for (uint32_t dependency : n.dependencies) {
+			const Node &d = m_nodes[dependency];
+			if (!d.done)
+				earliest_begin = std::max(earliest_begin, d.earliest_begin + d.duration);
+		}
+		if (earliest_begin == n.earliest_begin)
+			continue;
+		n.earliest_begin = earliest_begin;
+		m_backward_seeds.push_back(node);
+		for (uint32_t dependent : n.dependents)
+			push(&forward, dependent);
+	}
+
+	// Latest begin times in reverse topological order
+	++m_mark;
+	std::priority_queue<Entry> backward;
+	for (uint32_t node : m_backward_seeds)
+		push(&backward, node);
+	m_backward_seeds.clear();
+	while (!backward.empty()) {
+		uint32_t node = backward.top().second;
+		backward.pop();
+		Node &n = m_nodes[node];
+		uint64_t latest_end = n.earliest_begin + n.duration;
+		bool has_dependent = false;
+		for (uint32_t dependent : n.dependents) {
+			const Node &d = m_nodes[dependent];
+			if (!d.done) {
+				latest_end = has_dependent ? std::min(latest_end, d.latest_begin) : d.latest_begin;
+				has_dependent = true;
+			}
+		}
+		uint64_t latest_begin = n.done ? n.earliest_begin : latest_end - n.duration;
+		if (latest_begin == n.latest_begin)
+			continue;
+		n.latest_begin = latest_begin;
+		for (uint32_t dependency : n.dependencies)
+			push(&backward, dependency);
+	}
+}
+
+void TaskDependencyGraph::Update(const std::vector<Task> &tasks) {
+	SCHEDULITE_TRACE_SCOPE("TaskDependencyGraph::Update");
+	++m_generation;
+	std::vector<uint32_t> index_nodes(tasks.size()), edge_nodes;
+	for (uint32_t index = 0; index < (uint32_t)tasks.size(); ++index) {
+		const Task &task = tasks[index];
+		// Most Tasks keep their positions, which saves the lookup by ID
+		uint32_t node = index < m_index_nodes.size() ? m_index_nodes[index] : kNoNode;
+		if (node == kNoNode || !m_nodes[node].alive || m_nodes[node].id != task.id) {
+			auto it = m_id_nodes.find(task.id);
+			node = it == m_id_nodes.end() ? kNoNode : it->second;
+		}
+		index_nodes[index] = node;
+		if (node == kNoNode) {
+			index_nodes[index] = add_node(task, index);
+			if (!task.property.dependencies.empty())
+				edge_nodes.push_back(index_nodes[index]);
+			continue;
+		}
+
+		Node &n = m_nodes[node];
+		n.index = index;
+		n.generation = m_generation;
+		const TaskProperty &property = task.property;
+		if (n.done != property.done || n.begin_time != property.begin_time || n.duration != property.duration) {
+			n.done = property.done;
+			n.begin_time = property.begin_time;
+			n.duration = property.duration;
+			m_forward_seeds.push_back(node);
+		}
+		if (n.dependency_ids != property.dependencies) {
+			n.dependency_ids = property.dependencies;
+			edge_nodes.push_back(node);
+		}
+	}
+	// Erased, the alive nodes not seen in this generation
+	if (m_alive > tasks.size()) {
+		std::vector<uint32_t> erased;
+		for (auto it = m_id_nodes.begin(); it != m_id_nodes.end();) {
+			if (m_nodes[it->second].generation != m_generation) {
+				erased.push_back(it->second);
+				it = m_id_nodes.erase(it);
+			} else
+				++it;
+		}
+		for (uint32_t node : erased)
+			remove_node(node);
+	}
+	for (uint32_t node : edge_nodes)
+		update_edges(node);
+	if (m_order.size() > 64 && m_alive < m_order.size() / 2)
+		compact_order();
+	m_index_nodes = std::move(index_nodes);
+	propagate();
+}
+
+DependencyResult TaskDependencyGraph::make_result(uint32_t node) const {
+	const Node &n = m_nodes[node];
+	return {n.index, clamp_time(n.earliest_begin), clamp_time(n.latest_begin)};
+}
+
+std::vector<DependencyResult> TaskDependencyGraph::GetBlocked() const {
+	std::vector<DependencyResult> results;
+	for (uint32_t node : m_order) {
+		if (node == kNoNode || m_nodes[node].done)
+			continue;
+		const auto &dependencies = m_nodes[node].dependencies;
+		if (std::any_of(dependencies.begin(), dependencies.end(),
+		                [this](uint32_t dependency) { return !m_nodes[dependency].done; }))
+			results.push_back(make_result(node));
+	}
+	return results;
+}
+
+std::vector<DependencyResult> TaskDependencyGraph::GetCriticalPath() const {
+	// The latest ending chain ends with a blocked Task
+	const auto latest_dependency = [this](uint32_t node) {
+		uint32_t latest = kNoNode;
+		for (uint32_t dependency : m_nodes[node].dependencies) {
+			const Node &d = m_nodes[dependency];
+			if (!d.done && (latest == kNoNode || d.earliest_begin + d.duration >
+			                                         m_nodes[latest].earliest_begin + m_nodes[latest].duration))
+				latest = dependency;
+		}
+		return latest;
+	};
+	uint32_t last = kNoNode;
+	for (uint32_t node : m_order) {
+		if (node == kNoNode || m_nodes[node].done || latest_dependency(node) == kNoNode)
+			continue;
+		const Node &n = m_nodes[node];
+		if (last == kNoNode ||
+		    n.earliest_begin + n.duration > m_nodes[last].earliest_begin + m_nodes[last].duration)
+			last = node;
+	}
+
+	std::vector<DependencyResult> results;
+	for (uint32_t node = last; node != kNoNode;) {
+		results.push_back(make_result(node));
+		uint32_t dependency = latest_dependency(node);
+		// The chain stops at a Task beginning later than its dependencies end
+		if (dependency == kNoNode ||
+		    m_nodes[dependency].earliest_begin + m_nodes[dependency].duration < m_nodes[node].earliest_begin)
+			break;
+		node = dependency;
+	}
+	std::reverse(results.begin(), results.end());
+	return results;
+}
+
+} // namespace backend
@@ -0,0 +1,1241 @@
+#include <backend/Exchange.hpp>
+
+#include <backend/Trace.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <iterator>
+#include <limits>
+#include <thread>
+
+namespace backend {
+
+namespace {
+constexpr const char *kTaskColumns[] = {"id",   "name",   "begin_time", "remind_time", "priority",
+                                        "type", "done",   "status",     "repeat",      "duration"};
+enum class Column {
+	kId,
+	kName,
+	kBeginTime,
+	kRemindTime,
+	kPriority,
+	kType,
+	kDone,
+	kStatus,
+	kRepeat,
+	kDuration,
+	kUnknown
+};
+
+// Inputs below this size are not worth a thread
+constexpr std::size_t kMinChunkSize = 1u << 16u;
+constexpr uint32_t kChunksPerThread = 4;
+
+inline char to_lower(char c) { return c >= 'A' && c <= 'Z' ? char(c - 'A' + 'a') : c; }
+inline bool equal_ignore_case(std::string_view l, std::string_view r) {
+	if (l.size() != r.size())
+		return false;
+	for (std::size_t i = 0; i < l.size(); ++i)
+		if (to_lower(l[i]) != to_lower(r[i]))
+			return false;
+	return true;
+}
+
+/*
+ * Export
+ */
+void write_json_str(Writer *writer, std::string_view str) {
+	static constexpr const char *kHex = "0123456789abcdef";
+	writer->Put('"');
+	for (char c : str) {
+		switch (c) {
+		case '"':
+			writer->Write("\\\"");
+			break;
+		case '\\':
+			writer->Write("\\\\");
+			break;
+		case '\n':
+			writer->Write("\\n");
+			break;
+		case '\t':
+			writer->Write("\\t");
+			break;
+		default:
+			if ((unsigned char)c < 0x20) {
+				writer->Write("\\u00");
+				writer->Put(kHex[(unsigned char)c >> 4u]);
+				writer->Put(kHex[(unsigned char)c & 0xfu]);
+			} else
+				writer->Put(c);
+		}
+	}
+	writer->Put('"');
+}
+// RFC 4180, quote the field only if needed
+void write_csv_str(Writer *writer, std::string_view str) {
+	if (str.find_first_of(",\"\r\n") == std::string_view::npos) {
+		writer->Write(str);
+		return;
+	}
+	writer->Put('"');
+	for (char c : str) {
+		if (c == '"')
+			writer->Put('"');
+		writer->Put(c);
+	}
+	writer->Put('"');
+}
+// TSV has no quoting, escape as in PostgreSQL text format
+void write_tsv_str(Writer *writer, std::string_view str) {
+	for (char c : str) {
+		switch (c) {
+		case '\t':
+			writer->Write("\\t");
+			break;
+		case '\n':
+			writer->Write("\\n");
+			break;
+		case '\r':
+			writer->Write("\\r");
+			break;
+		case '\\':
+			writer->Write("\\\\");
+			break;
+		default:
+			writer->Put(c);
+		}
+	}
+}
+
+void write_task_jsonl(Writer *writer, const Task &task, TaskStatus status) {
+	writer->Write(R"({"id":)");
+	writer->WriteUInt(task.id);
+	writer->Write(R"(,"name":)");
+	write_json_str(writer, task.property.name);
+	writer->Write(R"(,"begin_time":")");
+	writer->WriteTime(task.property.begin_time);
+	writer->Write(R"(","remind_time":")");
+	writer->WriteTime(task.property.remind_time);
+	writer->Write(R"(","priority":")");
+	writer->Write(StrFromTaskPriority(task.property.priority));
+	writer->Write(R"(","type":")");
+	writer->Write(StrFromTaskType(task.property.type));
+	writer->Write(task.property.done ? R"(","done":true,"status":")" : R"(","done":false,"status":")");
+	writer->Write(StrFromTaskStatus(status));
+	writer->Put('"');
+	if (task.property.recurrence.IsRecurring()) {
+		writer->Write(R"(,"repeat":)");
+		write_json_str(writer, StrFromTaskRecurrence(task.property.recurrence, true));
+	}
+	if (task.property.duration) {
+		writer->Write(R"(,"duration":)");
+		writer->WriteUInt(task.property.duration);
+	}
+	writer->Write("}\n");
+}
+template <char kSeparator, void (*kWriteStr)(Writer *, std::string_view)>
+void write_task_separated(Writer *writer, const Task &task, TaskStatus status) {
+	writer->WriteUInt(task.id);
+	writer->Put(kSeparator);
+	kWriteStr(writer, task.property.name);
+	writer->Put(kSeparator);
+	writer->WriteTime(task.property.begin_time);
+	writer->Put(kSeparator);
+	writer->WriteTime(task.property.remind_time);
+	writer->Put(kSeparator);
+	writer->Write(StrFromTaskPriority(task.property.priority));
+	writer->Put(kSeparator);
+	writer->Write(StrFromTaskType(task.property.type));
+	writer->Put(kSeparator);
+	writer->Put(task.property.done ? '1' : '0');
+	writer->Put(kSeparator);
+	writer->Write(StrFromTaskStatus(status));
+	writer->Put(kSeparator);
+	kWriteStr(writer, StrFromTaskRecurrence(task.property.recurrence, true));
+	writer->Put(kSeparator);
+	if (task.property.duration)
+		writer->WriteUInt(task.property.duration);
+	writer->Put('\n');
+}
+template <char kSeparator> void write_task_header(Writer *writer) {
+	for (const char *column : kTaskColumns) {
+		if (column != kTaskColumns[0])
+			writer->Put(kSeparator);
+		writer->Write(column);
+	}
+	writer->Put('\n');
+}
+
+// iCalendar content lines end with CRLF and are folded at 75 octets, without breaking UTF-8 sequences
+void write_ical_line(Writer *writer, std::string_view line) {
+	constexpr std::size_t kMaxLineOctets = 75;
+	std::size_t max_octets = kMaxLineOctets;
+	while (line.size() > max_octets) {
+		std::size_t cut = max_octets;
+		while (cut > 1 && ((unsigned char)line[cut] & 0xc0u) == 0x80u)
+			--cut;
+		writer->Write(line.substr(0, cut));
+		writer->Write("\r\n ");
+		line = line.substr(cut);
+		max_octets = kMaxLineOctets - 1;
+	}
+	writer->Write(line);
+	writer->Write("\r\n");
+}
+void write_ical_text(Writer *writer, std::string_view name, std::string_view text) {
+	thread_local std::string line;
+	line = name;
+	line += ':';
+	for (char c : text) {
+		switch (c) {
+		case '\\':
+		case ';':
+		case ',':
+			line += '\\';
+			line += c;
+			break;
+		case '\n':
+			line += "\\n";
+			break;
+		case '\r':
+			break;
+		default:
+			line += c;
+		}
+	}
+	write_ical_line(writer, line);
+}
+// "YYYYMMDDThhmm00Z"
+void write_ical_utc(Writer *writer, TimeInt time_int) {
+	TimeInfo info = CivilFromDays(time_int / 1440);
+	char buf[16];
+	const auto put2 = [](char *p, unsigned n) {
+		p[0] = char('0' + n / 10 % 10);
+		p[1] = char('0' + n % 10);
+	};
+	auto year = (unsigned)info.year;
+	put2(buf, year / 100);
+	put2(buf + 2, year);
+	put2(buf + 4, info.month);
+	put2(buf + 6, info.day);
+	buf[8] = 'T';
+	put2(buf + 9, time_int % 1440 / 60);
+	put2(buf + 11, time_int % 60);
+	std::copy_n("00Z", 3, buf + 13);
+	writer->Write({buf, 16});
+}
+// RRULE with a UTC UNTIL, and EXDATE
+void write_ical_recurrence(Writer *writer, const TaskRecurrence &recurrence) {
+	TaskRecurrence rule = recurrence;
+	rule.until = 0;
+	writer->Write("RRULE:");
+	writer->Write(StrFromTaskRecurrence(rule));
+	if (recurrence.until) {
+		writer->Write(";UNTIL=");
+		write_ical_utc(writer, recurrence.until);
+	}
+	writer->Write("\r\n");
+	if (recurrence.exceptions.empty())
+		return;
+	writer->Write("EXDATE:");
+	for (TimeInt exception : recurrence.exceptions) {
+		if (exception != recurrence.exceptions.front())
+			writer->Put(',');
+		write_ical_utc(writer, exception);
+	}
+	writer->Write("\r\n");
+}
+void write_task_ical(Writer *writer, const Task &task, TimeInt time_int_now) {
+	const TaskProperty &property = task.property;
+	writer->Write("BEGIN:VTODO\r\nUID:");
+	writer->WriteUInt(task.id);
+	writer->Put('-');
+	writer->WriteUInt(property.begin_time);
+	writer->Write("@schedulite\r\nDTSTAMP:");
+	write_ical_utc(writer, time_int_now);
+	writer->Write("\r\n");
+	write_ical_text(writer, "SUMMARY", property.name);
+	writer->Write("DTSTART:");
+	write_ical_utc(writer, property.begin_time);
+	if (property.duration) {
+		writer->Write("\r\nDURATION:PT");
+		writer->WriteUInt(property.duration);
+		writer->Put('M');
+	}
+	writer->Write(property.priority == TaskPriority::kHigh
+	                  ? "\r\nPRIORITY:1\r\n"
+	                  : (property.priority == TaskPriority::kMedium ? "\r\nPRIORITY:5\r\n" : "\r\nPRIORITY:9\r\n"));
+	if (property.type != TaskType::kNone) {
+		writer->Write("CATEGORIES:");
+		writer->Write(StrFromTaskType(property.type));
+		writer->Write("\r\n");
+	}
+	writer->Write(property.done ? "STATUS:COMPLETED\r\n" : "STATUS:NEEDS-ACTION\r\n");
+	if (property.recurrence.IsRecurring())
+		write_ical_recurrence(writer, property.recurrence);
+	writer->Write("BEGIN:VALARM\r\nACTION:DISPLAY\r\n");
+	write_ical_text(writer, "DESCRIPTION", property.name);
+	writer->Write("TRIGGER;VALUE=DATE-TIME:");
+	write_ical_utc(writer, property.remind_time);
+	writer->Write("\r\nEND:VALARM\r\nEND:VTODO\r\n");
+}
+
+/*
+ * Import
+ */
+struct ChunkResult {
+	std::vector<TaskProperty> properties;
+	std::vector<ImportError> errors;
+};
+
+template <typename Func> void parallel_for(uint32_t count, uint32_t thread_count, Func &&func) {
+	std::atomic_uint32_t next{0};
+	const auto work = [&next, count, &func]() {
+		for (uint32_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;)
+			func(i);
+	};
+	std::vector<std::thread> threads;
+	for (uint32_t t = 1; t < std::min(thread_count, count); ++t)
+		threads.emplace_back([&work]() {
+			SetTraceThreadName("Import worker");
+			work();
+		});
+	work();
+	for (auto &thread : threads)
+		thread.join();
+}
+
+// Converts local times, mktime() is costly and serialized by a lock in libc, so the hours are cached
+class LocalTimeParser {
+public:
+	// "YYYY/MM/DD hh:mm", '-' and 'T' are accepted as separators as well
+	bool Parse(std::string_view str, TimeInt *p_time_int) {
+		TimeInfo info{};
+		const char *p = str.data(), *end = p + str.size();
+		const auto parse_uint = [&p, end](unsigned max_digits, unsigned *p_value) {
+			unsigned value = 0, digits = 0;
+			for (; p != end && digits < max_digits && *p >= '0' && *p <= '9'; ++p, ++digits)
+				value = value * 10 + unsigned(*p - '0');
+			*p_value = value;
+			return digits != 0;
+		};
+		const auto skip = [&p, end](std::string_view separators) {
+			if (p == end || separators.find(*p) == std::string_view::npos)
+				return false;
+			++p;
+			return true;
+		};
+		unsigned year;
+		if (!parse_uint(4, &year) || !skip("/-") || !parse_uint(2, &info.month) || !skip("/-") ||
+		    !parse_uint(2, &info.day) || !skip(" T") || !parse_uint(2, &info.hour) || !skip(":") ||
+		    !parse_uint(2, &info.minute) || p != end)
+			return false;
+		if (info.month < 1 || info.month > 12 || info.day < 1 || info.day > 31 || info.hour > 23 || info.minute > 59)
+			return false;
+		info.year = (int)year;
+		return Get(info, p_time_int);
+	}
+	bool Get(const TimeInfo &info, TimeInt *p_time_int) {
+		uint32_t i = 0;
+		for (; i < m_caches.size(); ++i) {
+			const HourCache &cache = m_caches[i];
+			if (cache.valid && info.year == cache.hour.year && info.month == cache.hour.month &&
+			    info.day == cache.hour.day && info.hour == cache.hour.hour)
+				break;
+		}
+		if (i < m_caches.size())
+			m_victim = i ^ 1u;
+		else {
+			i = m_victim;
+			m_victim ^= 1u;
+			HourCache &cache = m_caches[i];
+			cache.hour = info;
+			cache.hour.minute = 0;
+			cache.time_int = ToTimeInt(cache.hour);
+			cache.valid = true;
+		}
+		*p_time_int = m_caches[i].time_int + info.minute;
+		return true;
+	}
+
+private:
+	// Two hours, as begin and remind times alternate between nearby hours
+	struct HourCache {
+		bool valid{false};
+		TimeInfo hour{};
+		TimeInt time_int{};
+	};
+	std::array<HourCache, 2> m_caches{};
+	uint32_t m_victim{};
+};
+
+template <std::size_t kSize>
+bool option_from_str(const std::array<const char *, kSize> &options, std::string_view str, uint32_t *p_index) {
+	for (uint32_t i = 0; i < kSize; ++i)
+		if (equal_ignore_case(options[i], str)) {
+			*p_index = i;
+			return true;
+		}
+	return false;
+}
+
+// Fill a TaskProperty from its column values, the errors are static strings
+class RecordBuilder {
+public:
+	void Reset() {
+		m_property = {};
+		m_has_name = m_has_begin_time = m_has_remind_time = false;
+	}
+	const char *Set(Column column, std::string_view value) {
+		uint32_t index;
+		switch (column) {
+		case Column::kName:
+			m_property.name = value;
+			m_has_name = !value.empty();
+			break;
+		case Column::kBeginTime:
+			if (!m_time_parser.Parse(value, &m_property.begin_time))
+				return "Invalid begin time";
+			m_has_begin_time = true;
+			break;
+		case Column::kRemindTime:
+			if (value.empty())
+				break;
+			if (!m_time_parser.Parse(value, &m_property.remind_time))
+				return "Invalid remind time";
+			m_has_remind_time = true;
+			break;
+		case Column::kPriority:
+			if (value.empty())
+				break;
+			if (!option_from_str(GetTaskPriorityStrings(), value, &index))
+				return "Invalid priority";
+			m_property.priority = (TaskPriority)index;
+			break;
+		case Column::kType:
+			if (value.empty())
+				break;
+			if (!option_from_str(GetTaskTypeStrings(), value, &index))
+				return "Invalid type";
+			m_property.type = (TaskType)index;
+			break;
+		case Column::kDone:
+			if (value == "1" || equal_ignore_case(value, "true"))
+				m_property.done = true;
+			else if (value.empty() || value == "0" || equal_ignore_case(value, "false"))
+				m_property.done = false;
+			else
+				return "Invalid done flag";
+			break;
+		case Column::kRepeat: {
+			if (value.empty())
+				break;
+			bool valid;
+			std::tie(m_property.recurrence, valid) = TaskRecurrenceFromStr(value);
+			if (!valid)
+				return "Invalid repeat rule";
+			break;
+		}
+		case Column::kDuration: {
+			uint32_t duration = 0;
+			for (char c : value) {
+				if (c < '0' || c > '9' || duration > std::numeric_limits<TimeInt>::max() / 10)
+					return "Invalid duration";
+				duration = duration * 10 + uint32_t(c - '0');
+			}
+			m_property.duration = duration;
+			break;
+		}
+		default:
+			break;
+		}
+		return nullptr;
+	}
+	inline void SetDone(bool done) { m_property.done = done; }
+	const char *Finish(ChunkResult *result) {
+		if (!m_has_name)
+			return "Missing name";
+		if (!m_has_begin_time)
+			return "Missing begin time";
+		if (!m_has_remind_time)
+			m_property.remind_time = m_property.begin_time;
+		result->properties.push_back(std::move(m_property));
+		return nullptr;
+	}
+
+private:
+	LocalTimeParser m_time_parser;
+	TaskProperty m_property;
+	bool m_has_name{}, m_has_begin_time{}, m_has_remind_time{};
+};
+
+// Fields of a CSV/TSV record, the strings are kept to be reused by the following records
+class FieldList {
+public:
+	inline void Clear() { m_size = 0; }
+	inline std::string &Add() {
+		if (m_size == m_fields.size())
+			m_fields.emplace_back();
+		std::string &field = m_fields[m_size++];
+		field.clear();
+		return field;
+	}
+	inline std::string &Back() { return m_fields[m_size - 1]; }
+	inline const std::string &operator[](std::size_t i) const { return m_fields[i]; }
+	inline std::size_t Size() const { return m_size; }
+	inline bool IsBlank() const {
+		return m_size == 1 && m_fields[0].find_first_not_of(" \t") == std::string::npos;
+	}
+
+private:
+	std::vector<std::string> m_fields;
+	std::size_t m_size{};
+};
+
+Column column_from_str(std::string_view str) {
+	for (uint32_t i = 0; i < std::size(kTaskColumns); ++i)
+		if (equal_ignore_case(kTaskColumns[i], str))
+			return (Column)i;
+	return Column::kUnknown;
+}
+
+// Read a CSV (RFC 4180) or TSV record into fields, return the position after the record
+std::size_t read_csv_record(std::string_view data, std::size_t pos, FieldList *fields, uint32_t *p_lines) {
+	fields->Clear();
+	fields->Add();
+	bool quoted = false;
+	for (; pos < data.size(); ++pos) {
+		char c = data[pos];
+		if (quoted) {
+			if (c == '"') {
+				if (pos + 1 < data.size() && data[pos + 1] == '"')
+					fields->Back() += data[++pos];
+				else
+					quoted = false;
+			} else {
+				*p_lines += c == '\n';
+				fields->Back() += c;
+			}
+		} else if (c == ',')
+			fields->Add();
+		else if (c == '"')
+			quoted = true;
+		else if (c == '\n') {
+			++*p_lines;
+			return pos + 1;
+		} else if (c != '\r')
+			fields->Back() += c;
+	}
+	return pos;
+}
+std::size_t read_tsv_record(std::string_view data, std::size_t pos, FieldList *fields, uint32_t *p_lines) {
+	fields->Clear();
+	fields->Add();
+	for (; pos < data.size(); ++pos) {
+		char c = data[pos];
+		if (c == '\t')
+			fields->Add();
+		else if (c == '\\' && pos + 1 < data.size()) {
+			c = data[++pos];
+			fields->Back() += c == 't' ? '\t' : (c == 'n' ? '\n' : (c == 'r' ? '\r' : c));
+		} else if (c == '\n') {
+			++*p_lines;
+			return pos + 1;
+		} else if (c != '\r')
+			fields->Back() += c;
+	}
+	return pos;
+}
+
+void parse_separated_chunk(std::string_view chunk, uint32_t line, ExchangeFormat format,
+                           const std::vector<Column> &columns, ChunkResult *result) {
+	const auto read_record = format == ExchangeFormat::kCSV ? read_csv_record : read_tsv_record;
+	FieldList fields;
+	RecordBuilder builder;
+	for (std::size_t pos = 0; pos < chunk.size();) {
+		uint32_t record_line = line;
+		pos = read_record(chunk, pos, &fields, &line);
+		if (fields.IsBlank())
+			continue;
+		builder.Reset();
+		const char *error = fields.Size() > columns.size() ? "Too many fields" : nullptr;
+		for (std::size_t i = 0; i < fields.Size() && !error; ++i)
+			error = builder.Set(columns[i], fields[i]);
+		if (!error)
+			error = builder.Finish(result);
+		if (error)
+			result->errors.push_back({record_line, error});
+	}
+}
+
+// A flat JSON object per line, nested values are skipped
+class JSONParser {
+public:
+	const char *ParseObject(std::string_view str, RecordBuilder *builder) {
+		m_p = str.data();
+		m_end = str.data() + str.size();
+		skip_space();
+		if (!consume('{'))
+			return "Expected a JSON object";
+		skip_space();
+		if (consume('}'))
+			return nullptr;
+		std::string &key = m_key, &value = m_value;
+		do {
+			skip_space();
+			if (!parse_string(&key))
+				return "Invalid JSON key";
+			skip_space();
+			if (!consume(':'))
+				return "Expected ':'";
+			skip_space();
+			Column column = column_from_str(key);
+			if (column == Column::kDone) {
+				if (consume_literal("true"))
+					builder->SetDone(true);
+				else if (consume_literal("false") || consume_literal("null"))
+					builder->SetDone(false);
+				else if (!parse_scalar(&value) || builder->Set(column, value))
+					return "Invalid done flag";
+			} else if (column == Column::kUnknown || column == Column::kId || column == Column::kStatus) {
+				if (!skip_value())
+					return "Invalid JSON value";
+			} else {
+				if (!parse_scalar(&value))
+					return "Invalid JSON value";
+				if (const char *error = builder->Set(column, value))
+					return error;
+			}
+			skip_space();
+		} while (consume(','));
+		if (!consume('}'))
+			return "Expected '}'";
+		skip_space();
+		return m_p == m_end ? nullptr : "Unexpected characters after the JSON object";
+	}
+
+private:
+	const char *m_p{}, *m_end{};
+	// Reused by the records
+	std::string m_key, m_value, m_ignored;
+
+	inline void skip_space() {
+		while (m_p != m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\r' || *m_p == '\n'))
+			++m_p;
+	}
+	inline bool consume(char c) {
+		if (m_p == m_end || *m_p != c)
+			return false;
+		++m_p;
+		return true;
+	}
+	inline bool consume_literal(std::string_view literal) {
+		if (std::string_view(m_p, m_end - m_p).substr(0, literal.size()) != literal)
+			return false;
+		m_p += literal.size();
+		return true;
+	}
+	static void append_utf8(std::string *str, uint32_t code) {
+		if (code < 0x80)
+			*str += char(code);
+		else if (code < 0x800) {
+			*str += char(0xc0 | (code >> 6u));
+			*str += char(0x80 | (code & 0x3fu));
+		} else if (code < 0x10000) {
+			*str += char(0xe0 | (code >> 12u));
+			*str += char(0x80 | ((code >> 6u) & 0x3fu));
+			*str += char(0x80 | (code & 0x3fu));
+		} else {
+			*str += char(0xf0 | (code >> 18u));
+			*str += char(0x80 | ((code >> 12u) & 0x3fu));
+			*str += char(0x80 | ((code >> 6u) & 0x3fu));
+			*str += char(0x80 | (code & 0x3fu));
+		}
+	}
+	bool parse_hex4(uint32_t *p_code) {
+		if (m_end - m_p < 4)
+			return false;
+		uint32_t code = 0;
+		for (int i = 0; i < 4; ++i, ++m_p) {
+			char c = to_lower(*m_p);
+			if (c >= '0' && c <= '9')
+				code = code * 16 + uint32_t(c - '0');
+			else if (c >= 'a' && c <= 'f')
+				code = code * 16 + uint32_t(c - 'a' + 10);
+			else
+				return false;
+		}
+		*p_code = code;
+		return true;
+	}
+	bool parse_string(std::string *str) {
+		if (!consume('"'))
+			return false;
+		str->clear();
+		while (m_p != m_end) {
+			char c = *m_p++;
+			if (c == '"')
+				return true;
+			if (c != '\\') {
+				*str += c;
+				continue;
+			}
+			if (m_p == m_end)
+				return false;
+			switch (c = *m_p++) {
+			case 'b':
+				*str += '\b';
+				break;
+			case 'f':
+				*str += '\f';
+				break;
+			case 'n':
+				*str += '\n';
+				break;
+			case 'r':
+				*str += '\r';
+				break;
+			case 't':
+				*str += '\t';
+				break;
+			case 'u': {
+				uint32_t code, low;
+				if (!parse_hex4(&code))
+					return false;
+				if (code >= 0xd800 && code < 0xdc00) { // Surrogate pair
+					if (!consume_literal("\\u") || !parse_hex4(&low) || low < 0xdc00 || low >= 0xe000)
+						return false;
+					code = 0x10000 + ((code - 0xd800) << 10u) + (low - 0xdc00);
+				}
+				append_utf8(str, code);
+				break;
+			}
+			default:
+				*str += c;
+			}
+		}
+		return false;
+	}
+	// A string, or the text of a number
+	bool parse_scalar(std::string *str) {
+		if (m_p != m_end && *m_p == '"')
+			return parse_string(str);
+		const char *begin = m_p;
+		while (m_p != m_end && (std::isalnum((unsigned char)*m_p) || *m_p == '-' || *m_p == '+' || *m_p == '.'))
+			++m_p;
+		str->assign(begin, m_p);
+		return m_p != begin;
+	}
+	bool skip_value() {
+		if (m_p == m_end)
+			return false;
+		if (*m_p != '{' && *m_p != '[')
+			return parse_scalar(&m_ignored);
+		uint32_t depth = 0;
+		while (m_p != m_end) {
+			if (*m_p == '"') {
+				if (!parse_string(&m_ignored))
+					return false;
+				continue;
+			}
+			char c = *m_p++;
+			if (c == '{' || c == '[')
+				++depth;
+			else if ((c == '}' || c == ']') && --depth == 0)
+				return true;
+		}
+		return false;
+	}
+};
+
+void parse_jsonl_chunk(std::string_view chunk, uint32_t line, ChunkResult *result) {
+	JSONParser parser;
+	RecordBuilder builder;
+	for (std::size_t pos = 0; pos < chunk.size(); ++line) {
+		std::size_t next = chunk.find('\n', pos);
+		if (next == std::string_view::npos)
+			next = chunk.size();
+		std::string_view record = chunk.substr(pos, next - pos);
+		pos = next + 1;
+		if (record.find_first_not_of(" \t\r") == std::string_view::npos)
+			continue;
+		builder.Reset();
+		const char *error = parser.ParseObject(record, &builder);
+		if (!error)
+			error = builder.Finish(result);
+		if (error)
+			result->errors.push_back({line, error});
+	}
+}
+
+// iCalendar DATE ("YYYYMMDD") or DATE-TIME ("YYYYMMDDThhmmss[Z]"), times without 'Z' (floating or with a TZID) are
+// taken as local times
+bool parse_ical_time(std::string_view str, LocalTimeParser *parser, TimeInt *p_time_int) {
+	const auto digits = [&str](std::size_t pos, std::size_t count, unsigned *p_value) {
+		if (pos + count > str.size())
+			return false;
+		unsigned value = 0;
+		for (std::size_t i = pos; i < pos + count; ++i) {
+			if (str[i] < '0' || str[i] > '9')
+				return false;
+			value = value * 10 + unsigned(str[i] - '0');
+		}
+		*p_value = value;
+		return true;
+	};
+	unsigned year;
+	TimeInfo info{};
+	if (!digits(0, 4, &year) || !digits(4, 2, &info.month) || !digits(6, 2, &info.day))
+		return false;
+	info.year = (int)year;
+	if (str.size() > 8) {
+		unsigned second;
+		if (str[8] != 'T' || !digits(9, 2, &info.hour) || !digits(11, 2, &info.minute) || !digits(13, 2, &second))
+			return false;
+		if (str.size() == 16 && str[15] == 'Z') {
+			if (info.month < 1 || info.month > 12 || info.day < 1 || info.day > 31 || info.hour > 23 ||
+			    info.minute > 59)
+				return false;
+			int64_t minutes = DaysFromCivil(info.year, info.month, info.day) * 1440 + info.hour * 60 + info.minute;
+			if (minutes < 0 || minutes > std::numeric_limits<TimeInt>::max())
+				return false;
+			*p_time_int = (TimeInt)minutes;
+			return true;
+		}
+		if (str.size() != 15)
+			return false;
+	}
+	if (info.month < 1 || info.month > 12 || info.day < 1 || info.day > 31 || info.hour > 23 || info.minute > 59)
+		return false;
+	return parser->Get(info, p_time_int);
+}
+// iCalendar DURATION ("[+-]P[nW][nD][T[nH][nM][nS]]") in minutes
+bool parse_ical_duration(std::string_view str, int64_t *p_minutes) {
+	std::size_t pos = 0;
+	int64_t sign = 1, minutes = 0, seconds = 0;
+	if (pos < str.size() && (str[pos] == '-' || str[pos] == '+'))
+		sign = str[pos++] == '-' ? -1 : 1;
+	if (pos >= str.size() || str[pos++] != 'P')
+		return false;
+	bool time = false;
+	while (pos < str.size()) {
+		if (str[pos] == 'T') {
+			time = true;
+			++pos;
+			continue;
+		}
+		int64_t value = 0;
+		std::size_t begin = pos;
+		for (; pos < str.size() && str[pos] >= '0' && str[pos] <= '9'; ++pos)
+			value = value * 10 + (str[pos] - '0');
+		if (pos == begin || pos == str.size() || value > (1 << 24))
+			return false;
+		switch (str[pos++]) {
+		case 'W':
+			minutes += value * 7 * 1440;
+			break;
+		case 'D':
+			minutes += value * 1440;
+			break;
+		case 'H':
+			minutes += value * 60;
+			break;
+		case 'M':
+			if (!time)
+				return false;
+			minutes += value;
+			break;
+		case 'S':
+			seconds += value;
+			break;
+		default:
+			return false;
+		}
+	}
+	*p_minutes = sign * (minutes + seconds / 60);
+	return true;
+}
+// RRULE of the parts TaskRecurrence supports, UNTIL is an iCalendar time
+bool parse_ical_rrule(std::string_view str, LocalTimeParser *parser, TaskRecurrence *p_recurrence) {
+	std::string rule;
+	TimeInt until = 0;
+	for (std::size_t pos = 0; pos <= str.size();) {
+		std::size_t next = std::min(str.find(';', pos), str.size());
+		std::string_view part = str.substr(pos, next - pos);
+		pos = next + 1;
+		if (equal_ignore_case(part.substr(0, 6), "UNTIL=")) {
+			if (!parse_ical_time(part.substr(6), parser, &until))
+				return false;
+		} else if (!part.empty()) {
+			// Ordinal weekdays (like "BYDAY=1MO") and the other BYxxx parts are not supported
+			if (equal_ignore_case(part.substr(0, 4), "WKST"))
+				continue;
+			if (!rule.empty())
+				rule += ';';
+			rule += part;
+		}
+	}
+	auto [recurrence, valid] = TaskRecurrenceFromStr(rule);
+	if (!valid || !recurrence.IsRecurring())
+		return false;
+	// EXDATE may come first
+	recurrence.until = until;
+	recurrence.exceptions.insert(recurrence.exceptions.end(), p_recurrence->exceptions.begin(),
+	                             p_recurrence->exceptions.end());
+	*p_recurrence = std::move(recurrence);
+	return true;
+}
+std::string unescape_ical_text(std::string_view str) {
+	std::string text;
+	text.reserve(str.size());
+	for (std::size_t i = 0; i < str.size(); ++i) {
+		if (str[i] == '\\' && i + 1 < str.size()) {
+			char c = str[++i];
+			text += c == 'n' || c == 'N' ? '\n' : c;
+		} else
+			text += str[i];
+	}
+	return text;
+}
+
+class ICalComponentParser {
+public:
+	void Begin(uint32_t line) {
+		m_line = line;
+		m_property = {};
+		m_has_summary = m_has_start = m_has_due = m_has_duration = m_in_alarm = m_has_trigger = m_trigger_absolute =
+		    false;
+	}
+	void BeginAlarm() { m_in_alarm = true; }
+	void EndAlarm() { m_in_alarm = false; }
+	const char *Property(std::string_view name, std::string_view params, std::string_view value) {
+		if (m_in_alarm) {
+			if (equal_ignore_case(name, "TRIGGER") && !m_has_trigger) {
+				bool absolute = params.find("DATE-TIME") != std::string_view::npos;
+				if (absolute ? !parse_ical_time(value, &m_time_parser, &m_trigger_time)
+				             : !parse_ical_duration(value, &m_trigger_offset))
+					return "Invalid TRIGGER";
+				m_has_trigger = true;
+				m_trigger_absolute = absolute;
+			}
+			return nullptr;
+		}
+		if (equal_ignore_case(name, "SUMMARY")) {
+			m_property.name = unescape_ical_text(value);
+			m_has_summary = !m_property.name.empty();
+		} else if (equal_ignore_case(name, "DTSTART")) {
+			if (!parse_ical_time(value, &m_time_parser, &m_property.begin_time))
+				return "Invalid DTSTART";
+			m_has_start = true;
+		} else if (equal_ignore_case(name, "DUE")) {
+			if (!parse_ical_time(value, &m_time_parser, &m_due_time))
+				return "Invalid DUE";
+			m_has_due = true;
+		} else if (equal_ignore_case(name, "DURATION")) {
+			int64_t duration;
+			if (!parse_ical_duration(value, &duration) || duration < 0)
+				return "Invalid DURATION";
+			m_property.duration = (uint32_t)duration;
+			m_has_duration = true;
+		} else if (equal_ignore_case(name, "PRIORITY")) {
+			// RFC 5545: 1-4 high, 5 medium, 6-9 low, 0 undefined
+			int priority = value.size() == 1 && value[0] >= '0' && value[0] <= '9' ? value[0] - '0' : -1;
+			if (priority < 0)
+				return "Invalid PRIORITY";
+			m_property.priority = priority == 0 ? kDefaultTaskPriority
+			                                    : (priority < 5 ? TaskPriority::kHigh
+			                                                    : (priority == 5 ? TaskPriority::kMedium
+			                                                                     : TaskPriority::kLow));
+		} else if (equal_ignore_case(name, "CATEGORIES")) {
+			for (std::size_t pos = 0; pos <= value.size();) {
+				std::size_t next = std::min(value.find(',', pos), value.size());
+				uint32_t index;
+				if (option_from_str(GetTaskTypeStrings(), value.substr(pos, next - pos), &index)) {
+					m_property.type = (TaskType)index;
+					break;
+				}
+				pos = next + 1;
+			}
+		} else if (equal_ignore_case(name, "RRULE")) {
+			if (!parse_ical_rrule(value, &m_time_parser, &m_property.recurrence))
+				return "Unsupported RRULE";
+		} else if (equal_ignore_case(name, "EXDATE")) {
+			for (std::size_t pos = 0; pos <= value.size();) {
+				std::size_t next = std::min(value.find(',', pos), value.size());
+				TimeInt exception;
+				if (!parse_ical_time(value.substr(pos, next - pos), &m_time_parser, &exception))
+					return "Invalid EXDATE";
+				m_property.recurrence.exceptions.push_back(exception);
+				pos = next + 1;
+			}
+		} else if (equal_ignore_case(name, "STATUS"))
+			m_property.done = equal_ignore_case(value, "COMPLETED");
+		else if (equal_ignore_case(name, "COMPLETED"))
+			m_property.done = true;
+		return nullptr;
+	}
+	void End(ChunkResult *result) {
+		if (!m_has_summary) {
+			result->errors.push_back({m_line, "Missing SUMMARY"});
+			return;
+		}
+		if (!m_has_start) {
+			if (!m_has_due) {
+				result->errors.push_back({m_line, "Missing DTSTART"});
+				return;
+			}
+			m_property.begin_time = m_due_time;
+		} else if (m_has_due && !m_has_duration && m_due_time > m_property.begin_time)
+			m_property.duration = m_due_time - m_property.begin_time;
+		auto &exceptions = m_property.recurrence.exceptions;
+		if (!m_property.recurrence.IsRecurring())
+			exceptions.clear();
+		std::sort(exceptions.begin(), exceptions.end());
+		exceptions.erase(std::unique(exceptions.begin(), exceptions.end()), exceptions.end());
+		m_property.remind_time = m_property.begin_time;
+		if (m_has_trigger) {
+			int64_t remind_time = m_trigger_absolute ? m_trigger_time : m_property.begin_time + m_trigger_offset;
+			m_property.remind_time = (TimeInt)std::clamp<int64_t>(remind_time, 0, std::numeric_limits<TimeInt>::max());
+		}
+		result->properties.push_back(std::move(m_property));
+	}
+
+private:
+	LocalTimeParser m_time_parser;
+	TaskProperty m_property;
+	uint32_t m_line{};
+	TimeInt m_due_time{}, m_trigger_time{};
+	int64_t m_trigger_offset{};
+	bool m_has_summary{}, m_has_start{}, m_has_due{}, m_has_duration{}, m_in_alarm{}, m_has_trigger{},
+	    m_trigger_absolute{};
+};
+
+void parse_ical_chunk(std::string_view chunk, uint32_t line, ChunkResult *result) {
+	ICalComponentParser component;
+	bool in_component = false;
+	const char *component_error = nullptr;
+	std::string content;
+	for (std::size_t pos = 0; pos < chunk.size();) {
+		// Unfold a content line, the following lines beginning with a space or a tab continue it
+		uint32_t content_line = line;
+		content.clear();
+		bool folded = false;
+		do {
+			std::size_t next = chunk.find('\n', pos);
+			if (next == std::string_view::npos)
+				next = chunk.size();
+			std::string_view physical = chunk.substr(pos, next - pos);
+			if (!physical.empty() && physical.back() == '\r')
+				physical.remove_suffix(1);
+			if (folded)
+				physical.remove_prefix(1);
+			content += physical;
+			pos = next + 1;
+			++line;
+			folded = true;
+		} while (pos < chunk.size() && (chunk[pos] == ' ' || chunk[pos] == '\t'));
+
+		std::size_t colon = content.find(':');
+		if (colon == std::string::npos)
+			continue;
+		std::string_view name_params = std::string_view(content).substr(0, colon);
+		std::string_view value = std::string_view(content).substr(colon + 1);
+		std::size_t semicolon = name_params.find(';');
+		std::string_view name = name_params.substr(0, semicolon);
+		std::string_view params =
+		    semicolon == std::string_view::npos ? std::string_view{} : name_params.substr(semicolon);
+
+		if (equal_ignore_case(name, "BEGIN")) {
+			if (equal_ignore_case(value, "VEVENT") || equal_ignore_case(value, "VTODO")) {
+				component.Begin(content_line);
+				in_component = true;
+				component_error = nullptr;
+			} else if (in_component && equal_ignore_case(value, "VALARM"))
+				component.BeginAlarm();
+		} else if (equal_ignore_case(name, "END")) {
+			if (in_component && (equal_ignore_case(value, "VEVENT") || equal_ignore_case(value, "VTODO"))) {
+				if (component_error)
+					result->errors.push_back({content_line, component_error});
+				else
+					component.End(result);
+				in_component = false;
+			} else if (in_component && equal_ignore_case(value, "VALARM"))
+				component.EndAlarm();
+		} else if (in_component && !component_error)
+			component_error = component.Property(name, params, value);
+	}
+}
+
+// Find the first record boundary at or after pos
+std::size_t find_record_boundary(std::string_view data, std::size_t pos, ExchangeFormat format, bool quoted) {
+	if (format == ExchangeFormat::kICal) {
+		// The beginning of a "BEGIN:VEVENT" or "BEGIN:VTODO" line
+		for (; pos < data.size(); ++pos) {
+			pos = data.find("\nBEGIN:V", pos == 0 ? 0 : pos - 1);
+			if (pos == std::string_view::npos)
+				return data.size();
+			++pos;
+			std::string_view rest = data.substr(pos + 6);
+			if (rest.substr(0, 6) == "VEVENT" || rest.substr(0, 5) == "VTODO")
+				return pos;
+		}
+		return data.size();
+	}
+	// After a line break, outside of CSV quotes
+	for (; pos < data.size(); ++pos) {
+		if (data[pos] == '"' && format == ExchangeFormat::kCSV)
+			quoted = !quoted;
+		else if (data[pos] == '\n' && !quoted)
+			return pos + 1;
+	}
+	return data.size();
+}
+} // namespace
+
+bool ExchangeFormatFromStr(std::string_view str, ExchangeFormat *p_format) {
+	if (equal_ignore_case(str, "csv"))
+		*p_format = ExchangeFormat::kCSV;
+	else if (equal_ignore_case(str, "tsv"))
+		*p_format = ExchangeFormat::kTSV;
+	else if (equal_ignore_case(str, "jsonl"))
+		*p_format = ExchangeFormat::kJSONL;
+	else if (equal_ignore_case(str, "ics") || equal_ignore_case(str, "ical"))
+		*p_format = ExchangeFormat::kICal;
+	else
+		return false;
+	return true;
+}
+
+bool ExchangeFormatFromPath(std::string_view path, ExchangeFormat *p_format) {
+	std::size_t dot = path.rfind('.');
+	if (dot == std::string_view::npos || path.find_first_of("/\\", dot) != std::string_view::npos)
+		return false;
+	return ExchangeFormatFromStr(path.substr(dot + 1), p_format);
+}
+
+void ExportTasks(Writer *writer, const std::vector<Task> &tasks, ExchangeFormat format, TimeInt time_int_now) {
+	SCHEDULITE_TRACE_SCOPE("ExportTasks");
+	switch (format) {
+	case ExchangeFormat::kCSV:
+		write_task_header<','>(writer);
+		for (const auto &task : tasks)
+			write_task_separated<',', write_csv_str>(writer, task, TaskStatusFromTask(task, time_int_now));
+		break;
+	case ExchangeFormat::kTSV:
+		write_task_header<'\t'>(writer);
+		for (const auto &task : tasks)
+			write_task_separated<'\t', write_tsv_str>(writer, task, TaskStatusFromTask(task, time_int_now));
+		break;
+	case ExchangeFormat::kJSONL:
+		for (const auto &task : tasks)
+			write_task_jsonl(writer, task, TaskStatusFromTask(task, time_int_now));
+		break;
+	case ExchangeFormat::kICal:
+		writer->Write("BEGIN:VCALENDAR\r\nVERSION:2.0\r\nPRODID:-//Schedulite//Schedulite//EN\r\n");
+		for (const auto &task : tasks)
+			write_task_ical(writer, task, time_int_now);
+		writer->Write("END:VCALENDAR\r\n");
+		break;
+	}
+}
+
+std::tuple<std::vector<TaskProperty>, std::vector<ImportError>> ImportTasks(std::string_view data,
+                                                                            ExchangeFormat format,
+                                                                            uint32_t thread_count) {
+	SCHEDULITE_TRACE_SCOPE("ImportTasks");
+	if (data.substr(0, 3) == "\xef\xbb\xbf") // UTF-8 BOM
+		data.remove_prefix(3);
+
+	// The CSV/TSV header, mapping fields to columns
+	uint32_t first_line = 1;
+	std::vector<Column> columns;
+	if (format == ExchangeFormat::kCSV || format == ExchangeFormat::kTSV) {
+		FieldList fields;
+		std::size_t pos = 0;
+		do
+			pos = (format == ExchangeFormat::kCSV ? read_csv_record : read_tsv_record)(data, pos, &fields, &first_line);
+		while (fields.IsBlank() && pos < data.size());
+		for (std::size_t i = 0; i < fields.Size(); ++i)
+			columns.push_back(column_from_str(fields[i]));
+		if (std::find(columns.begin(), columns.end(), Column::kName) == columns.end() ||
+		    std::find(columns.begin(), columns.end(), Column::kBeginTime) == columns.end())
+			return {std::vector<TaskProperty>{},
+			        std::vector<ImportError>{{1, "Header without \"name\" and \"begin_time\" columns"}}};
+		data.remove_prefix(pos);
+	}
+
+	if (thread_count == 0)
+		thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+	auto chunk_count =
+	    (uint32_t)std::clamp<std::size_t>(data.size() / kMinChunkSize, 1, thread_count * kChunksPerThread);
+	if (data.size() / chunk_count < kMinChunkSize)
+		thread_count = 1;
+
+	// Count the line breaks (and CSV quotes) of evenly sized pieces in parallel, then move the piece boundaries
+	// forward to record boundaries
+	std::vector<std::size_t> offsets(chunk_count + 1);
+	std::vector<uint32_t> lines(chunk_count + 1), quotes(chunk_count + 1);
+	for (uint32_t i = 0; i <= chunk_count; ++i)
+		offsets[i] = data.size() * i / chunk_count;
+	if (chunk_count > 1) {
+		parallel_for(chunk_count, thread_count, [&](uint32_t i) {
+			auto piece = data.substr(offsets[i], offsets[i + 1] - offsets[i]);
+			lines[i + 1] = (uint32_t)std::count(piece.begin(), piece.end(), '\n');
+			quotes[i + 1] = format == ExchangeFormat::kCSV ? (uint32_t)std::count(piece.begin(), piece.end(), '"') : 0;
+		});
+		for (uint32_t i = 1; i <= chunk_count; ++i) {
+			lines[i] += lines[i - 1];
+			quotes[i] += quotes[i - 1];
+		}
+		for (uint32_t i = 1; i < chunk_count; ++i) {
+			// A record may span the whole piece
+			if (offsets[i - 1] >= offsets[i]) {
+				offsets[i] = offsets[i - 1];
+				lines[i] = lines[i - 1];
+				continue;
+			}
+			std::size_t boundary = find_record_boundary(data, offsets[i], format, quotes[i] & 1u);
+			auto skipped = data.substr(offsets[i], boundary - offsets[i]);
+			lines[i] += (uint32_t)std::count(skipped.begin(), skipped.end(), '\n');
+			offsets[i] = boundary;
+		}
+	}
+
+	std::vector<ChunkResult> results(chunk_count);
+	parallel_for(chunk_count, thread_count, [&](uint32_t i) {
+		SCHEDULITE_TRACE_SCOPE("ImportTasks chunk");
+		auto chunk = data.substr(offsets[i], offsets[i + 1] - offsets[i]);
+		uint32_t line = first_line + lines[i];
+		switch (format) {
+		case ExchangeFormat::kCSV:
+		case ExchangeFormat::kTSV:
+			parse_separated_chunk(chunk, line, format, columns, &results[i]);
+			break;
+		case ExchangeFormat::kJSONL:
+			parse_jsonl_chunk(chunk, line, &results[i]);
+			break;
+		case ExchangeFormat::kICal:
+			parse_ical_chunk(chunk, line, &results[i]);
+			break;
+		}
+	});
+
+	std::size_t property_count = 0, error_count = 0;
+	for (const auto &result : results) {
+		property_count += result.properties.size();
+		error_count += result.errors.size();
+	}
+	std::vector<TaskProperty> properties;
+	std::vector<ImportError> errors;
+	properties.reserve(property_count);
+	errors.reserve(error_count);
+	for (auto &result : results) {
+		std::move(result.properties.begin(), result.properties.end(), std::back_inserter(properties));
+		std::move(result.errors.begin(), result.errors.end(), std::back_inserter(errors));
+	}
+	return {std::move(properties), std::move(errors)};
+}
+
+} // namespace backend
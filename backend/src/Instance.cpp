@@ -47,6 +47,8 @@ std::vector<std::string> Instance::FetchUsernames() const {
 }
 
 bool Instance::MaintainDirs() const {
+	if (m_dirs_maintained.load(std::memory_order_relaxed))
+		return true;
 	// Maintain app dir
 	try {
 		if (ghc::filesystem::exists(m_app_dir_path)) {
@@ -77,6 +79,7 @@ bool Instance::MaintainDirs() const {
 	} catch (...) {
 		return false;
 	}
+	m_dirs_maintained.store(true, std::memory_order_relaxed);
 	return true;
 }
 
@@ -0,0 +1,112 @@
+#include <backend/Interval.hpp>
+
+#include <backend/Recurrence.hpp>
+#include <backend/Trace.hpp>
+
+#include <algorithm>
+
+namespace backend {
+
+namespace {
+inline TimeInt clamp_time(int64_t time) {
+	return (TimeInt)std::clamp<int64_t>(time, 0, std::numeric_limits<TimeInt>::max());
+}
+} // namespace
+
+void TaskIntervalIndex::Build(const std::vector<Task> &tasks) {
+	SCHEDULITE_TRACE_SCOPE("TaskIntervalIndex::Build");
+	m_spans.clear();
+	m_recurring.clear();
+	for (uint32_t index = 0; index < (uint32_t)tasks.size(); ++index) {
+		const TaskProperty &property = tasks[index].property;
+		if (property.done || !property.duration)
+			continue;
+		if (property.recurrence.IsRecurring())
+			m_recurring.emplace_back(index, property);
+		else
+			m_spans.push_back({property.begin_time, TaskEndTime(property), index});
+	}
+
+	auto size = (uint32_t)m_spans.size();
+	m_prefix_max_ends.resize(size);
+	for (uint32_t i = 0; i < size; ++i)
+		m_prefix_max_ends[i] = i ? std::max(m_prefix_max_ends[i - 1], m_spans[i].end) : m_spans[i].end;
+
+	// The leaves are padded with 0, which never ends after a time
+	for (m_tree_leaves = 1; m_tree_leaves < size;)
+		m_tree_leaves <<= 1u;
+	m_tree_max_ends.assign(m_tree_leaves * 2, 0);
+	for (uint32_t i = 0; i < size; ++i)
+		m_tree_max_ends[m_tree_leaves + i] = m_spans[i].end;
+	for (uint32_t node = m_tree_leaves - 1; node >= 1; --node)
+		m_tree_max_ends[node] = std::max(m_tree_max_ends[node << 1u], m_tree_max_ends[node << 1u | 1u]);
+}
+
+void TaskIntervalIndex::collect_ending_after(uint32_t node, uint32_t node_first, uint32_t node_last, uint32_t last,
+                                             TimeInt time, std::vector<IntervalResult> *p_results) const {
+	if (node_first >= last || m_tree_max_ends[node] <= time)
+		return;
+	if (node >= m_tree_leaves) {
+		p_results->push_back({m_spans[node_first].index, m_spans[node_first].begin});
+		return;
+	}
+	uint32_t mid = (node_first + node_last) >> 1u;
+	collect_ending_after(node << 1u, node_first, mid, last, time, p_results);
+	collect_ending_after(node << 1u | 1u, mid, node_last, last, time, p_results);
+}
+
+std::vector<IntervalResult> TaskIntervalIndex::QueryOverlaps(TimeInt begin, TimeInt end) const {
+	SCHEDULITE_TRACE_SCOPE("TaskIntervalIndex::QueryOverlaps");
+	std::vector<IntervalResult> results;
+	if (begin >= end)
+		return results;
+	auto begin_less = [](const Span &span, TimeInt time) { return span.begin < time; };
+	auto first = uint32_t(std::lower_bound(m_spans.begin(), m_spans.end(), begin, begin_less) - m_spans.begin());
+	auto last = uint32_t(std::lower_bound(m_spans.begin() + first, m_spans.end(), end, begin_less) - m_spans.begin());
+
+	// Spans beginning before the range overlap it if they end after its begin
+	if (first)
+		collect_ending_after(1, 0, m_tree_leaves, first, begin, &results);
+	// Spans beginning inside the range all overlap it
+	for (uint32_t i = first; i < last; ++i)
+		results.push_back({m_spans[i].index, m_spans[i].begin});
+	if (m_recurring.empty())
+		return results;
+
+	for (const auto &[index, property] : m_recurring)
+		for (TimeInt time_int :
+		     GetOccurrenceTimes(property, clamp_time(int64_t(begin) - property.duration + 1), end))
+			results.push_back({index, time_int});
+	std::sort(results.begin(), results.end(), [](const IntervalResult &l, const IntervalResult &r) {
+		return std::tie(l.begin_time, l.index) < std::tie(r.begin_time, r.index);
+	});
+	return results;
+}
+
+std::tuple<TimeInt, bool> TaskIntervalIndex::FindFreeSlot(TimeInt after, uint32_t duration, TimeInt until) const {
+	SCHEDULITE_TRACE_SCOPE("TaskIntervalIndex::FindFreeSlot");
+	auto begin_less = [](const Span &span, TimeInt time) { return span.begin < time; };
+	std::size_t i = std::lower_bound(m_spans.begin(), m_spans.end(), after, begin_less) - m_spans.begin();
+	// Spans beginning before the time cover it until their max end
+	int64_t slot = i ? std::max<int64_t>(after, m_prefix_max_ends[i - 1]) : after;
+	for (;;) {
+		// Every span beginning before the end of the slot pushes it past the span's end
+		for (; i < m_spans.size() && m_spans[i].begin < slot + duration; ++i)
+			slot = std::max<int64_t>(slot, m_spans[i].end);
+		if (slot + duration > until)
+			return {0, false};
+
+		int64_t pushed = slot;
+		for (const auto &[index, property] : m_recurring) {
+			auto times =
+			    GetOccurrenceTimes(property, clamp_time(slot - property.duration + 1), clamp_time(slot + duration));
+			if (!times.empty())
+				pushed = std::max<int64_t>(pushed, int64_t(times.back()) + property.duration);
+		}
+		if (pushed == slot)
+			return {(TimeInt)slot, true};
+		slot = pushed;
+	}
+}
+
+} // namespace backend
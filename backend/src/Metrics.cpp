@@ -0,0 +1,38 @@
+#include <backend/Metrics.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace backend {
+
+uint64_t HistogramSnapshot::GetPercentile(double p) const {
+	if (!count)
+		return 0;
+	// Nearest-rank percentile
+	auto target = std::max<uint64_t>(uint64_t(std::ceil(std::clamp(p, 0.0, 1.0) * double(count))), 1);
+	uint64_t acc = 0;
+	for (uint32_t i = 0; i < HistogramLayout::kBucketCount; ++i)
+		if ((acc += buckets[i]) >= target)
+			return std::min(HistogramLayout::GetLowerBound(i), max);
+	return max;
+}
+
+void HistogramSnapshot::Merge(const HistogramSnapshot &r) {
+	for (uint32_t i = 0; i < HistogramLayout::kBucketCount; ++i)
+		buckets[i] += r.buckets[i];
+	count += r.count;
+	sum += r.sum;
+	max = std::max(max, r.max);
+}
+
+HistogramSnapshot Histogram::GetSnapshot() const {
+	HistogramSnapshot snapshot;
+	for (uint32_t i = 0; i < HistogramLayout::kBucketCount; ++i)
+		snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+	snapshot.count = m_count.load(std::memory_order_relaxed);
+	snapshot.sum = m_sum.load(std::memory_order_relaxed);
+	snapshot.max = m_max.load(std::memory_order_relaxed);
+	return snapshot;
+}
+
+} // namespace backend
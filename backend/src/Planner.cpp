@@ -0,0 +1,266 @@
+#include <backend/Planner.hpp>
+
+#include <backend/Trace.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <numeric>
+
+namespace backend {
+
+namespace {
+inline TimeInt clamp_time(int64_t time) {
+	return (TimeInt)std::clamp<int64_t>(time, 0, std::numeric_limits<TimeInt>::max());
+}
+
+// Disjoint free time spans [begin, end) keyed by begin time, adjacent spans are always merged
+class FreeTime {
+public:
+	FreeTime(const std::vector<Task> &busy, TimeInt since, TimeInt until) {
+		std::vector<std::pair<TimeInt, TimeInt>> spans;
+		spans.reserve(busy.size());
+		for (const Task &task : busy)
+			if (task.property.duration)
+				spans.emplace_back(task.property.begin_time, TaskEndTime(task.property));
+		std::sort(spans.begin(), spans.end());
+		TimeInt time = since;
+		for (const auto &[begin, end] : spans) {
+			if (time >= until)
+				break;
+			if (begin > time)
+				m_free.emplace_hint(m_free.end(), time, std::min(begin, until));
+			time = std::max(time, end);
+		}
+		if (time < until)
+			m_free.emplace_hint(m_free.end(), time, until);
+	}
+
+	// Find the earliest span of a duration beginning at or after a time and ending before a deadline
+	bool Find(TimeInt after, uint32_t duration, TimeInt deadline, TimeInt *p_begin) const {
+		auto it = m_free.upper_bound(after);
+		if (it != m_free.begin() && std::prev(it)->second > after)
+			--it;
+		for (; it != m_free.end(); ++it) {
+			uint64_t begin = std::max(it->first, after), end = begin + duration;
+			// Later free spans only begin later
+			if (end > deadline)
+				return false;
+			if (end <= it->second) {
+				*p_begin = (TimeInt)begin;
+				return true;
+			}
+		}
+		return false;
+	}
+	// Get the free span containing a time, which must be free
+	std::pair<TimeInt, TimeInt> GetSpan(TimeInt time) const { return *std::prev(m_free.upper_bound(time)); }
+	// Take [begin, end) which lies in a free span
+	void Occupy(TimeInt begin, TimeInt end) {
+		auto it = std::prev(m_free.upper_bound(begin));
+		TimeInt free_begin = it->first, free_end = it->second;
+		it = m_free.erase(it);
+		if (end < free_end)
+			it = m_free.emplace_hint(it, end, free_end);
+		if (free_begin < begin)
+			m_free.emplace_hint(it, free_begin, begin);
+	}
+	// Give back [begin, end) which was taken by Occupy()
+	void Release(TimeInt begin, TimeInt end) {
+		auto next = m_free.lower_bound(begin);
+		if (next != m_free.end() && next->first == end) {
+			end = next->second;
+			next = m_free.erase(next);
+		}
+		if (next != m_free.begin() && std::prev(next)->second == begin) {
+			auto prev = std::prev(next);
+			begin = prev->first;
+			m_free.erase(prev);
+		}
+		m_free.emplace_hint(next, begin, end);
+	}
+
+private:
+	std::map<TimeInt, TimeInt> m_free;
+};
+
+class Planner {
+public:
+	Planner(const std::vector<Task> &busy, const std::vector<FlexibleTask> &tasks, const PlanOptions &options)
+	    : m_tasks{tasks}, m_free{busy, options.since, options.until}, m_slots(tasks.size()) {
+		m_windows.reserve(tasks.size());
+		for (const FlexibleTask &task : tasks) {
+			TimeInt deadline = task.deadline ? std::min(task.deadline, options.until) : options.until;
+			m_windows.emplace_back(std::max(task.earliest, options.since), deadline);
+		}
+		m_order.resize(tasks.size());
+		std::iota(m_order.begin(), m_order.end(), 0);
+		std::stable_sort(m_order.begin(), m_order.end(), [this](uint32_t l, uint32_t r) {
+			const TaskProperty &lp = m_tasks[l].property, &rp = m_tasks[r].property;
+			return std::make_tuple(rp.priority, m_windows[l].second, rp.duration) <
+			       std::make_tuple(lp.priority, m_windows[r].second, lp.duration);
+		});
+	}
+
+	void PlaceGreedy() {
+		SCHEDULITE_TRACE_SCOPE("Planner::PlaceGreedy");
+		for (uint32_t i : m_order)
+			place(i);
+	}
+
+	// Each accepted move places a Task, displacing only Tasks of lower priorities, or moves a Task earlier, moving only
+	// Tasks of lower priorities later, so the plan strictly improves and the loop ends even without the budget
+	void Improve(std::chrono::steady_clock::time_point deadline) {
+		SCHEDULITE_TRACE_SCOPE("Planner::Improve");
+		const auto expired = [deadline] { return std::chrono::steady_clock::now() >= deadline; };
+		for (bool improved = true; improved && !expired();) {
+			improved = false;
+			for (uint32_t i : m_order) {
+				if (expired())
+					return;
+				if (!m_slots[i].placed && m_tasks[i].property.duration && push_blocker(i))
+					improved = true;
+			}
+			for (uint32_t i : m_order) {
+				if (!m_slots[i].placed)
+					continue;
+				TimeInt begin = m_slots[i].begin;
+				m_free.Release(begin, begin + m_tasks[i].property.duration);
+				place(i);
+				improved |= m_slots[i].begin < begin;
+			}
+			for (uint32_t i : m_order) {
+				if (expired())
+					return;
+				if (m_slots[i].placed && swap_earlier(i))
+					improved = true;
+			}
+		}
+	}
+
+	TaskPlan MakePlan() const {
+		TaskPlan plan;
+		for (uint32_t i = 0; i < (uint32_t)m_tasks.size(); ++i)
+			(m_slots[i].placed ? plan.placed : plan.unplaced).push_back(i);
+		std::sort(plan.placed.begin(), plan.placed.end(),
+		          [this](uint32_t l, uint32_t r) { return m_slots[l].begin < m_slots[r].begin; });
+		plan.ops.reserve(plan.placed.size());
+		for (uint32_t i : plan.placed) {
+			const TaskProperty &property = m_tasks[i].property;
+			TaskOp op{TaskOpType::kInsert, 0, property, TaskPropertyMask::kAll};
+			op.property.begin_time = m_slots[i].begin;
+			op.property.remind_time = clamp_time(int64_t(m_slots[i].begin) - int64_t(property.begin_time) +
+			                                     int64_t(property.remind_time));
+			plan.ops.push_back(std::move(op));
+		}
+		return plan;
+	}
+
+private:
+	struct Slot {
+		bool placed;
+		TimeInt begin;
+	};
+	const std::vector<FlexibleTask> &m_tasks;
+	FreeTime m_free;
+	// Earliest begin time and latest end time of each Task
+	std::vector<std::pair<TimeInt, TimeInt>> m_windows;
+	std::vector<Slot> m_slots;
+	// Task indices in greedy order
+	std::vector<uint32_t> m_order;
+
+	bool find(uint32_t i, TimeInt *p_begin) const {
+		const auto &[earliest, deadline] = m_windows[i];
+		uint32_t duration = m_tasks[i].property.duration;
+		return duration && earliest < deadline && m_free.Find(earliest, duration, deadline, p_begin);
+	}
+	bool place(uint32_t i) {
+		TimeInt begin;
+		if (!find(i, &begin))
+			return false;
+		m_free.Occupy(begin, begin + m_tasks[i].property.duration);
+		m_slots[i] = {true, begin};
+		return true;
+	}
+
+	// Place an unplaced Task by moving a placed one inside its window, lower priorities first
+	bool push_blocker(uint32_t i) {
+		const auto &[earliest, deadline] = m_windows[i];
+		const TaskPriority priority = m_tasks[i].property.priority;
+		for (auto it = m_order.rbegin(); it != m_order.rend(); ++it) {
+			uint32_t blocker = *it;
+			if (!m_slots[blocker].placed)
+				continue;
+			TimeInt begin = m_slots[blocker].begin, end = begin + m_tasks[blocker].property.duration;
+			if (end <= earliest || begin >= deadline)
+				continue;
+			m_free.Release(begin, end);
+			// The Task did not fit anywhere else, so it can only go into the span freed by the blocker
+			auto [span_begin, span_end] = m_free.GetSpan(begin);
+			uint64_t slot = std::max(span_begin, earliest), slot_end = slot + m_tasks[i].property.duration;
+			if (slot_end <= std::min(span_end, deadline)) {
+				m_free.Occupy((TimeInt)slot, (TimeInt)slot_end);
+				m_slots[i] = {true, (TimeInt)slot};
+				m_slots[blocker].placed = false;
+				// A blocker of a lower priority may be left unplaced
+				if (place(blocker) || m_tasks[blocker].property.priority < priority)
+					return true;
+				m_slots[i].placed = false;
+				m_free.Release((TimeInt)slot, (TimeInt)slot_end);
+			}
+			m_free.Occupy(begin, end);
+			m_slots[blocker] = {true, begin};
+		}
+		return false;
+	}
+
+	// Move a placed Task earlier into the slot of a Task of a lower priority, which is placed again after it
+	bool swap_earlier(uint32_t i) {
+		const TaskPriority priority = m_tasks[i].property.priority;
+		const TimeInt begin = m_slots[i].begin, end = begin + m_tasks[i].property.duration;
+		for (auto it = m_order.rbegin(); it != m_order.rend() && m_tasks[*it].property.priority < priority; ++it) {
+			uint32_t other = *it;
+			if (!m_slots[other].placed || m_slots[other].begin >= begin ||
+			    m_slots[other].begin + m_tasks[other].property.duration <= m_windows[i].first)
+				continue;
+			const TimeInt other_begin = m_slots[other].begin,
+			              other_end = other_begin + m_tasks[other].property.duration;
+			m_free.Release(begin, end);
+			m_free.Release(other_begin, other_end);
+			// The Task is already as early as possible, so it can only move into the span freed by the other one
+			auto [span_begin, span_end] = m_free.GetSpan(other_begin);
+			uint64_t slot = std::max(span_begin, m_windows[i].first), slot_end = slot + m_tasks[i].property.duration;
+			if (slot < begin && slot_end <= std::min(span_end, m_windows[i].second)) {
+				m_free.Occupy((TimeInt)slot, (TimeInt)slot_end);
+				m_slots[i] = {true, (TimeInt)slot};
+				m_slots[other].placed = false;
+				if (place(other))
+					return true;
+				m_free.Release((TimeInt)slot, (TimeInt)slot_end);
+			}
+			m_free.Occupy(begin, end);
+			m_free.Occupy(other_begin, other_end);
+			m_slots[i] = {true, begin};
+			m_slots[other] = {true, other_begin};
+		}
+		return false;
+	}
+};
+} // namespace
+
+TaskPlan PlanTasks(const std::vector<Task> &busy, const std::vector<FlexibleTask> &tasks, const PlanOptions &options) {
+	SCHEDULITE_TRACE_SCOPE("PlanTasks");
+	auto deadline = std::chrono::steady_clock::now() + options.time_budget;
+	if (options.since >= options.until) {
+		TaskPlan plan;
+		plan.unplaced.resize(tasks.size());
+		std::iota(plan.unplaced.begin(), plan.unplaced.end(), 0);
+		return plan;
+	}
+	Planner planner{busy, tasks, options};
+	planner.PlaceGreedy();
+	planner.Improve(deadline);
+	return planner.MakePlan();
+}
+
+} // namespace backend
@@ -0,0 +1,243 @@
+#include <backend/Recurrence.hpp>
+
+#include <backend/Trace.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace backend {
+
+namespace {
+// Occurrences are generated up to 2200, which the local time conversions can still represent
+constexpr TimeInt kMaxOccurrenceTime = TimeInt(DaysFromCivil(2200, 1, 1) * 1440);
+constexpr TimeInt kMinutesPerDay = 1440;
+
+inline int64_t days_in_month(int64_t year, unsigned month) {
+	return month == 12 ? 31 : DaysFromCivil(year, month + 1, 1) - DaysFromCivil(year, month, 1);
+}
+inline TimeInt clamp_time(int64_t time) {
+	return (TimeInt)std::clamp<int64_t>(time, 0, std::numeric_limits<TimeInt>::max());
+}
+inline int64_t local_minutes(const TimeInfo &info) {
+	return DaysFromCivil(info.year, info.month, info.day) * kMinutesPerDay + info.hour * 60 + info.minute;
+}
+// ToTimeInt() takes the local time as standard time, correct it so that ToTimeInfo() gives the same wall clock time
+inline TimeInt wall_time_int(const TimeInfo &info) {
+	TimeInt time_int = ToTimeInt(info);
+	return clamp_time(int64_t(time_int) - (local_minutes(ToTimeInfo(time_int)) - local_minutes(info)));
+}
+inline bool occurrence_less(const Task &l, const Task &r) {
+	return std::tie(l.property.begin_time, l.property.name, l.id) <
+	       std::tie(r.property.begin_time, r.property.name, r.id);
+}
+} // namespace
+
+std::vector<TimeInt> GetOccurrenceTimes(const TaskProperty &property, TimeInt since, TimeInt until, uint32_t limit) {
+	std::vector<TimeInt> times;
+	const TaskRecurrence &recurrence = property.recurrence;
+	const TimeInt begin = property.begin_time;
+	if (!recurrence.IsRecurring()) {
+		if (limit && begin >= since && begin < until)
+			times.push_back(begin);
+		return times;
+	}
+	if (recurrence.until && recurrence.until < until)
+		until = recurrence.until + 1;
+	until = std::min(until, kMaxOccurrenceTime);
+	since = std::max(since, begin);
+	if (!limit || since >= until)
+		return times;
+
+	const TimeInfo start = ToTimeInfo(begin);
+	const int64_t start_day = DaysFromCivil(start.year, start.month, start.day);
+	// Days around the window, a local date is at most a day away from the UTC one
+	const int64_t first_day = since / kMinutesPerDay - 1, last_day = (until - 1) / kMinutesPerDay + 1;
+	const uint32_t interval = std::max<uint32_t>(recurrence.interval, 1);
+
+	// Visit a candidate day with its ordinal among the occurrences, return whether to continue
+	const auto visit = [&](int64_t day, uint64_t ordinal) -> bool {
+		if ((recurrence.count && ordinal >= recurrence.count) || day > last_day)
+			return false;
+		if (day < first_day)
+			return true;
+		TimeInt time_int = begin;
+		if (day != start_day) {
+			TimeInfo info = CivilFromDays(day);
+			info.hour = start.hour;
+			info.minute = start.minute;
+			time_int = wall_time_int(info);
+		}
+		if (time_int >= until)
+			return false;
+		if (time_int >= since &&
+		    !std::binary_search(recurrence.exceptions.begin(), recurrence.exceptions.end(), time_int)) {
+			times.push_back(time_int);
+			if (times.size() >= limit)
+				return false;
+		}
+		return true;
+	};
+
+	switch (recurrence.frequency) {
+	case RecurrenceFrequency::kDaily: {
+		uint64_t k = first_day > start_day ? uint64_t(first_day - start_day) / interval : 0;
+		while (visit(start_day + int64_t(k) * interval, k))
+			++k;
+		break;
+	}
+	case RecurrenceFrequency::kWeekly: {
+		// Weeks start on Monday, offset o of a week is weekday (o + 1) % 7
+		const unsigned start_weekday = WeekdayFromDays(start_day);
+		const uint8_t by_day = (recurrence.by_day & 0x7fu) ? uint8_t(recurrence.by_day & 0x7fu)
+		                                                   : uint8_t(1u << start_weekday);
+		const auto match = [by_day](unsigned offset) { return (by_day >> ((offset + 1) % 7)) & 1u; };
+		const int64_t start_monday = start_day - (start_weekday + 6) % 7;
+
+		// The begin time is the first occurrence even if its weekday is not in the rule
+		const uint64_t base = (by_day >> start_weekday) & 1u ? 0 : 1;
+		if (base && !visit(start_day, 0))
+			break;
+		uint64_t first_week_count = 0, week_count = 0;
+		for (unsigned o = 0; o < 7; ++o)
+			if (match(o)) {
+				++week_count;
+				first_week_count += start_monday + o >= start_day;
+			}
+
+		const int64_t week_days = 7 * int64_t(interval);
+		uint64_t w = first_day > start_monday + 6 ? uint64_t(first_day - start_monday) / week_days : 0;
+		for (bool run = true; run; ++w) {
+			int64_t monday = start_monday + int64_t(w) * week_days;
+			uint64_t ordinal = w == 0 ? base : base + first_week_count + (w - 1) * week_count;
+			for (unsigned o = 0; run && o < 7; ++o)
+				if (match(o) && monday + o >= start_day)
+					run = visit(monday + o, ordinal++);
+		}
+		break;
+	}
+	case RecurrenceFrequency::kMonthly:
+	case RecurrenceFrequency::kYearly: {
+		const uint32_t month_step = recurrence.frequency == RecurrenceFrequency::kMonthly ? interval : interval * 12;
+		uint64_t k = 0;
+		// Every month has the day, so the ordinal is only unknown if the count matters
+		if (!recurrence.count && start.day <= 28 && first_day > start_day) {
+			TimeInfo first = CivilFromDays(first_day);
+			int64_t months = int64_t(first.year - start.year) * 12 + int64_t(first.month) - int64_t(start.month);
+			k = months > 0 ? uint64_t(months) / month_step : 0;
+		}
+		for (uint64_t ordinal = 0;; ++k) {
+			int64_t months = int64_t(start.month - 1) + int64_t(k * month_step);
+			int64_t year = start.year + months / 12;
+			auto month = unsigned(months % 12 + 1);
+			if (DaysFromCivil(year, month, 1) > last_day)
+				break;
+			if (start.day > days_in_month(year, month))
+				continue;
+			if (!visit(DaysFromCivil(year, month, start.day), ordinal++))
+				break;
+		}
+		break;
+	}
+	default:
+		break;
+	}
+	return times;
+}
+
+Task MakeTaskOccurrence(const Task &task, TimeInt begin_time) {
+	Task occurrence = task;
+	occurrence.property.begin_time = begin_time;
+	occurrence.property.remind_time = clamp_time(int64_t(begin_time) - int64_t(task.property.begin_time) +
+	                                             int64_t(task.property.remind_time));
+	return occurrence;
+}
+
+std::vector<Task> ExpandTaskOccurrences(const std::vector<Task> &tasks, TimeInt since, TimeInt until) {
+	SCHEDULITE_TRACE_SCOPE("ExpandTaskOccurrences");
+	std::vector<Task> occurrences, recurring;
+	if (since >= until)
+		return occurrences;
+	// Tasks are sorted by (begin_time, name), the ones beginning after the window never occur in it
+	auto begin_less = [](const Task &task, TimeInt time) { return task.property.begin_time < time; };
+	auto first = std::lower_bound(tasks.begin(), tasks.end(), since, begin_less);
+	auto last = std::lower_bound(first, tasks.end(), until, begin_less);
+
+	const auto expand = [since, until, &recurring](const Task &task) {
+		for (TimeInt time_int : GetOccurrenceTimes(task.property, since, until))
+			recurring.push_back(MakeTaskOccurrence(task, time_int));
+	};
+	for (auto it = tasks.begin(); it != first; ++it)
+		if (it->property.recurrence.IsRecurring())
+			expand(*it);
+	for (auto it = first; it != last; ++it) {
+		if (it->property.recurrence.IsRecurring())
+			expand(*it);
+		else
+			occurrences.push_back(*it);
+	}
+	if (recurring.empty())
+		return occurrences;
+
+	// Merge the occurrences into the Tasks that do not recur, which are already in key order
+	std::sort(recurring.begin(), recurring.end(), occurrence_less);
+	std::vector<Task> merged;
+	merged.reserve(occurrences.size() + recurring.size());
+	std::merge(std::make_move_iterator(occurrences.begin()), std::make_move_iterator(occurrences.end()),
+	           std::make_move_iterator(recurring.begin()), std::make_move_iterator(recurring.end()),
+	           std::back_inserter(merged), occurrence_less);
+	return merged;
+}
+
+TaskOccurrenceStatus GetTaskOccurrenceStatus(const TaskProperty &property, TimeInt time_int) {
+	TaskOccurrenceStatus ret{TaskStatusFromTask(property, time_int), property.begin_time, 0};
+	if (property.done)
+		return ret;
+	if (!property.recurrence.IsRecurring()) {
+		if (ret.status == TaskStatus::kPending)
+			ret.transition_time = property.begin_time;
+		return ret;
+	}
+	const TimeInt span = std::max<TimeInt>(property.duration, 1);
+	const TimeInt since = time_int >= span ? time_int - span + 1 : 0;
+	std::vector<TimeInt> times = GetOccurrenceTimes(property, since, std::numeric_limits<TimeInt>::max(), 1);
+	if (times.empty()) {
+		// Every occurrence has ended
+		std::vector<TimeInt> past = GetOccurrenceTimes(property, 0, since);
+		if (!past.empty())
+			ret.begin_time = past.back();
+		return ret;
+	}
+	ret.begin_time = times.front();
+	if (times.front() > time_int) {
+		ret.status = TaskStatus::kPending;
+		ret.transition_time = times.front();
+	} else {
+		ret.status = TaskStatus::kOngoing;
+		ret.transition_time = clamp_time(int64_t(times.front()) + span);
+	}
+	return ret;
+}
+
+std::vector<Task> GetRecurringTasksAt(const std::vector<Task> &tasks, TimeInt time_int, bool with_begin_time) {
+	SCHEDULITE_TRACE_SCOPE("GetRecurringTasksAt");
+	std::vector<Task> matched;
+	const auto match = [&matched](const Task &task, int64_t begin_time) {
+		if (begin_time < 0 || begin_time >= std::numeric_limits<TimeInt>::max() ||
+		    GetOccurrenceTimes(task.property, (TimeInt)begin_time, (TimeInt)begin_time + 1, 1).empty())
+			return false;
+		matched.push_back(MakeTaskOccurrence(task, (TimeInt)begin_time));
+		return true;
+	};
+	for (const Task &task : tasks) {
+		if (!task.property.recurrence.IsRecurring() || task.property.done)
+			continue;
+		// The occurrence reminded now begins as far after as the Task's remind time is before its begin time
+		int64_t lead = int64_t(task.property.begin_time) - int64_t(task.property.remind_time);
+		if (!match(task, int64_t(time_int) + lead) && with_begin_time && lead != 0)
+			match(task, time_int);
+	}
+	return matched;
+}
+
+} // namespace backend
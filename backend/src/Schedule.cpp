@@ -1,29 +1,78 @@
 #include <backend/Schedule.hpp>
 
-#include <backend/Encryption.hpp>
 #include <backend/Environment.hpp>
+#include <backend/Recurrence.hpp>
+#include <backend/Trace.hpp>
 
+#include <cassert>
+#include <chrono>
 #include <condition_variable>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <ghc/filesystem.hpp>
 #include <libipc/mutex.h>
 #include <libipc/shm.h>
-#include <nowide/fstream.hpp>
 #include <uuid.h>
 
 namespace backend {
 
+namespace {
+// Sort the dependencies of a Task, which must be existing Tasks not depending on it
+Error check_dependencies(const std::vector<Task> &tasks, Task *p_task) {
+	auto &dependencies = p_task->property.dependencies;
+	if (dependencies.empty())
+		return Error::kSuccess;
+	std::sort(dependencies.begin(), dependencies.end());
+	dependencies.erase(std::unique(dependencies.begin(), dependencies.end()), dependencies.end());
+	if (std::binary_search(dependencies.begin(), dependencies.end(), p_task->id))
+		return Error::kTaskDependencyCycle;
+
+	std::unordered_map<uint32_t, const Task *> id_tasks;
+	id_tasks.reserve(tasks.size());
+	for (const Task &task : tasks)
+		id_tasks.emplace(task.id, &task);
+	for (uint32_t id : dependencies)
+		if (!id_tasks.count(id))
+			return Error::kTaskDependencyNotFound;
+	// The Task closes a cycle if it is reached through the dependencies
+	std::vector<uint32_t> stack = dependencies;
+	std::unordered_set<uint32_t> visited{stack.begin(), stack.end()};
+	while (!stack.empty()) {
+		auto it = id_tasks.find(stack.back());
+		stack.pop_back();
+		if (it == id_tasks.end())
+			continue;
+		for (uint32_t id : it->second->property.dependencies) {
+			if (id == p_task->id)
+				return Error::kTaskDependencyCycle;
+			if (visited.insert(id).second)
+				stack.push_back(id);
+		}
+	}
+	return Error::kSuccess;
+}
+} // namespace
+
 struct Schedule::SyncObject {
 	static constexpr const char *kIPCMutexHeader = "_SCHEDULITE_MUTEX_";
-	static constexpr const char *kIPCSHMHeader = "_SCHEDULITE_SHM_";
+	// Renamed with the SHM layout, so that an SHM left by an older build is not opened
+	static constexpr const char *kIPCSHMHeader = "_SCHEDULITE_SHM2_";
+	// The size, version, next Task ID and number of Stores come before the data
+	static constexpr uint32_t kSharedHeaderSize = 16;
 
 	// Named IPC mutex
 	ipc::sync::mutex ipc_mutex;
 
 	// Shared memory
 	ipc::shm::id_t shm_id{};
-	uint32_t *shared_size{}, *shared_version{};
+	uint32_t *shared_size{}, *shared_version{}, *shared_next_id{}, *shared_store_count{};
 	unsigned char *shared_data{};
+	// The shared number of Stores when this process last stored or loaded, another process replaced the manifest if it
+	// differs
+	uint32_t store_count{};
 
 	explicit SyncObject(std::string_view identifier)
 	    : ipc_mutex(std::string{kIPCMutexHeader + std::string(identifier)}.c_str()) {}
@@ -34,177 +83,676 @@ struct Schedule::SyncObject {
 	}
 };
 
+struct Schedule::MetricsObject {
+	Histogram lock_wait, lock_hold, parse, serialize, encrypt, decrypt, file_write;
+	std::atomic_uint64_t bytes_written{}, snapshot_reloads{};
+};
+
+namespace {
+#ifdef SCHEDULITE_ENABLE_METRICS
+thread_local std::chrono::nanoseconds t_last_lock_wait{};
+#endif
+
+// Scoped lock of a Schedule's IPC mutex, records the time spent waiting for and holding it when metrics are enabled
+class IPCLockGuard {
+public:
+	explicit IPCLockGuard(ipc::sync::mutex &mutex, Histogram *wait_histogram, Histogram *hold_histogram)
+	    : m_mutex{mutex}, m_hold_histogram{hold_histogram} {
+		if constexpr (kMetricsEnabled) {
+			auto begin = std::chrono::steady_clock::now();
+			lock();
+			m_locked = std::chrono::steady_clock::now();
+#ifdef SCHEDULITE_ENABLE_METRICS
+			t_last_lock_wait = m_locked - begin;
+#endif
+			wait_histogram->Record(m_locked - begin);
+		} else
+			lock();
+	}
+	~IPCLockGuard() {
+		if constexpr (kMetricsEnabled)
+			m_hold_histogram->Record(std::chrono::steady_clock::now() - m_locked);
+		m_mutex.unlock();
+	}
+	IPCLockGuard(const IPCLockGuard &) = delete;
+	IPCLockGuard &operator=(const IPCLockGuard &) = delete;
+
+private:
+	ipc::sync::mutex &m_mutex;
+	Histogram *m_hold_histogram;
+	std::chrono::steady_clock::time_point m_locked;
+
+	void lock() {
+		SCHEDULITE_TRACE_SCOPE("IPC lock wait");
+		m_mutex.lock();
+	}
+};
+
+// Schedules acquired in the process by User identifier, weakly held so that a Schedule is released with its last token
+struct ScheduleRegistry {
+	struct Entry {
+		std::weak_ptr<Schedule> schedule;
+		// Set while the Schedule is initialized outside the mutex, other Acquires of it wait on initialized
+		bool pending;
+	};
+	std::mutex mutex;
+	std::condition_variable initialized;
+	std::unordered_map<std::string, Entry> schedules;
+
+	static ScheduleRegistry &Get() {
+		static ScheduleRegistry registry;
+		return registry;
+	}
+};
+} // namespace
+
+#ifdef SCHEDULITE_ENABLE_METRICS
+std::chrono::nanoseconds Schedule::GetThreadLastLockWait() { return t_last_lock_wait; }
+#endif
+
 Schedule::Schedule(const std::shared_ptr<User> &user_ptr) {
 	m_user_ptr = user_ptr;
 	m_file_path =
 	    ghc::filesystem::absolute(
 	        ghc::filesystem::path{m_user_ptr->GetInstancePtr()->GetScheduleDirPath()}.append(m_user_ptr->GetName()))
 	        .string();
+	m_archive_file_path = m_file_path + kArchiveFileExtension;
+	// The manifest replacements are told by the shared number of Stores, see store_tasks
+	m_store = std::make_unique<TaskPartitionStore>(m_file_path + kPartitionDirExtension, m_file_path, false);
 	// Generate Identifier
 	uuids::uuid_name_generator gen(uuids::uuid::from_string("20c75eb5-1270-43f4-8af2-1ab7dc7e025e").value());
 	m_identifier = uuids::to_string(gen(m_file_path));
 	// Create sync object
 	m_sync_object = std::make_unique<SyncObject>(m_identifier);
+	m_metrics_object = std::make_unique<MetricsObject>();
 }
 
 std::tuple<std::shared_ptr<Schedule>, Error> Schedule::Acquire(const std::shared_ptr<User> &user_ptr) {
+	auto &registry = ScheduleRegistry::Get();
+	const std::string &identifier = user_ptr->GetIdentifier();
+	std::unique_lock registry_lock{registry.mutex};
+	// Concurrent Acquires of a Schedule wait for the first one, so that its SHM is mapped only once
+	registry.initialized.wait(registry_lock, [&]() {
+		auto it = registry.schedules.find(identifier);
+		return it == registry.schedules.end() || !it->second.pending;
+	});
+	if (auto it = registry.schedules.find(identifier); it != registry.schedules.end()) {
+		if (std::shared_ptr<Schedule> ret = it->second.schedule.lock()) {
+			// A second token of the Schedule would keep caches apart from this one, and store with another key
+			if (ret->m_user_ptr->GetKey() != user_ptr->GetKey())
+				return {nullptr, Error::kUserWrongPassword};
+			// The token keeps the User of its first Acquire, which must locate the same Schedule files
+			assert(ret->m_user_ptr->GetName() == user_ptr->GetName() &&
+			       ret->m_user_ptr->GetInstancePtr()->GetScheduleDirPath() ==
+			           user_ptr->GetInstancePtr()->GetScheduleDirPath());
+			return {std::move(ret), Error::kSuccess};
+		}
+	}
+	registry.schedules[identifier] = {std::weak_ptr<Schedule>{}, true};
+	registry_lock.unlock();
+
+	SCHEDULITE_TRACE_SCOPE("Schedule::Acquire");
 	std::shared_ptr<Schedule> ret = std::make_shared<Schedule>(user_ptr);
 	Error error = ret->initialize_shm_locked();
+
+	registry_lock.lock();
+	for (auto it = registry.schedules.begin(); it != registry.schedules.end();)
+		it = !it->second.pending && it->second.schedule.expired() ? registry.schedules.erase(it) : std::next(it);
+	if (error == Error::kSuccess)
+		registry.schedules[identifier] = {ret, false};
+	else
+		registry.schedules.erase(identifier);
+	registry_lock.unlock();
+	registry.initialized.notify_all();
 	if (error != Error::kSuccess)
 		return {nullptr, error};
 	return {std::move(ret), Error::kSuccess};
 }
 
 std::tuple<uint32_t, Error> Schedule::TaskInsert(const TaskProperty &task_property) {
-	std::scoped_lock ipc_lock{m_sync_object->ipc_mutex};
+	SCHEDULITE_TRACE_SCOPE("Schedule::TaskInsert");
+	IPCLockGuard ipc_lock{m_sync_object->ipc_mutex, &m_metrics_object->lock_wait, &m_metrics_object->lock_hold};
 	// Load shared tasks
 	std::vector<Task> tasks = load_tasks_from_shm();
-	uint32_t id;
-	{
-		// fetch a unique id
-		uint32_t max_id = 0;
-		for (auto &t : tasks)
-			max_id = std::max(t.id, max_id);
-		id = max_id + 1;
-		Error error = insert(&tasks, {id, task_property});
-		if (error != Error::kSuccess)
-			return {0, error};
-	}
+	// fetch a unique id
+	uint32_t id = get_next_id(tasks);
+	Error error = insert(&tasks, {id, task_property});
+	if (error != Error::kSuccess)
+		return {0, error};
 	return {id, store_tasks(tasks)};
 }
 
 Error Schedule::TaskErase(uint32_t id) {
-	std::scoped_lock ipc_lock{m_sync_object->ipc_mutex};
+	SCHEDULITE_TRACE_SCOPE("Schedule::TaskErase");
+	IPCLockGuard ipc_lock{m_sync_object->ipc_mutex, &m_metrics_object->lock_wait, &m_metrics_object->lock_hold};
 	// Load shared tasks
 	std::vector<Task> tasks = load_tasks_from_shm();
-	{
-		// find task
-		auto it = std::find_if(tasks.begin(), tasks.end(), [&id](const Task &c) { return c.id == id; });
-		if (it == tasks.end())
-			return Error::kTaskNotFound;
-		tasks.erase(it);
-	}
+	Error error = erase(&tasks, id);
+	if (error != Error::kSuccess)
+		return error;
 	return store_tasks(tasks);
 }
 
 Error Schedule::TaskToggleDone(uint32_t id) {
-	std::scoped_lock ipc_lock{m_sync_object->ipc_mutex};
+	SCHEDULITE_TRACE_SCOPE("Schedule::TaskToggleDone");
+	IPCLockGuard ipc_lock{m_sync_object->ipc_mutex, &m_metrics_object->lock_wait, &m_metrics_object->lock_hold};
 	// Load shared tasks
 	std::vector<Task> tasks = load_tasks_from_shm();
-	{
-		// find task
-		auto it = std::find_if(tasks.begin(), tasks.end(), [&id](const Task &c) { return c.id == id; });
-		if (it == tasks.end())
-			return Error::kTaskNotFound;
-		it->property.done ^= 1;
-	}
+	Error error = toggle_done(&tasks, id);
+	if (error != Error::kSuccess)
+		return error;
 	return store_tasks(tasks);
 }
 
 Error Schedule::TaskEdit(uint32_t id, const TaskProperty &property, TaskPropertyMask property_edit_mask) {
+	SCHEDULITE_TRACE_SCOPE("Schedule::TaskEdit");
 	if (property_edit_mask == TaskPropertyMask::kNone)
 		return Error::kSuccess;
 
-	std::scoped_lock ipc_lock{m_sync_object->ipc_mutex};
+	IPCLockGuard ipc_lock{m_sync_object->ipc_mutex, &m_metrics_object->lock_wait, &m_metrics_object->lock_hold};
 	// Load shared tasks
 	std::vector<Task> tasks = load_tasks_from_shm();
-	{
-		// find task
-		auto it = std::find_if(tasks.begin(), tasks.end(), [&id](const Task &c) { return c.id == id; });
-		if (it == tasks.end())
-			return Error::kTaskNotFound;
-
-		Task task = TaskPatch(*it, property, property_edit_mask);
-		if ((property_edit_mask & TaskPropertyMask::kKey) != TaskPropertyMask::kNone) {
-			tasks.erase(it);
-			Error error = insert(&tasks, task);
-			if (error != Error::kSuccess)
-				return error;
-		} else
-			*it = task;
-	}
+	Error error = edit(&tasks, id, property, property_edit_mask);
+	if (error != Error::kSuccess)
+		return error;
 	return store_tasks(tasks);
 }
 
-const std::vector<Task> &Schedule::GetTasks() const { return GetTasks(nullptr); }
-const std::vector<Task> &Schedule::GetTasks(bool *p_updated) const {
+std::tuple<std::vector<TaskOpResult>, Error> Schedule::TaskBatch(const std::vector<TaskOp> &ops) {
+	SCHEDULITE_TRACE_SCOPE("Schedule::TaskBatch");
+	std::vector<TaskOpResult> results;
+	results.reserve(ops.size());
+	Error batch_error = Error::kSuccess;
+
+	IPCLockGuard ipc_lock{m_sync_object->ipc_mutex, &m_metrics_object->lock_wait, &m_metrics_object->lock_hold};
+	// Load shared tasks
+	std::vector<Task> tasks = load_tasks_from_shm();
+	uint32_t next_id = get_next_id(tasks);
+	for (const TaskOp &op : ops) {
+		TaskOpResult result{op.id, Error::kSuccess};
+		switch (op.type) {
+		case TaskOpType::kInsert:
+			result.id = next_id;
+			if ((result.error = insert(&tasks, {next_id, op.property})) == Error::kSuccess)
+				++next_id;
+			else
+				result.id = 0;
+			break;
+		case TaskOpType::kErase:
+			result.error = erase(&tasks, op.id);
+			break;
+		case TaskOpType::kEdit:
+			result.error = edit(&tasks, op.id, op.property, op.property_edit_mask);
+			break;
+		case TaskOpType::kToggleDone:
+			result.error = toggle_done(&tasks, op.id);
+			break;
+		}
+		if (batch_error == Error::kSuccess)
+			batch_error = result.error;
+		results.push_back(result);
+	}
+	if (batch_error != Error::kSuccess || ops.empty())
+		return {std::move(results), batch_error};
+	return {std::move(results), store_tasks(tasks)};
+}
+
+std::tuple<uint32_t, Error> Schedule::ArchiveTasks(TimeInt before) {
+	SCHEDULITE_TRACE_SCOPE("Schedule::ArchiveTasks");
+	IPCLockGuard ipc_lock{m_sync_object->ipc_mutex, &m_metrics_object->lock_wait, &m_metrics_object->lock_hold};
+	// Load shared tasks
+	std::vector<Task> tasks = load_tasks_from_shm(), archived, kept;
+	kept.reserve(tasks.size());
+	for (Task &task : tasks) {
+		const TaskProperty &property = task.property;
+		bool archive = property.done && !property.recurrence.IsRecurring() && TaskEndTime(property) < before;
+		(archive ? archived : kept).push_back(std::move(task));
+	}
+	if (archived.empty())
+		return {0, Error::kSuccess};
+
+	// Drop the edges to the archived Tasks, which are done
+	std::vector<uint32_t> archived_ids;
+	archived_ids.reserve(archived.size());
+	for (const Task &task : archived)
+		archived_ids.push_back(task.id);
+	std::sort(archived_ids.begin(), archived_ids.end());
+	const auto is_archived = [&archived_ids](uint32_t id) {
+		return std::binary_search(archived_ids.begin(), archived_ids.end(), id);
+	};
+	for (Task &task : kept) {
+		auto &dependencies = task.property.dependencies;
+		dependencies.erase(std::remove_if(dependencies.begin(), dependencies.end(), is_archived), dependencies.end());
+	}
+
+	// The archive is appended first, so that no Task is lost if storing fails
+	if (!m_user_ptr->GetInstancePtr()->MaintainDirs())
+		return {0, Error::kFileIOError};
+	uint64_t archive_size;
+	if (Error error = TaskArchive::Append(m_archive_file_path, m_user_ptr->GetKey(), archived, &archive_size);
+	    error != Error::kSuccess) {
+		if (error == Error::kFileIOError)
+			m_user_ptr->GetInstancePtr()->InvalidateDirs();
+		return {0, error};
+	}
+	std::string shared_raw{(const char *)m_sync_object->shared_data, *m_sync_object->shared_size};
+	// The IDs of the archived Tasks are not assigned again, even if they were the highest
+	*m_sync_object->shared_next_id = std::max(*m_sync_object->shared_next_id, archived_ids.back() + 1);
+	if (Error error = store_tasks(kept); error != Error::kSuccess) {
+		// Nothing was committed to the files, so put the Tasks back in SHM as they are stored, and drop their block so
+		// that archiving them again does not duplicate them
+		store_tasks_to_shm(shared_raw);
+		TaskArchive::Truncate(m_archive_file_path, archive_size);
+		std::scoped_lock archive_lock{m_archive_mutex};
+		m_archive = TaskArchive{};
+		return {0, error};
+	}
+	return {(uint32_t)archived.size(), Error::kSuccess};
+}
+
+std::tuple<std::vector<Task>, Error> Schedule::QueryArchivedTasks(const TaskQuery &query) const {
+	SCHEDULITE_TRACE_SCOPE("Schedule::QueryArchivedTasks");
+	std::scoped_lock archive_lock{m_archive_mutex};
+	if (Error error = m_archive.Load(m_archive_file_path, m_user_ptr->GetKey()); error != Error::kSuccess)
+		return {std::vector<Task>{}, error};
+	return {m_archive.Query(query), Error::kSuccess};
+}
+
+std::tuple<std::vector<Task>, Error> Schedule::SearchArchivedTasks(std::string_view query, uint32_t limit) const {
+	SCHEDULITE_TRACE_SCOPE("Schedule::SearchArchivedTasks");
+	std::scoped_lock archive_lock{m_archive_mutex};
+	if (Error error = m_archive.Load(m_archive_file_path, m_user_ptr->GetKey()); error != Error::kSuccess)
+		return {std::vector<Task>{}, error};
+	return {m_archive.Search(query, limit), Error::kSuccess};
+}
+
+std::tuple<uint32_t, Error> Schedule::TaskImport(std::vector<TaskProperty> properties) {
+	SCHEDULITE_TRACE_SCOPE("Schedule::TaskImport");
+	// Sort and deduplicate outside of the lock, the first of equal keys is kept
+	std::stable_sort(properties.begin(), properties.end(), TaskPropertyKeyLess);
+	properties.erase(std::unique(properties.begin(), properties.end(), TaskPropertyKeyEqual), properties.end());
+
+	IPCLockGuard ipc_lock{m_sync_object->ipc_mutex, &m_metrics_object->lock_wait, &m_metrics_object->lock_hold};
+	// Load shared tasks
+	std::vector<Task> tasks = load_tasks_from_shm();
+	uint32_t next_id = get_next_id(tasks), inserted = 0;
+
+	// Merge the sorted lists, existing Tasks take precedence
+	std::vector<Task> merged;
+	merged.reserve(tasks.size() + properties.size());
+	auto task_it = tasks.begin();
+	for (auto &property : properties) {
+		while (task_it != tasks.end() && TaskPropertyKeyLess(task_it->property, property))
+			merged.push_back(std::move(*task_it++));
+		if (task_it != tasks.end() && TaskPropertyKeyEqual(task_it->property, property))
+			continue;
+		// Dependencies are IDs of a Schedule, which do not carry over
+		property.dependencies.clear();
+		merged.push_back({next_id++, std::move(property)});
+		++inserted;
+	}
+	std::move(task_it, tasks.end(), std::back_inserter(merged));
+
+	if (inserted == 0)
+		return {0, Error::kSuccess};
+	Error error = store_tasks(merged);
+	return {error == Error::kSuccess ? inserted : 0, error};
+}
+
+const std::vector<Task> &Schedule::GetTasks() const { return *get_local_tasks().first; }
+TaskSnapshot Schedule::GetTaskSnapshot(uint32_t *p_version) const {
+	const auto &[tasks, version] = get_local_tasks();
+	if (p_version)
+		*p_version = version;
+	return tasks;
+}
+std::shared_ptr<const TaskColumns> Schedule::GetTaskColumns(TaskSnapshot *p_tasks) const {
+	const auto &[tasks, version] = get_local_tasks();
+	std::scoped_lock columns_lock{m_columns_mutex};
+	if (!m_columns || m_columns_version != version) {
+		SCHEDULITE_TRACE_SCOPE("TaskColumnsFromTasks");
+		m_columns = std::make_shared<const TaskColumns>(TaskColumnsFromTasks(*tasks));
+		m_columns_version = version;
+		m_columns_tasks = tasks;
+	}
+	*p_tasks = m_columns_tasks;
+	return m_columns;
+}
+const std::pair<TaskSnapshot, uint32_t> &Schedule::get_local_tasks() const {
+	SCHEDULITE_TRACE_SCOPE("Schedule::GetTasks");
 	// Acquire a local tasks cache
 	std::unique_lock cache_lock{m_local_tasks_mutex};
 	auto &local_tasks = m_local_tasks[std::this_thread::get_id()];
 	cache_lock.unlock();
 
 	{ // Examine the shared version
-		std::scoped_lock ipc_lock{m_sync_object->ipc_mutex};
+		IPCLockGuard ipc_lock{m_sync_object->ipc_mutex, &m_metrics_object->lock_wait, &m_metrics_object->lock_hold};
 		if (*m_sync_object->shared_version > local_tasks.second) {
-			local_tasks = {load_tasks_from_shm(), *m_sync_object->shared_version};
-			if (p_updated)
-				*p_updated = true;
-		} else if (p_updated)
-			*p_updated = false;
+			local_tasks = {std::make_shared<const std::vector<Task>>(load_tasks_from_shm()),
+			               *m_sync_object->shared_version};
+			if constexpr (kMetricsEnabled)
+				m_metrics_object->snapshot_reloads.fetch_add(1, std::memory_order_relaxed);
+		}
 	}
-	return local_tasks.first;
+	return local_tasks;
 }
 
-Error Schedule::insert(std::vector<Task> *tasks, const Task &task) {
+std::vector<Task> Schedule::SearchTasks(std::string_view query, uint32_t limit) const {
+	SCHEDULITE_TRACE_SCOPE("Schedule::SearchTasks");
+	const auto &[tasks, version] = get_local_tasks();
+	std::vector<SearchResult> results;
+	{
+		std::scoped_lock search_lock{m_search_mutex};
+		if (m_search_version != version) {
+			m_search_index.Update(*tasks);
+			m_search_version = version;
+		}
+		results = m_search_index.Search(query, limit);
+	}
+	std::vector<Task> matched;
+	matched.reserve(results.size());
+	for (const auto &result : results)
+		matched.push_back((*tasks)[result.index]);
+	return matched;
+}
+
+TaskSnapshot Schedule::GetTaskOccurrences(TimeInt since, TimeInt until) const {
+	SCHEDULITE_TRACE_SCOPE("Schedule::GetTaskOccurrences");
+	const auto &[tasks, version] = get_local_tasks();
+	std::scoped_lock occurrence_lock{m_occurrence_mutex};
+	for (auto it = m_occurrence_windows.begin(); it != m_occurrence_windows.end(); ++it) {
+		if (it->version != version || it->since != since || it->until != until)
+			continue;
+		std::rotate(m_occurrence_windows.begin(), it, it + 1);
+		return m_occurrence_windows.front().occurrences;
+	}
+	// Windows of older versions are never hit again
+	const auto stale = [version = version](const OccurrenceWindow &window) { return window.version != version; };
+	m_occurrence_windows.erase(std::remove_if(m_occurrence_windows.begin(), m_occurrence_windows.end(), stale),
+	                           m_occurrence_windows.end());
+	if (m_occurrence_windows.size() >= kOccurrenceCacheSize)
+		m_occurrence_windows.pop_back();
+	auto occurrences = std::make_shared<const std::vector<Task>>(ExpandTaskOccurrences(*tasks, since, until));
+	m_occurrence_windows.insert(m_occurrence_windows.begin(), {version, since, until, occurrences});
+	return occurrences;
+}
+
+std::unique_lock<std::mutex> Schedule::lock_interval_index(TaskSnapshot *p_tasks) const {
+	const auto &[tasks, version] = get_local_tasks();
+	std::unique_lock interval_lock{m_interval_mutex};
+	if (m_interval_version != version || !m_interval_tasks) {
+		m_interval_index.Build(*tasks);
+		m_interval_version = version;
+		m_interval_tasks = tasks;
+	}
+	*p_tasks = m_interval_tasks;
+	return interval_lock;
+}
+
+std::vector<Task> Schedule::GetOverlappingTasks(TimeInt begin, TimeInt end) const {
+	SCHEDULITE_TRACE_SCOPE("Schedule::GetOverlappingTasks");
+	TaskSnapshot tasks;
+	std::vector<IntervalResult> results;
+	{
+		auto interval_lock = lock_interval_index(&tasks);
+		results = m_interval_index.QueryOverlaps(begin, end);
+	}
+	std::vector<Task> overlapping;
+	overlapping.reserve(results.size());
+	for (const auto &result : results)
+		overlapping.push_back(MakeTaskOccurrence((*tasks)[result.index], result.begin_time));
+	return overlapping;
+}
+
+std::vector<TaskDependencyInfo> Schedule::get_dependency_infos(bool critical_path) const {
+	const auto &[tasks, version] = get_local_tasks();
+	std::vector<DependencyResult> results;
+	{
+		std::scoped_lock dependency_lock{m_dependency_mutex};
+		if (m_dependency_version != version) {
+			m_dependency_graph.Update(*tasks);
+			m_dependency_version = version;
+		}
+		results = critical_path ? m_dependency_graph.GetCriticalPath() : m_dependency_graph.GetBlocked();
+	}
+	std::vector<TaskDependencyInfo> infos;
+	infos.reserve(results.size());
+	for (const auto &result : results)
+		infos.push_back({(*tasks)[result.index], result.earliest_begin, result.latest_begin});
+	return infos;
+}
+
+std::vector<TaskDependencyInfo> Schedule::GetBlockedTasks() const {
+	SCHEDULITE_TRACE_SCOPE("Schedule::GetBlockedTasks");
+	return get_dependency_infos(false);
+}
+
+std::vector<TaskDependencyInfo> Schedule::GetCriticalPath() const {
+	SCHEDULITE_TRACE_SCOPE("Schedule::GetCriticalPath");
+	return get_dependency_infos(true);
+}
+
+std::vector<DayTaskCounts> Schedule::GetDayCounts(int64_t first_day, int64_t last_day) const {
+	SCHEDULITE_TRACE_SCOPE("Schedule::GetDayCounts");
+	const auto &[tasks, version] = get_local_tasks();
+	std::scoped_lock calendar_lock{m_calendar_mutex};
+	if (m_calendar_version != version) {
+		m_calendar_index.Update(*tasks);
+		m_calendar_version = version;
+	}
+	return m_calendar_index.GetDayCounts(*tasks, first_day, last_day, GetTimeIntNow());
+}
+
+TaskCounts Schedule::GetRangeCounts(int64_t first_day, int64_t last_day) const {
+	SCHEDULITE_TRACE_SCOPE("Schedule::GetRangeCounts");
+	const auto &[tasks, version] = get_local_tasks();
+	std::scoped_lock calendar_lock{m_calendar_mutex};
+	if (m_calendar_version != version) {
+		m_calendar_index.Update(*tasks);
+		m_calendar_version = version;
+	}
+	return m_calendar_index.GetRangeCounts(*tasks, first_day, last_day, GetTimeIntNow());
+}
+
+TaskReport Schedule::GetTaskReport(TimeInt since, TimeInt until) const {
+	SCHEDULITE_TRACE_SCOPE("Schedule::GetTaskReport");
+	const auto &[tasks, version] = get_local_tasks();
+	std::shared_ptr<const TaskReportColumns> columns;
+	{
+		std::scoped_lock report_lock{m_report_mutex};
+		if (!m_report_columns || m_report_version != version) {
+			m_report_columns = std::make_shared<const TaskReportColumns>(TaskReportColumnsFromTasks(*tasks));
+			m_report_version = version;
+		}
+		columns = m_report_columns;
+	}
+	TaskReportOptions options;
+	options.since = since;
+	options.until = until;
+	return AnalyzeTasks(*columns, options);
+}
+
+std::vector<Task> Schedule::GetTaskConflicts(const TaskProperty &property, uint32_t id) const {
+	SCHEDULITE_TRACE_SCOPE("Schedule::GetTaskConflicts");
+	std::vector<Task> conflicts;
+	if (!property.duration)
+		return conflicts;
+	auto horizon = (TimeInt)std::min<uint64_t>(uint64_t(property.begin_time) + kConflictMinutes,
+	                                           std::numeric_limits<TimeInt>::max());
+	std::vector<TimeInt> begin_times = GetOccurrenceTimes(property, property.begin_time, horizon);
+
+	TaskSnapshot tasks;
+	std::vector<IntervalResult> results;
+	{
+		auto interval_lock = lock_interval_index(&tasks);
+		for (TimeInt begin_time : begin_times) {
+			TaskProperty occurrence = property;
+			occurrence.begin_time = begin_time;
+			auto overlaps = m_interval_index.QueryOverlaps(begin_time, TaskEndTime(occurrence));
+			results.insert(results.end(), overlaps.begin(), overlaps.end());
+		}
+	}
+	// An occurrence may overlap several occurrences of a recurring TaskProperty
+	const auto result_less = [](const IntervalResult &l, const IntervalResult &r) {
+		return std::tie(l.begin_time, l.index) < std::tie(r.begin_time, r.index);
+	};
+	const auto result_equal = [](const IntervalResult &l, const IntervalResult &r) {
+		return l.begin_time == r.begin_time && l.index == r.index;
+	};
+	std::sort(results.begin(), results.end(), result_less);
+	results.erase(std::unique(results.begin(), results.end(), result_equal), results.end());
+	for (const auto &result : results)
+		if ((*tasks)[result.index].id != id)
+			conflicts.push_back(MakeTaskOccurrence((*tasks)[result.index], result.begin_time));
+	return conflicts;
+}
+
+std::tuple<TimeInt, bool> Schedule::FindFreeSlot(TimeInt after, uint32_t duration, TimeInt until) const {
+	SCHEDULITE_TRACE_SCOPE("Schedule::FindFreeSlot");
+	TaskSnapshot tasks;
+	auto interval_lock = lock_interval_index(&tasks);
+	return m_interval_index.FindFreeSlot(after, duration, until);
+}
+
+std::vector<Task> Schedule::QueryTasks(const TaskQuery &query) const {
+	const auto &tasks = GetTasks();
+	auto [first, last] = QueryTaskRange(tasks, query);
+	return {tasks.begin() + (std::ptrdiff_t)first, tasks.begin() + (std::ptrdiff_t)last};
+}
+
+std::tuple<std::size_t, std::size_t> Schedule::QueryTaskRange(const std::vector<Task> &tasks, const TaskQuery &query) {
+	if (query.since >= query.until)
+		return {0, 0};
+	// Tasks are sorted by (begin_time, name)
+	auto begin_less = [](const Task &task, TimeInt time) { return task.property.begin_time < time; };
+	std::size_t first = std::lower_bound(tasks.begin(), tasks.end(), query.since, begin_less) - tasks.begin();
+	std::size_t last = std::lower_bound(tasks.begin() + (std::ptrdiff_t)first, tasks.end(), query.until, begin_less) -
+	                   tasks.begin();
+	first = std::min<std::size_t>(first + query.offset, last);
+	last = std::min<std::size_t>(last, first + query.limit);
+	return {first, last};
+}
+
+uint32_t Schedule::get_max_id(const std::vector<Task> &tasks) {
+	uint32_t max_id = 0;
+	for (auto &t : tasks)
+		max_id = std::max(t.id, max_id);
+	return max_id;
+}
+
+uint32_t Schedule::get_next_id(const std::vector<Task> &tasks) const {
+	return std::max(*m_sync_object->shared_next_id, get_max_id(tasks) + 1);
+}
+
+Error Schedule::insert(std::vector<Task> *tasks, Task task) {
+	if (Error error = check_dependencies(*tasks, &task); error != Error::kSuccess)
+		return error;
 	auto it = std::lower_bound(tasks->begin(), tasks->end(), task, TaskKeyLess);
 	if (it != tasks->end() && TaskKeyEqual(task, *it))
 		return Error::kTaskAlreadyExist;
-	tasks->insert(it, task);
+	tasks->insert(it, std::move(task));
+	return Error::kSuccess;
+}
+
+Error Schedule::erase(std::vector<Task> *tasks, uint32_t id) {
+	auto it = std::find_if(tasks->begin(), tasks->end(), [&id](const Task &c) { return c.id == id; });
+	if (it == tasks->end())
+		return Error::kTaskNotFound;
+	tasks->erase(it);
+	// Drop the edges to the erased Task, whose ID may be assigned again
+	for (Task &task : *tasks) {
+		auto &dependencies = task.property.dependencies;
+		auto dependency_it = std::lower_bound(dependencies.begin(), dependencies.end(), id);
+		if (dependency_it != dependencies.end() && *dependency_it == id)
+			dependencies.erase(dependency_it);
+	}
+	return Error::kSuccess;
+}
+
+Error Schedule::toggle_done(std::vector<Task> *tasks, uint32_t id) {
+	auto it = std::find_if(tasks->begin(), tasks->end(), [&id](const Task &c) { return c.id == id; });
+	if (it == tasks->end())
+		return Error::kTaskNotFound;
+	it->property.done ^= 1;
+	it->property.done_time = it->property.done ? GetTimeIntNow() : 0;
+	return Error::kSuccess;
+}
+
+Error Schedule::edit(std::vector<Task> *tasks, uint32_t id, const TaskProperty &property,
+                     TaskPropertyMask property_edit_mask) {
+	auto it = std::find_if(tasks->begin(), tasks->end(), [&id](const Task &c) { return c.id == id; });
+	if (it == tasks->end())
+		return Error::kTaskNotFound;
+
+	Task task = TaskPatch(*it, property, property_edit_mask);
+	if (task.property.done != it->property.done)
+		task.property.done_time = task.property.done ? GetTimeIntNow() : 0;
+	if ((property_edit_mask & TaskPropertyMask::kDependencies) != TaskPropertyMask::kNone)
+		if (Error error = check_dependencies(*tasks, &task); error != Error::kSuccess)
+			return error;
+	if ((property_edit_mask & TaskPropertyMask::kKey) != TaskPropertyMask::kNone) {
+		Task origin = std::move(*it);
+		tasks->erase(it);
+		Error error = insert(tasks, task);
+		// Restore the origin Task, so that a batch can continue
+		if (error != Error::kSuccess)
+			insert(tasks, origin);
+		return error;
+	}
+	*it = task;
 	return Error::kSuccess;
 }
 
 Error Schedule::initialize_shm_locked() {
+	SCHEDULITE_TRACE_SCOPE("Schedule::Initialize");
 	if (!m_user_ptr->GetInstancePtr()->MaintainDirs())
 		return Error::kFileIOError;
 
 	std::string shm_name = SyncObject::kIPCSHMHeader + m_identifier;
+	constexpr std::size_t kSHMSize = kMaxSharedScheduleMemory + SyncObject::kSharedHeaderSize;
 	{
-		std::scoped_lock ipc_lock{m_sync_object->ipc_mutex};
-		m_sync_object->shm_id = ipc::shm::acquire(shm_name.c_str(), kMaxSharedScheduleMemory + 8, ipc::shm::open);
+		IPCLockGuard ipc_lock{m_sync_object->ipc_mutex, &m_metrics_object->lock_wait, &m_metrics_object->lock_hold};
+		m_sync_object->shm_id = ipc::shm::acquire(shm_name.c_str(), kSHMSize, ipc::shm::open);
 		if (m_sync_object->shm_id) {
 			// If SHM already exists, open it
 			std::size_t size;
 			auto mem = (unsigned char *)ipc::shm::get_mem(m_sync_object->shm_id, &size);
-			if (size < kMaxSharedScheduleMemory + 8)
+			if (size < kSHMSize)
 				return Error::kSHMInitializationError;
 			m_sync_object->shared_size = (uint32_t *)mem;
 			m_sync_object->shared_version = (uint32_t *)(mem + 4);
-			m_sync_object->shared_data = mem + 8;
+			m_sync_object->shared_next_id = (uint32_t *)(mem + 8);
+			m_sync_object->shared_store_count = (uint32_t *)(mem + 12);
+			m_sync_object->shared_data = mem + SyncObject::kSharedHeaderSize;
+			m_sync_object->store_count = *m_sync_object->shared_store_count;
 			return Error::kSuccess;
 		} else {
 			// Otherwise, create SHM and copy file data to it
-			m_sync_object->shm_id = ipc::shm::acquire(shm_name.c_str(), kMaxSharedScheduleMemory + 8, ipc::shm::create);
+			m_sync_object->shm_id = ipc::shm::acquire(shm_name.c_str(), kSHMSize, ipc::shm::create);
 			if (!m_sync_object->shm_id)
 				return Error::kSHMInitializationError;
 			std::size_t size;
 			auto mem = (unsigned char *)ipc::shm::get_mem(m_sync_object->shm_id, &size);
-			if (size < kMaxSharedScheduleMemory + 8)
+			if (size < kSHMSize)
 				return Error::kSHMInitializationError;
 			m_sync_object->shared_size = (uint32_t *)mem;
 			m_sync_object->shared_version = (uint32_t *)(mem + 4);
-			m_sync_object->shared_data = mem + 8;
+			m_sync_object->shared_next_id = (uint32_t *)(mem + 8);
+			m_sync_object->shared_store_count = (uint32_t *)(mem + 12);
+			m_sync_object->shared_data = mem + SyncObject::kSharedHeaderSize;
 
 			*m_sync_object->shared_size = 0;
 			*m_sync_object->shared_version = 1;
+			*m_sync_object->shared_next_id = 0;
+			*m_sync_object->shared_store_count = m_sync_object->store_count = 0;
 
-			std::string encrypted;
-			{
-				nowide::ifstream in{m_file_path, std::ios::binary};
-				if (!in.is_open()) {
-					return Error::kSuccess;
-				}
-				// get length of file
-				in.seekg(0, nowide::ifstream::end);
-				std::streamsize length = in.tellg();
-				in.seekg(0, nowide::ifstream::beg);
-				// read file
-				if (length > 0) {
-					encrypted.resize(length);
-					in.read((char *)encrypted.data(), length);
-				} else
-					return Error::kSuccess;
+			auto [raw, error] = load_tasks_from_file(m_sync_object->shared_next_id);
+			if (error != Error::kSuccess) {
+				// Released while locked, so that no other process opens the SHM left empty
+				ipc::shm::release(m_sync_object->shm_id);
+				m_sync_object->shm_id = {};
+				return error;
 			}
-			std::string raw = Decrypt(encrypted, m_user_ptr->GetKey());
 			if (raw.size() > kMaxSharedScheduleMemory)
 				raw.resize(kMaxSharedScheduleMemory);
 			*m_sync_object->shared_size = raw.size();
@@ -216,49 +764,117 @@ Error Schedule::initialize_shm_locked() {
 }
 
 std::vector<Task> Schedule::load_tasks_from_shm() const {
-	return parse_string({(char *)m_sync_object->shared_data, *m_sync_object->shared_size});
+	HistogramTimer timer{&m_metrics_object->parse};
+	SCHEDULITE_TRACE_SCOPE("TasksFromStr");
+	return TasksFromStr({(char *)m_sync_object->shared_data, *m_sync_object->shared_size});
 }
 
 Error Schedule::store_tasks(const std::vector<Task> &tasks) {
-	std::string raw = get_string(tasks);
+	std::vector<TaskPartition> partitions;
+	std::string raw;
+	{
+		HistogramTimer timer{&m_metrics_object->serialize};
+		SCHEDULITE_TRACE_SCOPE("StrFromTasks");
+		// The Schedule string is made of the partition records, so the Tasks are serialized once
+		partitions = PartitionTasks(tasks);
+		raw = StrFromTasks({});
+		for (const TaskPartition &partition : partitions)
+			raw += partition.records;
+	}
 	{ // Store to SHM
 		if (raw.size() > kMaxSharedScheduleMemory) {
 			return Error::kSHMSizeExceed;
 		}
-		*m_sync_object->shared_size = raw.size();
-		++(*m_sync_object->shared_version);
-		std::copy(raw.begin(), raw.end(), m_sync_object->shared_data);
+		store_tasks_to_shm(raw);
+		*m_sync_object->shared_next_id = get_next_id(tasks);
 	}
 
-	{ // Then store to file
-		if (!m_user_ptr->GetInstancePtr()->MaintainDirs())
-			return Error::kFileIOError;
-		std::string encrypted = Encrypt(raw, m_user_ptr->GetKey());
-		nowide::ofstream out{m_file_path, std::ios::binary};
-		if (!out.is_open())
+	{ // Then store the changed partitions to files
+		const auto &instance_ptr = m_user_ptr->GetInstancePtr();
+		if (!instance_ptr->MaintainDirs())
 			return Error::kFileIOError;
-		out.write(encrypted.data(), (std::streamsize)encrypted.size());
+		TaskStoreStats stats{};
+		uint32_t next_id = *m_sync_object->shared_next_id;
+		// Another process stored since, so the cached manifest may be replaced. Counted whether or not storing
+		// succeeds, as a failed Store may have replaced it too
+		if (*m_sync_object->shared_store_count != m_sync_object->store_count)
+			m_store->InvalidateManifest();
+		Error error = m_store->Store(partitions, m_user_ptr->GetKey(), &stats, next_id);
+		if (error == Error::kFileIOError) {
+			// The directories may have been removed, check them again and retry once
+			instance_ptr->InvalidateDirs();
+			if (instance_ptr->MaintainDirs())
+				error = m_store->Store(partitions, m_user_ptr->GetKey(), &stats, next_id);
+		}
+		m_sync_object->store_count = ++(*m_sync_object->shared_store_count);
+		if constexpr (kMetricsEnabled) {
+			m_metrics_object->encrypt.Record(stats.encrypt);
+			m_metrics_object->file_write.Record(stats.file_write);
+			m_metrics_object->bytes_written.fetch_add(stats.bytes_written, std::memory_order_relaxed);
+		}
+		return error;
 	}
-	return Error::kSuccess;
 }
 
-std::string Schedule::get_string(const std::vector<Task> &tasks) {
+void Schedule::store_tasks_to_shm(std::string_view raw) {
+	*m_sync_object->shared_size = raw.size();
+	++(*m_sync_object->shared_version);
+	std::copy(raw.begin(), raw.end(), m_sync_object->shared_data);
+}
+
+std::tuple<std::string, Error> Schedule::load_tasks_from_file(uint32_t *p_next_id) const {
+	TaskStoreStats stats{};
+	auto [raw, error] = m_store->Load(m_user_ptr->GetKey(), &stats, p_next_id);
+	if constexpr (kMetricsEnabled)
+		m_metrics_object->decrypt.Record(stats.decrypt);
+	return {std::move(raw), error};
+}
+
+ScheduleMetrics Schedule::GetMetrics() const {
+	ScheduleMetrics metrics{};
+	metrics.shm_capacity = kMaxSharedScheduleMemory;
+	if (m_sync_object->shared_size) {
+		IPCLockGuard ipc_lock{m_sync_object->ipc_mutex, &m_metrics_object->lock_wait, &m_metrics_object->lock_hold};
+		metrics.shm_size = *m_sync_object->shared_size;
+	}
+	if constexpr (kMetricsEnabled) {
+		metrics.lock_wait = m_metrics_object->lock_wait.GetSnapshot();
+		metrics.lock_hold = m_metrics_object->lock_hold.GetSnapshot();
+		metrics.parse = m_metrics_object->parse.GetSnapshot();
+		metrics.serialize = m_metrics_object->serialize.GetSnapshot();
+		metrics.encrypt = m_metrics_object->encrypt.GetSnapshot();
+		metrics.decrypt = m_metrics_object->decrypt.GetSnapshot();
+		metrics.file_write = m_metrics_object->file_write.GetSnapshot();
+		metrics.bytes_written = m_metrics_object->bytes_written.load(std::memory_order_relaxed);
+		metrics.snapshot_reloads = m_metrics_object->snapshot_reloads.load(std::memory_order_relaxed);
+	}
+	return metrics;
+}
+
+std::string Schedule::StrFromTasks(const std::vector<Task> &tasks) {
 	std::string ret = kStringHeader;
+	ret.append(4, '\0');
+	ret += (char)kTaskStrVersion;
 	for (const Task &task : tasks)
 		ret += StrFromTask(task);
 	return ret;
 }
-std::vector<Task> Schedule::parse_string(std::string_view str) {
+std::vector<Task> Schedule::TasksFromStr(std::string_view str) {
 	if (str.length() < kStringHeaderLength || str.substr(0, kStringHeaderLength) != kStringHeader)
 		return std::vector<Task>{}; // Return empty if header not match (do not drop error)
 
 	std::vector<Task> ret;
 	str = str.substr(kStringHeaderLength);
+	uint8_t version = 1;
+	if (str.length() >= kStringVersionLength && str.substr(0, 4) == std::string_view("\0\0\0\0", 4)) {
+		version = (uint8_t)str[4];
+		str = str.substr(kStringVersionLength);
+	}
 
 	Task task;
 	uint32_t len;
 	while (true) {
-		std::tie(task, len) = TaskFromStr(str);
+		std::tie(task, len) = TaskFromStr(str, version);
 		if (len == 0)
 			break;
 		ret.push_back(task);
@@ -0,0 +1,192 @@
+#include <backend/Search.hpp>
+
+#include <backend/Trace.hpp>
+
+#include <algorithm>
+
+namespace backend {
+
+namespace {
+inline char fold_char(char c) { return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c; }
+inline std::string fold_str(std::string_view str) {
+	std::string folded(str.size(), '\0');
+	std::transform(str.begin(), str.end(), folded.begin(), fold_char);
+	return folded;
+}
+inline uint32_t get_trigram(const char *p) {
+	return uint32_t(uint8_t(p[0])) | (uint32_t(uint8_t(p[1])) << 8u) | (uint32_t(uint8_t(p[2])) << 16u);
+}
+inline bool is_word_char(char c) {
+	return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || (unsigned char)c >= 0x80u;
+}
+// The best match of a query in a name, both case-folded
+inline bool match_name(std::string_view name, std::string_view query, SearchMatch *p_match) {
+	std::size_t pos = name.find(query);
+	if (pos == std::string_view::npos)
+		return false;
+	if (pos == 0) {
+		*p_match = name.size() == query.size() ? SearchMatch::kExact : SearchMatch::kPrefix;
+		return true;
+	}
+	for (; pos != std::string_view::npos; pos = name.find(query, pos + 1))
+		if (!is_word_char(name[pos - 1])) {
+			*p_match = SearchMatch::kWordPrefix;
+			return true;
+		}
+	*p_match = SearchMatch::kSubstring;
+	return true;
+}
+} // namespace
+
+void TaskSearchIndex::add_entry(uint32_t id, uint32_t index, std::string_view name) {
+	auto entry_id = (uint32_t)m_entries.size();
+	m_entries.push_back({id, index, m_generation, true, fold_str(name)});
+	m_id_entries[id] = entry_id;
+	++m_alive;
+
+	const std::string &folded = m_entries.back().name;
+	for (std::size_t i = 0; i + 3 <= folded.size(); ++i) {
+		auto &posting = m_postings[get_trigram(folded.data() + i)];
+		// Repeated trigrams of a name are posted once, entries are appended in ascending order
+		if (posting.empty() || posting.back() != entry_id)
+			posting.push_back(entry_id);
+	}
+}
+
+void TaskSearchIndex::compact() {
+	SCHEDULITE_TRACE_SCOPE("TaskSearchIndex::compact");
+	std::vector<Entry> entries;
+	entries.swap(m_entries);
+	m_id_entries.clear();
+	m_postings.clear();
+	m_alive = 0;
+	for (const auto &entry : entries)
+		if (entry.alive)
+			add_entry(entry.id, entry.index, entry.name);
+}
+
+void TaskSearchIndex::Update(const std::vector<Task> &tasks) {
+	SCHEDULITE_TRACE_SCOPE("TaskSearchIndex::Update");
+	++m_generation;
+	std::vector<uint32_t> index_entries(tasks.size());
+	for (uint32_t index = 0; index < (uint32_t)tasks.size(); ++index) {
+		const Task &task = tasks[index];
+		// Most Tasks keep their positions, which saves the lookup by ID
+		uint32_t entry_id = index < m_index_entries.size() ? m_index_entries[index] : kNoEntry;
+		if (entry_id == kNoEntry || m_entries[entry_id].id != task.id || !m_entries[entry_id].alive) {
+			auto it = m_id_entries.find(task.id);
+			entry_id = it == m_id_entries.end() ? kNoEntry : it->second;
+		}
+		if (entry_id != kNoEntry) {
+			Entry &entry = m_entries[entry_id];
+			if (entry.name.size() == task.property.name.size() &&
+			    std::equal(entry.name.begin(), entry.name.end(), task.property.name.begin(),
+			               [](char l, char r) { return l == fold_char(r); })) {
+				entry.index = index;
+				entry.generation = m_generation;
+				index_entries[index] = entry_id;
+				continue;
+			}
+			// Renamed
+			entry.alive = false;
+			--m_alive;
+		}
+		index_entries[index] = (uint32_t)m_entries.size();
+		add_entry(task.id, index, task.property.name);
+	}
+	// Erased, the alive entries not seen in this generation
+	for (auto it = m_id_entries.begin(); m_alive > tasks.size() && it != m_id_entries.end();) {
+		Entry &entry = m_entries[it->second];
+		if (entry.generation != m_generation) {
+			entry.alive = false;
+			--m_alive;
+			it = m_id_entries.erase(it);
+		} else
+			++it;
+	}
+	if (m_entries.size() > 64 && m_alive < m_entries.size() / 2) {
+		compact();
+		for (uint32_t entry_id = 0; entry_id < (uint32_t)m_entries.size(); ++entry_id)
+			index_entries[m_entries[entry_id].index] = entry_id;
+	}
+	m_index_entries = std::move(index_entries);
+}
+
+std::vector<SearchResult> TaskSearchIndex::Search(std::string_view query, uint32_t limit) const {
+	SCHEDULITE_TRACE_SCOPE("TaskSearchIndex::Search");
+	if (query.empty() || !limit)
+		return {};
+	std::string folded = fold_str(query);
+
+	struct Candidate {
+		uint32_t entry_id;
+		SearchMatch match;
+	};
+	std::vector<Candidate> candidates;
+	const auto try_entry = [this, &folded, &candidates](uint32_t entry_id) {
+		const Entry &entry = m_entries[entry_id];
+		SearchMatch match;
+		if (entry.alive && match_name(entry.name, folded, &match))
+			candidates.push_back({entry_id, match});
+	};
+
+	if (folded.size() < 3) {
+		// Shorter than a trigram, scan the names
+		for (uint32_t entry_id = 0; entry_id < (uint32_t)m_entries.size(); ++entry_id)
+			try_entry(entry_id);
+	} else {
+		// Intersect the postings of the query trigrams from the shortest, then verify the candidates
+		std::vector<const std::vector<uint32_t> *> postings;
+		for (std::size_t i = 0; i + 3 <= folded.size(); ++i) {
+			auto it = m_postings.find(get_trigram(folded.data() + i));
+			if (it == m_postings.end())
+				return {};
+			postings.push_back(&it->second);
+		}
+		std::sort(postings.begin(), postings.end(), [](auto l, auto r) { return l->size() < r->size(); });
+		postings.erase(std::unique(postings.begin(), postings.end()), postings.end());
+
+		std::vector<uint32_t> entry_ids = *postings.front();
+		candidates.reserve(entry_ids.size());
+		for (std::size_t p = 1; p < postings.size() && !entry_ids.empty(); ++p) {
+			// Gallop through the longer posting
+			const std::vector<uint32_t> &posting = *postings[p];
+			std::size_t pos = 0, size = posting.size();
+			auto out_it = entry_ids.begin();
+			for (uint32_t entry_id : entry_ids) {
+				std::size_t step = 1;
+				while (pos + step < size && posting[pos + step] < entry_id)
+					step <<= 1u;
+				pos = std::lower_bound(posting.begin() + (std::ptrdiff_t)(pos + (step >> 1u)),
+				                       posting.begin() + (std::ptrdiff_t)std::min(pos + step + 1, size), entry_id) -
+				      posting.begin();
+				if (pos == size)
+					break;
+				if (posting[pos] == entry_id)
+					*(out_it++) = entry_id;
+			}
+			entry_ids.erase(out_it, entry_ids.end());
+		}
+		for (uint32_t entry_id : entry_ids)
+			try_entry(entry_id);
+	}
+
+	const auto candidate_less = [this](const Candidate &l, const Candidate &r) {
+		const Entry &l_entry = m_entries[l.entry_id], &r_entry = m_entries[r.entry_id];
+		if (l.match != r.match)
+			return l.match < r.match;
+		if (l_entry.name.size() != r_entry.name.size())
+			return l_entry.name.size() < r_entry.name.size();
+		return l_entry.index < r_entry.index;
+	};
+	auto count = std::min<std::size_t>(limit, candidates.size());
+	std::partial_sort(candidates.begin(), candidates.begin() + (std::ptrdiff_t)count, candidates.end(),
+	                  candidate_less);
+
+	std::vector<SearchResult> results(count);
+	for (std::size_t i = 0; i < count; ++i)
+		results[i] = {m_entries[candidates[i].entry_id].index, candidates[i].match};
+	return results;
+}
+
+} // namespace backend
@@ -0,0 +1,432 @@
+#include <backend/Storage.hpp>
+
+#include <backend/Encryption.hpp>
+#include <backend/Schedule.hpp>
+#include <backend/Trace.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <unordered_set>
+
+#include <ghc/filesystem.hpp>
+#include <nowide/fstream.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace backend {
+
+namespace {
+inline void str_append_uint32(std::string *str, uint32_t x) {
+	for (uint32_t i = 0; i < 4; ++i)
+		(*str) += char(x >> (i * 8u));
+}
+inline uint32_t uint32_from_str(std::string_view str) {
+	uint32_t x = 0;
+	for (uint32_t i = 0; i < 4; ++i)
+		x |= uint32_t((uint8_t)str[i]) << (i * 8u);
+	return x;
+}
+// FNV-1a, only to tell whether the records of a partition changed
+inline uint64_t hash_str(std::string_view str) {
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : str)
+		hash = (hash ^ (uint8_t)c) * 1099511628211ull;
+	return hash;
+}
+inline const std::string &get_string_header() {
+	static const std::string kStringHeader = Schedule::StrFromTasks({});
+	return kStringHeader;
+}
+bool read_file(const std::string &path, std::string *p_data) {
+	nowide::ifstream in{path, std::ios::binary};
+	if (!in.is_open())
+		return false;
+	in.seekg(0, nowide::ifstream::end);
+	std::streamsize length = in.tellg();
+	in.seekg(0, nowide::ifstream::beg);
+	p_data->resize(length > 0 ? length : 0);
+	in.read(p_data->data(), (std::streamsize)p_data->size());
+	return !in.fail();
+}
+#ifdef _WIN32
+bool write_file(const std::string &path, std::string_view data) {
+	nowide::ofstream out{path, std::ios::binary};
+	if (!out.is_open())
+		return false;
+	out.write(data.data(), (std::streamsize)data.size());
+	out.close();
+	return !out.fail();
+}
+#else
+bool read_file_at(int dir_fd, const char *name, std::string *p_data) {
+	int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return false;
+	constexpr std::size_t kChunkSize = 1u << 16u;
+	p_data->clear();
+	for (ssize_t size;;) {
+		std::size_t offset = p_data->size();
+		p_data->resize(offset + kChunkSize);
+		if ((size = read(fd, p_data->data() + offset, kChunkSize)) <= 0) {
+			p_data->resize(offset);
+			close(fd);
+			return size == 0;
+		}
+		p_data->resize(offset + size);
+	}
+}
+// Synced before closing, so that a later rename cannot commit a file whose data is not on disk yet
+bool write_file_at(int dir_fd, const char *name, std::string_view data) {
+	int fd = openat(dir_fd, name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (fd == -1)
+		return false;
+	for (ssize_t size; !data.empty(); data.remove_prefix(size))
+		if ((size = write(fd, data.data(), data.size())) <= 0) {
+			close(fd);
+			return false;
+		}
+	bool synced = fsync(fd) == 0;
+	return close(fd) == 0 && synced;
+}
+inline int64_t get_timespec_ns(const timespec &time) { return int64_t(time.tv_sec) * 1000000000 + time.tv_nsec; }
+#endif
+template <typename Func> inline auto timed(std::chrono::nanoseconds *p_duration, Func &&func) {
+	auto begin = std::chrono::steady_clock::now();
+	auto result = func();
+	*p_duration += std::chrono::steady_clock::now() - begin;
+	return result;
+}
+} // namespace
+
+std::vector<TaskPartition> PartitionTasks(const std::vector<Task> &tasks) {
+	SCHEDULITE_TRACE_SCOPE("PartitionTasks");
+	std::vector<TaskPartition> partitions;
+	for (const Task &task : tasks) {
+		uint32_t month = TaskPartitionMonth(task.property.begin_time);
+		if (partitions.empty() || partitions.back().month != month)
+			partitions.push_back({month, {}});
+		partitions.back().records += StrFromTask(task);
+	}
+	return partitions;
+}
+
+TaskPartitionStore::TaskPartitionStore(std::string dir_path, std::string legacy_file_path, bool check_manifest)
+    : m_dir_path{std::move(dir_path)}, m_legacy_file_path{std::move(legacy_file_path)},
+      m_check_manifest{check_manifest} {
+	m_manifest_path = ghc::filesystem::path{m_dir_path}.append(kManifestFileName).string();
+}
+
+TaskPartitionStore::~TaskPartitionStore() { close_dir(); }
+
+bool TaskPartitionStore::open_dir() const {
+	if (m_dir_opened)
+		return true;
+	std::error_code error_code;
+	ghc::filesystem::create_directories(m_dir_path, error_code);
+	if (error_code)
+		return false;
+#ifndef _WIN32
+	m_dir_fd = open(m_dir_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (m_dir_fd == -1)
+		return false;
+#endif
+	m_dir_opened = true;
+	return true;
+}
+
+void TaskPartitionStore::close_dir() const {
+#ifndef _WIN32
+	if (m_dir_fd != -1)
+		close(m_dir_fd);
+	m_dir_fd = -1;
+#endif
+	m_dir_opened = false;
+	m_segments_cached = false;
+}
+
+bool TaskPartitionStore::find_manifest(bool *p_found) const {
+	*p_found = false;
+#ifndef _WIN32
+	// The directory is only opened, it is created by the first Store
+	if (!m_dir_opened) {
+		m_dir_fd = open(m_dir_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		if (m_dir_fd == -1)
+			return errno == ENOENT;
+		m_dir_opened = true;
+	}
+	if (faccessat(m_dir_fd, kManifestFileName, F_OK, 0) == 0) {
+		*p_found = true;
+		return true;
+	}
+	return errno == ENOENT;
+#else
+	std::error_code error_code;
+	*p_found = ghc::filesystem::exists(m_manifest_path, error_code);
+	return !error_code;
+#endif
+}
+
+bool TaskPartitionStore::sync_dir() const {
+#ifndef _WIN32
+	return fsync(m_dir_fd) == 0;
+#else
+	return true;
+#endif
+}
+
+bool TaskPartitionStore::get_manifest_state(ManifestState *p_state) const {
+#ifndef _WIN32
+	struct stat st {};
+	if (fstatat(m_dir_fd, kManifestFileName, &st, 0) != 0)
+		return false;
+#ifdef __APPLE__
+	*p_state = {(uint64_t)st.st_ino, (uint64_t)st.st_size, get_timespec_ns(st.st_mtimespec),
+	            get_timespec_ns(st.st_ctimespec)};
+#else
+	*p_state = {(uint64_t)st.st_ino, (uint64_t)st.st_size, get_timespec_ns(st.st_mtim), get_timespec_ns(st.st_ctim)};
+#endif
+	return true;
+#else
+	std::error_code error_code;
+	uint64_t size = ghc::filesystem::file_size(m_manifest_path, error_code);
+	if (error_code)
+		return false;
+	auto time = ghc::filesystem::last_write_time(m_manifest_path, error_code);
+	if (error_code)
+		return false;
+	*p_state = {0, size, (int64_t)time.time_since_epoch().count(), 0};
+	return true;
+#endif
+}
+
+bool TaskPartitionStore::read_dir_file(const std::string &name, std::string *p_data) const {
+#ifndef _WIN32
+	return read_file_at(m_dir_fd, name.c_str(), p_data);
+#else
+	return read_file(ghc::filesystem::path{m_dir_path}.append(name).string(), p_data);
+#endif
+}
+
+bool TaskPartitionStore::write_dir_file(const std::string &name, std::string_view data) const {
+#ifndef _WIN32
+	return write_file_at(m_dir_fd, name.c_str(), data);
+#else
+	return write_file(ghc::filesystem::path{m_dir_path}.append(name).string(), data);
+#endif
+}
+
+bool TaskPartitionStore::rename_dir_file(const std::string &name, const std::string &new_name) const {
+#ifndef _WIN32
+	return renameat(m_dir_fd, name.c_str(), m_dir_fd, new_name.c_str()) == 0;
+#else
+	std::error_code error_code;
+	ghc::filesystem::path dir_path{m_dir_path};
+	ghc::filesystem::rename(dir_path / name, dir_path / new_name, error_code);
+	return !error_code;
+#endif
+}
+
+void TaskPartitionStore::remove_dir_file(const std::string &name) const {
+#ifndef _WIN32
+	unlinkat(m_dir_fd, name.c_str(), 0);
+#else
+	std::error_code error_code;
+	ghc::filesystem::remove(ghc::filesystem::path{m_dir_path}.append(name), error_code);
+#endif
+}
+
+std::string TaskPartitionStore::get_segment_name(const Segment &segment) {
+	char name[32];
+	snprintf(name, sizeof(name), "%04u-%02u.%016llx", segment.month / 12, segment.month % 12 + 1,
+	         (unsigned long long)segment.hash);
+	return name;
+}
+
+std::tuple<std::vector<TaskPartitionStore::Segment>, uint32_t, bool>
+TaskPartitionStore::read_manifest(std::string_view key) const {
+	// Only read again if another process replaced it since it was last read or written
+	ManifestState state{};
+	bool state_valid = m_check_manifest && get_manifest_state(&state);
+	if (m_segments_cached && (!m_check_manifest || (state_valid && state == m_manifest_state)))
+		return {m_segments, m_next_id, true};
+	m_segments_cached = false;
+
+	std::string encrypted;
+	if (!read_dir_file(kManifestFileName, &encrypted))
+		return {std::vector<Segment>{}, 0, false};
+	std::string raw = Decrypt(encrypted, key);
+	std::string_view view = raw, header = kManifestHeader;
+	if (view.substr(0, header.size()) != header)
+		return {std::vector<Segment>{}, 0, false};
+	view = view.substr(header.size());
+	uint32_t next_id = 0;
+	if (view.size() >= kManifestNextIDLength && uint32_from_str(view) == 0) {
+		next_id = uint32_from_str(view.substr(4));
+		view = view.substr(kManifestNextIDLength);
+	}
+	std::vector<Segment> segments;
+	for (; view.size() >= kManifestEntryLength; view = view.substr(kManifestEntryLength)) {
+		uint64_t hash = uint32_from_str(view.substr(4)) | uint64_t(uint32_from_str(view.substr(8))) << 32u;
+		segments.push_back({uint32_from_str(view), hash});
+	}
+	if (state_valid || !m_check_manifest)
+		cache_segments(segments, next_id, state);
+	return {std::move(segments), next_id, true};
+}
+
+void TaskPartitionStore::cache_segments(const std::vector<Segment> &segments, uint32_t next_id,
+                                        const ManifestState &state) const {
+	m_segments = segments;
+	m_next_id = next_id;
+	m_manifest_state = state;
+	m_segments_cached = true;
+}
+
+void TaskPartitionStore::remove_unlisted(const std::vector<Segment> &segments) const {
+	std::unordered_set<std::string> listed{kManifestFileName};
+	for (const Segment &segment : segments)
+		listed.insert(get_segment_name(segment));
+	std::error_code error_code;
+	for (const auto &entry : ghc::filesystem::directory_iterator{m_dir_path, error_code})
+		if (entry.is_regular_file(error_code) && !listed.count(entry.path().filename().string()))
+			ghc::filesystem::remove(entry.path(), error_code);
+}
+
+std::tuple<std::string, Error> TaskPartitionStore::Load(std::string_view key, TaskStoreStats *p_stats,
+                                                       uint32_t *p_next_id) const {
+	SCHEDULITE_TRACE_SCOPE("TaskPartitionStore::Load");
+	TaskStoreStats stats{};
+	if (p_next_id)
+		*p_next_id = 0;
+	std::string encrypted;
+	bool found;
+	if (!find_manifest(&found)) {
+		close_dir();
+		return {std::string{}, Error::kFileIOError};
+	}
+	if (!found) {
+		// Migrate the single-file Schedule, which is kept if storing the partitions fails
+		if (!read_file(m_legacy_file_path, &encrypted) || encrypted.empty())
+			return {std::string{}, Error::kSuccess};
+		std::string raw = timed(&stats.decrypt, [&]() { return Decrypt(encrypted, key); });
+		std::error_code error_code;
+		if (Store(PartitionTasks(Schedule::TasksFromStr(raw)), key, &stats) == Error::kSuccess)
+			ghc::filesystem::remove(m_legacy_file_path, error_code);
+		if (p_stats)
+			*p_stats = stats;
+		return {std::move(raw), Error::kSuccess};
+	}
+
+	auto [segments, next_id, valid] = read_manifest(key);
+	if (!valid) {
+		close_dir();
+		return {std::string{}, Error::kFileIOError};
+	}
+	const std::string &string_header = get_string_header();
+	std::string raw = string_header;
+	for (const Segment &segment : segments) {
+		if (!read_dir_file(get_segment_name(segment), &encrypted)) {
+			close_dir();
+			return {std::string{}, Error::kFileIOError};
+		}
+		std::string segment_raw = timed(&stats.decrypt, [&]() { return Decrypt(encrypted, key); });
+		if (std::string_view{segment_raw}.substr(0, string_header.size()) == string_header) {
+			raw.append(segment_raw, string_header.size());
+			continue;
+		}
+		// Written with another Task encoding version
+		std::vector<Task> tasks = Schedule::TasksFromStr(segment_raw);
+		if (tasks.empty()) {
+			close_dir();
+			return {std::string{}, Error::kFileIOError};
+		}
+		for (const Task &task : tasks)
+			raw += StrFromTask(task);
+	}
+	remove_unlisted(segments);
+	if (p_stats)
+		*p_stats = stats;
+	if (p_next_id)
+		*p_next_id = next_id;
+	return {std::move(raw), Error::kSuccess};
+}
+
+Error TaskPartitionStore::Store(const std::vector<TaskPartition> &partitions, std::string_view key,
+                                TaskStoreStats *p_stats, uint32_t next_id) const {
+	SCHEDULITE_TRACE_SCOPE("TaskPartitionStore::Store");
+	if (!open_dir())
+		return Error::kFileIOError;
+	Error error = store(partitions, key, p_stats, next_id);
+	// The directory may have been removed or replaced, so it is opened again by the next call
+	if (error != Error::kSuccess)
+		close_dir();
+	return error;
+}
+
+Error TaskPartitionStore::store(const std::vector<TaskPartition> &partitions, std::string_view key,
+                                TaskStoreStats *p_stats, uint32_t next_id) const {
+	TaskStoreStats stats{};
+	// An unreadable manifest lists nothing, so that every segment is written again
+	auto [old_segments, old_next_id, valid] = read_manifest(key);
+	const auto segment_less = [](const Segment &l, const Segment &r) {
+		return l.month < r.month || (l.month == r.month && l.hash < r.hash);
+	};
+	std::sort(old_segments.begin(), old_segments.end(), segment_less);
+
+	// Write the new segments, unlisted until the manifest is replaced
+	std::vector<Segment> segments;
+	segments.reserve(partitions.size());
+	for (const TaskPartition &partition : partitions) {
+		Segment segment{partition.month, hash_str(partition.records)};
+		segments.push_back(segment);
+		if (std::binary_search(old_segments.begin(), old_segments.end(), segment, segment_less))
+			continue;
+		std::string encrypted =
+		    timed(&stats.encrypt, [&]() { return Encrypt(get_string_header() + partition.records, key); });
+		if (!timed(&stats.file_write, [&]() { return write_dir_file(get_segment_name(segment), encrypted); }))
+			return Error::kFileIOError;
+		stats.bytes_written += encrypted.size();
+		++stats.segments_written;
+	}
+
+	if (!stats.segments_written && segments.size() == old_segments.size() && next_id == old_next_id) {
+		if (p_stats)
+			*p_stats = stats;
+		return Error::kSuccess;
+	}
+
+	// Replace the manifest, which commits the segments
+	std::string manifest = kManifestHeader;
+	str_append_uint32(&manifest, 0);
+	str_append_uint32(&manifest, next_id);
+	for (const Segment &segment : segments) {
+		str_append_uint32(&manifest, segment.month);
+		str_append_uint32(&manifest, uint32_t(segment.hash));
+		str_append_uint32(&manifest, uint32_t(segment.hash >> 32u));
+	}
+	std::string encrypted = timed(&stats.encrypt, [&]() { return Encrypt(manifest, key); });
+	std::string temp_name = std::string{kManifestFileName} + ".tmp";
+	if (!timed(&stats.file_write, [&]() { return write_dir_file(temp_name, encrypted); }) ||
+	    !rename_dir_file(temp_name, kManifestFileName) || !sync_dir())
+		return Error::kFileIOError;
+	stats.bytes_written += encrypted.size();
+	ManifestState state{};
+	if (!m_check_manifest || get_manifest_state(&state))
+		cache_segments(segments, next_id, state);
+
+	// Remove the segments replaced
+	std::sort(segments.begin(), segments.end(), segment_less);
+	for (const Segment &segment : old_segments)
+		if (!std::binary_search(segments.begin(), segments.end(), segment, segment_less))
+			remove_dir_file(get_segment_name(segment));
+	if (p_stats)
+		*p_stats = stats;
+	return Error::kSuccess;
+}
+
+} // namespace backend
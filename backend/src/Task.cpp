@@ -1,6 +1,10 @@
 #include <backend/Task.hpp>
 
+#include <algorithm>
 #include <cctype>
+#include <cstdio>
+#include <iterator>
+#include <limits>
 
 namespace backend {
 
@@ -17,7 +21,71 @@ inline static uint32_t uint32_from_str(std::string_view str) {
 	return uint8_t(str[0]) | (uint8_t(str[1]) << 8u) | (uint8_t(str[2]) << 16u) | (uint8_t(str[3]) << 24u);
 }
 
-std::tuple<Task, uint32_t> TaskFromStr(std::string_view str) {
+inline static void str_append_uint16(std::string *str, uint16_t n) {
+	(*str) += char(n & 0xffu);
+	(*str) += char(n >> 8u);
+}
+
+inline static uint16_t uint16_from_str(std::string_view str) {
+	return uint16_t(uint8_t(str[0]) | (uint8_t(str[1]) << 8u));
+}
+
+// Tags of the Task extensions, 5 and above are reserved
+enum class TaskExtensionTag : uint8_t { kRecurrence = 1, kDuration, kDependencies, kDoneTime };
+constexpr uint32_t kTaskExtensionHeaderLength = 1 + 4;
+constexpr uint32_t kRecurrenceFixedLength = 1 + 2 + 1 + 4 + 4 + 4;
+
+inline static void str_append_recurrence(std::string *str, const TaskRecurrence &recurrence) {
+	(*str) += (char)TaskExtensionTag::kRecurrence;
+	str_append_uint32(str, kRecurrenceFixedLength + 4 * (uint32_t)recurrence.exceptions.size());
+	(*str) += (char)recurrence.frequency;
+	str_append_uint16(str, recurrence.interval);
+	(*str) += (char)recurrence.by_day;
+	str_append_uint32(str, recurrence.count);
+	str_append_uint32(str, recurrence.until);
+	str_append_uint32(str, (uint32_t)recurrence.exceptions.size());
+	for (TimeInt exception : recurrence.exceptions)
+		str_append_uint32(str, exception);
+}
+
+inline static void str_append_duration(std::string *str, uint32_t duration) {
+	(*str) += (char)TaskExtensionTag::kDuration;
+	str_append_uint32(str, 4);
+	str_append_uint32(str, duration);
+}
+
+inline static void str_append_done_time(std::string *str, TimeInt done_time) {
+	(*str) += (char)TaskExtensionTag::kDoneTime;
+	str_append_uint32(str, 4);
+	str_append_uint32(str, done_time);
+}
+
+inline static void str_append_dependencies(std::string *str, const std::vector<uint32_t> &dependencies) {
+	(*str) += (char)TaskExtensionTag::kDependencies;
+	str_append_uint32(str, 4 * (uint32_t)dependencies.size());
+	for (uint32_t id : dependencies)
+		str_append_uint32(str, id);
+}
+
+inline static bool recurrence_from_str(std::string_view str, TaskRecurrence *p_recurrence) {
+	if (str.length() < kRecurrenceFixedLength)
+		return false;
+	p_recurrence->frequency = (RecurrenceFrequency)str[0];
+	p_recurrence->interval = uint16_from_str(str.substr(1));
+	p_recurrence->by_day = (uint8_t)str[3];
+	p_recurrence->count = uint32_from_str(str.substr(4));
+	p_recurrence->until = uint32_from_str(str.substr(8));
+	uint32_t exception_count = uint32_from_str(str.substr(12));
+	str = str.substr(kRecurrenceFixedLength);
+	if (str.length() / 4 < exception_count)
+		return false;
+	p_recurrence->exceptions.resize(exception_count);
+	for (uint32_t i = 0; i < exception_count; ++i)
+		p_recurrence->exceptions[i] = uint32_from_str(str.substr(i * 4));
+	return true;
+}
+
+std::tuple<Task, uint32_t> TaskFromStr(std::string_view str, uint8_t version) {
 	if (str.length() <= 4 + 4 + 4 + 1 + 1 + 1)
 		return {Task{}, 0};
 	Task task{};
@@ -35,12 +103,53 @@ std::tuple<Task, uint32_t> TaskFromStr(std::string_view str) {
 	{
 		auto num = str.find_first_of('\0');
 		if (num == std::string::npos) {
+			if (version >= 2)
+				return {Task{}, 0};
 			task.property.name = str;
 			len += str.length();
 		} else {
 			task.property.name = str.substr(0, num);
 			len += num + 1;
+			str = str.substr(num + 1);
+		}
+	}
+	if (version < 2)
+		return {task, len};
+
+	// Extensions
+	if (str.empty())
+		return {Task{}, 0};
+	auto extension_count = (uint8_t)str[0];
+	str = str.substr(1);
+	++len;
+	for (uint8_t i = 0; i < extension_count; ++i) {
+		if (str.length() < kTaskExtensionHeaderLength)
+			return {Task{}, 0};
+		auto tag = (TaskExtensionTag)str[0];
+		uint32_t data_len = uint32_from_str(str.substr(1));
+		str = str.substr(kTaskExtensionHeaderLength);
+		if (str.length() < data_len)
+			return {Task{}, 0};
+		if (tag == TaskExtensionTag::kRecurrence &&
+		    !recurrence_from_str(str.substr(0, data_len), &task.property.recurrence))
+			return {Task{}, 0};
+		if (tag == TaskExtensionTag::kDuration) {
+			if (data_len < 4)
+				return {Task{}, 0};
+			task.property.duration = uint32_from_str(str);
+		}
+		if (tag == TaskExtensionTag::kDoneTime) {
+			if (data_len < 4)
+				return {Task{}, 0};
+			task.property.done_time = uint32_from_str(str);
 		}
+		if (tag == TaskExtensionTag::kDependencies) {
+			task.property.dependencies.resize(data_len / 4);
+			for (uint32_t d = 0; d < data_len / 4; ++d)
+				task.property.dependencies[d] = uint32_from_str(str.substr(d * 4));
+		}
+		str = str.substr(data_len);
+		len += kTaskExtensionHeaderLength + data_len;
 	}
 	return {task, len};
 }
@@ -54,9 +163,165 @@ std::string StrFromTask(const Task &task) {
 	ret += (char)task.property.done;
 	ret += task.property.name;
 	ret += '\0';
+	// Extensions, only the non-default ones are stored
+	bool recurring = task.property.recurrence.IsRecurring(), has_duration = task.property.duration,
+	     has_dependencies = !task.property.dependencies.empty(), has_done_time = task.property.done_time;
+	ret += char(recurring + has_duration + has_dependencies + has_done_time);
+	if (recurring)
+		str_append_recurrence(&ret, task.property.recurrence);
+	if (has_duration)
+		str_append_duration(&ret, task.property.duration);
+	if (has_dependencies)
+		str_append_dependencies(&ret, task.property.dependencies);
+	if (has_done_time)
+		str_append_done_time(&ret, task.property.done_time);
+	return ret;
+}
+
+namespace {
+constexpr const char *kWeekdayStrs[7] = {"SU", "MO", "TU", "WE", "TH", "FR", "SA"};
+constexpr const char *kFrequencyStrs[5] = {"NONE", "DAILY", "WEEKLY", "MONTHLY", "YEARLY"};
+
+inline bool equal_ignore_case(std::string_view l, std::string_view r) {
+	if (l.size() != r.size())
+		return false;
+	for (std::size_t i = 0; i < l.size(); ++i)
+		if (toupper(l[i]) != toupper(r[i]))
+			return false;
+	return true;
+}
+inline bool uint_from_str(std::string_view str, uint32_t *p_value) {
+	if (str.empty() || str.size() > 9)
+		return false;
+	uint32_t value = 0;
+	for (char c : str) {
+		if (c < '0' || c > '9')
+			return false;
+		value = value * 10 + uint32_t(c - '0');
+	}
+	*p_value = value;
+	return true;
+}
+// "YYYY/MM/DD hh:mm"
+inline bool time_from_str(std::string_view str, TimeInt *p_time_int) {
+	TimeInfo info{};
+	std::string time_str{str};
+	int matched =
+	    sscanf(time_str.c_str(), "%d/%u/%u%u:%u", &info.year, &info.month, &info.day, &info.hour, &info.minute);
+	if (matched != 5 || info.month < 1 || info.month > 12 || info.day < 1 || info.day > 31 || info.hour > 23 ||
+	    info.minute > 59)
+		return false;
+	*p_time_int = ToTimeInt(info);
+	return true;
+}
+} // namespace
+
+std::string StrFromTaskRecurrence(const TaskRecurrence &recurrence, bool with_exceptions) {
+	if (!recurrence.IsRecurring() || (uint8_t)recurrence.frequency >= std::size(kFrequencyStrs))
+		return {};
+	std::string ret = "FREQ=";
+	ret += kFrequencyStrs[(uint8_t)recurrence.frequency];
+	if (recurrence.interval > 1)
+		ret += ";INTERVAL=" + std::to_string(recurrence.interval);
+	if (recurrence.by_day) {
+		ret += ";BYDAY=";
+		bool first = true;
+		for (uint32_t d = 0; d < 7; ++d)
+			if (recurrence.by_day & (1u << d)) {
+				if (!first)
+					ret += ',';
+				ret += kWeekdayStrs[d];
+				first = false;
+			}
+	}
+	if (recurrence.count)
+		ret += ";COUNT=" + std::to_string(recurrence.count);
+	if (recurrence.until)
+		ret += ";UNTIL=" + ToTimeStr(recurrence.until);
+	if (with_exceptions && !recurrence.exceptions.empty()) {
+		ret += ";EXDATE=";
+		for (TimeInt exception : recurrence.exceptions) {
+			if (exception != recurrence.exceptions.front())
+				ret += ',';
+			ret += ToTimeStr(exception);
+		}
+	}
 	return ret;
 }
 
+std::tuple<TaskRecurrence, bool> TaskRecurrenceFromStr(std::string_view str) {
+	TaskRecurrence recurrence{};
+	const auto frequency_from_str = [](std::string_view value, RecurrenceFrequency *p_frequency) {
+		for (uint8_t f = 0; f < std::size(kFrequencyStrs); ++f)
+			if (equal_ignore_case(value, kFrequencyStrs[f])) {
+				*p_frequency = (RecurrenceFrequency)f;
+				return true;
+			}
+		return false;
+	};
+	if (str.find('=') == std::string_view::npos)
+		return {recurrence, frequency_from_str(str, &recurrence.frequency)};
+
+	bool has_frequency = false;
+	while (!str.empty()) {
+		auto end = str.find(';');
+		std::string_view part = str.substr(0, end);
+		str = end == std::string_view::npos ? std::string_view{} : str.substr(end + 1);
+		if (part.empty())
+			continue;
+		auto eq = part.find('=');
+		if (eq == std::string_view::npos)
+			return {TaskRecurrence{}, false};
+		std::string_view key = part.substr(0, eq), value = part.substr(eq + 1);
+		uint32_t number;
+		if (equal_ignore_case(key, "FREQ")) {
+			if (!frequency_from_str(value, &recurrence.frequency))
+				return {TaskRecurrence{}, false};
+			has_frequency = true;
+		} else if (equal_ignore_case(key, "INTERVAL")) {
+			if (!uint_from_str(value, &number) || number == 0 || number > std::numeric_limits<uint16_t>::max())
+				return {TaskRecurrence{}, false};
+			recurrence.interval = (uint16_t)number;
+		} else if (equal_ignore_case(key, "BYDAY")) {
+			while (!value.empty()) {
+				auto comma = value.find(',');
+				std::string_view day = value.substr(0, comma);
+				value = comma == std::string_view::npos ? std::string_view{} : value.substr(comma + 1);
+				uint32_t d = 0;
+				while (d < 7 && !equal_ignore_case(day, kWeekdayStrs[d]))
+					++d;
+				if (d == 7)
+					return {TaskRecurrence{}, false};
+				recurrence.by_day |= uint8_t(1u << d);
+			}
+		} else if (equal_ignore_case(key, "COUNT")) {
+			if (!uint_from_str(value, &number))
+				return {TaskRecurrence{}, false};
+			recurrence.count = number;
+		} else if (equal_ignore_case(key, "UNTIL")) {
+			if (!time_from_str(value, &recurrence.until))
+				return {TaskRecurrence{}, false};
+		} else if (equal_ignore_case(key, "EXDATE")) {
+			while (!value.empty()) {
+				auto comma = value.find(',');
+				TimeInt exception;
+				if (!time_from_str(value.substr(0, comma), &exception))
+					return {TaskRecurrence{}, false};
+				recurrence.exceptions.push_back(exception);
+				value = comma == std::string_view::npos ? std::string_view{} : value.substr(comma + 1);
+			}
+		} else
+			return {TaskRecurrence{}, false};
+	}
+	// BYDAY is only supported by weekly rules
+	if (!has_frequency || (recurrence.by_day && recurrence.frequency != RecurrenceFrequency::kWeekly))
+		return {TaskRecurrence{}, false};
+	auto &exceptions = recurrence.exceptions;
+	std::sort(exceptions.begin(), exceptions.end());
+	exceptions.erase(std::unique(exceptions.begin(), exceptions.end()), exceptions.end());
+	return {recurrence, true};
+}
+
 TaskType TaskTypeFromStr(std::string_view str) {
 	if (str.empty())
 		return kDefaultTaskType;
@@ -0,0 +1,230 @@
+#include <backend/TaskScan.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64) || (defined(__i386__) && defined(__SSE2__)) ||                             \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCHEDULITE_TASKSCAN_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define SCHEDULITE_TASKSCAN_AVX2
+#define SCHEDULITE_TASKSCAN_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER)
+#define SCHEDULITE_TASKSCAN_AVX2
+#define SCHEDULITE_TASKSCAN_AVX2_TARGET
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+#endif
+
+namespace backend {
+
+static_assert(sizeof(TaskStatus) == sizeof(uint32_t), "TaskStatus is expected to be 32-bit");
+
+TaskColumns TaskColumnsFromTasks(const std::vector<Task> &tasks) {
+	TaskColumns columns;
+	columns.begin_times.reserve(tasks.size());
+	columns.remind_times.reserve(tasks.size());
+	columns.dones.reserve(tasks.size());
+	for (const auto &task : tasks) {
+		columns.begin_times.push_back(task.property.begin_time);
+		columns.remind_times.push_back(task.property.remind_time);
+		columns.dones.push_back(task.property.done);
+	}
+	return columns;
+}
+
+// Scalar kernels, also used for the tails of the vector kernels
+inline static void status_scan_scalar(const TimeInt *begin_times, const uint8_t *dones, uint32_t first,
+                                      uint32_t count, TimeInt time_int_now, TaskStatus *statuses) {
+	for (uint32_t i = first; i < count; ++i)
+		statuses[i] = dones[i] ? TaskStatus::kDone
+		                       : (begin_times[i] > time_int_now ? TaskStatus::kPending : TaskStatus::kOngoing);
+}
+inline static void equal_scan_scalar(const TimeInt *times, uint32_t first, uint32_t count, TimeInt value,
+                                     uint64_t *mask) {
+	for (uint32_t i = first; i < count; ++i)
+		mask[i >> 6u] |= uint64_t(times[i] == value) << (i & 63u);
+}
+inline static void range_scan_scalar(const TimeInt *times, uint32_t first, uint32_t count, TimeInt begin,
+                                     TimeInt end, uint64_t *mask) {
+	// begin <= t < end  <=>  t - begin < end - begin (unsigned)
+	TimeInt width = end > begin ? end - begin : 0;
+	for (uint32_t i = first; i < count; ++i)
+		mask[i >> 6u] |= uint64_t(TimeInt(times[i] - begin) < width) << (i & 63u);
+}
+
+static void status_scan_0(const TimeInt *begin_times, const uint8_t *dones, uint32_t count, TimeInt time_int_now,
+                          TaskStatus *statuses) {
+	status_scan_scalar(begin_times, dones, 0, count, time_int_now, statuses);
+}
+static void equal_scan_0(const TimeInt *times, uint32_t count, TimeInt value, uint64_t *mask) {
+	equal_scan_scalar(times, 0, count, value, mask);
+}
+static void range_scan_0(const TimeInt *times, uint32_t count, TimeInt begin, TimeInt end, uint64_t *mask) {
+	range_scan_scalar(times, 0, count, begin, end, mask);
+}
+
+#ifdef SCHEDULITE_TASKSCAN_SSE2
+// SSE2 only has signed 32-bit compares, so unsigned operands are biased by 2^31 first
+static constexpr int kSignBias = int(0x80000000u);
+
+static void status_scan_1(const TimeInt *begin_times, const uint8_t *dones, uint32_t count, TimeInt time_int_now,
+                          TaskStatus *statuses) {
+	const __m128i bias = _mm_set1_epi32(kSignBias), now = _mm_set1_epi32(int(time_int_now ^ 0x80000000u));
+	const __m128i ongoing = _mm_set1_epi32((int)TaskStatus::kOngoing), done = _mm_set1_epi32((int)TaskStatus::kDone);
+	const __m128i zero = _mm_setzero_si128();
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i begin = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(begin_times + i)), bias);
+		// kPending = 0, kOngoing = 1
+		__m128i status = _mm_andnot_si128(_mm_cmpgt_epi32(begin, now), ongoing);
+		int32_t done4;
+		std::copy(dones + i, dones + i + 4, (uint8_t *)&done4);
+		__m128i is_done = _mm_cvtsi32_si128(done4);
+		is_done = _mm_unpacklo_epi16(_mm_unpacklo_epi8(is_done, zero), zero);
+		is_done = _mm_cmpgt_epi32(is_done, zero);
+		status = _mm_or_si128(_mm_and_si128(is_done, done), _mm_andnot_si128(is_done, status));
+		_mm_storeu_si128((__m128i *)(statuses + i), status);
+	}
+	status_scan_scalar(begin_times, dones, i, count, time_int_now, statuses);
+}
+static void equal_scan_1(const TimeInt *times, uint32_t count, TimeInt value, uint64_t *mask) {
+	const __m128i v = _mm_set1_epi32((int)value);
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *)(times + i)), v);
+		mask[i >> 6u] |= uint64_t(_mm_movemask_ps(_mm_castsi128_ps(eq))) << (i & 63u);
+	}
+	equal_scan_scalar(times, i, count, value, mask);
+}
+static void range_scan_1(const TimeInt *times, uint32_t count, TimeInt begin, TimeInt end, uint64_t *mask) {
+	TimeInt width = end > begin ? end - begin : 0;
+	const __m128i bias = _mm_set1_epi32(kSignBias), b = _mm_set1_epi32((int)begin),
+	              w = _mm_set1_epi32(int(width ^ 0x80000000u));
+	uint32_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i offset = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(times + i)), b);
+		__m128i lt = _mm_cmpgt_epi32(w, _mm_xor_si128(offset, bias));
+		mask[i >> 6u] |= uint64_t(_mm_movemask_ps(_mm_castsi128_ps(lt))) << (i & 63u);
+	}
+	range_scan_scalar(times, i, count, begin, end, mask);
+}
+#endif
+
+#ifdef SCHEDULITE_TASKSCAN_AVX2
+SCHEDULITE_TASKSCAN_AVX2_TARGET static void status_scan_2(const TimeInt *begin_times, const uint8_t *dones,
+                                                          uint32_t count, TimeInt time_int_now, TaskStatus *statuses) {
+	const __m256i bias = _mm256_set1_epi32(kSignBias), now = _mm256_set1_epi32(int(time_int_now ^ 0x80000000u));
+	const __m256i ongoing = _mm256_set1_epi32((int)TaskStatus::kOngoing),
+	              done = _mm256_set1_epi32((int)TaskStatus::kDone);
+	const __m256i zero = _mm256_setzero_si256();
+	uint32_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i begin = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(begin_times + i)), bias);
+		__m256i status = _mm256_andnot_si256(_mm256_cmpgt_epi32(begin, now), ongoing);
+		__m256i is_done = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(dones + i)));
+		is_done = _mm256_cmpgt_epi32(is_done, zero);
+		status = _mm256_blendv_epi8(status, done, is_done);
+		_mm256_storeu_si256((__m256i *)(statuses + i), status);
+	}
+	status_scan_scalar(begin_times, dones, i, count, time_int_now, statuses);
+}
+SCHEDULITE_TASKSCAN_AVX2_TARGET static void equal_scan_2(const TimeInt *times, uint32_t count, TimeInt value,
+                                                         uint64_t *mask) {
+	const __m256i v = _mm256_set1_epi32((int)value);
+	uint32_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *)(times + i)), v);
+		mask[i >> 6u] |= uint64_t(_mm256_movemask_ps(_mm256_castsi256_ps(eq))) << (i & 63u);
+	}
+	equal_scan_scalar(times, i, count, value, mask);
+}
+SCHEDULITE_TASKSCAN_AVX2_TARGET static void range_scan_2(const TimeInt *times, uint32_t count, TimeInt begin,
+                                                         TimeInt end, uint64_t *mask) {
+	TimeInt width = end > begin ? end - begin : 0;
+	const __m256i bias = _mm256_set1_epi32(kSignBias), b = _mm256_set1_epi32((int)begin),
+	              w = _mm256_set1_epi32(int(width ^ 0x80000000u));
+	uint32_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i offset = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *)(times + i)), b);
+		__m256i lt = _mm256_cmpgt_epi32(w, _mm256_xor_si256(offset, bias));
+		mask[i >> 6u] |= uint64_t(_mm256_movemask_ps(_mm256_castsi256_ps(lt))) << (i & 63u);
+	}
+	range_scan_scalar(times, i, count, begin, end, mask);
+}
+
+static bool cpu_support_avx2() {
+#if defined(__GNUC__) || defined(__clang__)
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#else
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+	__cpuid(info, 1);
+	// OSXSAVE and AVX, then check that the OS saves YMM state
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+		return false;
+	__cpuidex(info, 7, 0);
+	return info[1] & (1 << 5);
+#endif
+}
+#endif
+
+namespace {
+struct ScanKernels {
+	static constexpr const char *kEnvName = "SCHEDULITE_TASKSCAN";
+
+	TaskScanPath path;
+	void (*status_scan)(const TimeInt *, const uint8_t *, uint32_t, TimeInt, TaskStatus *);
+	void (*equal_scan)(const TimeInt *, uint32_t, TimeInt, uint64_t *);
+	void (*range_scan)(const TimeInt *, uint32_t, TimeInt, TimeInt, uint64_t *);
+
+	static const ScanKernels &Get() {
+		static const ScanKernels kernels = Select();
+		return kernels;
+	}
+	static ScanKernels Select() {
+		// SCHEDULITE_TASKSCAN=scalar|sse2 restricts the selection, mostly for comparing the paths
+		const char *env = std::getenv(kEnvName);
+		std::string_view limit = env ? env : "";
+		if (limit == "scalar")
+			return {TaskScanPath::kScalar, status_scan_0, equal_scan_0, range_scan_0};
+#ifdef SCHEDULITE_TASKSCAN_AVX2
+		if (limit != "sse2" && cpu_support_avx2())
+			return {TaskScanPath::kAVX2, status_scan_2, equal_scan_2, range_scan_2};
+#endif
+#ifdef SCHEDULITE_TASKSCAN_SSE2
+		return {TaskScanPath::kSSE2, status_scan_1, equal_scan_1, range_scan_1};
+#else
+		return {TaskScanPath::kScalar, status_scan_0, equal_scan_0, range_scan_0};
+#endif
+	}
+};
+} // namespace
+
+TaskScanPath GetTaskScanPath() { return ScanKernels::Get().path; }
+
+void TaskStatusScan(const TimeInt *begin_times, const uint8_t *dones, uint32_t count, TimeInt time_int_now,
+                    TaskStatus *statuses) {
+	ScanKernels::Get().status_scan(begin_times, dones, count, time_int_now, statuses);
+}
+void TimeEqualScan(const TimeInt *times, uint32_t count, TimeInt value, uint64_t *mask) {
+	std::fill(mask, mask + GetTaskScanMaskSize(count), 0);
+	ScanKernels::Get().equal_scan(times, count, value, mask);
+}
+void TimeRangeScan(const TimeInt *times, uint32_t count, TimeInt begin, TimeInt end, uint64_t *mask) {
+	std::fill(mask, mask + GetTaskScanMaskSize(count), 0);
+	ScanKernels::Get().range_scan(times, count, begin, end, mask);
+}
+void UndoneMaskScan(const uint8_t *dones, uint32_t count, uint64_t *mask) {
+	for (uint32_t i = 0; i < count; ++i)
+		mask[i >> 6u] &= ~(uint64_t(dones[i] != 0) << (i & 63u));
+}
+
+} // namespace backend
@@ -0,0 +1,214 @@
+#include <backend/Trace.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <libipc/mutex.h>
+#include <nowide/fstream.hpp>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace backend {
+
+namespace {
+constexpr const char *kEnvName = "SCHEDULITE_TRACE";
+constexpr const char *kIPCMutexName = "_SCHEDULITE_TRACE_MUTEX_";
+
+struct TraceEvent {
+	const char *name;
+	uint64_t begin, duration; // nanoseconds
+};
+
+// Single-producer ring buffer of a thread, only the owner thread writes events; the flusher reads up to the
+// published head, the oldest events are overwritten once the ring is full. Each slot publishes the sequence number of
+// its event (odd while being written), so that the flusher skips the slots the producer is overwriting meanwhile.
+class TraceBuffer {
+public:
+	static constexpr uint32_t kCapacity = 1u << 15u;
+
+	explicit TraceBuffer(uint32_t tid) : m_tid{tid} {}
+
+	inline void Push(const TraceEvent &event) {
+		uint64_t head = m_head.load(std::memory_order_relaxed);
+		Slot &slot = m_slots[head & (kCapacity - 1)];
+		slot.sequence.store(head * 2 + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.name.store(event.name, std::memory_order_relaxed);
+		slot.begin.store(event.begin, std::memory_order_relaxed);
+		slot.duration.store(event.duration, std::memory_order_relaxed);
+		slot.sequence.store(head * 2 + 2, std::memory_order_release);
+		m_head.store(head + 1, std::memory_order_release);
+	}
+	template <typename Func> inline void Consume(Func &&func) {
+		uint64_t head = m_head.load(std::memory_order_acquire);
+		uint64_t begin = head - m_flushed > kCapacity ? head - kCapacity : m_flushed;
+		for (uint64_t i = begin; i < head; ++i) {
+			const Slot &slot = m_slots[i & (kCapacity - 1)];
+			uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+			if (sequence != i * 2 + 2)
+				continue; // Overwritten since head was read
+			TraceEvent event{slot.name.load(std::memory_order_relaxed), slot.begin.load(std::memory_order_relaxed),
+			                 slot.duration.load(std::memory_order_relaxed)};
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+				continue; // Overwritten while being read
+			func(event);
+		}
+		m_flushed = head;
+	}
+	inline uint32_t GetTID() const { return m_tid; }
+
+	// Guarded by TraceState::mutex
+	std::string name;
+	bool name_flushed{false};
+
+private:
+	struct Slot {
+		std::atomic_uint64_t sequence{};
+		std::atomic<const char *> name{};
+		std::atomic_uint64_t begin{}, duration{};
+	};
+
+	uint32_t m_tid;
+	std::atomic_uint64_t m_head{};
+	uint64_t m_flushed{};
+	std::array<Slot, kCapacity> m_slots{};
+};
+
+struct TraceState {
+	std::string path;
+	std::unique_ptr<ipc::sync::mutex> ipc_mutex;
+
+	std::mutex mutex;
+	std::vector<std::shared_ptr<TraceBuffer>> buffers;
+
+	static TraceState *Get() {
+		static TraceState *state = Create();
+		return state;
+	}
+	static TraceState *Create() {
+		const char *env = std::getenv(kEnvName);
+		if (!env || !*env)
+			return nullptr;
+		// Never destructed, so that threads still running at exit can keep recording
+		auto state = new TraceState{};
+		state->path = env;
+		state->ipc_mutex = std::make_unique<ipc::sync::mutex>(kIPCMutexName);
+		std::atexit(FlushTrace);
+		g_trace_enabled.store(true, std::memory_order_relaxed);
+		return state;
+	}
+};
+
+// Read the environment before main, so that g_trace_enabled is set before the first TraceScope
+[[maybe_unused]] const bool kTraceStateCreated = TraceState::Get();
+
+thread_local std::shared_ptr<TraceBuffer> t_buffer;
+
+inline TraceBuffer *get_thread_buffer(TraceState *state) {
+	if (!t_buffer) {
+		std::scoped_lock lock{state->mutex};
+		t_buffer = std::make_shared<TraceBuffer>((uint32_t)state->buffers.size() + 1);
+		state->buffers.push_back(t_buffer);
+	}
+	return t_buffer.get();
+}
+
+inline uint64_t get_trace_clock() {
+	// steady_clock is system-wide on the supported platforms, so timelines of different processes line up
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+	    .count();
+}
+
+inline uint32_t get_pid() {
+#ifdef _WIN32
+	return (uint32_t)_getpid();
+#else
+	return (uint32_t)getpid();
+#endif
+}
+
+void append_json_str(std::string *out, std::string_view str) {
+	out->push_back('"');
+	for (char c : str) {
+		if (c == '"' || c == '\\') {
+			out->push_back('\\');
+			out->push_back(c);
+		} else if ((unsigned char)c < 0x20)
+			out->push_back(' ');
+		else
+			out->push_back(c);
+	}
+	out->push_back('"');
+}
+} // namespace
+
+void SetTraceThreadName(std::string_view name) {
+	TraceState *state = TraceState::Get();
+	if (!state)
+		return;
+	TraceBuffer *buffer = get_thread_buffer(state);
+	std::scoped_lock lock{state->mutex};
+	buffer->name = name;
+	buffer->name_flushed = false;
+}
+
+void FlushTrace() {
+	TraceState *state = TraceState::Get();
+	if (!state)
+		return;
+
+	std::string pid = std::to_string(get_pid()), json;
+	{
+		std::scoped_lock lock{state->mutex};
+		for (const auto &buffer : state->buffers) {
+			std::string tid = std::to_string(buffer->GetTID());
+			if (!buffer->name.empty() && !buffer->name_flushed) {
+				json += R"({"ph":"M","name":"thread_name","pid":)" + pid + R"(,"tid":)" + tid + R"(,"args":{"name":)";
+				append_json_str(&json, buffer->name);
+				json += "}},\n";
+				buffer->name_flushed = true;
+			}
+			buffer->Consume([&json, &pid, &tid](const TraceEvent &event) {
+				char ts[64];
+				snprintf(ts, sizeof(ts), R"(,"ts":%.3f,"dur":%.3f)", double(event.begin) / 1000.0,
+				         double(event.duration) / 1000.0);
+				json += R"({"ph":"X","cat":"schedulite","name":)";
+				append_json_str(&json, event.name);
+				json += R"(,"pid":)" + pid + R"(,"tid":)" + tid + ts + "},\n";
+			});
+		}
+	}
+	if (json.empty())
+		return;
+
+	// The JSON array is left unterminated, which trace viewers accept, so that processes can keep appending to it
+	std::scoped_lock ipc_lock{*state->ipc_mutex};
+	nowide::ofstream out{state->path, std::ios::binary | std::ios::app};
+	if (!out.is_open())
+		return;
+	out.seekp(0, std::ios::end);
+	if (out.tellp() == 0)
+		out << "[\n";
+	out.write(json.data(), (std::streamsize)json.size());
+}
+
+void TraceScope::begin(const char *name) {
+	m_name = name;
+	m_begin = get_trace_clock();
+}
+
+void TraceScope::end() { get_thread_buffer(TraceState::Get())->Push({m_name, m_begin, get_trace_clock() - m_begin}); }
+
+} // namespace backend
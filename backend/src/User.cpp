@@ -60,8 +60,10 @@ std::tuple<std::shared_ptr<User>, Error> User::Register(const std::shared_ptr<In
 				return {nullptr, Error::kUserAlreadyExist};
 		}
 		nowide::ofstream out{user->m_file_path, std::ios::binary};
-		if (!out.is_open())
+		if (!out.is_open()) {
+			instance_ptr->InvalidateDirs();
 			return {nullptr, Error::kFileIOError};
+		}
 
 		out.write(user->m_key.data(), (std::streamsize)user->m_key.size());
 	}
@@ -0,0 +1,65 @@
+#include <backend/Writer.hpp>
+
+namespace backend {
+
+void Writer::WriteUInt(uint32_t n) {
+	char digits[10];
+	uint32_t count = 0;
+	do {
+		digits[count++] = char('0' + n % 10);
+		n /= 10;
+	} while (n);
+	while (count)
+		Put(digits[--count]);
+}
+
+void Writer::WriteTime(TimeInt time_int) {
+	// Converting to local time is the expensive part, Tasks are visited in time order so most of them share an hour
+	TimeInfo info;
+	uint32_t i = 0;
+	for (; i < m_time_caches.size(); ++i) {
+		const TimeCache &cache = m_time_caches[i];
+		if (cache.valid && time_int >= cache.base && time_int - cache.base < 60)
+			break;
+	}
+	if (i < m_time_caches.size()) {
+		info = m_time_caches[i].info;
+		info.minute = time_int - m_time_caches[i].base;
+		m_time_cache_victim = i ^ 1u;
+	} else {
+		// Cache the beginning of the hour
+		TimeCache &cache = m_time_caches[m_time_cache_victim];
+		info = cache.info = ToTimeInfo(time_int);
+		cache.base = time_int - info.minute;
+		cache.valid = true;
+		m_time_cache_victim ^= 1u;
+	}
+	// Format "YYYY/MM/DD hh:mm" by hand, snprintf would cost more than the rest of a Task row
+	char buf[16];
+	const auto put2 = [](char *p, unsigned n) {
+		p[0] = char('0' + n / 10 % 10);
+		p[1] = char('0' + n % 10);
+	};
+	auto year = (unsigned)info.year;
+	put2(buf, year / 100);
+	put2(buf + 2, year);
+	buf[4] = '/';
+	put2(buf + 5, info.month);
+	buf[7] = '/';
+	put2(buf + 8, info.day);
+	buf[10] = ' ';
+	put2(buf + 11, info.hour);
+	buf[13] = ':';
+	put2(buf + 14, info.minute);
+	Write({buf, 16});
+}
+
+void Writer::Flush() {
+	if (m_size) {
+		std::fwrite(m_buffer.data(), 1, m_size, m_file);
+		m_size = 0;
+	}
+	std::fflush(m_file);
+}
+
+} // namespace backend
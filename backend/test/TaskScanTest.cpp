@@ -0,0 +1,127 @@
+#include <backend/TaskScan.hpp>
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string_view>
+#include <vector>
+
+// Compare the scan kernels of the selected TaskScanPath against the scalar functions of Task.hpp. Run once per path,
+// with SCHEDULITE_TASKSCAN restricting the selection, see ScanKernels::Select.
+
+namespace {
+constexpr int kSkipReturnCode = 77;
+constexpr backend::TimeInt kTimeMax = std::numeric_limits<backend::TimeInt>::max();
+
+uint32_t g_failures = 0;
+
+void Fail(const char *scan, uint32_t count, uint32_t index, const char *what) {
+	if (++g_failures <= 16)
+		fprintf(stderr, "FAIL: %s count=%u index=%u: %s\n", scan, count, index, what);
+}
+
+bool MaskBit(const std::vector<uint64_t> &mask, uint32_t i) { return (mask[i >> 6u] >> (i & 63u)) & 1u; }
+
+// The bits past count must stay clear, ForEachTaskScanMaskBit visits them
+void CheckMaskTail(const char *scan, const std::vector<uint64_t> &mask, uint32_t count) {
+	for (uint32_t i = count; i < (uint32_t)mask.size() * 64u; ++i)
+		if (MaskBit(mask, i))
+			return Fail(scan, count, i, "bit set past count");
+}
+
+// offset shifts the columns off their allocation alignment
+void CheckScans(const std::vector<backend::TimeInt> &times, const std::vector<uint8_t> &dones, uint32_t offset,
+                backend::TimeInt now, backend::TimeInt begin, backend::TimeInt end) {
+	auto count = uint32_t(times.size() - offset);
+	const backend::TimeInt *time_ptr = times.data() + offset;
+	const uint8_t *done_ptr = dones.data() + offset;
+
+	std::vector<backend::TaskStatus> statuses(count);
+	backend::TaskStatusScan(time_ptr, done_ptr, count, now, statuses.data());
+	for (uint32_t i = 0; i < count; ++i) {
+		backend::TaskProperty property{};
+		property.begin_time = time_ptr[i];
+		property.done = done_ptr[i];
+		if (statuses[i] != backend::TaskStatusFromTask(property, now))
+			Fail("TaskStatusScan", count, i, "status differs from TaskStatusFromTask");
+	}
+
+	// Prefill with set bits, the scans must clear the mask themselves
+	std::vector<uint64_t> mask(backend::GetTaskScanMaskSize(count), ~uint64_t(0));
+	backend::TimeEqualScan(time_ptr, count, now, mask.data());
+	for (uint32_t i = 0; i < count; ++i)
+		if (MaskBit(mask, i) != (time_ptr[i] == now))
+			Fail("TimeEqualScan", count, i, "bit differs from ==");
+	CheckMaskTail("TimeEqualScan", mask, count);
+
+	mask.assign(mask.size(), ~uint64_t(0));
+	backend::TimeRangeScan(time_ptr, count, begin, end, mask.data());
+	for (uint32_t i = 0; i < count; ++i)
+		if (MaskBit(mask, i) != (begin <= time_ptr[i] && time_ptr[i] < end))
+			Fail("TimeRangeScan", count, i, "bit differs from begin <= t < end");
+	CheckMaskTail("TimeRangeScan", mask, count);
+
+	std::vector<uint64_t> undone = mask;
+	backend::UndoneMaskScan(done_ptr, count, undone.data());
+	for (uint32_t i = 0; i < count; ++i)
+		if (MaskBit(undone, i) != (MaskBit(mask, i) && !done_ptr[i]))
+			Fail("UndoneMaskScan", count, i, "bit differs from mask & !done");
+}
+} // namespace
+
+int main(int argc, char **argv) {
+	std::string_view expected = argc > 1 ? argv[1] : "";
+	const char *path = backend::StrFromTaskScanPath(backend::GetTaskScanPath());
+	if (!expected.empty() && expected != path) {
+		printf("SKIPPED: %s path expected, %s selected\n", argv[1], path);
+		return kSkipReturnCode;
+	}
+
+	std::mt19937 rng{1336};
+	const backend::TimeInt kEdgeTimes[] = {0, 1, 0x7fffffffu, 0x80000000u, kTimeMax - 1, kTimeMax};
+
+	// Empty input
+	CheckScans({}, {}, 0, 0, 0, kTimeMax);
+
+	// Every length up to a few vectors, covering each tail length of the SSE2 and AVX2 kernels
+	for (uint32_t count = 1; count <= 200; ++count) {
+		for (uint32_t offset = 0; offset < 3; ++offset) {
+			std::vector<backend::TimeInt> times(count + offset);
+			std::vector<uint8_t> dones(count + offset);
+			// Clustered around now, so that each comparison goes both ways
+			backend::TimeInt now = rng() % 2 ? kEdgeTimes[rng() % std::size(kEdgeTimes)] : rng();
+			for (uint32_t i = 0; i < count + offset; ++i) {
+				uint32_t kind = rng() % 4;
+				times[i] = kind == 0 ? kEdgeTimes[rng() % std::size(kEdgeTimes)]
+				                     : (kind == 1 ? backend::TimeInt(rng()) : now + rng() % 5 - 2);
+				dones[i] = rng() % 2;
+			}
+			backend::TimeInt begin = now - rng() % 3, end = now + rng() % 3;
+			CheckScans(times, dones, offset, now, begin, end);
+			// Ranges reaching the ends of TimeInt, and empty and inverted ones
+			CheckScans(times, dones, offset, now, 0, kTimeMax);
+			CheckScans(times, dones, offset, now, kTimeMax - 1, kTimeMax);
+			CheckScans(times, dones, offset, now, now, now);
+			CheckScans(times, dones, offset, now, end + 1, begin);
+		}
+	}
+
+	// Large random inputs
+	for (uint32_t round = 0; round < 16; ++round) {
+		uint32_t count = 1000 + rng() % 5000;
+		std::vector<backend::TimeInt> times(count);
+		std::vector<uint8_t> dones(count);
+		for (uint32_t i = 0; i < count; ++i) {
+			times[i] = rng() % 4096;
+			dones[i] = rng() % 2;
+		}
+		backend::TimeInt begin = rng() % 4096, end = rng() % 4096;
+		CheckScans(times, dones, 0, rng() % 4096, begin, end);
+	}
+
+	printf("%s: %u failures\n", path, g_failures);
+	return g_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+#ifndef SCHEDULITE_CLI_BATCH_HPP
+#define SCHEDULITE_CLI_BATCH_HPP
+
+#include <backend/Planner.hpp>
+#include <backend/Schedule.hpp>
+
+#include <cxxopts.hpp>
+
+#include <istream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace cli {
+
+/**
+ * Add the Task property options (-t, -b, -m, -p, -y, --repeat, --except, --duration, --after), shared by the command
+ * line and the batch commands.
+ */
+void AddTaskOptions(cxxopts::Options *options);
+
+/**
+ * Get the Task dependencies of the --after option, which must be given.
+ */
+void ParseTaskDependencies(const cxxopts::ParseResult &result, std::vector<uint32_t> *p_dependencies);
+
+/**
+ * Get the TaskRecurrence of the --repeat and --except options, if --repeat is given.
+ * @return nullptr if valid, or else an error string.
+ */
+const char *ParseTaskRecurrence(const cxxopts::ParseResult &result, backend::TaskRecurrence *p_recurrence);
+
+/**
+ * A batch is a stream of command lines, each with one of -i, -e ID, -s ID or -d ID and the Task property options,
+ * e.g. `-i -t "Read a book" -b "2022/05/01 20:00" -p high`. Empty lines and lines starting with '#' are skipped.
+ * @brief Parsed batch commands.
+ */
+struct Batch {
+	std::vector<backend::TaskOp> ops;
+	/** @brief The line number of each TaskOp. */
+	std::vector<uint32_t> lines;
+};
+
+/**
+ * Parse and validate all the commands of a batch, errors are printed with their line numbers.
+ * @return The Batch, and whether every command is valid.
+ */
+std::tuple<Batch, bool> ParseBatch(std::istream &in);
+
+/**
+ * Print the result of each batch command.
+ */
+void PrintBatchResults(const Batch &batch, const std::vector<backend::TaskOpResult> &results);
+
+/**
+ * A plan is a stream of lines like a batch, each describing a FlexibleTask with -t, --duration and optionally -p, -y,
+ * -b (the earliest begin time) and --deadline, e.g. `-t "Write report" --duration 90 --deadline "2022/05/06 18:00"`.
+ * @brief Parsed plan lines.
+ */
+struct Plan {
+	std::vector<backend::FlexibleTask> tasks;
+	/** @brief The line number of each FlexibleTask. */
+	std::vector<uint32_t> lines;
+};
+
+/**
+ * Parse and validate all the lines of a plan, errors are printed with their line numbers.
+ * @return The Plan, and whether every line is valid.
+ */
+std::tuple<Plan, bool> ParsePlan(std::istream &in);
+
+/**
+ * Print the slot planned for each line of a Plan, or the lines left unplaced.
+ */
+void PrintTaskPlan(const Plan &plan, const backend::TaskPlan &task_plan);
+
+} // namespace cli
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef SCHEDULITE_CLI_DAEMON_HPP
+#define SCHEDULITE_CLI_DAEMON_HPP
+
+#include <backend/Dependency.hpp>
+#include <backend/Error.hpp>
+#include <backend/Instance.hpp>
+#include <backend/Schedule.hpp>
+#include <backend/Task.hpp>
+
+#include <cli/ScheduleClient.hpp>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+namespace cli {
+
+/**
+ * The daemon keeps logged-in Schedules warm and serves them over a Unix domain socket, each request and response is a
+ * frame of [u32 payload length][u8 op or Error][payload]. Requests after kLogin are prefixed with the session token,
+ * sessions expire after 12 idle hours. Only available on POSIX systems.
+ */
+enum class DaemonOp : uint8_t {
+	kLogin = 1,
+	kList,
+	kInsert,
+	kEdit,
+	kErase,
+	kDone,
+	kBatch,
+	kImport,
+	kSearch,
+	kOccurrences,
+	kConflicts,
+	kFreeSlot,
+	kOverlaps,
+	kDependencies,
+	kDayCounts,
+	kReport,
+	kArchive,
+	kArchivedList,
+	kArchivedSearch,
+	kLogout
+};
+
+/** @brief Environment variable holding a daemon session token. */
+constexpr const char *kDaemonSessionEnvName = "SCHEDULITE_SESSION";
+
+std::string GetDaemonSocketPath(const backend::Instance &instance);
+
+/**
+ * Serve the Instance until SIGINT or SIGTERM.
+ * @return Exit code.
+ */
+int RunDaemon(const std::shared_ptr<backend::Instance> &instance_ptr);
+
+/**
+ * A Schedule served by the daemon, exposing the same Task operations as backend::Schedule.
+ */
+class DaemonSchedule final : public ScheduleClient {
+public:
+	explicit DaemonSchedule(int fd) : m_fd{fd} {}
+	~DaemonSchedule() override;
+	DaemonSchedule(const DaemonSchedule &) = delete;
+	DaemonSchedule &operator=(const DaemonSchedule &) = delete;
+
+	/**
+	 * Connect to the daemon of an Instance.
+	 * @return nullptr if the daemon is not running.
+	 */
+	static std::unique_ptr<DaemonSchedule> Connect(const backend::Instance &instance);
+
+	/**
+	 * Login through the daemon, the session token is kept for the following operations.
+	 */
+	backend::Error Login(std::string_view username, std::string_view password);
+	/**
+	 * End the session on the daemon.
+	 */
+	backend::Error Logout();
+	inline void SetSession(std::string token) { m_token = std::move(token); }
+	inline const std::string &GetSession() const { return m_token; }
+
+	/**
+	 * Fetch the Tasks matching a TaskQuery, the query is run by the daemon.
+	 * @return Tasks and Error code.
+	 */
+	std::tuple<std::vector<backend::Task>, backend::Error> QueryTasks(const backend::TaskQuery &query) override;
+	/**
+	 * Search Tasks by name with the daemon's warm search index.
+	 * @return Tasks and Error code.
+	 * @see backend::Schedule::SearchTasks
+	 */
+	std::tuple<std::vector<backend::Task>, backend::Error> SearchTasks(std::string_view query, uint32_t limit) override;
+	/**
+	 * Fetch the archived Tasks matching a TaskQuery from the daemon's loaded archive.
+	 * @return Tasks and Error code.
+	 * @see backend::Schedule::QueryArchivedTasks
+	 */
+	std::tuple<std::vector<backend::Task>, backend::Error>
+	QueryArchivedTasks(const backend::TaskQuery &query) override;
+	/**
+	 * Search the archived Tasks by name with the daemon's loaded archive.
+	 * @return Tasks and Error code.
+	 * @see backend::Schedule::SearchArchivedTasks
+	 */
+	std::tuple<std::vector<backend::Task>, backend::Error> SearchArchivedTasks(std::string_view query,
+	                                                                           uint32_t limit) override;
+	/**
+	 * Archive the done Tasks that ended before a time.
+	 * @return Number of archived Tasks and Error code.
+	 * @see backend::Schedule::ArchiveTasks
+	 */
+	std::tuple<uint32_t, backend::Error> ArchiveTasks(backend::TimeInt before) override;
+	/**
+	 * Get the Task occurrences inside a time window, expanded (and cached) by the daemon.
+	 * @return Task occurrences and Error code.
+	 * @see backend::Schedule::GetTaskOccurrences
+	 */
+	std::tuple<std::vector<backend::Task>, backend::Error> GetTaskOccurrences(backend::TimeInt since,
+	                                                                          backend::TimeInt until) override;
+	/**
+	 * Get the conflicts of a TaskProperty with the daemon's warm interval index.
+	 * @return Conflicting Task occurrences and Error code.
+	 * @see backend::Schedule::GetTaskConflicts
+	 */
+	std::tuple<std::vector<backend::Task>, backend::Error> GetTaskConflicts(const backend::TaskProperty &property,
+	                                                                        uint32_t id) override;
+	/**
+	 * Find the first free time slot of a duration through the daemon.
+	 * @return The begin time of the slot, whether a slot is found, and Error code.
+	 * @see backend::Schedule::FindFreeSlot
+	 */
+	std::tuple<backend::TimeInt, bool, backend::Error> FindFreeSlot(backend::TimeInt after, uint32_t duration,
+	                                                                backend::TimeInt until) override;
+	/**
+	 * Get the Task occurrences overlapping a time span with the daemon's warm interval index.
+	 * @return Overlapping Task occurrences and Error code.
+	 * @see backend::Schedule::GetOverlappingTasks
+	 */
+	std::tuple<std::vector<backend::Task>, backend::Error> GetOverlappingTasks(backend::TimeInt begin,
+	                                                                           backend::TimeInt end) override;
+	/**
+	 * Get the blocked Tasks with the daemon's warm dependency graph.
+	 * @return Blocked Tasks and Error code.
+	 * @see backend::Schedule::GetBlockedTasks
+	 */
+	std::tuple<std::vector<backend::TaskDependencyInfo>, backend::Error> GetBlockedTasks() override;
+	/**
+	 * Get the critical path of the Task dependencies with the daemon's warm dependency graph.
+	 * @return Tasks on the critical path and Error code.
+	 * @see backend::Schedule::GetCriticalPath
+	 */
+	std::tuple<std::vector<backend::TaskDependencyInfo>, backend::Error> GetCriticalPath() override;
+	/**
+	 * Count the Task occurrences of each local day with the daemon's warm calendar index.
+	 * @return Counts of each day and Error code.
+	 * @see backend::Schedule::GetDayCounts
+	 */
+	std::tuple<std::vector<backend::DayTaskCounts>, backend::Error> GetDayCounts(int64_t first_day,
+	                                                                           int64_t last_day) override;
+	/**
+	 * Count the Task occurrences of a range of local days with the daemon's warm calendar index.
+	 * @return Counts and Error code.
+	 * @see backend::Schedule::GetRangeCounts
+	 */
+	std::tuple<backend::TaskCounts, backend::Error> GetRangeCounts(int64_t first_day, int64_t last_day) override;
+	/**
+	 * Compute a productivity report with the daemon's cached report columns.
+	 * @return The TaskReport and Error code.
+	 * @see backend::Schedule::GetTaskReport
+	 */
+	std::tuple<backend::TaskReport, backend::Error> GetTaskReport(backend::TimeInt since,
+	                                                            backend::TimeInt until) override;
+	std::tuple<uint32_t, backend::Error> TaskInsert(const backend::TaskProperty &task_property) override;
+	backend::Error TaskErase(uint32_t id) override;
+	backend::Error TaskEdit(uint32_t id, const backend::TaskProperty &property,
+	                        backend::TaskPropertyMask property_edit_mask) override;
+	backend::Error TaskToggleDone(uint32_t id) override;
+	std::tuple<std::vector<backend::TaskOpResult>, backend::Error>
+	TaskBatch(const std::vector<backend::TaskOp> &ops) override;
+	std::tuple<uint32_t, backend::Error> TaskImport(std::vector<backend::TaskProperty> properties) override;
+
+private:
+	int m_fd;
+	std::string m_token;
+
+	std::tuple<std::string, backend::Error> request(DaemonOp op, std::string_view payload);
+	std::tuple<std::vector<backend::TaskDependencyInfo>, backend::Error> request_dependencies(bool critical_path);
+};
+
+} // namespace cli
+
+#endif
@@ -1,8 +1,16 @@
 #ifndef SCHEDULITE_CLI_FORMAT_HPP
 #define SCHEDULITE_CLI_FORMAT_HPP
 
+#include <backend/Analytics.hpp>
+#include <backend/Calendar.hpp>
+#include <backend/Dependency.hpp>
 #include <backend/Error.hpp>
+#include <backend/Exchange.hpp>
+#include <backend/Metrics.hpp>
 #include <backend/Task.hpp>
+#include <optional>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace cli {
@@ -10,6 +18,44 @@ namespace cli {
 void PrintError(backend::Error error);
 void PrintError(std::string_view error_str);
 void PrintTasks(const std::vector<backend::Task> &tasks);
+/**
+ * Print Tasks as a table, or streamed in an ExchangeFormat.
+ */
+void PrintTasks(const std::vector<backend::Task> &tasks, const std::optional<backend::ExchangeFormat> &format);
+/**
+ * Print the records rejected by an import, with their line numbers.
+ */
+void PrintImportErrors(const std::vector<backend::ImportError> &errors);
+/**
+ * Print a warning for each Task occurrence a Task would overlap.
+ */
+void PrintConflicts(const std::vector<backend::Task> &conflicts);
+/**
+ * Print the earliest begin time and slack of each Task on the dependency chains.
+ */
+void PrintDependencyInfos(const std::vector<backend::TaskDependencyInfo> &infos);
+/**
+ * @brief The days [first, last) of a month, and of each of its weeks (from Monday), in days since 1970/01/01.
+ */
+struct MonthDays {
+	int year;
+	unsigned month;
+	int64_t first, last;
+	std::vector<std::pair<int64_t, int64_t>> weeks;
+};
+MonthDays GetMonthDays(int year, unsigned month);
+/**
+ * Print the Task counts of a month as a grid of weeks from Monday, with the totals of each week and of the month.
+ * @param day_counts Counts of each day of the month.
+ * @param week_counts Counts of each of MonthDays::weeks.
+ */
+void PrintMonthCounts(const MonthDays &days, const std::vector<backend::DayTaskCounts> &day_counts,
+                      const std::vector<backend::TaskCounts> &week_counts, const backend::TaskCounts &month_counts);
+/**
+ * Print a TaskReport of the Tasks beginning in [since, until) as a JSON object.
+ */
+void PrintTaskReport(backend::TimeInt since, backend::TimeInt until, const backend::TaskReport &report);
+void PrintMetrics(const backend::ScheduleMetrics &metrics);
 
 } // namespace cli
 
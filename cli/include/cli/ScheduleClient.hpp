@@ -0,0 +1,123 @@
+#ifndef SCHEDULITE_CLI_SCHEDULE_CLIENT_HPP
+#define SCHEDULITE_CLI_SCHEDULE_CLIENT_HPP
+
+#include <backend/Dependency.hpp>
+#include <backend/Error.hpp>
+#include <backend/Schedule.hpp>
+#include <backend/Task.hpp>
+
+#include <memory>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+namespace cli {
+
+/**
+ * The Task operations of the CLI, served by either a local backend::Schedule (LocalScheduleClient) or the daemon
+ * (DaemonSchedule). Every operation reports an Error, since a daemon request may fail even where the Schedule cannot.
+ * @brief Schedule operations of the CLI.
+ */
+class ScheduleClient {
+public:
+	virtual ~ScheduleClient() = default;
+
+	/** @see backend::Schedule::QueryTasks */
+	virtual std::tuple<std::vector<backend::Task>, backend::Error> QueryTasks(const backend::TaskQuery &query) = 0;
+	/** @see backend::Schedule::SearchTasks */
+	virtual std::tuple<std::vector<backend::Task>, backend::Error> SearchTasks(std::string_view query,
+	                                                                           uint32_t limit) = 0;
+	/** @see backend::Schedule::QueryArchivedTasks */
+	virtual std::tuple<std::vector<backend::Task>, backend::Error>
+	QueryArchivedTasks(const backend::TaskQuery &query) = 0;
+	/** @see backend::Schedule::SearchArchivedTasks */
+	virtual std::tuple<std::vector<backend::Task>, backend::Error> SearchArchivedTasks(std::string_view query,
+	                                                                                   uint32_t limit) = 0;
+	/** @see backend::Schedule::ArchiveTasks */
+	virtual std::tuple<uint32_t, backend::Error> ArchiveTasks(backend::TimeInt before) = 0;
+	/** @see backend::Schedule::GetTaskOccurrences */
+	virtual std::tuple<std::vector<backend::Task>, backend::Error> GetTaskOccurrences(backend::TimeInt since,
+	                                                                                  backend::TimeInt until) = 0;
+	/** @see backend::Schedule::GetTaskConflicts */
+	virtual std::tuple<std::vector<backend::Task>, backend::Error>
+	GetTaskConflicts(const backend::TaskProperty &property, uint32_t id) = 0;
+	/** @see backend::Schedule::FindFreeSlot */
+	virtual std::tuple<backend::TimeInt, bool, backend::Error> FindFreeSlot(backend::TimeInt after, uint32_t duration,
+	                                                                        backend::TimeInt until) = 0;
+	/** @see backend::Schedule::GetOverlappingTasks */
+	virtual std::tuple<std::vector<backend::Task>, backend::Error> GetOverlappingTasks(backend::TimeInt begin,
+	                                                                                   backend::TimeInt end) = 0;
+	/** @see backend::Schedule::GetBlockedTasks */
+	virtual std::tuple<std::vector<backend::TaskDependencyInfo>, backend::Error> GetBlockedTasks() = 0;
+	/** @see backend::Schedule::GetCriticalPath */
+	virtual std::tuple<std::vector<backend::TaskDependencyInfo>, backend::Error> GetCriticalPath() = 0;
+	/** @see backend::Schedule::GetDayCounts */
+	virtual std::tuple<std::vector<backend::DayTaskCounts>, backend::Error> GetDayCounts(int64_t first_day,
+	                                                                                   int64_t last_day) = 0;
+	/** @see backend::Schedule::GetRangeCounts */
+	virtual std::tuple<backend::TaskCounts, backend::Error> GetRangeCounts(int64_t first_day, int64_t last_day) = 0;
+	/** @see backend::Schedule::GetTaskReport */
+	virtual std::tuple<backend::TaskReport, backend::Error> GetTaskReport(backend::TimeInt since,
+	                                                                    backend::TimeInt until) = 0;
+	/** @see backend::Schedule::TaskInsert */
+	virtual std::tuple<uint32_t, backend::Error> TaskInsert(const backend::TaskProperty &task_property) = 0;
+	/** @see backend::Schedule::TaskErase */
+	virtual backend::Error TaskErase(uint32_t id) = 0;
+	/** @see backend::Schedule::TaskEdit */
+	virtual backend::Error TaskEdit(uint32_t id, const backend::TaskProperty &property,
+	                                backend::TaskPropertyMask property_edit_mask) = 0;
+	/** @see backend::Schedule::TaskToggleDone */
+	virtual backend::Error TaskToggleDone(uint32_t id) = 0;
+	/** @see backend::Schedule::TaskBatch */
+	virtual std::tuple<std::vector<backend::TaskOpResult>, backend::Error>
+	TaskBatch(const std::vector<backend::TaskOp> &ops) = 0;
+	/** @see backend::Schedule::TaskImport */
+	virtual std::tuple<uint32_t, backend::Error> TaskImport(std::vector<backend::TaskProperty> properties) = 0;
+};
+
+/**
+ * ScheduleClient of a Schedule acquired by the process.
+ */
+class LocalScheduleClient final : public ScheduleClient {
+public:
+	explicit LocalScheduleClient(std::shared_ptr<backend::Schedule> schedule_ptr)
+	    : m_schedule_ptr{std::move(schedule_ptr)} {}
+
+	std::tuple<std::vector<backend::Task>, backend::Error> QueryTasks(const backend::TaskQuery &query) override;
+	std::tuple<std::vector<backend::Task>, backend::Error> SearchTasks(std::string_view query,
+	                                                                   uint32_t limit) override;
+	std::tuple<std::vector<backend::Task>, backend::Error> QueryArchivedTasks(const backend::TaskQuery &query) override;
+	std::tuple<std::vector<backend::Task>, backend::Error> SearchArchivedTasks(std::string_view query,
+	                                                                           uint32_t limit) override;
+	std::tuple<uint32_t, backend::Error> ArchiveTasks(backend::TimeInt before) override;
+	std::tuple<std::vector<backend::Task>, backend::Error> GetTaskOccurrences(backend::TimeInt since,
+	                                                                          backend::TimeInt until) override;
+	std::tuple<std::vector<backend::Task>, backend::Error> GetTaskConflicts(const backend::TaskProperty &property,
+	                                                                        uint32_t id) override;
+	std::tuple<backend::TimeInt, bool, backend::Error> FindFreeSlot(backend::TimeInt after, uint32_t duration,
+	                                                                backend::TimeInt until) override;
+	std::tuple<std::vector<backend::Task>, backend::Error> GetOverlappingTasks(backend::TimeInt begin,
+	                                                                           backend::TimeInt end) override;
+	std::tuple<std::vector<backend::TaskDependencyInfo>, backend::Error> GetBlockedTasks() override;
+	std::tuple<std::vector<backend::TaskDependencyInfo>, backend::Error> GetCriticalPath() override;
+	std::tuple<std::vector<backend::DayTaskCounts>, backend::Error> GetDayCounts(int64_t first_day,
+	                                                                           int64_t last_day) override;
+	std::tuple<backend::TaskCounts, backend::Error> GetRangeCounts(int64_t first_day, int64_t last_day) override;
+	std::tuple<backend::TaskReport, backend::Error> GetTaskReport(backend::TimeInt since,
+	                                                            backend::TimeInt until) override;
+	std::tuple<uint32_t, backend::Error> TaskInsert(const backend::TaskProperty &task_property) override;
+	backend::Error TaskErase(uint32_t id) override;
+	backend::Error TaskEdit(uint32_t id, const backend::TaskProperty &property,
+	                        backend::TaskPropertyMask property_edit_mask) override;
+	backend::Error TaskToggleDone(uint32_t id) override;
+	std::tuple<std::vector<backend::TaskOpResult>, backend::Error>
+	TaskBatch(const std::vector<backend::TaskOp> &ops) override;
+	std::tuple<uint32_t, backend::Error> TaskImport(std::vector<backend::TaskProperty> properties) override;
+
+private:
+	std::shared_ptr<backend::Schedule> m_schedule_ptr;
+};
+
+} // namespace cli
+
+#endif
@@ -34,10 +34,16 @@ private:
 	void cmd_register();
 	void cmd_login();
 	void cmd_list();
+	void cmd_search();
+	void cmd_agenda();
+	void cmd_free();
+	void cmd_blocked();
+	void cmd_month();
 	void cmd_insert();
 	void cmd_edit();
 	void cmd_erase();
 	void cmd_done();
+	void cmd_stats();
 
 	void print_prompt();
 };
@@ -3,6 +3,8 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 namespace cli {
 
@@ -11,6 +13,15 @@ std::string Input(const char *prompt, bool echo = true);
 inline std::string Input(const std::string &prompt, bool echo = true) { return Input(prompt.c_str(), echo); }
 uint32_t GetTerminalWidth();
 bool EmptyInput(std::string_view input);
+/**
+ * Split a command line into arguments, supporting '' and "" quoting and backslash escapes.
+ */
+std::vector<std::string> SplitArgs(std::string_view line);
+/**
+ * Parse a "YYYY/MM" month.
+ * @return Whether the month is valid.
+ */
+bool ParseMonth(std::string_view str, int *p_year, unsigned *p_month);
 template <typename Iter> inline std::string MakeOptionStr(Iter begin, Iter end) {
 	std::string ret{*(begin++)};
 	for (Iter i = begin; i != end; ++i) {
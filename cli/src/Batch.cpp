@@ -0,0 +1,278 @@
+#include <cli/Batch.hpp>
+
+#include <cli/Format.hpp>
+#include <cli/Util.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+
+namespace cli {
+
+namespace {
+bool parse_time(const std::string &str, backend::TimeInt *p_time_int) {
+	backend::TimeInfo info{};
+	if (sscanf(str.c_str(), "%d/%u/%u%u:%u", &info.year, &info.month, &info.day, &info.hour, &info.minute) != 5 ||
+	    info.month < 1 || info.month > 12 || info.day < 1 || info.day > 31 || info.hour > 23 || info.minute > 59)
+		return false;
+	*p_time_int = backend::ToTimeInt(info);
+	return true;
+}
+
+// Check the first letter, as TaskPriorityFromStr() and TaskTypeFromStr() do
+template <typename Container> bool is_option_str(const Container &options, const std::string &str) {
+	for (const char *option : options)
+		if (!str.empty() && tolower(str[0]) == tolower(option[0]))
+			return true;
+	return false;
+}
+
+// Get the TaskOp of a command line, or an error string
+const char *parse_task_op(const cxxopts::ParseResult &result, backend::TimeInt time_int_now, backend::TaskOp *p_op) {
+	if (result.count("insert") + result.count("edit") + result.count("erase") + result.count("done") != 1)
+		return "Exactly one of -i, -e, -s and -d is required";
+
+	backend::TaskOp &op = *p_op;
+	op = {};
+	if (result.count("erase")) {
+		op.type = backend::TaskOpType::kErase;
+		op.id = result["erase"].as<uint32_t>();
+		return nullptr;
+	}
+	if (result.count("done")) {
+		op.type = backend::TaskOpType::kToggleDone;
+		op.id = result["done"].as<uint32_t>();
+		return nullptr;
+	}
+
+	if (result.count("insert")) {
+		if (!result.count("taskname"))
+			return "Task name not provided";
+		op.type = backend::TaskOpType::kInsert;
+		op.property.begin_time = op.property.remind_time = time_int_now;
+	} else {
+		op.type = backend::TaskOpType::kEdit;
+		op.id = result["edit"].as<uint32_t>();
+	}
+
+	if (result.count("taskname")) {
+		op.property.name = result["taskname"].as<std::string>();
+		if (op.property.name.empty())
+			return "Empty task name";
+		op.property_edit_mask |= backend::TaskPropertyMask::kName;
+	}
+	if (result.count("btime")) {
+		if (!parse_time(result["btime"].as<std::string>(), &op.property.begin_time))
+			return "Invalid begin time";
+		op.property_edit_mask |= backend::TaskPropertyMask::kBeginTime;
+	}
+	if (result.count("rtime")) {
+		if (!parse_time(result["rtime"].as<std::string>(), &op.property.remind_time))
+			return "Invalid remind time";
+		op.property_edit_mask |= backend::TaskPropertyMask::kRemindTime;
+	}
+	if (result.count("priority")) {
+		const auto &str = result["priority"].as<std::string>();
+		if (!is_option_str(backend::GetTaskPriorityStrings(), str))
+			return "Invalid priority";
+		op.property.priority = backend::TaskPriorityFromStr(str);
+		op.property_edit_mask |= backend::TaskPropertyMask::kPriority;
+	}
+	if (result.count("type")) {
+		const auto &str = result["type"].as<std::string>();
+		if (!is_option_str(backend::GetTaskTypeStrings(), str))
+			return "Invalid type";
+		op.property.type = backend::TaskTypeFromStr(str);
+		op.property_edit_mask |= backend::TaskPropertyMask::kType;
+	}
+	if (result.count("repeat") || result.count("except")) {
+		if (const char *error = ParseTaskRecurrence(result, &op.property.recurrence))
+			return error;
+		op.property_edit_mask |= backend::TaskPropertyMask::kRecurrence;
+	}
+	if (result.count("duration")) {
+		op.property.duration = result["duration"].as<uint32_t>();
+		op.property_edit_mask |= backend::TaskPropertyMask::kDuration;
+	}
+	if (result.count("after")) {
+		ParseTaskDependencies(result, &op.property.dependencies);
+		op.property_edit_mask |= backend::TaskPropertyMask::kDependencies;
+	}
+	return nullptr;
+}
+
+// Parse each command line of a stream, parse() returns nullptr or an error string which is printed with the line number
+template <typename Parse> bool parse_lines(std::istream &in, cxxopts::Options *p_options, Parse &&parse) {
+	bool valid = true;
+	std::string line;
+	std::vector<const char *> argv;
+	for (uint32_t line_number = 1; std::getline(in, line); ++line_number) {
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+		if (EmptyInput(line) || line[line.find_first_not_of(" \t")] == '#')
+			continue;
+
+		std::vector<std::string> args = SplitArgs(line);
+		argv.assign(1, "batch");
+		for (const auto &arg : args)
+			argv.push_back(arg.c_str());
+
+		const char *error;
+		try {
+			auto result = p_options->parse((int)argv.size(), argv.data());
+			if (!result.unmatched().empty())
+				error = "Unexpected argument";
+			else
+				error = parse(result, line_number);
+		} catch (cxxopts::OptionException &e) {
+			printf("Line %u: ERROR: %s\n", line_number, e.what());
+			valid = false;
+			continue;
+		}
+		if (error) {
+			printf("Line %u: ERROR: %s\n", line_number, error);
+			valid = false;
+		}
+	}
+	return valid;
+}
+} // namespace
+
+const char *ParseTaskRecurrence(const cxxopts::ParseResult &result, backend::TaskRecurrence *p_recurrence) {
+	if (!result.count("repeat"))
+		return result.count("except") ? "--except requires --repeat" : nullptr;
+	bool valid;
+	std::tie(*p_recurrence, valid) = backend::TaskRecurrenceFromStr(result["repeat"].as<std::string>());
+	if (!valid)
+		return "Invalid repeat rule";
+	if (result.count("except")) {
+		if (!p_recurrence->IsRecurring())
+			return "--except requires a repeating task";
+		auto &exceptions = p_recurrence->exceptions;
+		for (const auto &str : result["except"].as<std::vector<std::string>>()) {
+			backend::TimeInt time_int;
+			if (!parse_time(str, &time_int))
+				return "Invalid exception time";
+			exceptions.push_back(time_int);
+		}
+		std::sort(exceptions.begin(), exceptions.end());
+		exceptions.erase(std::unique(exceptions.begin(), exceptions.end()), exceptions.end());
+	}
+	return nullptr;
+}
+
+void AddTaskOptions(cxxopts::Options *options) {
+	options->add_options("Task")                                   //
+	    ("t,taskname", "Task name", cxxopts::value<std::string>()) //
+	    ("b,btime", "Begin time (local time, \"YYYY/MM/DD hh:mm\")",
+	     cxxopts::value<std::string>()) //
+	    ("m,rtime", "Remind time (local time, \"YYYY/MM/DD hh:mm\")",
+	     cxxopts::value<std::string>()) //
+	    ("p,priority", "Priority (" + MakeOptionStr(backend::GetTaskPriorityStrings()) + ")",
+	     cxxopts::value<std::string>()) //
+	    ("y,type", "Type (" + MakeOptionStr(backend::GetTaskTypeStrings()) + ")",
+	     cxxopts::value<std::string>()) //
+	    ("repeat",
+	     "Repeat rule (daily/weekly/monthly/yearly/none, or \"FREQ=WEEKLY;INTERVAL=2;BYDAY=MO,FR;COUNT=10\")",
+	     cxxopts::value<std::string>()) //
+	    ("except", "Skip the occurrence at a time of the repeat rule (local time, can be repeated)",
+	     cxxopts::value<std::vector<std::string>>()) //
+	    ("duration", "Duration in minutes, 0 for no end time", cxxopts::value<uint32_t>()) //
+	    ("after", "IDs of the tasks to be done before (comma separated, 0 for none)",
+	     cxxopts::value<std::vector<uint32_t>>()) //
+	    ;
+}
+
+void ParseTaskDependencies(const cxxopts::ParseResult &result, std::vector<uint32_t> *p_dependencies) {
+	*p_dependencies = result["after"].as<std::vector<uint32_t>>();
+	p_dependencies->erase(std::remove(p_dependencies->begin(), p_dependencies->end(), 0), p_dependencies->end());
+}
+
+std::tuple<Batch, bool> ParseBatch(std::istream &in) {
+	cxxopts::Options options{"batch"};
+	options.add_options()                                                                 //
+	    ("i,insert", "Insert task")                                                       //
+	    ("e,edit", "Edit task (with task ID)", cxxopts::value<uint32_t>())                //
+	    ("s,erase", "Erase task (with task ID)", cxxopts::value<uint32_t>())              //
+	    ("d,done", "Done with a task (toggle, with task ID)", cxxopts::value<uint32_t>()) //
+	    ;
+	AddTaskOptions(&options);
+
+	Batch batch;
+	backend::TimeInt time_int_now = backend::GetTimeIntNow();
+	bool valid = parse_lines(in, &options, [&](const cxxopts::ParseResult &result, uint32_t line_number) {
+		backend::TaskOp op;
+		const char *error = parse_task_op(result, time_int_now, &op);
+		if (!error) {
+			batch.ops.push_back(std::move(op));
+			batch.lines.push_back(line_number);
+		}
+		return error;
+	});
+	return {std::move(batch), valid};
+}
+
+std::tuple<Plan, bool> ParsePlan(std::istream &in) {
+	cxxopts::Options options{"plan"};
+	options.add_options()                                                          //
+	    ("t,taskname", "Task name", cxxopts::value<std::string>())                 //
+	    ("b,btime", "Earliest begin time", cxxopts::value<std::string>())          //
+	    ("deadline", "Latest end time", cxxopts::value<std::string>())             //
+	    ("p,priority", "Priority", cxxopts::value<std::string>())                  //
+	    ("y,type", "Type", cxxopts::value<std::string>())                          //
+	    ("duration", "Duration in minutes", cxxopts::value<uint32_t>())            //
+	    ;
+
+	Plan plan;
+	bool valid = parse_lines(in, &options, [&](const cxxopts::ParseResult &result, uint32_t line_number) {
+		backend::FlexibleTask task{};
+		if (!result.count("taskname") || result["taskname"].as<std::string>().empty())
+			return "Task name not provided";
+		task.property.name = result["taskname"].as<std::string>();
+		if (!result.count("duration") || !result["duration"].as<uint32_t>())
+			return "Duration not provided";
+		task.property.duration = result["duration"].as<uint32_t>();
+		if (result.count("btime") && !parse_time(result["btime"].as<std::string>(), &task.earliest))
+			return "Invalid begin time";
+		if (result.count("deadline") && !parse_time(result["deadline"].as<std::string>(), &task.deadline))
+			return "Invalid deadline";
+		if (result.count("priority")) {
+			const auto &str = result["priority"].as<std::string>();
+			if (!is_option_str(backend::GetTaskPriorityStrings(), str))
+				return "Invalid priority";
+			task.property.priority = backend::TaskPriorityFromStr(str);
+		}
+		if (result.count("type")) {
+			const auto &str = result["type"].as<std::string>();
+			if (!is_option_str(backend::GetTaskTypeStrings(), str))
+				return "Invalid type";
+			task.property.type = backend::TaskTypeFromStr(str);
+		}
+		plan.tasks.push_back(std::move(task));
+		plan.lines.push_back(line_number);
+		return (const char *)nullptr;
+	});
+	return {std::move(plan), valid};
+}
+
+void PrintBatchResults(const Batch &batch, const std::vector<backend::TaskOpResult> &results) {
+	for (std::size_t i = 0; i < results.size() && i < batch.lines.size(); ++i) {
+		if (results[i].error == backend::Error::kSuccess)
+			printf("Line %u: Success (task %u)\n", batch.lines[i], results[i].id);
+		else
+			printf("Line %u: ERROR: %s\n", batch.lines[i], backend::GetErrorMessage(results[i].error));
+	}
+}
+
+void PrintTaskPlan(const Plan &plan, const backend::TaskPlan &task_plan) {
+	for (std::size_t i = 0; i < task_plan.ops.size(); ++i) {
+		const backend::TaskProperty &property = task_plan.ops[i].property;
+		printf("Line %u: %s - %s \"%s\"\n", plan.lines[task_plan.placed[i]],
+		       backend::ToTimeStr(property.begin_time).c_str(),
+		       backend::ToTimeStr(backend::TaskEndTime(property)).c_str(), property.name.c_str());
+	}
+	for (uint32_t index : task_plan.unplaced)
+		printf("Line %u: ERROR: No free slot before the deadline\n", plan.lines[index]);
+}
+
+} // namespace cli
@@ -0,0 +1,891 @@
+#include <cli/Daemon.hpp>
+
+#include <backend/Environment.hpp>
+#include <backend/Schedule.hpp>
+#include <backend/User.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace cli {
+
+namespace {
+constexpr const char *kSocketName = "schedulite.sock";
+constexpr uint32_t kTokenLength = 32; // Hex digits of 16 random bytes
+constexpr uint32_t kMaxFrameSize = backend::kMaxSharedScheduleMemory + 4096;
+// Sessions unused for longer expire, the least recently used one is ended when a login exceeds the cap
+constexpr std::chrono::hours kSessionIdleTimeout{12};
+constexpr std::size_t kMaxSessions = 256;
+
+inline void str_append_uint32(std::string *str, uint32_t n) {
+	(*str) += char(n & 0xffu);
+	(*str) += char((n >> 8u) & 0xffu);
+	(*str) += char((n >> 16u) & 0xffu);
+	(*str) += char(n >> 24u);
+}
+inline uint32_t uint32_from_str(std::string_view str) {
+	return uint8_t(str[0]) | (uint8_t(str[1]) << 8u) | (uint8_t(str[2]) << 16u) | (uint8_t(str[3]) << 24u);
+}
+// [Task][u32 earliest begin][u32 latest begin] of each TaskDependencyInfo
+inline std::string str_from_dependency_infos(const std::vector<backend::TaskDependencyInfo> &infos) {
+	std::string str;
+	for (const auto &info : infos) {
+		str += backend::StrFromTask(info.task);
+		str_append_uint32(&str, info.earliest_begin);
+		str_append_uint32(&str, info.latest_begin);
+	}
+	return str;
+}
+inline std::vector<backend::TaskDependencyInfo> dependency_infos_from_str(std::string_view str) {
+	std::vector<backend::TaskDependencyInfo> infos;
+	while (!str.empty()) {
+		auto [task, len] = backend::TaskFromStr(str);
+		if (!len || str.size() < len + 8)
+			break;
+		infos.push_back({std::move(task), uint32_from_str(str.substr(len)), uint32_from_str(str.substr(len + 4))});
+		str = str.substr(len + 8);
+	}
+	return infos;
+}
+// The counts in TaskStatus, then TaskType order
+inline void str_append_counts(std::string *str, const backend::TaskCounts &counts) {
+	for (const auto &type_counts : counts)
+		for (uint32_t count : type_counts)
+			str_append_uint32(str, count);
+}
+inline backend::TaskCounts counts_from_str(std::string_view str) {
+	backend::TaskCounts counts{};
+	for (auto &type_counts : counts)
+		for (uint32_t &count : type_counts) {
+			count = uint32_from_str(str);
+			str = str.substr(4);
+		}
+	return counts;
+}
+constexpr std::size_t kCountsSize = sizeof(backend::TaskCounts);
+// The counts by TaskType, the completion and backlog counts, then the u64 backlog age sum as two u32s
+inline void str_append_report(std::string *str, const backend::TaskReport &report) {
+	for (uint32_t count : report.type_counts)
+		str_append_uint32(str, count);
+	for (uint32_t count : report.type_done_counts)
+		str_append_uint32(str, count);
+	for (uint32_t count :
+	     {report.on_time, report.late, report.done_time_unknown, report.backlog, report.backlog_max_age})
+		str_append_uint32(str, count);
+	str_append_uint32(str, uint32_t(report.backlog_age_sum));
+	str_append_uint32(str, uint32_t(report.backlog_age_sum >> 32u));
+}
+constexpr std::size_t kReportSize = 4 * (2 * backend::GetTaskTypeStrings().size() + 7);
+inline backend::TaskReport report_from_str(std::string_view str) {
+	backend::TaskReport report{};
+	const auto next = [&str]() {
+		uint32_t value = uint32_from_str(str);
+		str = str.substr(4);
+		return value;
+	};
+	for (uint32_t &count : report.type_counts)
+		count = next();
+	for (uint32_t &count : report.type_done_counts)
+		count = next();
+	for (uint32_t *p_count : {&report.on_time, &report.late, &report.done_time_unknown, &report.backlog,
+	                          &report.backlog_max_age})
+		*p_count = next();
+	report.backlog_age_sum = next();
+	report.backlog_age_sum |= uint64_t(next()) << 32u;
+	return report;
+}
+inline std::string make_frame(uint8_t head, std::string_view payload) {
+	std::string frame;
+	frame.reserve(5 + payload.size());
+	str_append_uint32(&frame, payload.size());
+	frame += char(head);
+	frame += payload;
+	return frame;
+}
+} // namespace
+
+std::string GetDaemonSocketPath(const backend::Instance &instance) {
+	std::string path = instance.GetAppDirPath();
+	if (!path.empty() && path.back() != '/' && path.back() != '\\')
+		path += '/';
+	return path + kSocketName;
+}
+
+#ifdef _WIN32
+
+int RunDaemon(const std::shared_ptr<backend::Instance> &) {
+	printf("ERROR: Daemon is not supported on this platform\n");
+	return EXIT_FAILURE;
+}
+DaemonSchedule::~DaemonSchedule() = default;
+std::unique_ptr<DaemonSchedule> DaemonSchedule::Connect(const backend::Instance &) { return nullptr; }
+std::tuple<std::string, backend::Error> DaemonSchedule::request(DaemonOp, std::string_view) {
+	return {"", backend::Error::kFileIOError};
+}
+
+#else
+
+namespace {
+volatile std::sig_atomic_t g_daemon_stop = 0;
+
+bool write_all(int fd, std::string_view data) {
+	while (!data.empty()) {
+		ssize_t n = write(fd, data.data(), data.size());
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		data = data.substr(n);
+	}
+	return true;
+}
+bool read_all(int fd, char *data, std::size_t size) {
+	while (size) {
+		ssize_t n = read(fd, data, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return false;
+		data += n;
+		size -= n;
+	}
+	return true;
+}
+
+// Random bytes from the OS CSPRNG
+bool read_random(char *data, std::size_t size) {
+	int fd = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+	bool success = read_all(fd, data, size);
+	close(fd);
+	return success;
+}
+
+// Compare the whole tokens without an early exit, so that the time does not depend on where they differ
+bool token_equal(std::string_view l, std::string_view r) {
+	if (l.size() != r.size())
+		return false;
+	unsigned char diff = 0;
+	for (std::size_t i = 0; i < l.size(); ++i)
+		diff |= (unsigned char)(l[i] ^ r[i]);
+	return diff == 0;
+}
+
+bool set_non_blocking(int fd) {
+	int flags = fcntl(fd, F_GETFL);
+	return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) >= 0;
+}
+
+bool make_socket_address(const std::string &path, sockaddr_un *addr) {
+	*addr = {};
+	addr->sun_family = AF_UNIX;
+	if (path.size() >= sizeof(addr->sun_path))
+		return false;
+	std::copy(path.begin(), path.end(), addr->sun_path);
+	return true;
+}
+
+int connect_socket(const std::string &path) {
+	sockaddr_un addr;
+	if (!make_socket_address(path, &addr))
+		return -1;
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+	if (connect(fd, (const sockaddr *)&addr, sizeof(addr)) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+class DaemonServer {
+public:
+	explicit DaemonServer(std::shared_ptr<backend::Instance> instance_ptr) : m_instance_ptr{std::move(instance_ptr)} {}
+
+	std::string Handle(DaemonOp op, std::string_view payload) {
+		if (op == DaemonOp::kLogin)
+			return handle_login(payload);
+
+		if (payload.size() < kTokenLength)
+			return make_frame((uint8_t)backend::Error::kUserNotLoggedIn, {});
+		auto session_it = find_session(payload.substr(0, kTokenLength));
+		if (session_it == m_sessions.end())
+			return make_frame((uint8_t)backend::Error::kUserNotLoggedIn, {});
+		session_it->last_used = std::chrono::steady_clock::now();
+		backend::Schedule &schedule = *session_it->schedule;
+		payload = payload.substr(kTokenLength);
+
+		switch (op) {
+		case DaemonOp::kLogout:
+			m_sessions.erase(session_it);
+			release_schedules();
+			return make_frame((uint8_t)backend::Error::kSuccess, {});
+		case DaemonOp::kList: {
+			if (payload.size() < 16)
+				break;
+			backend::TaskQuery query{uint32_from_str(payload), uint32_from_str(payload.substr(4)),
+			                         uint32_from_str(payload.substr(8)), uint32_from_str(payload.substr(12))};
+			return make_frame((uint8_t)backend::Error::kSuccess,
+			                  backend::Schedule::StrFromTasks(schedule.QueryTasks(query)));
+		}
+		case DaemonOp::kArchivedList: {
+			// Same as kList
+			if (payload.size() < 16)
+				break;
+			backend::TaskQuery query{uint32_from_str(payload), uint32_from_str(payload.substr(4)),
+			                         uint32_from_str(payload.substr(8)), uint32_from_str(payload.substr(12))};
+			auto [tasks, error] = schedule.QueryArchivedTasks(query);
+			return make_frame((uint8_t)error, backend::Schedule::StrFromTasks(tasks));
+		}
+		case DaemonOp::kArchivedSearch: {
+			// Same as kSearch
+			if (payload.size() < 4)
+				break;
+			auto [tasks, error] = schedule.SearchArchivedTasks(payload.substr(4), uint32_from_str(payload));
+			return make_frame((uint8_t)error, backend::Schedule::StrFromTasks(tasks));
+		}
+		case DaemonOp::kArchive: {
+			// [u32 before], responds [u32 count]
+			if (payload.size() < 4)
+				break;
+			auto [count, error] = schedule.ArchiveTasks(uint32_from_str(payload));
+			std::string response;
+			str_append_uint32(&response, count);
+			return make_frame((uint8_t)error, response);
+		}
+		case DaemonOp::kSearch: {
+			// [u32 limit][query]
+			if (payload.size() < 4)
+				break;
+			return make_frame((uint8_t)backend::Error::kSuccess,
+			                  backend::Schedule::StrFromTasks(
+			                      schedule.SearchTasks(payload.substr(4), uint32_from_str(payload))));
+		}
+		case DaemonOp::kOccurrences: {
+			// [u32 since][u32 until]
+			if (payload.size() < 8)
+				break;
+			auto occurrences =
+			    schedule.GetTaskOccurrences(uint32_from_str(payload), uint32_from_str(payload.substr(4)));
+			return make_frame((uint8_t)backend::Error::kSuccess, backend::Schedule::StrFromTasks(*occurrences));
+		}
+		case DaemonOp::kConflicts: {
+			// [Task], the ID of the Task being edited
+			auto [task, len] = backend::TaskFromStr(payload);
+			if (!len)
+				break;
+			return make_frame((uint8_t)backend::Error::kSuccess,
+			                  backend::Schedule::StrFromTasks(schedule.GetTaskConflicts(task.property, task.id)));
+		}
+		case DaemonOp::kFreeSlot: {
+			// [u32 after][u32 duration][u32 until], responds [u32 begin time] if found
+			if (payload.size() < 12)
+				break;
+			auto [begin_time, found] = schedule.FindFreeSlot(
+			    uint32_from_str(payload), uint32_from_str(payload.substr(4)), uint32_from_str(payload.substr(8)));
+			std::string response;
+			if (found)
+				str_append_uint32(&response, begin_time);
+			return make_frame((uint8_t)backend::Error::kSuccess, response);
+		}
+		case DaemonOp::kOverlaps: {
+			// [u32 begin][u32 end]
+			if (payload.size() < 8)
+				break;
+			return make_frame((uint8_t)backend::Error::kSuccess,
+			                  backend::Schedule::StrFromTasks(schedule.GetOverlappingTasks(
+			                      uint32_from_str(payload), uint32_from_str(payload.substr(4)))));
+		}
+		case DaemonOp::kDependencies: {
+			// [u8 critical path]
+			if (payload.empty())
+				break;
+			return make_frame((uint8_t)backend::Error::kSuccess,
+			                  str_from_dependency_infos(payload[0] ? schedule.GetCriticalPath()
+			                                                       : schedule.GetBlockedTasks()));
+		}
+		case DaemonOp::kDayCounts: {
+			// [u32 first day][u32 last day][u8 range], responds [counts] of the range or [u32 day][counts] of each day
+			if (payload.size() < 9)
+				break;
+			int64_t first_day = uint32_from_str(payload), last_day = uint32_from_str(payload.substr(4));
+			std::string response;
+			if (payload[8])
+				str_append_counts(&response, schedule.GetRangeCounts(first_day, last_day));
+			else
+				for (const auto &day_counts : schedule.GetDayCounts(first_day, last_day)) {
+					str_append_uint32(&response, (uint32_t)day_counts.day);
+					str_append_counts(&response, day_counts.counts);
+				}
+			return make_frame((uint8_t)backend::Error::kSuccess, response);
+		}
+		case DaemonOp::kReport: {
+			// [u32 since][u32 until], responds [report]
+			if (payload.size() < 8)
+				break;
+			backend::TimeInt since = uint32_from_str(payload), until = uint32_from_str(payload.substr(4));
+			std::string response;
+			str_append_report(&response, schedule.GetTaskReport(since, until));
+			return make_frame((uint8_t)backend::Error::kSuccess, response);
+		}
+		case DaemonOp::kInsert: {
+			auto [task, len] = backend::TaskFromStr(payload);
+			if (!len)
+				break;
+			auto [id, error] = schedule.TaskInsert(task.property);
+			std::string response;
+			str_append_uint32(&response, id);
+			return make_frame((uint8_t)error, response);
+		}
+		case DaemonOp::kEdit: {
+			if (payload.size() < 4)
+				break;
+			auto mask = (backend::TaskPropertyMask)uint32_from_str(payload);
+			auto [task, len] = backend::TaskFromStr(payload.substr(4));
+			if (!len)
+				break;
+			return make_frame((uint8_t)schedule.TaskEdit(task.id, task.property, mask), {});
+		}
+		case DaemonOp::kErase:
+			if (payload.size() < 4)
+				break;
+			return make_frame((uint8_t)schedule.TaskErase(uint32_from_str(payload)), {});
+		case DaemonOp::kDone:
+			if (payload.size() < 4)
+				break;
+			return make_frame((uint8_t)schedule.TaskToggleDone(uint32_from_str(payload)), {});
+		case DaemonOp::kBatch: {
+			// [u8 type][u32 edit mask][Task] for each TaskOp
+			std::vector<backend::TaskOp> ops;
+			while (payload.size() > 5) {
+				auto [task, len] = backend::TaskFromStr(payload.substr(5));
+				if (!len)
+					break;
+				ops.push_back({(backend::TaskOpType)payload[0], task.id, std::move(task.property),
+				               (backend::TaskPropertyMask)uint32_from_str(payload.substr(1))});
+				payload = payload.substr(5 + len);
+			}
+			if (!payload.empty())
+				break;
+			auto [results, error] = schedule.TaskBatch(ops);
+			// [u32 id][u8 Error] for each TaskOpResult
+			std::string response;
+			response.reserve(results.size() * 5);
+			for (const auto &result : results) {
+				str_append_uint32(&response, result.id);
+				response += char(result.error);
+			}
+			return make_frame((uint8_t)error, response);
+		}
+		case DaemonOp::kImport: {
+			// [Task] for each TaskProperty
+			std::vector<backend::TaskProperty> properties;
+			while (!payload.empty()) {
+				auto [task, len] = backend::TaskFromStr(payload);
+				if (!len)
+					break;
+				properties.push_back(std::move(task.property));
+				payload = payload.substr(len);
+			}
+			if (!payload.empty())
+				break;
+			auto [inserted, error] = schedule.TaskImport(std::move(properties));
+			std::string response;
+			str_append_uint32(&response, inserted);
+			return make_frame((uint8_t)error, response);
+		}
+		default:
+			break;
+		}
+		return {};
+	}
+
+	/**
+	 * End the sessions idle for longer than kSessionIdleTimeout.
+	 */
+	void ExpireSessions() {
+		auto now = std::chrono::steady_clock::now();
+		auto expired = std::remove_if(m_sessions.begin(), m_sessions.end(), [now](const DaemonSession &session) {
+			return now - session.last_used > kSessionIdleTimeout;
+		});
+		if (expired == m_sessions.end())
+			return;
+		m_sessions.erase(expired, m_sessions.end());
+		release_schedules();
+	}
+
+private:
+	struct DaemonSession {
+		std::string token;
+		std::shared_ptr<backend::Schedule> schedule;
+		std::chrono::steady_clock::time_point last_used;
+	};
+
+	std::shared_ptr<backend::Instance> m_instance_ptr;
+	// Schedules are kept alive by username while they have sessions, so that their SHM and local Task caches stay warm
+	std::unordered_map<std::string, std::shared_ptr<backend::Schedule>> m_schedules;
+	std::vector<DaemonSession> m_sessions;
+
+	// Every session is compared, so that the lookup time does not depend on the token
+	std::vector<DaemonSession>::iterator find_session(std::string_view token) {
+		auto found = m_sessions.end();
+		for (auto it = m_sessions.begin(); it != m_sessions.end(); ++it)
+			if (token_equal(it->token, token))
+				found = it;
+		return found;
+	}
+	void release_schedules() {
+		for (auto it = m_schedules.begin(); it != m_schedules.end();) {
+			if (it->second.use_count() == 1)
+				it = m_schedules.erase(it);
+			else
+				++it;
+		}
+	}
+	static bool make_token(std::string *p_token) {
+		static constexpr const char *kHex = "0123456789abcdef";
+		char bytes[kTokenLength / 2];
+		if (!read_random(bytes, sizeof(bytes)))
+			return false;
+		p_token->clear();
+		for (char byte : bytes) {
+			*p_token += kHex[(unsigned char)byte >> 4u];
+			*p_token += kHex[(unsigned char)byte & 0xfu];
+		}
+		return true;
+	}
+
+	std::string handle_login(std::string_view payload) {
+		auto sep = payload.find('\0');
+		if (sep == std::string_view::npos)
+			return {};
+		std::string_view username = payload.substr(0, sep), password = payload.substr(sep + 1);
+
+		auto [user, error] = backend::User::Login(m_instance_ptr, username, password);
+		if (!user)
+			return make_frame((uint8_t)error, {});
+
+		std::string token;
+		if (!make_token(&token))
+			return make_frame((uint8_t)backend::Error::kFileIOError, {});
+		ExpireSessions();
+		if (m_sessions.size() >= kMaxSessions) {
+			m_sessions.erase(std::min_element(
+			    m_sessions.begin(), m_sessions.end(),
+			    [](const DaemonSession &l, const DaemonSession &r) { return l.last_used < r.last_used; }));
+			release_schedules();
+		}
+
+		auto &schedule = m_schedules[user->GetName()];
+		if (!schedule) {
+			std::tie(schedule, error) = backend::Schedule::Acquire(user);
+			if (!schedule) {
+				m_schedules.erase(user->GetName());
+				return make_frame((uint8_t)error, {});
+			}
+		}
+		m_sessions.push_back({token, schedule, std::chrono::steady_clock::now()});
+		return make_frame((uint8_t)backend::Error::kSuccess, token);
+	}
+};
+
+// Requests are read and responses written without blocking, pending responses are buffered per client
+struct DaemonClientConnection {
+	int fd;
+	std::string input, output;
+};
+
+// Write as much of the pending output as the socket takes
+bool flush_output(DaemonClientConnection *client) {
+	std::size_t offset = 0;
+	while (offset < client->output.size()) {
+		ssize_t n = write(client->fd, client->output.data() + offset, client->output.size() - offset);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			break;
+		if (n <= 0)
+			return false;
+		offset += n;
+	}
+	client->output.erase(0, offset);
+	return true;
+}
+} // namespace
+
+int RunDaemon(const std::shared_ptr<backend::Instance> &instance_ptr) {
+	if (!instance_ptr->MaintainDirs()) {
+		printf("ERROR: %s\n", backend::GetErrorMessage(backend::Error::kFileIOError));
+		return EXIT_FAILURE;
+	}
+	std::string path = GetDaemonSocketPath(*instance_ptr);
+	sockaddr_un addr;
+	if (!make_socket_address(path, &addr)) {
+		printf("ERROR: Socket path \"%s\" too long\n", path.c_str());
+		return EXIT_FAILURE;
+	}
+	{
+		int fd = connect_socket(path);
+		if (fd >= 0) {
+			close(fd);
+			printf("ERROR: Daemon already running on \"%s\"\n", path.c_str());
+			return EXIT_FAILURE;
+		}
+		// Remove the stale socket left by a killed daemon
+		unlink(path.c_str());
+	}
+
+	int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	bool bound = false;
+	if (listen_fd >= 0) {
+		// Created owner-only by bind() itself, so that other users can never connect
+		mode_t old_mask = umask(S_IRWXG | S_IRWXO);
+		bound = bind(listen_fd, (const sockaddr *)&addr, sizeof(addr)) == 0;
+		umask(old_mask);
+	}
+	if (!bound || !set_non_blocking(listen_fd) || listen(listen_fd, SOMAXCONN) < 0) {
+		printf("ERROR: Failed to listen on \"%s\"\n", path.c_str());
+		if (listen_fd >= 0)
+			close(listen_fd);
+		return EXIT_FAILURE;
+	}
+
+	std::signal(SIGPIPE, SIG_IGN);
+	std::signal(SIGINT, [](int) { g_daemon_stop = 1; });
+	std::signal(SIGTERM, [](int) { g_daemon_stop = 1; });
+	printf("Daemon listening on \"%s\"\n", path.c_str());
+	fflush(stdout);
+
+	DaemonServer server{instance_ptr};
+	std::vector<DaemonClientConnection> clients;
+	std::vector<pollfd> poll_fds;
+	char read_buffer[65536];
+
+	while (!g_daemon_stop) {
+		server.ExpireSessions();
+		poll_fds.clear();
+		poll_fds.push_back({listen_fd, POLLIN, 0});
+		// A client is not read until it has taken its pending responses
+		for (const auto &client : clients)
+			poll_fds.push_back({client.fd, short(client.output.empty() ? POLLIN : POLLOUT), 0});
+		if (poll(poll_fds.data(), poll_fds.size(), 500) <= 0)
+			continue;
+
+		for (std::size_t i = clients.size(); i-- > 0;) {
+			short revents = poll_fds[i + 1].revents;
+			if (!revents)
+				continue;
+			auto &client = clients[i];
+			bool alive = true;
+			if (revents & POLLOUT)
+				alive = flush_output(&client);
+			else if (revents & (POLLIN | POLLHUP | POLLERR)) {
+				ssize_t n = read(client.fd, read_buffer, sizeof(read_buffer));
+				if (n > 0) {
+					client.input.append(read_buffer, n);
+					// Handle every complete frame
+					std::size_t offset = 0;
+					while (alive && client.input.size() - offset >= 5) {
+						uint32_t size = uint32_from_str(std::string_view{client.input}.substr(offset));
+						if (size > kMaxFrameSize) {
+							alive = false;
+							break;
+						}
+						if (client.input.size() - offset < 5 + size)
+							break;
+						std::string response = server.Handle((DaemonOp)client.input[offset + 4],
+						                                     std::string_view{client.input}.substr(offset + 5, size));
+						alive = !response.empty();
+						client.output += response;
+						offset += 5 + size;
+					}
+					client.input.erase(0, offset);
+					alive = alive && flush_output(&client);
+				} else
+					alive = n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK);
+			}
+			if (!alive) {
+				close(client.fd);
+				clients.erase(clients.begin() + (std::ptrdiff_t)i);
+			}
+		}
+		if (poll_fds[0].revents & POLLIN) {
+			int fd = accept(listen_fd, nullptr, nullptr);
+			if (fd >= 0 && set_non_blocking(fd))
+				clients.push_back({fd, {}, {}});
+			else if (fd >= 0)
+				close(fd);
+		}
+	}
+
+	for (const auto &client : clients)
+		close(client.fd);
+	close(listen_fd);
+	unlink(path.c_str());
+	return EXIT_SUCCESS;
+}
+
+DaemonSchedule::~DaemonSchedule() { close(m_fd); }
+
+std::unique_ptr<DaemonSchedule> DaemonSchedule::Connect(const backend::Instance &instance) {
+	int fd = connect_socket(GetDaemonSocketPath(instance));
+	if (fd < 0)
+		return nullptr;
+	std::signal(SIGPIPE, SIG_IGN);
+	return std::make_unique<DaemonSchedule>(fd);
+}
+
+std::tuple<std::string, backend::Error> DaemonSchedule::request(DaemonOp op, std::string_view payload) {
+	// Every request but login is prefixed with the session token
+	std::string frame = op == DaemonOp::kLogin ? make_frame((uint8_t)op, payload)
+	                                           : make_frame((uint8_t)op, m_token + std::string{payload});
+	// The daemon would drop the connection on an oversized frame
+	if (frame.size() - 5 > kMaxFrameSize)
+		return {"", backend::Error::kSHMSizeExceed};
+	char head[5];
+	if (!write_all(m_fd, frame) || !read_all(m_fd, head, 5))
+		return {"", backend::Error::kFileIOError};
+	uint32_t size = uint32_from_str({head, 4});
+	if (size > kMaxFrameSize)
+		return {"", backend::Error::kFileIOError};
+	std::string response(size, '\0');
+	if (!read_all(m_fd, response.data(), size))
+		return {"", backend::Error::kFileIOError};
+	return {std::move(response), (backend::Error)head[4]};
+}
+
+#endif
+
+backend::Error DaemonSchedule::Login(std::string_view username, std::string_view password) {
+	std::string payload{username};
+	payload += '\0';
+	payload += password;
+	auto [token, error] = request(DaemonOp::kLogin, payload);
+	if (error == backend::Error::kSuccess)
+		m_token = std::move(token);
+	return error;
+}
+
+backend::Error DaemonSchedule::Logout() {
+	auto error = std::get<backend::Error>(request(DaemonOp::kLogout, {}));
+	if (error == backend::Error::kSuccess)
+		m_token.clear();
+	return error;
+}
+
+std::tuple<std::vector<backend::Task>, backend::Error> DaemonSchedule::QueryTasks(const backend::TaskQuery &query) {
+	std::string payload;
+	str_append_uint32(&payload, query.since);
+	str_append_uint32(&payload, query.until);
+	str_append_uint32(&payload, query.offset);
+	str_append_uint32(&payload, query.limit);
+	auto [str, error] = request(DaemonOp::kList, payload);
+	if (error != backend::Error::kSuccess)
+		return {std::vector<backend::Task>{}, error};
+	return {backend::Schedule::TasksFromStr(str), error};
+}
+
+std::tuple<std::vector<backend::Task>, backend::Error> DaemonSchedule::SearchTasks(std::string_view query,
+                                                                                   uint32_t limit) {
+	std::string payload;
+	str_append_uint32(&payload, limit);
+	payload += query;
+	auto [str, error] = request(DaemonOp::kSearch, payload);
+	if (error != backend::Error::kSuccess)
+		return {std::vector<backend::Task>{}, error};
+	return {backend::Schedule::TasksFromStr(str), error};
+}
+
+std::tuple<std::vector<backend::Task>, backend::Error>
+DaemonSchedule::QueryArchivedTasks(const backend::TaskQuery &query) {
+	std::string payload;
+	str_append_uint32(&payload, query.since);
+	str_append_uint32(&payload, query.until);
+	str_append_uint32(&payload, query.offset);
+	str_append_uint32(&payload, query.limit);
+	auto [str, error] = request(DaemonOp::kArchivedList, payload);
+	if (error != backend::Error::kSuccess)
+		return {std::vector<backend::Task>{}, error};
+	return {backend::Schedule::TasksFromStr(str), error};
+}
+
+std::tuple<std::vector<backend::Task>, backend::Error> DaemonSchedule::SearchArchivedTasks(std::string_view query,
+                                                                                           uint32_t limit) {
+	std::string payload;
+	str_append_uint32(&payload, limit);
+	payload += query;
+	auto [str, error] = request(DaemonOp::kArchivedSearch, payload);
+	if (error != backend::Error::kSuccess)
+		return {std::vector<backend::Task>{}, error};
+	return {backend::Schedule::TasksFromStr(str), error};
+}
+
+std::tuple<uint32_t, backend::Error> DaemonSchedule::ArchiveTasks(backend::TimeInt before) {
+	std::string payload;
+	str_append_uint32(&payload, before);
+	auto [str, error] = request(DaemonOp::kArchive, payload);
+	return {str.size() >= 4 ? uint32_from_str(str) : 0, error};
+}
+
+std::tuple<std::vector<backend::Task>, backend::Error> DaemonSchedule::GetTaskOccurrences(backend::TimeInt since,
+                                                                                          backend::TimeInt until) {
+	std::string payload;
+	str_append_uint32(&payload, since);
+	str_append_uint32(&payload, until);
+	auto [str, error] = request(DaemonOp::kOccurrences, payload);
+	if (error != backend::Error::kSuccess)
+		return {std::vector<backend::Task>{}, error};
+	return {backend::Schedule::TasksFromStr(str), error};
+}
+
+std::tuple<std::vector<backend::Task>, backend::Error>
+DaemonSchedule::GetTaskConflicts(const backend::TaskProperty &property, uint32_t id) {
+	auto [str, error] = request(DaemonOp::kConflicts, backend::StrFromTask({id, property}));
+	if (error != backend::Error::kSuccess)
+		return {std::vector<backend::Task>{}, error};
+	return {backend::Schedule::TasksFromStr(str), error};
+}
+
+std::tuple<backend::TimeInt, bool, backend::Error>
+DaemonSchedule::FindFreeSlot(backend::TimeInt after, uint32_t duration, backend::TimeInt until) {
+	std::string payload;
+	str_append_uint32(&payload, after);
+	str_append_uint32(&payload, duration);
+	str_append_uint32(&payload, until);
+	auto [str, error] = request(DaemonOp::kFreeSlot, payload);
+	bool found = error == backend::Error::kSuccess && str.size() >= 4;
+	return {found ? uint32_from_str(str) : 0, found, error};
+}
+
+std::tuple<std::vector<backend::Task>, backend::Error> DaemonSchedule::GetOverlappingTasks(backend::TimeInt begin,
+                                                                                           backend::TimeInt end) {
+	std::string payload;
+	str_append_uint32(&payload, begin);
+	str_append_uint32(&payload, end);
+	auto [str, error] = request(DaemonOp::kOverlaps, payload);
+	if (error != backend::Error::kSuccess)
+		return {std::vector<backend::Task>{}, error};
+	return {backend::Schedule::TasksFromStr(str), error};
+}
+
+std::tuple<std::vector<backend::TaskDependencyInfo>, backend::Error>
+DaemonSchedule::request_dependencies(bool critical_path) {
+	auto [str, error] = request(DaemonOp::kDependencies, std::string(1, char(critical_path)));
+	if (error != backend::Error::kSuccess)
+		return {std::vector<backend::TaskDependencyInfo>{}, error};
+	return {dependency_infos_from_str(str), error};
+}
+
+std::tuple<std::vector<backend::TaskDependencyInfo>, backend::Error> DaemonSchedule::GetBlockedTasks() {
+	return request_dependencies(false);
+}
+
+std::tuple<std::vector<backend::TaskDependencyInfo>, backend::Error> DaemonSchedule::GetCriticalPath() {
+	return request_dependencies(true);
+}
+
+std::tuple<std::vector<backend::DayTaskCounts>, backend::Error> DaemonSchedule::GetDayCounts(int64_t first_day,
+                                                                                           int64_t last_day) {
+	std::string payload;
+	str_append_uint32(&payload, (uint32_t)first_day);
+	str_append_uint32(&payload, (uint32_t)last_day);
+	payload += '\0';
+	auto [str, error] = request(DaemonOp::kDayCounts, payload);
+	std::vector<backend::DayTaskCounts> day_counts;
+	if (error != backend::Error::kSuccess)
+		return {day_counts, error};
+	for (std::string_view view = str; view.size() >= 4 + kCountsSize; view = view.substr(4 + kCountsSize))
+		day_counts.push_back({uint32_from_str(view), counts_from_str(view.substr(4))});
+	return {std::move(day_counts), error};
+}
+
+std::tuple<backend::TaskCounts, backend::Error> DaemonSchedule::GetRangeCounts(int64_t first_day, int64_t last_day) {
+	std::string payload;
+	str_append_uint32(&payload, (uint32_t)first_day);
+	str_append_uint32(&payload, (uint32_t)last_day);
+	payload += '\1';
+	auto [str, error] = request(DaemonOp::kDayCounts, payload);
+	if (error != backend::Error::kSuccess || str.size() < kCountsSize)
+		return {backend::TaskCounts{}, error};
+	return {counts_from_str(str), error};
+}
+
+std::tuple<backend::TaskReport, backend::Error> DaemonSchedule::GetTaskReport(backend::TimeInt since,
+                                                                            backend::TimeInt until) {
+	std::string payload;
+	str_append_uint32(&payload, since);
+	str_append_uint32(&payload, until);
+	auto [str, error] = request(DaemonOp::kReport, payload);
+	if (error != backend::Error::kSuccess || str.size() < kReportSize)
+		return {backend::TaskReport{}, error};
+	return {report_from_str(str), error};
+}
+
+std::tuple<uint32_t, backend::Error> DaemonSchedule::TaskInsert(const backend::TaskProperty &task_property) {
+	auto [str, error] = request(DaemonOp::kInsert, backend::StrFromTask({0, task_property}));
+	return {str.size() >= 4 ? uint32_from_str(str) : 0, error};
+}
+
+backend::Error DaemonSchedule::TaskErase(uint32_t id) {
+	std::string payload;
+	str_append_uint32(&payload, id);
+	return std::get<backend::Error>(request(DaemonOp::kErase, payload));
+}
+
+backend::Error DaemonSchedule::TaskEdit(uint32_t id, const backend::TaskProperty &property,
+                                        backend::TaskPropertyMask property_edit_mask) {
+	std::string payload;
+	str_append_uint32(&payload, (uint32_t)property_edit_mask);
+	payload += backend::StrFromTask({id, property});
+	return std::get<backend::Error>(request(DaemonOp::kEdit, payload));
+}
+
+backend::Error DaemonSchedule::TaskToggleDone(uint32_t id) {
+	std::string payload;
+	str_append_uint32(&payload, id);
+	return std::get<backend::Error>(request(DaemonOp::kDone, payload));
+}
+
+std::tuple<std::vector<backend::TaskOpResult>, backend::Error>
+DaemonSchedule::TaskBatch(const std::vector<backend::TaskOp> &ops) {
+	std::string payload;
+	for (const auto &op : ops) {
+		payload += char(op.type);
+		str_append_uint32(&payload, (uint32_t)op.property_edit_mask);
+		payload += backend::StrFromTask({op.id, op.property});
+	}
+	auto [str, error] = request(DaemonOp::kBatch, payload);
+	std::vector<backend::TaskOpResult> results;
+	results.reserve(str.size() / 5);
+	for (std::string_view view = str; view.size() >= 5; view = view.substr(5))
+		results.push_back({uint32_from_str(view), (backend::Error)view[4]});
+	return {std::move(results), error};
+}
+
+std::tuple<uint32_t, backend::Error> DaemonSchedule::TaskImport(std::vector<backend::TaskProperty> properties) {
+	std::string payload;
+	for (const auto &property : properties)
+		payload += backend::StrFromTask({0, property});
+	// Would never fit in the Schedule, and the daemon drops oversized frames
+	if (payload.size() > backend::kMaxSharedScheduleMemory)
+		return {0, backend::Error::kSHMSizeExceed};
+	auto [str, error] = request(DaemonOp::kImport, payload);
+	return {str.size() >= 4 ? uint32_from_str(str) : 0, error};
+}
+
+} // namespace cli
@@ -1,22 +1,79 @@
 #include <cli/Format.hpp>
 
+#include <backend/Trace.hpp>
+#include <backend/Writer.hpp>
+
+#include <algorithm>
 #include <iostream>
+#include <numeric>
+#include <variant>
 #include <nowide/convert.hpp>
 #include <nowide/iostream.hpp>
 #include <tabulate/table.hpp>
 
 namespace cli {
+namespace {
+constexpr std::size_t kMaxPrintedImportErrors = 20;
+} // namespace
+
+void PrintTasks(const std::vector<backend::Task> &tasks, const std::optional<backend::ExchangeFormat> &format) {
+	if (!format) {
+		PrintTasks(tasks);
+		return;
+	}
+	backend::Writer writer{stdout};
+	backend::ExportTasks(&writer, tasks, *format);
+}
+
+void PrintImportErrors(const std::vector<backend::ImportError> &errors) {
+	for (std::size_t i = 0; i < errors.size() && i < kMaxPrintedImportErrors; ++i)
+		printf("Line %u: ERROR: %s\n", errors[i].line, errors[i].message.c_str());
+	if (errors.size() > kMaxPrintedImportErrors)
+		printf("... and %zu more errors\n", errors.size() - kMaxPrintedImportErrors);
+}
+
 void PrintTasks(const std::vector<backend::Task> &tasks) {
+	SCHEDULITE_TRACE_SCOPE("PrintTasks");
 	tabulate::Table table;
-	table.add_row({"ID", "Name", "Begin time", "Remind time", "Priority", "Type", "Status"});
+	// The repeat rules, end times and dependencies are only shown if any Task has them
+	bool show_repeat = std::any_of(tasks.begin(), tasks.end(),
+	                               [](const backend::Task &task) { return task.property.recurrence.IsRecurring(); });
+	bool show_end = std::any_of(tasks.begin(), tasks.end(),
+	                            [](const backend::Task &task) { return task.property.duration != 0; });
+	bool show_after = std::any_of(tasks.begin(), tasks.end(),
+	                              [](const backend::Task &task) { return !task.property.dependencies.empty(); });
+	const auto ids_str = [](const std::vector<uint32_t> &ids) {
+		std::string str;
+		for (uint32_t id : ids)
+			str += (str.empty() ? "" : ",") + std::to_string(id);
+		return str;
+	};
+	using Cells = std::vector<std::variant<std::string, const char *, tabulate::Table>>;
+	Cells header = {"ID", "Name", "Begin time", "Remind time", "Priority", "Type", "Status"};
+	if (show_end)
+		header.insert(header.begin() + 3, "End time");
+	if (show_after)
+		header.emplace_back("After");
+	if (show_repeat)
+		header.emplace_back("Repeat");
+	table.add_row(header);
 	uint32_t row = 1;
 	backend::TimeInt time_int_now = backend::GetTimeIntNow();
 	for (const auto &task : tasks) {
 		auto status = backend::TaskStatusFromTask(task, time_int_now);
-		table.add_row({std::to_string(task.id), task.property.name, backend::ToTimeStr(task.property.begin_time),
+		Cells cells = {std::to_string(task.id), task.property.name, backend::ToTimeStr(task.property.begin_time),
 		               backend::ToTimeStr(task.property.remind_time),
 		               backend::StrFromTaskPriority(task.property.priority),
-		               backend::StrFromTaskType(task.property.type), backend::StrFromTaskStatus(status)});
+		               backend::StrFromTaskType(task.property.type), backend::StrFromTaskStatus(status)};
+		if (show_end)
+			cells.insert(cells.begin() + 3, task.property.duration
+			                                    ? backend::ToTimeStr(backend::TaskEndTime(task.property))
+			                                    : std::string{});
+		if (show_after)
+			cells.emplace_back(ids_str(task.property.dependencies));
+		if (show_repeat)
+			cells.emplace_back(backend::StrFromTaskRecurrence(task.property.recurrence));
+		table.add_row(cells);
 		if (status == backend::TaskStatus::kOngoing) {
 			table.row(row).format().font_style({tabulate::FontStyle::bold});
 		} else if (status == backend::TaskStatus::kDone)
@@ -37,12 +94,131 @@ void PrintTasks(const std::vector<backend::Task> &tasks) {
 		table.row(1).format().border_top("-").border_bottom("-").border_left("").border_right("").corner("");
 	else if (row > 2) {
 		table.row(1).format().border_top("-").border_bottom(" ").border_left("").border_right("").corner("");
-		for (int i = 2; i < row - 1; ++i)
+		for (uint32_t i = 2; i < row - 1; ++i)
 			table.row(i).format().border_top(" ").border_bottom(" ").border_left("").border_right("").corner("");
 		table.row(row - 1).format().border_top(" ").border_bottom("-").border_left("").border_right("").corner("");
 	}
 	nowide::cout << table << std::endl;
 }
+void PrintConflicts(const std::vector<backend::Task> &conflicts) {
+	for (const auto &task : conflicts)
+		nowide::cout << "WARNING: Overlaps with task " << task.id << " \"" << task.property.name << "\" ("
+		             << backend::ToTimeStr(task.property.begin_time) << " - "
+		             << backend::ToTimeStr(backend::TaskEndTime(task.property)) << ")" << std::endl;
+}
+void PrintDependencyInfos(const std::vector<backend::TaskDependencyInfo> &infos) {
+	for (const auto &info : infos)
+		nowide::cout << "Task " << info.task.id << " \"" << info.task.property.name << "\": earliest begin "
+		             << backend::ToTimeStr(info.earliest_begin) << ", slack " << info.latest_begin - info.earliest_begin
+		             << " minutes" << std::endl;
+}
+MonthDays GetMonthDays(int year, unsigned month) {
+	MonthDays days{};
+	days.year = year;
+	days.month = month;
+	days.first = backend::DaysFromCivil(year, month, 1);
+	days.last = month == 12 ? backend::DaysFromCivil(year + 1, 1, 1) : backend::DaysFromCivil(year, month + 1, 1);
+	for (int64_t first = days.first; first < days.last;) {
+		// Weeks end before Mondays
+		int64_t last = std::min<int64_t>(first + 7 - (backend::WeekdayFromDays(first) + 6) % 7, days.last);
+		days.weeks.emplace_back(first, last);
+		first = last;
+	}
+	return days;
+}
+void PrintMonthCounts(const MonthDays &days, const std::vector<backend::DayTaskCounts> &day_counts,
+                      const std::vector<backend::TaskCounts> &week_counts, const backend::TaskCounts &month_counts) {
+	const auto status_count = [](const backend::TaskCounts &counts, backend::TaskStatus status) {
+		const auto &type_counts = counts[(uint32_t)status];
+		return std::accumulate(type_counts.begin(), type_counts.end(), 0u);
+	};
+	// Pending/ongoing/done counts under a title, if any
+	const auto cell_str = [&status_count](std::string title, const backend::TaskCounts &counts) {
+		uint32_t pending = status_count(counts, backend::TaskStatus::kPending),
+		         ongoing = status_count(counts, backend::TaskStatus::kOngoing),
+		         done = status_count(counts, backend::TaskStatus::kDone);
+		if (pending || ongoing || done)
+			title += "\n" + std::to_string(pending) + "/" + std::to_string(ongoing) + "/" + std::to_string(done);
+		return title;
+	};
+
+	tabulate::Table table;
+	table.add_row({"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun", "Week"});
+	for (std::size_t week = 0; week < days.weeks.size(); ++week) {
+		std::vector<std::variant<std::string, const char *, tabulate::Table>> cells(8, std::string{});
+		for (int64_t day = days.weeks[week].first; day < days.weeks[week].second; ++day) {
+			const auto &counts = day_counts[day - days.first].counts;
+			cells[(backend::WeekdayFromDays(day) + 6) % 7] = cell_str(std::to_string(day - days.first + 1), counts);
+		}
+		cells[7] = cell_str("", week_counts[week]);
+		table.add_row(cells);
+	}
+	for (auto &row : table)
+		row.format().border_top("").border_bottom("").border_left("").border_right("").corner("");
+	table.row(0).format().border_bottom("-");
+	printf("%04d/%02u (pending/ongoing/done)\n", days.year, days.month);
+	nowide::cout << table << std::endl;
+
+	printf("Total: %u pending, %u ongoing, %u done\n", status_count(month_counts, backend::TaskStatus::kPending),
+	       status_count(month_counts, backend::TaskStatus::kOngoing),
+	       status_count(month_counts, backend::TaskStatus::kDone));
+	constexpr auto kTypeStrings = backend::GetTaskTypeStrings();
+	for (uint32_t type = 0; type < kTypeStrings.size(); ++type) {
+		uint32_t pending = month_counts[(uint32_t)backend::TaskStatus::kPending][type],
+		         ongoing = month_counts[(uint32_t)backend::TaskStatus::kOngoing][type],
+		         done = month_counts[(uint32_t)backend::TaskStatus::kDone][type];
+		if (pending || ongoing || done)
+			printf("  %s: %u/%u/%u\n", kTypeStrings[type], pending, ongoing, done);
+	}
+}
+void PrintTaskReport(backend::TimeInt since, backend::TimeInt until, const backend::TaskReport &report) {
+	constexpr auto kTypeStrings = backend::GetTaskTypeStrings();
+	const auto ratio = [](uint64_t part, uint64_t whole) { return whole ? double(part) / double(whole) : 0.0; };
+	printf("{\n  \"since\": \"%s\",\n  \"until\": \"%s\",\n  \"types\": {\n", backend::ToTimeStr(since).c_str(),
+	       backend::ToTimeStr(until).c_str());
+	for (uint32_t type = 0; type < kTypeStrings.size(); ++type)
+		printf("    \"%s\": {\"count\": %u, \"done\": %u, \"done_ratio\": %.3f}%s\n", kTypeStrings[type],
+		       report.type_counts[type], report.type_done_counts[type],
+		       ratio(report.type_done_counts[type], report.type_counts[type]),
+		       type + 1 < kTypeStrings.size() ? "," : "");
+	printf("  },\n  \"completion\": {\"on_time\": %u, \"late\": %u, \"unknown\": %u, \"on_time_ratio\": %.3f},\n",
+	       report.on_time, report.late, report.done_time_unknown, ratio(report.on_time, report.on_time + report.late));
+	printf("  \"high_priority_backlog\": {\"count\": %u, \"mean_age_minutes\": %.1f, \"max_age_minutes\": %u}\n"
+	       "}\n",
+	       report.backlog, ratio(report.backlog_age_sum, report.backlog), report.backlog_max_age);
+}
+void PrintMetrics(const backend::ScheduleMetrics &metrics) {
+	if (!metrics.enabled) {
+		PrintError("Metrics are not compiled in (SCHEDULITE_ENABLE_METRICS)");
+		return;
+	}
+	const auto us_str = [](double ns) {
+		char buf[32];
+		snprintf(buf, sizeof(buf), "%.1f", ns / 1000.0);
+		return std::string{buf};
+	};
+	tabulate::Table table;
+	table.add_row({"Metric", "Count", "Mean (us)", "P50 (us)", "P99 (us)", "Max (us)"});
+	const auto add_histogram = [&table, &us_str](const char *name, const backend::HistogramSnapshot &histogram) {
+		table.add_row({name, std::to_string(histogram.count), us_str(histogram.GetMean()),
+		               us_str((double)histogram.GetPercentile(0.5)), us_str((double)histogram.GetPercentile(0.99)),
+		               us_str((double)histogram.max)});
+	};
+	add_histogram("Lock wait", metrics.lock_wait);
+	add_histogram("Lock hold", metrics.lock_hold);
+	add_histogram("Parse", metrics.parse);
+	add_histogram("Serialize", metrics.serialize);
+	add_histogram("Encrypt", metrics.encrypt);
+	add_histogram("Decrypt", metrics.decrypt);
+	add_histogram("File write", metrics.file_write);
+	for (auto &row : table)
+		row.format().border_top("").border_bottom("").border_left("").border_right("").corner("");
+	table.row(0).format().border_bottom("-");
+	nowide::cout << table << std::endl;
+	printf("Bytes written: %llu\nSnapshot reloads: %llu\nSHM usage: %u / %u bytes\n",
+	       (unsigned long long)metrics.bytes_written, (unsigned long long)metrics.snapshot_reloads, metrics.shm_size,
+	       metrics.shm_capacity);
+}
 void PrintError(backend::Error error) {
 	if (error != backend::Error::kSuccess)
 		printf("ERROR: %s\n", backend::GetErrorMessage(error));
@@ -0,0 +1,95 @@
+#include <cli/ScheduleClient.hpp>
+
+namespace cli {
+
+std::tuple<std::vector<backend::Task>, backend::Error>
+LocalScheduleClient::QueryTasks(const backend::TaskQuery &query) {
+	return {m_schedule_ptr->QueryTasks(query), backend::Error::kSuccess};
+}
+
+std::tuple<std::vector<backend::Task>, backend::Error> LocalScheduleClient::SearchTasks(std::string_view query,
+                                                                                        uint32_t limit) {
+	return {m_schedule_ptr->SearchTasks(query, limit), backend::Error::kSuccess};
+}
+
+std::tuple<std::vector<backend::Task>, backend::Error>
+LocalScheduleClient::QueryArchivedTasks(const backend::TaskQuery &query) {
+	return m_schedule_ptr->QueryArchivedTasks(query);
+}
+
+std::tuple<std::vector<backend::Task>, backend::Error>
+LocalScheduleClient::SearchArchivedTasks(std::string_view query, uint32_t limit) {
+	return m_schedule_ptr->SearchArchivedTasks(query, limit);
+}
+
+std::tuple<uint32_t, backend::Error> LocalScheduleClient::ArchiveTasks(backend::TimeInt before) {
+	return m_schedule_ptr->ArchiveTasks(before);
+}
+
+std::tuple<std::vector<backend::Task>, backend::Error>
+LocalScheduleClient::GetTaskOccurrences(backend::TimeInt since, backend::TimeInt until) {
+	return {*m_schedule_ptr->GetTaskOccurrences(since, until), backend::Error::kSuccess};
+}
+
+std::tuple<std::vector<backend::Task>, backend::Error>
+LocalScheduleClient::GetTaskConflicts(const backend::TaskProperty &property, uint32_t id) {
+	return {m_schedule_ptr->GetTaskConflicts(property, id), backend::Error::kSuccess};
+}
+
+std::tuple<backend::TimeInt, bool, backend::Error>
+LocalScheduleClient::FindFreeSlot(backend::TimeInt after, uint32_t duration, backend::TimeInt until) {
+	auto [begin_time, found] = m_schedule_ptr->FindFreeSlot(after, duration, until);
+	return {begin_time, found, backend::Error::kSuccess};
+}
+
+std::tuple<std::vector<backend::Task>, backend::Error>
+LocalScheduleClient::GetOverlappingTasks(backend::TimeInt begin, backend::TimeInt end) {
+	return {m_schedule_ptr->GetOverlappingTasks(begin, end), backend::Error::kSuccess};
+}
+
+std::tuple<std::vector<backend::TaskDependencyInfo>, backend::Error> LocalScheduleClient::GetBlockedTasks() {
+	return {m_schedule_ptr->GetBlockedTasks(), backend::Error::kSuccess};
+}
+
+std::tuple<std::vector<backend::TaskDependencyInfo>, backend::Error> LocalScheduleClient::GetCriticalPath() {
+	return {m_schedule_ptr->GetCriticalPath(), backend::Error::kSuccess};
+}
+
+std::tuple<std::vector<backend::DayTaskCounts>, backend::Error> LocalScheduleClient::GetDayCounts(int64_t first_day,
+                                                                                                int64_t last_day) {
+	return {m_schedule_ptr->GetDayCounts(first_day, last_day), backend::Error::kSuccess};
+}
+
+std::tuple<backend::TaskCounts, backend::Error> LocalScheduleClient::GetRangeCounts(int64_t first_day,
+                                                                                  int64_t last_day) {
+	return {m_schedule_ptr->GetRangeCounts(first_day, last_day), backend::Error::kSuccess};
+}
+
+std::tuple<backend::TaskReport, backend::Error> LocalScheduleClient::GetTaskReport(backend::TimeInt since,
+                                                                                 backend::TimeInt until) {
+	return {m_schedule_ptr->GetTaskReport(since, until), backend::Error::kSuccess};
+}
+
+std::tuple<uint32_t, backend::Error> LocalScheduleClient::TaskInsert(const backend::TaskProperty &task_property) {
+	return m_schedule_ptr->TaskInsert(task_property);
+}
+
+backend::Error LocalScheduleClient::TaskErase(uint32_t id) { return m_schedule_ptr->TaskErase(id); }
+
+backend::Error LocalScheduleClient::TaskEdit(uint32_t id, const backend::TaskProperty &property,
+                                             backend::TaskPropertyMask property_edit_mask) {
+	return m_schedule_ptr->TaskEdit(id, property, property_edit_mask);
+}
+
+backend::Error LocalScheduleClient::TaskToggleDone(uint32_t id) { return m_schedule_ptr->TaskToggleDone(id); }
+
+std::tuple<std::vector<backend::TaskOpResult>, backend::Error>
+LocalScheduleClient::TaskBatch(const std::vector<backend::TaskOp> &ops) {
+	return m_schedule_ptr->TaskBatch(ops);
+}
+
+std::tuple<uint32_t, backend::Error> LocalScheduleClient::TaskImport(std::vector<backend::TaskProperty> properties) {
+	return m_schedule_ptr->TaskImport(std::move(properties));
+}
+
+} // namespace cli
@@ -4,9 +4,13 @@
 #include <cli/Util.hpp>
 
 #include <backend/Environment.hpp>
+#include <backend/Recurrence.hpp>
 #include <backend/Schedule.hpp>
 #include <backend/Task.hpp>
+#include <backend/TaskScan.hpp>
+#include <backend/Trace.hpp>
 
+#include <algorithm>
 #include <cctype>
 #include <iostream>
 
@@ -17,6 +21,24 @@
 
 namespace cli {
 
+namespace {
+// Parse comma separated Task IDs, 0 for none
+bool ids_from_str(const std::string &str, std::vector<uint32_t> *p_ids) {
+	p_ids->clear();
+	for (std::size_t begin = 0; begin <= str.size();) {
+		std::size_t end = std::min(str.find(',', begin), str.size());
+		try {
+			if (uint32_t id = std::stoul(str.substr(begin, end - begin)))
+				p_ids->push_back(id);
+		} catch (...) {
+			return false;
+		}
+		begin = end + 1;
+	}
+	return true;
+}
+} // namespace
+
 void Shell::Run() {
 	printf("%s CLI shell\n", backend::kAppName);
 	nowide::cout << "App directory: " << m_instance_ptr->GetAppDirPath() << std::endl;
@@ -58,6 +80,7 @@ std::string Shell::regularize_cmd(std::string_view raw) {
 }
 
 void Shell::run_cmd(std::string_view cmd) {
+	SCHEDULITE_TRACE_SCOPE("Shell::run_cmd");
 	if (cmd == "help") {
 		cmd_help();
 	} else if (cmd == "login") {
@@ -66,6 +89,16 @@ void Shell::run_cmd(std::string_view cmd) {
 		cmd_register();
 	} else if (cmd == "list" || cmd == "ls") {
 		cmd_list();
+	} else if (cmd == "search") {
+		cmd_search();
+	} else if (cmd == "agenda") {
+		cmd_agenda();
+	} else if (cmd == "free") {
+		cmd_free();
+	} else if (cmd == "blocked") {
+		cmd_blocked();
+	} else if (cmd == "month") {
+		cmd_month();
 	} else if (cmd == "insert") {
 		cmd_insert();
 	} else if (cmd == "edit") {
@@ -78,10 +111,12 @@ void Shell::run_cmd(std::string_view cmd) {
 		p.begin_time = std::random_device{}();
 		for (uint32_t i = 0; i < 1000; ++i) {
 			++p.begin_time;
-			PrintError(m_schedule_ptr->TaskInsert(p));
+			PrintError(std::get<backend::Error>(m_schedule_ptr->TaskInsert(p)));
 		}
 	} else if (cmd == "done") {
 		cmd_done();
+	} else if (cmd == "stats") {
+		cmd_stats();
 	} else {
 		std::cout << "Unknown command \"" << cmd << "\"" << std::endl;
 	}
@@ -92,10 +127,16 @@ void Shell::cmd_help() {
 login       User login.
 register    User register.
 list, ls    List all tasks.
+search      Search tasks by name.
+agenda      List the task occurrences of the next 7 days.
+free        Find the first free time slot.
+blocked     List the tasks waiting for others, and the critical path.
+month       Print task counts of each day of a month.
 insert      Insert a task.
 edit        Edit a task.
 erase       Erase a task.
 done        Done with a task (toggle).
+stats       Show backend metrics.
 )");
 }
 void Shell::cmd_login() {
@@ -151,6 +192,77 @@ void Shell::cmd_list() {
 	}
 	PrintTasks(m_schedule_ptr->GetTasks());
 }
+void Shell::cmd_search() {
+	if (!m_schedule_ptr) {
+		PrintError(backend::Error::kUserNotLoggedIn);
+		return;
+	}
+	PrintTasks(m_schedule_ptr->SearchTasks(Input("Name contains")));
+}
+void Shell::cmd_agenda() {
+	if (!m_schedule_ptr) {
+		PrintError(backend::Error::kUserNotLoggedIn);
+		return;
+	}
+	backend::TimeInt time_int_now = backend::GetTimeIntNow();
+	PrintTasks(*m_schedule_ptr->GetTaskOccurrences(time_int_now, time_int_now + 7 * 24 * 60));
+}
+void Shell::cmd_free() {
+	if (!m_schedule_ptr) {
+		PrintError(backend::Error::kUserNotLoggedIn);
+		return;
+	}
+	uint32_t duration;
+	try {
+		duration = std::stoul(Input("Duration (minutes)"));
+	} catch (...) {
+		PrintError("Bad duration");
+		return;
+	}
+	std::string input = Input("After (YYYY/MM/DD hh:mm, leave empty for now)");
+	backend::TimeInt after = EmptyInput(input) ? backend::GetTimeIntNow() : backend::ToTimeInt(input);
+	auto [begin_time, found] = m_schedule_ptr->FindFreeSlot(after, duration);
+	if (!found) {
+		PrintError("No free slot");
+		return;
+	}
+	printf("Free from %s to %s\n", backend::ToTimeStr(begin_time).c_str(),
+	       backend::ToTimeStr(begin_time + duration).c_str());
+}
+void Shell::cmd_blocked() {
+	if (!m_schedule_ptr) {
+		PrintError(backend::Error::kUserNotLoggedIn);
+		return;
+	}
+	auto blocked = m_schedule_ptr->GetBlockedTasks();
+	if (blocked.empty()) {
+		printf("No blocked tasks\n");
+		return;
+	}
+	PrintDependencyInfos(blocked);
+	printf("Critical path:\n");
+	PrintDependencyInfos(m_schedule_ptr->GetCriticalPath());
+}
+void Shell::cmd_month() {
+	if (!m_schedule_ptr) {
+		PrintError(backend::Error::kUserNotLoggedIn);
+		return;
+	}
+	backend::TimeInfo now = backend::GetTimeInfoNow();
+	int year = now.year;
+	unsigned month = now.month;
+	std::string input = Input("Month (YYYY/MM, leave empty for this month)");
+	if (!EmptyInput(input) && !ParseMonth(input, &year, &month)) {
+		PrintError("Invalid month");
+		return;
+	}
+	MonthDays days = GetMonthDays(year, month);
+	std::vector<backend::TaskCounts> week_counts;
+	for (const auto &[first_day, last_day] : days.weeks)
+		week_counts.push_back(m_schedule_ptr->GetRangeCounts(first_day, last_day));
+	PrintMonthCounts(days, m_schedule_ptr->GetDayCounts(days.first, days.last), week_counts,
+	                 m_schedule_ptr->GetRangeCounts(days.first, days.last));
+}
 void Shell::cmd_insert() {
 	if (!m_schedule_ptr) {
 		PrintError(backend::Error::kUserNotLoggedIn);
@@ -165,7 +277,34 @@ void Shell::cmd_insert() {
 	    Input((std::string) "Priority (" + MakeOptionStr(backend::GetTaskPriorityStrings()) + ")"));
 	property.type =
 	    backend::TaskTypeFromStr(Input((std::string) "Type (" + MakeOptionStr(backend::GetTaskTypeStrings()) + ")"));
-	PrintError(std::get<backend::Error>(m_schedule_ptr->TaskInsert(property)));
+	std::string input = Input("Repeat (daily/weekly/monthly/yearly or FREQ=...;BYDAY=..., leave empty if not)");
+	if (!EmptyInput(input)) {
+		bool valid;
+		std::tie(property.recurrence, valid) = backend::TaskRecurrenceFromStr(input);
+		if (!valid) {
+			PrintError("Invalid repeat rule");
+			return;
+		}
+	}
+	input = Input("Duration (minutes, leave empty if no end time)");
+	if (!EmptyInput(input)) {
+		try {
+			property.duration = std::stoul(input);
+		} catch (...) {
+			PrintError("Bad duration");
+			return;
+		}
+	}
+	input = Input("After (task IDs separated by commas, leave empty if none)");
+	if (!EmptyInput(input) && !ids_from_str(input, &property.dependencies)) {
+		PrintError("Bad task IDs");
+		return;
+	}
+	auto conflicts = m_schedule_ptr->GetTaskConflicts(property);
+	backend::Error error = std::get<backend::Error>(m_schedule_ptr->TaskInsert(property));
+	if (error == backend::Error::kSuccess)
+		PrintConflicts(conflicts);
+	PrintError(error);
 }
 void Shell::cmd_edit() {
 	if (!m_schedule_ptr) {
@@ -214,6 +353,37 @@ void Shell::cmd_edit() {
 			property.type = backend::TaskTypeFromStr(input);
 			edit_mask |= backend::TaskPropertyMask::kType;
 		}
+
+		input = Input("New repeat (daily/weekly/monthly/yearly/none or FREQ=...;BYDAY=...)");
+		if (!EmptyInput(input)) {
+			bool valid;
+			std::tie(property.recurrence, valid) = backend::TaskRecurrenceFromStr(input);
+			if (!valid) {
+				PrintError("Invalid repeat rule");
+				return;
+			}
+			edit_mask |= backend::TaskPropertyMask::kRecurrence;
+		}
+
+		input = Input("New duration (minutes, 0 for no end time)");
+		if (!EmptyInput(input)) {
+			try {
+				property.duration = std::stoul(input);
+			} catch (...) {
+				PrintError("Bad duration");
+				return;
+			}
+			edit_mask |= backend::TaskPropertyMask::kDuration;
+		}
+
+		input = Input("New after (task IDs separated by commas, 0 for none)");
+		if (!EmptyInput(input)) {
+			if (!ids_from_str(input, &property.dependencies)) {
+				PrintError("Bad task IDs");
+				return;
+			}
+			edit_mask |= backend::TaskPropertyMask::kDependencies;
+		}
 	}
 	PrintError(m_schedule_ptr->TaskEdit(id, property, edit_mask));
 }
@@ -247,6 +417,13 @@ void Shell::cmd_done() {
 
 	PrintError(m_schedule_ptr->TaskToggleDone(id));
 }
+void Shell::cmd_stats() {
+	if (!m_schedule_ptr) {
+		PrintError(backend::Error::kUserNotLoggedIn);
+		return;
+	}
+	PrintMetrics(m_schedule_ptr->GetMetrics());
+}
 
 void Shell::launch_reminder_thread() {
 	if (m_reminder_thread.joinable())
@@ -263,6 +440,7 @@ void Shell::join_reminder_thread() {
 }
 
 void Shell::reminder_thread_func() {
+	backend::SetTraceThreadName("CLI reminder");
 	auto schedule = m_schedule_ptr;
 	std::mutex cv_mutex;
 	std::unique_lock cv_lock{cv_mutex};
@@ -271,15 +449,26 @@ void Shell::reminder_thread_func() {
 
 	while (m_thread_run.load(std::memory_order_acquire)) {
 		std::string message;
-		for (const auto &task : schedule->GetTasks()) {
-			if (task.property.remind_time == time_int && !task.property.done) {
-				message += backend::ToTimeStr(task.property.begin_time) + " ▶ " + task.property.name;
-				if (task.property.type != backend::TaskType::kNone)
-					message += (std::string) " (" + backend::StrFromTaskType(task.property.type) + ")";
-				message += (std::string) " [" + backend::StrFromTaskPriority(task.property.priority) + " priority]";
-				message += '\n';
-			}
-		}
+		backend::TaskSnapshot snapshot;
+		auto columns = schedule->GetTaskColumns(&snapshot);
+		const auto &tasks = *snapshot;
+		std::vector<uint64_t> remind_mask(backend::GetTaskScanMaskSize(columns->size()));
+		backend::TimeEqualScan(columns->remind_times.data(), columns->size(), time_int, remind_mask.data());
+		backend::UndoneMaskScan(columns->dones.data(), columns->size(), remind_mask.data());
+		const auto add_message = [&message](const backend::Task &task) {
+			message += backend::ToTimeStr(task.property.begin_time) + " ▶ " + task.property.name;
+			if (task.property.type != backend::TaskType::kNone)
+				message += (std::string) " (" + backend::StrFromTaskType(task.property.type) + ")";
+			message += (std::string) " [" + backend::StrFromTaskPriority(task.property.priority) + " priority]";
+			message += '\n';
+		};
+		backend::ForEachTaskScanMaskBit(remind_mask.data(), columns->size(), [&add_message, &tasks](uint32_t i) {
+			// Recurring Tasks are reminded by their occurrences
+			if (!tasks[i].property.recurrence.IsRecurring())
+				add_message(tasks[i]);
+		});
+		for (const auto &occurrence : backend::GetRecurringTasksAt(tasks, time_int, false))
+			add_message(occurrence);
 		if (!message.empty())
 			tinyfd_messageBox("Task remind", message.c_str(), "ok", "info", 1);
 
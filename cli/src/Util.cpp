@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstdio>
 #include <nowide/iostream.hpp>
 
 // From https://stackoverflow.com/questions/1413445/reading-a-password-from-stdcin
@@ -60,6 +61,48 @@ std::string Input(const char *prompt, bool echo) {
 
 bool EmptyInput(std::string_view input) { return std::all_of(input.begin(), input.end(), isspace); }
 
+bool ParseMonth(std::string_view str, int *p_year, unsigned *p_month) {
+	std::string month_str{str};
+	char tail;
+	return sscanf(month_str.c_str(), "%d/%u%c", p_year, p_month, &tail) == 2 && *p_year >= 1970 && *p_month >= 1 &&
+	       *p_month <= 12;
+}
+
+std::vector<std::string> SplitArgs(std::string_view line) {
+	std::vector<std::string> args;
+	std::string arg;
+	bool in_arg = false;
+	char quote = '\0';
+	for (std::size_t i = 0; i < line.size(); ++i) {
+		char c = line[i];
+		if (quote) {
+			if (c == quote)
+				quote = '\0';
+			else if (c == '\\' && quote == '"' && i + 1 < line.size())
+				arg += line[++i];
+			else
+				arg += c;
+		} else if (c == '"' || c == '\'') {
+			quote = c;
+			in_arg = true;
+		} else if (c == '\\' && i + 1 < line.size()) {
+			arg += line[++i];
+			in_arg = true;
+		} else if (isspace((unsigned char)c)) {
+			if (in_arg)
+				args.push_back(std::move(arg));
+			arg.clear();
+			in_arg = false;
+		} else {
+			arg += c;
+			in_arg = true;
+		}
+	}
+	if (in_arg)
+		args.push_back(std::move(arg));
+	return args;
+}
+
 uint32_t GetTerminalWidth() {
 #if defined(_WIN32)
 	CONSOLE_SCREEN_BUFFER_INFO csbi;
@@ -1,30 +1,84 @@
 #include <backend/Environment.hpp>
+#include <backend/Exchange.hpp>
 #include <backend/Instance.hpp>
+#include <backend/Planner.hpp>
 #include <backend/Schedule.hpp>
 #include <backend/Time.hpp>
+#include <backend/Trace.hpp>
 #include <backend/User.hpp>
 
+#include <cli/Batch.hpp>
+#include <cli/Daemon.hpp>
 #include <cli/Format.hpp>
+#include <cli/ScheduleClient.hpp>
 #include <cli/Shell.hpp>
 #include <cli/Util.hpp>
 
 #include <cxxopts.hpp>
 #include <nowide/args.hpp>
+#include <nowide/cstdio.hpp>
+#include <nowide/fstream.hpp>
 #include <nowide/iostream.hpp>
 
+#include <iterator>
+#include <limits>
+#include <optional>
+
+// Default window of --occurrences
+static constexpr backend::TimeInt kDefaultOccurrenceMinutes = 7 * 24 * 60;
+// Default window of --plan
+static constexpr backend::TimeInt kDefaultPlanMinutes = 366 * 24 * 60;
+// Default window of --report, before --until
+static constexpr backend::TimeInt kDefaultReportMinutes = 7 * 24 * 60;
+
 static constexpr const char *kExampleShell = " --shell";
 static constexpr const char *kExampleUserRegister = " -u USER_NAME -r";
 static constexpr const char *kExampleListTasks = " -u USER_NAME -l";
+static constexpr const char *kExampleListOccurrences = " -u USER_NAME -l --occurrences --until \"YYYY/MM/DD hh:mm\"";
+static constexpr const char *kExampleSearchTasks = " -u USER_NAME --search TEXT --limit 10";
 static constexpr const char *kExampleInsertTask =
-    " -u USER_NAME -i -t TASK_NAME -b BEGIN_TIME\n      -m REMIND_TIME -p PRIORITY -y TYPE";
+    " -u USER_NAME -i -t TASK_NAME -b BEGIN_TIME\n      -m REMIND_TIME -p PRIORITY -y TYPE --duration MINUTES";
 static constexpr const char *kExampleEditTask =
     " -u USER_NAME -e TASK_ID [-t NEW_TASK_NAME]\n      [-b NEW_BEGIN_TIME] [-m NEW_REMIND_TIME]\n      [-p "
-    "NEW_PRIORITY] [-y NEW_TYPE]";
+    "NEW_PRIORITY] [-y NEW_TYPE] [--duration NEW_MINUTES] [--after TASK_IDS]";
+static constexpr const char *kExampleRepeatTask =
+    " -u USER_NAME -i -t TASK_NAME -b BEGIN_TIME\n      --repeat \"FREQ=WEEKLY;BYDAY=MO,WE\" --except EXCLUDED_TIME";
+static constexpr const char *kExampleFreeSlot = " -u USER_NAME --free MINUTES [--since \"YYYY/MM/DD hh:mm\"]";
+static constexpr const char *kExamplePlan = " -u USER_NAME --plan FILE [--apply]";
+static constexpr const char *kExampleDependencies =
+    " -u USER_NAME -i -t TASK_NAME -b BEGIN_TIME --duration MINUTES --after TASK_ID,TASK_ID\n      Schedulite -u "
+    "USER_NAME --blocked\n      Schedulite -u USER_NAME --critical";
+static constexpr const char *kExampleMonth = " -u USER_NAME --month YYYY/MM";
+static constexpr const char *kExampleReport =
+    " -u USER_NAME --report [--since \"YYYY/MM/DD hh:mm\"] [--until \"YYYY/MM/DD hh:mm\"]";
+static constexpr const char *kExampleArchive =
+    " -u USER_NAME --archive DAYS\n      Schedulite -u USER_NAME -l --archived [--search TEXT]";
 static constexpr const char *kExampleEraseTasks = " -u USER_NAME -s TASK_ID";
 static constexpr const char *kExampleDoneTasks = " -u USER_NAME -d TASK_ID";
+static constexpr const char *kExampleBatch = " -u USER_NAME --batch FILE";
+static constexpr const char *kExampleImportExport =
+    " -u USER_NAME --import FILE.csv\n      Schedulite -u USER_NAME --export - --format ics";
+static constexpr const char *kExampleDaemon = " --daemon &\n      export SCHEDULITE_SESSION=$(Schedulite -u USER_NAME "
+                                              "--login)\n      Schedulite -l\n      Schedulite --logout";
+
+// Print the metrics of a Schedule (if any) on leaving the scope, for --stats
+class ScopedMetricsPrinter {
+public:
+	explicit ScopedMetricsPrinter(std::shared_ptr<backend::Schedule> schedule) : m_schedule{std::move(schedule)} {}
+	~ScopedMetricsPrinter() {
+		if (m_schedule)
+			cli::PrintMetrics(m_schedule->GetMetrics());
+	}
+	ScopedMetricsPrinter(const ScopedMetricsPrinter &) = delete;
+	ScopedMetricsPrinter &operator=(const ScopedMetricsPrinter &) = delete;
+
+private:
+	std::shared_ptr<backend::Schedule> m_schedule;
+};
 
 int main(int argc, char **argv) {
 	nowide::args _(argc, argv);
+	backend::SetTraceThreadName("CLI main");
 
 	cxxopts::Options options{backend::kAppName, "A simple schedule program"};
 	options.add_options()             //
@@ -33,35 +87,63 @@ int main(int argc, char **argv) {
 	     cxxopts::value<std::string>()->default_value(backend::GetDefaultAppDirPath())) //
 	    ("env", "Print program environment")                                            //
 	    ("shell", "Run CLI shell")                                                      //
+	    ("stats", "Print backend metrics after the operation")                          //
+	    ("daemon", "Run daemon serving schedule operations on a local socket")           //
 	    ;
 
 	options.add_options("User")                                   //
 	    ("u,username", "Username", cxxopts::value<std::string>()) //
 	    ("r,register", "Register")                                //
+	    ("login", "Login to the daemon and print a session token") //
+	    ("logout", "End the daemon session")                        //
+	    ("session", std::string{"Daemon session token (or "} + cli::kDaemonSessionEnvName + ")",
+	     cxxopts::value<std::string>()) //
 	    ;
 
 	options.add_options("Schedule")                                                       //
 	    ("l,list", "List")                                                                //
+	    ("search", "Search tasks by name (substring, letter case ignored)", cxxopts::value<std::string>()) //
+	    ("free", "Find the first free slot of the minutes, from --since (or now) ending before --until",
+	     cxxopts::value<uint32_t>()) //
+	    ("plan", "Plan tasks from a file (or - for stdin) into free time from --since (or now) until --until (or a "
+	             "year later)",
+	     cxxopts::value<std::string>()) //
+	    ("apply", "Apply the --plan in one transaction") //
+	    ("blocked", "List undone tasks waiting for undone tasks they are after") //
+	    ("month", "Print task counts of each day of a month (\"YYYY/MM\")", cxxopts::value<std::string>()) //
+	    ("critical", "Print the chain of undone tasks ending the latest") //
+	    ("report", "Print a JSON productivity report of the tasks beginning from --since (or 7 days ago) until --until "
+	               "(or now)") //
+	    ("archive", "Move the done tasks ended more than the days ago to the archive", cxxopts::value<uint32_t>()) //
 	    ("i,insert", "Insert task")                                                       //
 	    ("e,edit", "Edit task (with task ID)", cxxopts::value<uint32_t>())                //
 	    ("s,erase", "Erase task (with task ID)", cxxopts::value<uint32_t>())              //
 	    ("d,done", "Done with a task (toggle, with task ID)", cxxopts::value<uint32_t>()) //
-	    ;
-
-	backend::TimeInt time_int_now = backend::GetTimeIntNow();
-	std::string time_str_now = backend::ToTimeStr(time_int_now);
-	options.add_options("Task")                                    //
-	    ("t,taskname", "Task name", cxxopts::value<std::string>()) //
-	    ("b,btime", "Begin time (local time, \"YYYY/MM/DD hh:mm\")",
+	    ("batch", "Apply commands from a file (or - for stdin) in one transaction",
 	     cxxopts::value<std::string>()) //
-	    ("m,rtime", "Remind time (local time, \"YYYY/MM/DD hh:mm\")",
+	    ("import", "Import tasks from a file (or - for stdin) in one transaction", cxxopts::value<std::string>()) //
+	    ("export", "Export tasks to a file (or - for stdout), filtered by the list options",
 	     cxxopts::value<std::string>()) //
-	    ("p,priority", "Priority (" + cli::MakeOptionStr(backend::GetTaskPriorityStrings()) + ")",
+	    ;
+
+	options.add_options("List") //
+	    ("format", "Output format (table/jsonl/csv/tsv/ics, import/export default to the file extension)",
 	     cxxopts::value<std::string>()) //
-	    ("y,type", "Type (" + cli::MakeOptionStr(backend::GetTaskTypeStrings()) + ")",
+	    ("since", "List tasks beginning at or after (local time, \"YYYY/MM/DD hh:mm\")",
 	     cxxopts::value<std::string>()) //
+	    ("until", "List tasks beginning before (local time, \"YYYY/MM/DD hh:mm\")",
+	     cxxopts::value<std::string>())                                    //
+	    ("offset", "Number of tasks to skip", cxxopts::value<uint32_t>())    //
+	    ("limit", "Max number of tasks to list", cxxopts::value<uint32_t>()) //
+	    ("archived", "List (or --search) the archived tasks instead") //
+	    ("occurrences",
+	     "List the occurrences of repeating tasks, from --since (or now) until --until (or 7 days later)") //
 	    ;
 
+	backend::TimeInt time_int_now = backend::GetTimeIntNow();
+	std::string time_str_now = backend::ToTimeStr(time_int_now);
+	cli::AddTaskOptions(&options);
+
 	cxxopts::ParseResult result;
 	try {
 		result = options.parse(argc, argv);
@@ -80,14 +162,38 @@ int main(int argc, char **argv) {
 		    "\n      " + backend::kAppName + kExampleUserRegister +         //
 		    "\n\n  List Tasks: " +                                          //
 		    "\n      " + backend::kAppName + kExampleListTasks +            //
+		    "\n\n  List Occurrences of Repeating Tasks (default to 7 days): " + //
+		    "\n      " + backend::kAppName + kExampleListOccurrences +      //
+		    "\n\n  Search Tasks: " +                                        //
+		    "\n      " + backend::kAppName + kExampleSearchTasks +          //
 		    "\n\n  Insert Tasks: " +                                        //
 		    "\n      " + backend::kAppName + kExampleInsertTask +           //
+		    "\n\n  Insert Repeating Tasks: " +                              //
+		    "\n      " + backend::kAppName + kExampleRepeatTask +           //
+		    "\n\n  Find Free Time: " +                                      //
+		    "\n      " + backend::kAppName + kExampleFreeSlot +             //
+		    "\n\n  Plan Tasks (one per line, e.g. -t TASK_NAME --duration 60 --deadline TIME): " + //
+		    "\n      " + backend::kAppName + kExamplePlan +                 //
+		    "\n\n  Count Tasks of Each Day: " +                             //
+		    "\n      " + backend::kAppName + kExampleMonth +               //
+		    "\n\n  Productivity Report (JSON): " +                          //
+		    "\n      " + backend::kAppName + kExampleReport +              //
+		    "\n\n  Task Dependencies: " +                                   //
+		    "\n      " + backend::kAppName + kExampleDependencies +        //
+		    "\n\n  Archive Old Done Tasks: " +                                //
+		    "\n      " + backend::kAppName + kExampleArchive +             //
 		    "\n\n  Edit Tasks (ignore args in [] if no need to change): " + //
 		    "\n      " + backend::kAppName + kExampleEditTask +             //
 		    "\n\n  Erase Tasks: " +                                         //
 		    "\n      " + backend::kAppName + kExampleEraseTasks +           //
 		    "\n\n  Done Tasks: " +                                          //
 		    "\n      " + backend::kAppName + kExampleDoneTasks +            //
+		    "\n\n  Batch (one command per line, e.g. -i -t TASK_NAME): " +   //
+		    "\n      " + backend::kAppName + kExampleBatch +                //
+		    "\n\n  Import and Export (csv/tsv/jsonl/ics): " +              //
+		    "\n      " + backend::kAppName + kExampleImportExport +         //
+		    "\n\n  Run Daemon and Use a Session: " +                        //
+		    "\n      " + backend::kAppName + kExampleDaemon +               //
 		    "\n\n");
 		return 0;
 	}
@@ -119,45 +225,384 @@ int main(int argc, char **argv) {
 		return 0;
 	}
 
+	if (result.count("daemon"))
+		return cli::RunDaemon(instance);
+
+	// Use the daemon when it is running, new users are registered locally
+	std::unique_ptr<cli::DaemonSchedule> daemon_schedule;
+	if (!result.count("register"))
+		daemon_schedule = cli::DaemonSchedule::Connect(*instance);
+
+	std::string session;
+	if (result.count("session"))
+		session = result["session"].as<std::string>();
+	else if (const char *env = std::getenv(cli::kDaemonSessionEnvName))
+		session = env;
+
+	if ((result.count("login") || result.count("logout") || (!session.empty() && !result.count("username"))) &&
+	    !daemon_schedule) {
+		cli::PrintError("Daemon not running");
+		return EXIT_FAILURE;
+	}
+
 	// User
 	std::shared_ptr<backend::User> user;
-	std::shared_ptr<backend::Schedule> schedule;
+	std::shared_ptr<backend::Schedule> schedule_ptr;
 
-	if (result.count("username")) {
+	if (!session.empty() && !result.count("username")) {
+		daemon_schedule->SetSession(std::move(session));
+		if (result.count("logout")) {
+			error = daemon_schedule->Logout();
+			cli::PrintError(error);
+			return (error == backend::Error::kSuccess ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+	} else if (result.count("username")) {
 		std::string username = result["username"].as<std::string>();
 
 		std::string password = cli::Input("Password", false);
 
-		if (result.count("register")) {
-			if (password != cli::Input("Repeat Password", false)) {
-				cli::PrintError("Not equal");
+		if (daemon_schedule) {
+			error = daemon_schedule->Login(username, password);
+			if (error != backend::Error::kSuccess) {
+				cli::PrintError(error);
 				return EXIT_FAILURE;
 			}
-			std::tie(user, error) = backend::User::Register(instance, username, password);
+			if (result.count("login")) {
+				printf("%s\n", daemon_schedule->GetSession().c_str());
+				return 0;
+			}
 		} else {
-			std::tie(user, error) = backend::User::Login(instance, username, password);
-		}
+			if (result.count("register")) {
+				if (password != cli::Input("Repeat Password", false)) {
+					cli::PrintError("Not equal");
+					return EXIT_FAILURE;
+				}
+				std::tie(user, error) = backend::User::Register(instance, username, password);
+			} else {
+				std::tie(user, error) = backend::User::Login(instance, username, password);
+			}
 
-		if (!user) {
-			cli::PrintError(error);
-			return EXIT_FAILURE;
+			if (!user) {
+				cli::PrintError(error);
+				return EXIT_FAILURE;
+			}
 		}
 	} else {
 		cli::PrintError("User not determined");
 		return EXIT_FAILURE;
 	}
 
-	std::tie(schedule, error) = backend::Schedule::Acquire(user);
-	if (!schedule) {
-		cli::PrintError(error);
-		return EXIT_FAILURE;
+	// Operations on either a local backend::Schedule or the daemon
+	std::unique_ptr<cli::ScheduleClient> schedule;
+	if (daemon_schedule) {
+		if (result.count("stats"))
+			cli::PrintError("Metrics are not available through the daemon");
+		schedule = std::move(daemon_schedule);
+	} else {
+		std::tie(schedule_ptr, error) = backend::Schedule::Acquire(user);
+		if (!schedule_ptr) {
+			cli::PrintError(error);
+			return EXIT_FAILURE;
+		}
+		schedule = std::make_unique<cli::LocalScheduleClient>(schedule_ptr);
+	}
+	ScopedMetricsPrinter metrics_printer{result.count("stats") ? schedule_ptr : nullptr};
+
+	const auto get_search_limit = [&result]() {
+		return result.count("limit") ? result["limit"].as<uint32_t>() : backend::Schedule::kDefaultSearchLimit;
+	};
+	const auto list_occurrences = [&schedule, &result, time_int_now]() {
+		backend::TimeInt since = result.count("since") ? backend::ToTimeInt(result["since"].as<std::string>())
+		                                               : time_int_now;
+		backend::TimeInt until = result.count("until") ? backend::ToTimeInt(result["until"].as<std::string>())
+		                                               : since + kDefaultOccurrenceMinutes;
+		auto [tasks, error] = schedule->GetTaskOccurrences(since, until);
+		// Apply the offset and limit to the occurrences
+		uint32_t offset = result.count("offset") ? result["offset"].as<uint32_t>() : 0;
+		uint32_t limit = result.count("limit") ? result["limit"].as<uint32_t>() : tasks.size();
+		tasks.erase(tasks.begin(), tasks.begin() + (std::ptrdiff_t)std::min<std::size_t>(offset, tasks.size()));
+		if (limit < tasks.size())
+			tasks.resize(limit);
+		return std::make_tuple(std::move(tasks), error);
+	};
+	const auto get_query = [&result]() {
+		backend::TaskQuery query{};
+		if (result.count("since"))
+			query.since = backend::ToTimeInt(result["since"].as<std::string>());
+		if (result.count("until"))
+			query.until = backend::ToTimeInt(result["until"].as<std::string>());
+		if (result.count("offset"))
+			query.offset = result["offset"].as<uint32_t>();
+		if (result.count("limit"))
+			query.limit = result["limit"].as<uint32_t>();
+		return query;
+	};
+	// The exchange format from --format, or else the file extension
+	const auto get_exchange_format = [&result](const std::string &path, backend::ExchangeFormat *p_format) {
+		if (result.count("format") ? backend::ExchangeFormatFromStr(result["format"].as<std::string>(), p_format)
+		                           : backend::ExchangeFormatFromPath(path, p_format))
+			return true;
+		cli::PrintError("Unknown exchange format, specify one with --format");
+		return false;
+	};
+
+	if (result.count("list") || result.count("search")) {
+		std::optional<backend::ExchangeFormat> format;
+		if (result.count("format") && result["format"].as<std::string>() != "table") {
+			format.emplace();
+			if (!backend::ExchangeFormatFromStr(result["format"].as<std::string>(), &*format)) {
+				cli::PrintError("Invalid output format");
+				return EXIT_FAILURE;
+			}
+		}
+		std::vector<backend::Task> tasks;
+		backend::Error fetch_error;
+		if (result.count("archived"))
+			std::tie(tasks, fetch_error) =
+			    result.count("search")
+			        ? schedule->SearchArchivedTasks(result["search"].as<std::string>(), get_search_limit())
+			        : schedule->QueryArchivedTasks(get_query());
+		else
+			std::tie(tasks, fetch_error) =
+			    result.count("search")
+			        ? schedule->SearchTasks(result["search"].as<std::string>(), get_search_limit())
+			        : (result.count("occurrences") ? list_occurrences() : schedule->QueryTasks(get_query()));
+		if (fetch_error != backend::Error::kSuccess) {
+			cli::PrintError(fetch_error);
+			return EXIT_FAILURE;
+		}
+		cli::PrintTasks(tasks, format);
+		return 0;
+	}
+
+	if (result.count("free")) {
+		auto duration = result["free"].as<uint32_t>();
+		backend::TimeInt after = result.count("since") ? backend::ToTimeInt(result["since"].as<std::string>())
+		                                               : time_int_now;
+		backend::TimeInt until = result.count("until") ? backend::ToTimeInt(result["until"].as<std::string>())
+		                                               : std::numeric_limits<backend::TimeInt>::max();
+		auto [begin_time, found, fetch_error] = schedule->FindFreeSlot(after, duration, until);
+		if (fetch_error != backend::Error::kSuccess) {
+			cli::PrintError(fetch_error);
+			return EXIT_FAILURE;
+		}
+		if (!found) {
+			cli::PrintError("No free slot");
+			return EXIT_FAILURE;
+		}
+		printf("Free from %s to %s\n", backend::ToTimeStr(begin_time).c_str(),
+		       backend::ToTimeStr(begin_time + duration).c_str());
+		return 0;
+	}
+
+	if (result.count("blocked") || result.count("critical")) {
+		auto [infos, fetch_error] =
+		    result.count("critical") ? schedule->GetCriticalPath() : schedule->GetBlockedTasks();
+		if (fetch_error != backend::Error::kSuccess) {
+			cli::PrintError(fetch_error);
+			return EXIT_FAILURE;
+		}
+		if (infos.empty())
+			printf("No blocked tasks\n");
+		cli::PrintDependencyInfos(infos);
+		return 0;
+	}
+
+	if (result.count("month")) {
+		int year;
+		unsigned month;
+		if (!cli::ParseMonth(result["month"].as<std::string>(), &year, &month)) {
+			cli::PrintError("Invalid month");
+			return EXIT_FAILURE;
+		}
+		cli::MonthDays days = cli::GetMonthDays(year, month);
+		auto [day_counts, fetch_error] = schedule->GetDayCounts(days.first, days.last);
+		std::vector<backend::TaskCounts> week_counts;
+		for (const auto &[first_day, last_day] : days.weeks) {
+			if (fetch_error != backend::Error::kSuccess)
+				break;
+			week_counts.emplace_back();
+			std::tie(week_counts.back(), fetch_error) = schedule->GetRangeCounts(first_day, last_day);
+		}
+		backend::TaskCounts month_counts{};
+		if (fetch_error == backend::Error::kSuccess)
+			std::tie(month_counts, fetch_error) = schedule->GetRangeCounts(days.first, days.last);
+		if (fetch_error != backend::Error::kSuccess) {
+			cli::PrintError(fetch_error);
+			return EXIT_FAILURE;
+		}
+		cli::PrintMonthCounts(days, day_counts, week_counts, month_counts);
+		return 0;
+	}
+
+	if (result.count("archive")) {
+		backend::TimeInt age = result["archive"].as<uint32_t>() * 24u * 60u;
+		auto [count, archive_error] = schedule->ArchiveTasks(std::max(time_int_now, age) - age);
+		if (archive_error != backend::Error::kSuccess) {
+			cli::PrintError(archive_error);
+			return EXIT_FAILURE;
+		}
+		printf("Archived %u tasks\n", count);
+		return 0;
+	}
+
+	if (result.count("report")) {
+		backend::TimeInt until = result.count("until") ? backend::ToTimeInt(result["until"].as<std::string>())
+		                                               : time_int_now;
+		backend::TimeInt since = result.count("since")
+		                             ? backend::ToTimeInt(result["since"].as<std::string>())
+		                             : std::max(until, kDefaultReportMinutes) - kDefaultReportMinutes;
+		auto [report, fetch_error] = schedule->GetTaskReport(since, until);
+		if (fetch_error != backend::Error::kSuccess) {
+			cli::PrintError(fetch_error);
+			return EXIT_FAILURE;
+		}
+		cli::PrintTaskReport(since, until, report);
+		return 0;
+	}
+
+	if (result.count("plan")) {
+		auto path = result["plan"].as<std::string>();
+		cli::Plan plan;
+		bool valid;
+		if (path == "-")
+			std::tie(plan, valid) = cli::ParsePlan(nowide::cin);
+		else {
+			nowide::ifstream in{path};
+			if (!in.is_open()) {
+				printf("ERROR: Failed to open \"%s\"\n", path.c_str());
+				return EXIT_FAILURE;
+			}
+			std::tie(plan, valid) = cli::ParsePlan(in);
+		}
+		if (!valid) {
+			cli::PrintError("Invalid plan");
+			return EXIT_FAILURE;
+		}
+		backend::PlanOptions plan_options{};
+		plan_options.since = result.count("since") ? backend::ToTimeInt(result["since"].as<std::string>())
+		                                           : time_int_now;
+		plan_options.until = result.count("until") ? backend::ToTimeInt(result["until"].as<std::string>())
+		                                           : plan_options.since + kDefaultPlanMinutes;
+		auto [busy, fetch_error] = schedule->GetOverlappingTasks(plan_options.since, plan_options.until);
+		if (fetch_error != backend::Error::kSuccess) {
+			cli::PrintError(fetch_error);
+			return EXIT_FAILURE;
+		}
+		backend::TaskPlan task_plan = backend::PlanTasks(busy, plan.tasks, plan_options);
+		if (!result.count("apply")) {
+			cli::PrintTaskPlan(plan, task_plan);
+			return task_plan.unplaced.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+
+		cli::Batch batch;
+		for (uint32_t index : task_plan.placed)
+			batch.lines.push_back(plan.lines[index]);
+		batch.ops = std::move(task_plan.ops);
+		std::vector<backend::TaskOpResult> results;
+		std::tie(results, error) = schedule->TaskBatch(batch.ops);
+		cli::PrintBatchResults(batch, results);
+		for (uint32_t index : task_plan.unplaced)
+			printf("Line %u: ERROR: No free slot before the deadline\n", plan.lines[index]);
+		if (error != backend::Error::kSuccess)
+			cli::PrintError(std::string{backend::GetErrorMessage(error)} + ", nothing applied");
+		else
+			cli::PrintError(error);
+		return (error == backend::Error::kSuccess && task_plan.unplaced.empty() ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
+	if (result.count("export")) {
+		auto path = result["export"].as<std::string>();
+		backend::ExchangeFormat format;
+		if (!get_exchange_format(path, &format))
+			return EXIT_FAILURE;
+		auto [tasks, fetch_error] = schedule->QueryTasks(get_query());
+		if (fetch_error != backend::Error::kSuccess) {
+			cli::PrintError(fetch_error);
+			return EXIT_FAILURE;
+		}
+		std::FILE *file = path == "-" ? stdout : nowide::fopen(path.c_str(), "wb");
+		if (!file) {
+			printf("ERROR: Failed to open \"%s\"\n", path.c_str());
+			return EXIT_FAILURE;
+		}
+		{
+			backend::Writer writer{file};
+			backend::ExportTasks(&writer, tasks, format);
+		}
+		if (file != stdout) {
+			bool failed = std::ferror(file);
+			failed |= std::fclose(file) != 0;
+			if (failed) {
+				printf("ERROR: Failed to write \"%s\"\n", path.c_str());
+				return EXIT_FAILURE;
+			}
+			printf("Exported %zu tasks\n", tasks.size());
+		}
+		return 0;
 	}
 
-	if (result.count("list")) {
-		cli::PrintTasks(schedule->GetTasks());
+	if (result.count("import")) {
+		auto path = result["import"].as<std::string>();
+		backend::ExchangeFormat format;
+		if (!get_exchange_format(path, &format))
+			return EXIT_FAILURE;
+		std::string data;
+		if (path == "-")
+			data.assign(std::istreambuf_iterator<char>{nowide::cin}, {});
+		else {
+			nowide::ifstream in{path, std::ios::binary};
+			if (!in.is_open()) {
+				printf("ERROR: Failed to open \"%s\"\n", path.c_str());
+				return EXIT_FAILURE;
+			}
+			data.assign(std::istreambuf_iterator<char>{in}, {});
+		}
+		auto [properties, import_errors] = backend::ImportTasks(data, format);
+		if (!import_errors.empty()) {
+			cli::PrintImportErrors(import_errors);
+			cli::PrintError("Invalid import, nothing applied");
+			return EXIT_FAILURE;
+		}
+		std::size_t parsed = properties.size();
+		uint32_t inserted;
+		std::tie(inserted, error) = schedule->TaskImport(std::move(properties));
+		if (error != backend::Error::kSuccess) {
+			cli::PrintError(std::string{backend::GetErrorMessage(error)} + ", nothing applied");
+			return EXIT_FAILURE;
+		}
+		printf("Imported %u tasks (%zu already existing skipped)\n", inserted, parsed - inserted);
 		return 0;
 	}
 
+	if (result.count("batch")) {
+		auto path = result["batch"].as<std::string>();
+		cli::Batch batch;
+		bool valid;
+		if (path == "-")
+			std::tie(batch, valid) = cli::ParseBatch(nowide::cin);
+		else {
+			nowide::ifstream in{path};
+			if (!in.is_open()) {
+				printf("ERROR: Failed to open \"%s\"\n", path.c_str());
+				return EXIT_FAILURE;
+			}
+			std::tie(batch, valid) = cli::ParseBatch(in);
+		}
+		if (!valid) {
+			cli::PrintError("Invalid batch, nothing applied");
+			return EXIT_FAILURE;
+		}
+		std::vector<backend::TaskOpResult> results;
+		std::tie(results, error) = schedule->TaskBatch(batch.ops);
+		cli::PrintBatchResults(batch, results);
+		if (error != backend::Error::kSuccess)
+			cli::PrintError(std::string{backend::GetErrorMessage(error)} + ", nothing applied");
+		else
+			cli::PrintError(error);
+		return (error == backend::Error::kSuccess ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
 	if (result.count("erase")) {
 		auto id = result["erase"].as<uint32_t>();
 		error = schedule->TaskErase(id);
@@ -189,8 +634,20 @@ int main(int argc, char **argv) {
 			property.priority = backend::TaskPriorityFromStr(result["priority"].as<std::string>());
 		if (result.count("type"))
 			property.type = backend::TaskTypeFromStr(result["type"].as<std::string>());
+		if (const char *recurrence_error = cli::ParseTaskRecurrence(result, &property.recurrence)) {
+			cli::PrintError(recurrence_error);
+			return EXIT_FAILURE;
+		}
+		if (result.count("duration"))
+			property.duration = result["duration"].as<uint32_t>();
+		if (result.count("after"))
+			cli::ParseTaskDependencies(result, &property.dependencies);
 
+		// Double-booking is allowed, but warned
+		auto conflicts = std::get<std::vector<backend::Task>>(schedule->GetTaskConflicts(property, 0));
 		error = std::get<backend::Error>(schedule->TaskInsert(property));
+		if (error == backend::Error::kSuccess)
+			cli::PrintConflicts(conflicts);
 		cli::PrintError(error);
 		return (error == backend::Error::kSuccess ? EXIT_SUCCESS : EXIT_FAILURE);
 	}
@@ -221,6 +678,21 @@ int main(int argc, char **argv) {
 			property.type = backend::TaskTypeFromStr(result["type"].as<std::string>());
 			edit_mask |= backend::TaskPropertyMask::kType;
 		}
+		if (result.count("repeat") || result.count("except")) {
+			if (const char *recurrence_error = cli::ParseTaskRecurrence(result, &property.recurrence)) {
+				cli::PrintError(recurrence_error);
+				return EXIT_FAILURE;
+			}
+			edit_mask |= backend::TaskPropertyMask::kRecurrence;
+		}
+		if (result.count("duration")) {
+			property.duration = result["duration"].as<uint32_t>();
+			edit_mask |= backend::TaskPropertyMask::kDuration;
+		}
+		if (result.count("after")) {
+			cli::ParseTaskDependencies(result, &property.dependencies);
+			edit_mask |= backend::TaskPropertyMask::kDependencies;
+		}
 
 		error = schedule->TaskEdit(id, property, edit_mask);
 		cli::PrintError(error);
@@ -2,6 +2,8 @@
 
 #include "Icon.hpp"
 
+#include <backend/Recurrence.hpp>
+
 namespace gui {
 
 void TaskDetailBox::init_widget() {
@@ -116,9 +118,15 @@ void TaskDetailBox::set_task(const backend::Task &task) {
 }
 void TaskDetailBox::update_status() {
 	backend::TimeInt now_int = backend::GetTimeIntNow();
-	auto status = backend::TaskStatusFromTask(m_task, now_int);
+	// A recurring Task has the status of its current or next occurrence
+	auto status = backend::GetTaskOccurrenceStatus(m_task.property, now_int).status;
 	m_p_status_label->set_text(backend::StrFromTaskStatus(status));
 	m_p_status_icon->set_from_icon_name(GetTaskStatusIconName(status), Gtk::ICON_SIZE_DND);
+	// The Tasks to be done before are told by the tooltip
+	std::string after;
+	for (uint32_t id : m_task.property.dependencies)
+		after += (after.empty() ? "After task " : ", ") + std::to_string(id);
+	m_p_status_label->set_tooltip_text(after);
 }
 
 bool TaskDetailBox::update_from_tasks(const std::vector<backend::Task> &tasks) {
@@ -1,79 +1,453 @@
 #include "TaskFlowBox.hpp"
 
+#include <backend/Recurrence.hpp>
+#include <backend/TaskScan.hpp>
+#include <backend/Trace.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <numeric>
+
 namespace gui {
 
+namespace {
+constexpr int kBorder = 16, kSpacing = 16, kMaxColumns = 3;
+// Rows materialized above and below the visible ones, so that slow scrolling does not rebind on every step
+constexpr int kMarginRows = 2;
+} // namespace
+
 TaskFlowBox::TaskFlowBox() { init_widget(); }
 
-void TaskFlowBox::init_widget() {
-	set_selection_mode(Gtk::SELECTION_NONE);
-	set_column_spacing(16);
-	set_row_spacing(16);
-	set_border_width(16);
-	set_homogeneous(true);
-	set_max_children_per_line(3);
-}
-
-void TaskFlowBox::refilter() {
-	for (Gtk::Widget *child : get_children()) {
-		const backend::TaskProperty &p = ((TaskFlowBoxChild *)child)->get_task().property;
-		bool show = bool(m_priority_filter & (1 << (uint32_t)p.priority)) &&
-		            bool(m_type_filter & (1 << (uint32_t)p.type)) &&
-		            bool(m_status_filter & (1 << (uint32_t)backend::TaskStatusFromTask(p)));
-		if (show)
-			child->show();
-		else
-			child->hide();
+void TaskFlowBox::init_widget() { set_can_focus(false); }
+
+TaskSortOrder TaskSortOrderFromStr(std::string_view str) {
+	const auto strings = GetTaskSortOrderStrings();
+	for (std::size_t i = 0; i < strings.size(); ++i)
+		if (str.size() == std::string_view{strings[i]}.size() &&
+		    std::equal(str.begin(), str.end(), strings[i],
+		               [](char l, char r) { return std::tolower((unsigned char)l) == std::tolower((unsigned char)r); }))
+			return (TaskSortOrder)i;
+	return TaskSortOrder::kBeginTime;
+}
+
+void TaskFlowBox::invalidate_sort() {
+	m_sort_dirty = true;
+	schedule_update();
+}
+void TaskFlowBox::invalidate_filter() {
+	m_filter_dirty = true;
+	schedule_update();
+}
+void TaskFlowBox::schedule_update() {
+	// Before GTK's resize (PRIORITY_HIGH_IDLE + 10) and redraw (+ 20) handlers
+	if (!m_update_connection.connected())
+		m_update_connection = Glib::signal_idle().connect(
+		    [this]() {
+			    update_model();
+			    return false;
+		    },
+		    Glib::PRIORITY_HIGH_IDLE);
+}
+void TaskFlowBox::update_model() {
+	m_update_connection.disconnect();
+	if (!m_sort_dirty && !m_filter_dirty)
+		return;
+	if (m_sort_dirty) {
+		update_statuses();
+		sort();
 	}
+	filter();
+	m_sort_dirty = m_filter_dirty = false;
+	update_viewport();
 }
 
-void TaskFlowBox::set_tasks(const std::vector<backend::Task> &tasks) {
-	std::unordered_map<uint32_t, TaskFlowBoxChild *> update_set{}, erase_set;
+void TaskFlowBox::sort() {
+	SCHEDULITE_TRACE_SCOPE("TaskFlowBox::sort");
+	auto count = (uint32_t)m_tasks->size();
+	m_order.resize(count);
+	std::iota(m_order.begin(), m_order.end(), 0u);
+	// Tasks are kept in key order (begin time, name), which breaks the ties of the other orders
+	switch (m_sort_order) {
+	case TaskSortOrder::kBeginTime:
+		break;
+	case TaskSortOrder::kRemindTime:
+	case TaskSortOrder::kPriority: {
+		// Pack (key, index) into integers, so that sorting does not touch the Tasks
+		std::vector<uint64_t> keys(count);
+		for (uint32_t i = 0; i < count; ++i) {
+			const backend::TaskProperty &p = (*m_tasks)[i].property;
+			uint64_t key = m_sort_order == TaskSortOrder::kRemindTime
+			                   ? p.remind_time
+			                   : uint64_t(backend::TaskPriority::kHigh) - uint64_t(p.priority);
+			keys[i] = key << 32u | i;
+		}
+		std::sort(keys.begin(), keys.end());
+		for (uint32_t i = 0; i < count; ++i)
+			m_order[i] = uint32_t(keys[i]);
+		break;
+	}
+	case TaskSortOrder::kName:
+		if (m_name_keys.size() != count) {
+			m_name_keys.resize(count);
+			for (uint32_t i = 0; i < count; ++i) {
+				gchar *key = g_utf8_collate_key((*m_tasks)[i].property.name.c_str(), -1);
+				m_name_keys[i] = key;
+				g_free(key);
+			}
+		}
+		std::sort(m_order.begin(), m_order.end(), [this](uint32_t l, uint32_t r) {
+			int cmp = m_name_keys[l].compare(m_name_keys[r]);
+			return cmp < 0 || (cmp == 0 && l < r);
+		});
+		break;
+	}
+	m_ranks.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+		m_ranks[m_order[i]] = i;
+}
 
-	{
-		std::unique_lock write_lock{m_children_mutex};
-		erase_set = std::move(m_children);
-		m_children.clear();
+void TaskFlowBox::update_statuses() {
+	SCHEDULITE_TRACE_SCOPE("TaskFlowBox::update_statuses");
+	backend::TimeInt now = backend::GetTimeIntNow();
+	m_statuses.resize(m_task_columns->size());
+	backend::TaskStatusScan(m_task_columns->begin_times.data(), m_task_columns->dones.data(), m_task_columns->size(),
+	                        now, m_statuses.data());
+	m_begin_times = m_task_columns->begin_times;
+	m_transitions.clear();
+	for (uint32_t i = 0; i < (uint32_t)m_tasks->size(); ++i) {
+		const backend::TaskProperty &property = (*m_tasks)[i].property;
+		// The scan only covers the first occurrence of a recurring Task
+		if (property.recurrence.IsRecurring() && !property.done) {
+			auto occurrence = backend::GetTaskOccurrenceStatus(property, now);
+			m_statuses[i] = occurrence.status;
+			m_begin_times[i] = occurrence.begin_time;
+			if (occurrence.transition_time)
+				m_transitions.emplace_back(occurrence.transition_time, i);
+		} else if (m_statuses[i] == backend::TaskStatus::kPending)
+			m_transitions.emplace_back(property.begin_time, i);
 	}
+	std::make_heap(m_transitions.begin(), m_transitions.end(), std::greater<>{});
+	schedule_transition();
+}
+
+bool TaskFlowBox::pass_filters(uint32_t index) const {
+	const backend::TaskProperty &p = (*m_tasks)[index].property;
+	return bool(m_priority_filter & (1 << (uint32_t)p.priority)) && bool(m_type_filter & (1 << (uint32_t)p.type)) &&
+	       bool(m_status_filter & (1 << (uint32_t)m_statuses[index])) &&
+	       (m_search_query.empty() || m_search_matches[index]);
+}
+
+void TaskFlowBox::filter() {
+	SCHEDULITE_TRACE_SCOPE("TaskFlowBox::filter");
+	if (!m_search_query.empty()) {
+		if (m_search_index_dirty) {
+			m_search_index.Update(*m_tasks);
+			m_search_index_dirty = false;
+		}
+		m_search_matches.assign(m_tasks->size(), false);
+		for (const auto &result : m_search_index.Search(m_search_query, std::numeric_limits<uint32_t>::max()))
+			m_search_matches[result.index] = true;
+	}
+	m_filtered.clear();
+	for (uint32_t i : m_order)
+		if (pass_filters(i))
+			m_filtered.push_back(i);
+}
+
+void TaskFlowBox::refilter_tasks(const std::vector<uint32_t> &indices) {
+	// Each insertion or removal moves the tail of m_filtered, a full pass is cheaper beyond a few
+	if (indices.size() > 16) {
+		filter();
+		return;
+	}
+	for (uint32_t index : indices) {
+		auto it = std::lower_bound(m_filtered.begin(), m_filtered.end(), index,
+		                           [this](uint32_t l, uint32_t r) { return m_ranks[l] < m_ranks[r]; });
+		bool shown = it != m_filtered.end() && *it == index;
+		if (pass_filters(index)) {
+			if (!shown)
+				m_filtered.insert(it, index);
+		} else if (shown)
+			m_filtered.erase(it);
+	}
+}
+
+void TaskFlowBox::schedule_transition() {
+	m_transition_connection.disconnect();
+	if (m_transitions.empty())
+		return;
+	// Wake up at the earliest transition, but at least every minute to follow changes of the wall clock
+	auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(
+	    backend::ToTimePoint(m_transitions.front().first) - backend::Clock::now());
+	delay = std::clamp(delay, std::chrono::milliseconds{0}, std::chrono::milliseconds{std::chrono::minutes{1}});
+	m_transition_connection =
+	    Glib::signal_timeout().connect(sigc::mem_fun(*this, &TaskFlowBox::on_transition), (unsigned)delay.count() + 1);
+}
+
+bool TaskFlowBox::on_transition() {
+	// The heap refers to the old Tasks, update_model() rebuilds it
+	if (m_sort_dirty)
+		return false;
+	SCHEDULITE_TRACE_SCOPE("TaskFlowBox::on_transition");
+	backend::TimeInt now = backend::GetTimeIntNow();
+	std::vector<uint32_t> flipped;
+	while (!m_transitions.empty() && m_transitions.front().first <= now) {
+		std::pop_heap(m_transitions.begin(), m_transitions.end(), std::greater<>{});
+		uint32_t index = m_transitions.back().second;
+		m_transitions.pop_back();
+		// A recurring Task moves on to its next occurrence, whose transitions are later than now
+		auto occurrence = backend::GetTaskOccurrenceStatus((*m_tasks)[index].property, now);
+		m_statuses[index] = occurrence.status;
+		m_begin_times[index] = occurrence.begin_time;
+		if (occurrence.transition_time) {
+			m_transitions.emplace_back(occurrence.transition_time, index);
+			std::push_heap(m_transitions.begin(), m_transitions.end(), std::greater<>{});
+		}
+		flipped.push_back(index);
+	}
+	if (!flipped.empty()) {
+		// Only the flipped Tasks can change their filter results, bound children are rebound if their status changed
+		if (!m_filter_dirty)
+			refilter_tasks(flipped);
+		update_viewport();
+	}
+	schedule_transition();
+	return false;
+}
 
-	int pos = 0;
-	for (const auto &task : tasks) {
-		auto it = erase_set.find(task.id);
-		if (it != erase_set.end()) {
-			// The task ID already exists, modify it
-			update_set.insert(*it);
-			auto child = it->second;
-			bool key_changed = !backend::TaskKeyEqual(child->get_task(), task);
-			if (child->get_task() != task)
-				child->set_task(task);
-			if (key_changed) {
-				Gtk::FlowBox::remove(*child);
-				Gtk::FlowBox::insert(*child, pos);
+void TaskFlowBox::set_tasks(backend::TaskSnapshot tasks, std::shared_ptr<const backend::TaskColumns> columns) {
+	SCHEDULITE_TRACE_SCOPE("TaskFlowBox::set_tasks");
+	m_tasks = std::move(tasks);
+	m_task_columns = std::move(columns);
+	m_name_keys.clear();
+	m_search_index_dirty = true;
+	m_transition_connection.disconnect();
+	if (m_active_id && std::none_of(m_tasks->begin(), m_tasks->end(),
+	                                [this](const backend::Task &task) { return task.id == m_active_id; }))
+		m_active_id = 0;
+	invalidate_sort();
+}
+
+void TaskFlowBox::set_sort_order(TaskSortOrder order) {
+	if (order == m_sort_order)
+		return;
+	m_sort_order = order;
+	invalidate_sort();
+}
+
+TaskFlowBoxChild *TaskFlowBox::make_child() {
+	auto child = Gtk::make_managed<TaskFlowBoxChild>(this);
+	put(*child, 0, 0);
+	child->m_x = child->m_y = 0;
+	m_children.push_back(child);
+	return child;
+}
+
+void TaskFlowBox::update_geometry() {
+	if (m_width < 0 || m_filtered.empty())
+		return;
+	// Measure a child bound to a Task, all of them have the same layout
+	TaskFlowBoxChild *sample = m_children.empty() ? make_child() : m_children.front();
+	if (!sample->m_bound)
+		sample->set_task((*m_tasks)[m_filtered.front()], m_statuses[m_filtered.front()],
+		                 m_begin_times[m_filtered.front()]);
+	sample->set_size_request(-1, -1);
+
+	int min_width, natural_width, min_height, natural_height;
+	sample->get_preferred_width(min_width, natural_width);
+	int width = m_width - 2 * kBorder;
+	m_columns = std::clamp((width + kSpacing) / (min_width + kSpacing), 1, kMaxColumns);
+	m_column_width = std::max((width - (m_columns - 1) * kSpacing) / m_columns, min_width);
+	sample->get_preferred_height_for_width(m_column_width, min_height, natural_height);
+	m_row_height = std::max(natural_height, 1);
+}
+
+void TaskFlowBox::update_viewport() {
+	if (m_width < 0)
+		return;
+	SCHEDULITE_TRACE_SCOPE("TaskFlowBox::update_viewport");
+	if (!m_row_height)
+		update_geometry();
+
+	auto count = (uint32_t)m_filtered.size();
+	int rows = int((count + m_columns - 1) / m_columns), row_stride = m_row_height + kSpacing;
+	m_vadjustment_connection.block();
+	set_size(m_width, rows ? 2 * kBorder + rows * row_stride - kSpacing : 0);
+	m_vadjustment_connection.unblock();
+
+	// The slots (indices of the filtered Tasks) in view
+	uint32_t begin = 0, end = 0;
+	if (m_row_height) {
+		double top = m_vadjustment ? m_vadjustment->get_value() : 0.0;
+		double height = m_vadjustment ? m_vadjustment->get_page_size() : get_allocated_height();
+		int first_row = std::max(int((top - kBorder) / row_stride) - kMarginRows, 0);
+		int last_row = std::min(int((top + height - kBorder) / row_stride) + 1 + kMarginRows, rows);
+		begin = std::min(uint32_t(first_row * m_columns), count);
+		end = std::min(uint32_t(std::max(last_row, first_row) * m_columns), count);
+	}
+
+	// Children keep their slots if still in view, the others are recycled. The focused child keeps its slot out of
+	// view too, so that the keyboard focus stays on the slot rather than moving with a recycled widget
+	std::vector<TaskFlowBoxChild *> slot_children(end - begin), free_children;
+	TaskFlowBoxChild *focus_child = nullptr;
+	for (auto child : m_children) {
+		if (child->m_slot >= begin && child->m_slot < end && !slot_children[child->m_slot - begin])
+			slot_children[child->m_slot - begin] = child;
+		else if (!focus_child && child->m_slot < count && child->m_button.is_focus())
+			focus_child = child;
+		else
+			free_children.push_back(child);
+	}
+	const auto bind_child = [this, row_stride](TaskFlowBoxChild *child, uint32_t slot) {
+		uint32_t index = m_filtered[slot];
+		const backend::Task &task = (*m_tasks)[index];
+		if (!child->m_bound || child->m_task != task || child->m_status != m_statuses[index] ||
+		    child->m_begin_time != m_begin_times[index])
+			child->set_task(task, m_statuses[index], m_begin_times[index]);
+		child->set_active_silently(task.id == m_active_id);
+
+		int x = kBorder + int(slot % m_columns) * (m_column_width + kSpacing);
+		int y = kBorder + int(slot / m_columns) * row_stride;
+		if (x != child->m_x || y != child->m_y) {
+			move(*child, x, y);
+			child->m_x = x;
+			child->m_y = y;
+		}
+		child->set_size_request(m_column_width, m_row_height);
+		child->show();
+	};
+	for (uint32_t slot = begin; slot < end; ++slot) {
+		TaskFlowBoxChild *&child = slot_children[slot - begin];
+		if (!child) {
+			if (free_children.empty())
+				child = make_child();
+			else {
+				child = free_children.back();
+				free_children.pop_back();
 			}
-			erase_set.erase(task.id);
-		} else {
-			// Not exist, insert it
-			auto child = Gtk::make_managed<TaskFlowBoxChild>(task);
-			update_set.insert({task.id, child});
-			Gtk::FlowBox::insert(*child, pos);
-			child->show();
+			child->m_slot = slot;
 		}
-		++pos;
+		bind_child(child, slot);
 	}
-	for (const auto &p : erase_set) {
-		auto child = p.second;
+	if (focus_child)
+		bind_child(focus_child, focus_child->m_slot);
+	for (auto child : free_children) {
+		child->m_slot = TaskFlowBoxChild::kNoSlot;
 		child->hide();
-		if (child == m_active_child) {
-			m_active_child = nullptr;
+	}
+}
+
+void TaskFlowBox::on_size_allocate(Gtk::Allocation &allocation) {
+	if (get_vadjustment() != m_vadjustment) {
+		m_vadjustment_connection.disconnect();
+		m_vadjustment = get_vadjustment();
+		if (m_vadjustment) {
+			m_vadjustment_connection =
+			    m_vadjustment->signal_value_changed().connect(sigc::mem_fun(*this, &TaskFlowBox::update_viewport));
+			// Scroll the children focused by Tab into view
+			set_focus_vadjustment(m_vadjustment);
 		}
-		Gtk::FlowBox::remove(*child);
 	}
+	Gtk::Layout::on_size_allocate(allocation);
+	if (allocation.get_width() != m_width) {
+		m_width = allocation.get_width();
+		update_geometry();
+	}
+	update_viewport();
+}
+
+void TaskFlowBox::scroll_to_slot(uint32_t slot) {
+	if (!m_vadjustment || !m_row_height)
+		return;
+	double y = kBorder + int(slot / m_columns) * (m_row_height + kSpacing);
+	double top = m_vadjustment->get_value();
+	if (y < top || y + m_row_height > top + m_vadjustment->get_page_size())
+		m_vadjustment->set_value(y - kBorder);
+}
+
+uint32_t TaskFlowBox::get_focus_slot() const {
+	for (auto child : m_children)
+		if (child->m_slot != TaskFlowBoxChild::kNoSlot && child->m_button.is_focus())
+			return child->m_slot;
+	return TaskFlowBoxChild::kNoSlot;
+}
 
-	{
-		std::unique_lock write_lock{m_children_mutex};
-		m_children = std::move(update_set);
+void TaskFlowBox::focus_slot(uint32_t slot) {
+	scroll_to_slot(slot);
+	update_viewport();
+	for (auto child : m_children)
+		if (child->m_slot == slot) {
+			child->m_button.grab_focus();
+			return;
+		}
+}
+
+bool TaskFlowBox::on_key_press_event(GdkEventKey *key_event) {
+	uint32_t slot = get_focus_slot();
+	auto count = (int64_t)m_filtered.size();
+	if (slot == TaskFlowBoxChild::kNoSlot || (int64_t)slot >= count)
+		return Gtk::Layout::on_key_press_event(key_event);
+	int64_t columns = m_columns, target = slot, page = columns;
+	if (m_vadjustment && m_row_height)
+		page *= std::max(int64_t(m_vadjustment->get_page_size()) / (m_row_height + kSpacing), int64_t{1});
+	switch (key_event->keyval) {
+	case GDK_KEY_Left:
+	case GDK_KEY_KP_Left:
+		target -= 1;
+		break;
+	case GDK_KEY_Right:
+	case GDK_KEY_KP_Right:
+		target += 1;
+		break;
+	case GDK_KEY_Up:
+	case GDK_KEY_KP_Up:
+		target -= columns;
+		break;
+	case GDK_KEY_Down:
+	case GDK_KEY_KP_Down:
+		target += columns;
+		break;
+	case GDK_KEY_Page_Up:
+	case GDK_KEY_KP_Page_Up:
+		target = std::max(target - page, slot % columns);
+		break;
+	case GDK_KEY_Page_Down:
+	case GDK_KEY_KP_Page_Down:
+		target = std::min(target + page, count - 1);
+		break;
+	case GDK_KEY_Home:
+	case GDK_KEY_KP_Home:
+		target = 0;
+		break;
+	case GDK_KEY_End:
+	case GDK_KEY_KP_End:
+		target = count - 1;
+		break;
+	default:
+		return Gtk::Layout::on_key_press_event(key_event);
 	}
+	// Arrows past the edges move the focus out of the box, as the toplevel does by default
+	if (target < 0 || target >= count)
+		return Gtk::Layout::on_key_press_event(key_event);
+	if (target != slot)
+		focus_slot(uint32_t(target));
+	return true;
+}
 
-	refilter();
+void TaskFlowBox::on_child_clicked(TaskFlowBoxChild *child) {
+	if (child->m_button.get_active()) {
+		m_active_id = child->m_task.id;
+		for (auto other : m_children)
+			if (other != child)
+				other->set_active_silently(false);
+		m_signal_task_selected.emit(child->m_task);
+	} else if (m_active_id == child->m_task.id) {
+		m_active_id = 0;
+		m_signal_deactivate.emit();
+	}
 }
 
 void TaskFlowBox::set_status_filter(backend::TaskStatus status, bool activate) {
@@ -88,13 +462,32 @@ void TaskFlowBox::set_priority_filter(backend::TaskPriority priority, bool activ
 	uint32_t d = (uint32_t)priority, mask = ~(1u << d);
 	m_priority_filter = (m_priority_filter & mask) | ((uint32_t)activate << d);
 }
+void TaskFlowBox::set_search_query(std::string query) {
+	if (query == m_search_query)
+		return;
+	m_search_query = std::move(query);
+	invalidate_filter();
+}
 bool TaskFlowBox::activate_children(uint32_t id) {
-	std::shared_lock read_lock{m_children_mutex};
-	auto it = m_children.find(id);
-	if (it == m_children.end())
+	update_model();
+	auto it = std::find_if(m_tasks->begin(), m_tasks->end(), [id](const backend::Task &task) { return task.id == id; });
+	if (it == m_tasks->end())
 		return false;
-	it->second->set_active(true);
+	m_active_id = id;
+	// Scroll the Task into view if it passes the filters
+	auto filtered_it = std::find(m_filtered.begin(), m_filtered.end(), uint32_t(it - m_tasks->begin()));
+	if (filtered_it != m_filtered.end())
+		scroll_to_slot(uint32_t(filtered_it - m_filtered.begin()));
+	update_viewport();
+	m_signal_task_selected.emit(*it);
 	return true;
 }
+void TaskFlowBox::deactivate_children() {
+	if (!m_active_id)
+		return;
+	m_active_id = 0;
+	update_viewport();
+	m_signal_deactivate.emit();
+}
 
-} // namespace gui
\ No newline at end of file
+} // namespace gui
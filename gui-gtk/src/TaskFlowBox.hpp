@@ -4,45 +4,118 @@
 #include <gtkmm.h>
 
 #include "TaskFlowBoxChild.hpp"
+#include <array>
 #include <backend/Schedule.hpp>
-#include <shared_mutex>
-#include <unordered_map>
+#include <backend/Search.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace gui {
 
-class TaskFlowBox : public Gtk::FlowBox {
+enum class TaskSortOrder { kBeginTime, kRemindTime, kPriority, kName };
+
+/**
+ * Get all TaskSortOrder strings
+ */
+inline constexpr std::array<const char *, 4> GetTaskSortOrderStrings() {
+	return {"Begin Time", "Remind Time", "Priority", "Name"};
+}
+
+/**
+ * Get TaskSortOrder from a string, the letter case is ignored.
+ */
+TaskSortOrder TaskSortOrderFromStr(std::string_view str);
+
+/**
+ * A grid of Tasks backed by a Task vector, widgets are only materialized for the visible rows (plus a margin) and
+ * recycled on scroll, so that its cost does not grow with the Schedule. The arrow, Home, End and Page keys move the
+ * focus between the Tasks like Gtk::FlowBox, materializing the focused one.
+ */
+class TaskFlowBox : public Gtk::Layout {
 public:
 	TaskFlowBox();
 	~TaskFlowBox() override = default;
 
-	void refilter();
+	/**
+	 * Sorting and filtering are deferred to one idle pass before the next relayout, however many times they are
+	 * invalidated.
+	 */
+	void invalidate_sort();
+	void invalidate_filter();
 
-	void set_tasks(const std::vector<backend::Task> &tasks);
+	void set_tasks(backend::TaskSnapshot tasks, std::shared_ptr<const backend::TaskColumns> columns);
+	void set_sort_order(TaskSortOrder order);
+	inline TaskSortOrder get_sort_order() const { return m_sort_order; }
 	sigc::signal<void(const backend::Task &)> signal_task_selected() { return m_signal_task_selected; }
 	sigc::signal<void()> signal_deactivate() { return m_signal_deactivate; }
 
 	void set_status_filter(backend::TaskStatus status, bool activate);
 	void set_type_filter(backend::TaskType type, bool activate);
 	void set_priority_filter(backend::TaskPriority priority, bool activate);
+	/**
+	 * Only show the Tasks whose names contain the query, an empty query shows all.
+	 */
+	void set_search_query(std::string query);
 
-	inline bool have_active_child() const { return m_active_child; }
+	inline bool have_active_child() const { return m_active_id; }
 	bool activate_children(uint32_t id);
-	inline void deactivate_children() {
-		if (m_active_child) {
-			m_active_child->set_active(false);
-			m_active_child = nullptr;
-		}
-	}
+	void deactivate_children();
 
 protected:
 	sigc::signal<void(const backend::Task &)> m_signal_task_selected;
 	sigc::signal<void()> m_signal_deactivate;
 
+	void on_size_allocate(Gtk::Allocation &allocation) override;
+	bool on_key_press_event(GdkEventKey *key_event) override;
+
 private:
-	TaskFlowBoxChild *m_active_child{};
-	std::unordered_map<uint32_t, TaskFlowBoxChild *> m_children;
-	std::shared_mutex m_children_mutex;
+	// The model: Tasks in key order with the statuses and begin times of their current or next occurrences, the
+	// indices of the Tasks in the sort order, and those of them passing the filters
+	backend::TaskSnapshot m_tasks{std::make_shared<const std::vector<backend::Task>>()};
+	std::shared_ptr<const backend::TaskColumns> m_task_columns{std::make_shared<const backend::TaskColumns>()};
+	std::vector<backend::TaskStatus> m_statuses;
+	std::vector<backend::TimeInt> m_begin_times;
+	std::vector<uint32_t> m_order, m_ranks, m_filtered;
+	// Status transitions, a min-heap of (transition time, index): Pending Tasks begin, and the occurrences of recurring
+	// Tasks begin and end
+	std::vector<std::pair<backend::TimeInt, uint32_t>> m_transitions;
+	sigc::connection m_transition_connection;
+	// Collation keys of the Task names, computed on the first sort by name
+	std::vector<std::string> m_name_keys;
+	TaskSortOrder m_sort_order{TaskSortOrder::kBeginTime};
+	bool m_sort_dirty{false}, m_filter_dirty{false};
+	// Search index over the names, only updated while searching
+	std::string m_search_query;
+	backend::TaskSearchIndex m_search_index;
+	bool m_search_index_dirty{true};
+	std::vector<bool> m_search_matches;
+	sigc::connection m_update_connection;
+	// Task IDs start from 1
+	uint32_t m_active_id{};
+
+	std::vector<TaskFlowBoxChild *> m_children;
+	int m_width{-1}, m_columns{1}, m_column_width{}, m_row_height{};
+	Glib::RefPtr<Gtk::Adjustment> m_vadjustment;
+	sigc::connection m_vadjustment_connection;
+
 	void init_widget();
+	void schedule_update();
+	void update_model();
+	void update_statuses();
+	void sort();
+	bool pass_filters(uint32_t index) const;
+	void filter();
+	void refilter_tasks(const std::vector<uint32_t> &indices);
+	void schedule_transition();
+	bool on_transition();
+	void update_geometry();
+	void update_viewport();
+	void scroll_to_slot(uint32_t slot);
+	uint32_t get_focus_slot() const;
+	void focus_slot(uint32_t slot);
+	TaskFlowBoxChild *make_child();
+	void on_child_clicked(TaskFlowBoxChild *child);
 
 	uint32_t m_status_filter = -1, m_type_filter = -1, m_priority_filter = -1;
 
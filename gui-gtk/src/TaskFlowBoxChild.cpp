@@ -2,20 +2,23 @@
 
 #include "Icon.hpp"
 #include "TaskFlowBox.hpp"
-#include <utility>
+
+#include <backend/Recurrence.hpp>
 
 namespace gui {
 
-TaskFlowBoxChild::TaskFlowBoxChild(backend::Task task) : m_task{std::move(task)} {
-	initialize();
+TaskFlowBoxChild::TaskFlowBoxChild(TaskFlowBox *flow_box) : m_flow_box{flow_box} { initialize(); }
+
+void TaskFlowBoxChild::set_task(const backend::Task &task, backend::TaskStatus status, backend::TimeInt begin_time) {
+	m_task = task;
+	m_status = status;
+	m_begin_time = begin_time;
+	m_bound = true;
 	update();
 }
 
 void TaskFlowBoxChild::initialize() {
-	set_valign(Gtk::ALIGN_CENTER);
-	set_halign(Gtk::ALIGN_BASELINE);
-	set_hexpand(true);
-	set_vexpand(true);
+	set_visible_window(false);
 
 	m_button.add(m_content_box);
 	m_button.set_halign(Gtk::ALIGN_FILL);
@@ -79,20 +82,19 @@ void TaskFlowBoxChild::initialize() {
 	show_all();
 
 	m_button.signal_clicked().connect([this]() {
-		auto parent = (TaskFlowBox *)get_parent();
-		if (m_button.get_active()) {
-			if (parent->m_active_child && parent->m_active_child != this)
-				parent->m_active_child->set_active(false);
-			parent->m_active_child = this;
-			parent->m_signal_task_selected.emit(m_task);
-		} else if (parent->m_active_child == this) {
-			parent->m_active_child = nullptr;
-			parent->m_signal_deactivate.emit();
-		}
+		if (!m_silent)
+			m_flow_box->on_child_clicked(this);
 	});
 }
+void TaskFlowBoxChild::set_active_silently(bool active) {
+	if (m_button.get_active() == active)
+		return;
+	m_silent = true;
+	m_button.set_active(active);
+	m_silent = false;
+}
 void TaskFlowBoxChild::update() {
-	auto status = backend::TaskStatusFromTask(m_task);
+	auto status = m_status;
 	m_priority_icon.set_from_icon_name(GetTaskPriorityIconName(m_task.property.priority), Gtk::ICON_SIZE_DND);
 	m_priority_icon.set_tooltip_text((std::string)backend::StrFromTaskPriority(m_task.property.priority) + " Priority");
 
@@ -109,13 +111,15 @@ void TaskFlowBoxChild::update() {
 	} */
 	m_content_box.set_sensitive(!m_task.property.done);
 
-	m_begin_time_label.set_text(backend::ToTimeStr(m_task.property.begin_time));
-	m_remind_time_label.set_text(backend::ToTimeStr(m_task.property.remind_time));
+	// A recurring Task shows its current or next occurrence
+	backend::Task occurrence = backend::MakeTaskOccurrence(m_task, m_begin_time);
+	m_begin_time_label.set_text(backend::ToTimeStr(occurrence.property.begin_time));
+	m_remind_time_label.set_text(backend::ToTimeStr(occurrence.property.remind_time));
 	m_name_label.set_text(m_task.property.name);
 }
 
 void TaskFlowBoxChild::on_grab_focus() {
-	Gtk::FlowBoxChild::on_grab_focus();
+	Gtk::EventBox::on_grab_focus();
 	m_button.grab_focus();
 }
 
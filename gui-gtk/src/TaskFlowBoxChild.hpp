@@ -4,38 +4,46 @@
 #include <gtkmm.h>
 
 #include <backend/Task.hpp>
+#include <limits>
 
 namespace gui {
-class TaskFlowBoxChild : public Gtk::FlowBoxChild {
+class TaskFlowBox;
+
+/**
+ * A recyclable Task widget of TaskFlowBox, bound to one slot of the filtered Tasks at a time.
+ */
+class TaskFlowBoxChild : public Gtk::EventBox {
 public:
-	explicit TaskFlowBoxChild(backend::Task task);
+	explicit TaskFlowBoxChild(TaskFlowBox *flow_box);
 	~TaskFlowBoxChild() override = default;
 
 	inline const backend::Task &get_task() const { return m_task; }
-	inline void set_task(const backend::Task &task) {
-		m_task = task;
-		update();
-	}
+	/**
+	 * Bind a Task, showing the times of its occurrence beginning at begin_time.
+	 */
+	void set_task(const backend::Task &task, backend::TaskStatus status, backend::TimeInt begin_time);
 	void on_grab_focus() override;
-	inline void set_active(bool active = true) { m_button.set_active(active); }
-	inline bool get_active() { return m_button.get_active(); }
 
 private:
-	backend::Task m_task;
+	static constexpr uint32_t kNoSlot = std::numeric_limits<uint32_t>::max();
+
+	TaskFlowBox *m_flow_box;
+	backend::Task m_task{};
+	backend::TaskStatus m_status{};
+	backend::TimeInt m_begin_time{};
+	bool m_bound{false}, m_silent{false};
+	uint32_t m_slot{kNoSlot};
+	int m_x{-1}, m_y{-1};
 
 	Gtk::ToggleButton m_button;
 	Gtk::Box m_content_box, m_time_box, m_remind_box;
 	Gtk::Label m_name_label, m_begin_time_label, m_remind_time_label;
 	Gtk::Image m_priority_icon, m_type_icon, m_status_icon, m_remind_icon;
 
-	/* Gtk::Button *m_p_task_button{nullptr};
-	Gtk::Box *m_p_task_content_box{};
-	Gtk::Label *m_p_name_label{nullptr}, *m_p_begin_time_label{nullptr}, *m_p_remind_time_label{nullptr},
-	    *m_p_type_label{nullptr};
-	Gtk::Image *m_p_priority_icon{nullptr}, *m_p_type_icon{nullptr}, *m_p_status_icon{nullptr}; */
-
 	void initialize();
 	void update();
+	// Set the button state without emitting the click
+	void set_active_silently(bool active);
 
 	friend class TaskFlowBox;
 };
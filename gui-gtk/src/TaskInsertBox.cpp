@@ -11,6 +11,7 @@ void TaskInsertBox::init_widget() {
 	builder->get_widget("grid", m_p_grid);
 	builder->get_widget("task_name_entry", m_p_task_name_entry);
 	builder->get_widget("begin_time_button", m_p_begin_time_button);
+	builder->get_widget("end_time_button", m_p_end_time_button);
 	builder->get_widget("remind_time_button", m_p_remind_time_button);
 	builder->get_widget("priority_button", m_p_priority_button);
 	builder->get_widget("type_button", m_p_type_button);
@@ -19,16 +20,27 @@ void TaskInsertBox::init_widget() {
 	builder->get_widget("priority_icon", m_p_priority_icon);
 	builder->get_widget("type_label", m_p_type_label);
 	builder->get_widget("type_icon", m_p_type_icon);
+	builder->get_widget("conflict_label", m_p_conflict_label);
 	pack_start(*m_p_grid);
 	show_all();
 	m_p_begin_time_button->set_popover(m_begin_time_popover);
+	m_p_end_time_button->set_popover(m_end_time_popover);
 	m_p_remind_time_button->set_popover(m_remind_time_popover);
 	m_p_priority_button->set_popover(m_priority_popover);
 	m_p_type_button->set_popover(m_type_popover);
 	restore();
 
-	m_begin_time_popover.signal_time_selected().connect(
-	    [this](const backend::TimeInfo &info) { m_p_begin_time_button->set_label(backend::ToTimeStr(info)); });
+	m_begin_time_popover.signal_time_selected().connect([this](const backend::TimeInfo &info) {
+		// The end time moves along, keeping the duration
+		uint32_t duration = get_duration();
+		m_p_begin_time_button->set_label(backend::ToTimeStr(info));
+		set_end_time(backend::ToTimeInt(info) + duration);
+		m_signal_time_changed.emit(get_task_property());
+	});
+	m_end_time_popover.signal_time_selected().connect([this](const backend::TimeInfo &info) {
+		m_p_end_time_button->set_label(backend::ToTimeStr(info));
+		m_signal_time_changed.emit(get_task_property());
+	});
 
 	m_remind_time_popover.signal_time_selected().connect(
 	    [this](const backend::TimeInfo &info) { m_p_remind_time_button->set_label(backend::ToTimeStr(info)); });
@@ -45,17 +57,40 @@ void TaskInsertBox::restore() {
 	auto time_info = backend::GetTimeInfoNow();
 	auto time_str = backend::ToTimeStr(time_info);
 	m_p_begin_time_button->set_label(time_str);
+	m_p_end_time_button->set_label(time_str);
 	m_p_remind_time_button->set_label(time_str);
 	m_begin_time_popover.set_time(time_info);
+	m_end_time_popover.set_time(time_info);
 	m_remind_time_popover.set_time(time_info);
 	set_priority(backend::kDefaultTaskPriority);
 	set_type(backend::kDefaultTaskType);
+	set_conflicts({});
+}
+
+void TaskInsertBox::set_conflicts(const std::vector<backend::Task> &conflicts) {
+	constexpr std::size_t kMaxShownConflicts = 3;
+	if (conflicts.empty()) {
+		m_p_conflict_label->hide();
+		return;
+	}
+	std::string markup = "Overlaps with";
+	for (std::size_t i = 0; i < conflicts.size() && i < kMaxShownConflicts; ++i) {
+		const auto &property = conflicts[i].property;
+		markup += (i ? ", <b>" : " <b>") + Glib::Markup::escape_text(property.name).raw() + "</b> (" +
+		          backend::ToTimeStr(property.begin_time) + " - " + backend::ToTimeStr(backend::TaskEndTime(property)) +
+		          ")";
+	}
+	if (conflicts.size() > kMaxShownConflicts)
+		markup += " and " + std::to_string(conflicts.size() - kMaxShownConflicts) + " more";
+	m_p_conflict_label->set_markup(markup);
+	m_p_conflict_label->show();
 }
 
 backend::TaskProperty TaskInsertBox::get_task_property() {
 	backend::TaskProperty p{};
 	p.name = m_p_task_name_entry->get_text();
 	p.begin_time = backend::ToTimeInt(m_p_begin_time_button->get_label());
+	p.duration = get_duration();
 	p.remind_time = backend::ToTimeInt(m_p_remind_time_button->get_label());
 	p.priority = backend::TaskPriorityFromStr(m_p_priority_label->get_text().c_str());
 	p.type = backend::TaskTypeFromStr(m_p_type_label->get_text().c_str());
@@ -67,6 +102,16 @@ void TaskInsertBox::set_priority(backend::TaskPriority priority) {
 	m_p_priority_icon->set_from_icon_name(GetTaskPriorityIconName(priority), Gtk::ICON_SIZE_DND);
 	m_p_priority_label->set_text(backend::StrFromTaskPriority(priority));
 }
+void TaskInsertBox::set_end_time(backend::TimeInt time_int) {
+	auto time_info = backend::ToTimeInfo(time_int);
+	m_p_end_time_button->set_label(backend::ToTimeStr(time_info));
+	m_end_time_popover.set_time(time_info);
+}
+uint32_t TaskInsertBox::get_duration() const {
+	backend::TimeInt begin_time = backend::ToTimeInt(m_p_begin_time_button->get_label()),
+	                 end_time = backend::ToTimeInt(m_p_end_time_button->get_label());
+	return end_time > begin_time ? end_time - begin_time : 0;
+}
 void TaskInsertBox::set_type(backend::TaskType type) {
 	m_p_type_icon->set_from_icon_name(GetTaskTypeIconName(type), Gtk::ICON_SIZE_DND);
 	m_p_type_label->set_text(backend::StrFromTaskType(type));
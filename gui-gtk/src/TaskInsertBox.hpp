@@ -4,6 +4,8 @@
 #include <backend/Task.hpp>
 #include <gtkmm.h>
 
+#include <vector>
+
 #include "EnumSelectPopover.hpp"
 #include "TimePopover.hpp"
 
@@ -15,26 +17,34 @@ public:
 
 	void restore();
 	backend::TaskProperty get_task_property();
+	/**
+	 * Show the Task occurrences the inserted Task would overlap, none hides the warning.
+	 */
+	void set_conflicts(const std::vector<backend::Task> &conflicts);
 
 private:
 	Gtk::Grid *m_p_grid{};
 	Gtk::Entry *m_p_task_name_entry{};
-	Gtk::MenuButton *m_p_begin_time_button{}, *m_p_remind_time_button{}, *m_p_priority_button{}, *m_p_type_button{};
+	Gtk::MenuButton *m_p_begin_time_button{}, *m_p_end_time_button{}, *m_p_remind_time_button{}, *m_p_priority_button{},
+	    *m_p_type_button{};
 	Gtk::Button *m_p_ok_button{};
-	Gtk::Label *m_p_priority_label{}, *m_p_type_label{};
+	Gtk::Label *m_p_priority_label{}, *m_p_type_label{}, *m_p_conflict_label{};
 	Gtk::Image *m_p_priority_icon{}, *m_p_type_icon{};
-	TimePopover m_begin_time_popover{false}, m_remind_time_popover{false};
+	TimePopover m_begin_time_popover{false}, m_end_time_popover{false}, m_remind_time_popover{false};
 	EnumSelectPopover m_priority_popover{backend::GetTaskPriorityStrings()},
 	    m_type_popover{backend::GetTaskTypeStrings()};
 	void init_widget();
 	void set_priority(backend::TaskPriority priority);
 	void set_type(backend::TaskType type);
+	void set_end_time(backend::TimeInt time_int);
+	uint32_t get_duration() const;
 
 protected:
-	sigc::signal<void(const backend::TaskProperty &)> m_signal_task_inserted;
+	sigc::signal<void(const backend::TaskProperty &)> m_signal_task_inserted, m_signal_time_changed;
 
 public:
 	decltype(m_signal_task_inserted) signal_task_inserted() { return m_signal_task_inserted; }
+	decltype(m_signal_time_changed) signal_time_changed() { return m_signal_time_changed; }
 };
 } // namespace gui
 
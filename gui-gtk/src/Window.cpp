@@ -2,6 +2,9 @@
 
 #include "Icon.hpp"
 #include <backend/Environment.hpp>
+#include <backend/Recurrence.hpp>
+#include <backend/TaskScan.hpp>
+#include <backend/Trace.hpp>
 
 namespace gui {
 
@@ -76,16 +79,25 @@ void Window::initialize_body() {
 	m_body.task_insert_box.signal_task_inserted().connect([this](const backend::TaskProperty &property) {
 		if (!m_schedule_ptr)
 			return;
+		// Double-booking is allowed, but warned
+		auto conflicts = m_schedule_ptr->GetTaskConflicts(property);
 		auto [id, error] = m_schedule_ptr->TaskInsert(property);
 		if (error == backend::Error::kSuccess) {
 			goto_list_page();
 			m_body.task_insert_box.restore();
-			message_task(Gtk::MESSAGE_INFO, ("Task <b>" + property.name + "</b> has been inserted.").c_str(), id,
+			std::string str = "Task <b>" + property.name + "</b> has been inserted";
+			str += conflicts.empty() ? "." : ", overlapping " + std::to_string(conflicts.size()) + " tasks.";
+			message_task(conflicts.empty() ? Gtk::MESSAGE_INFO : Gtk::MESSAGE_WARNING, str.c_str(), id,
 			             property.priority, property.type);
 		} else
 			message_error(error);
 	});
 
+	m_body.task_insert_box.signal_time_changed().connect([this](const backend::TaskProperty &property) {
+		m_body.task_insert_box.set_conflicts(m_schedule_ptr ? m_schedule_ptr->GetTaskConflicts(property)
+		                                                    : std::vector<backend::Task>{});
+	});
+
 	m_body.task_detail_box.signal_task_edited().connect(
 	    [this](uint32_t id, const backend::TaskProperty &property, backend::TaskPropertyMask mask) {
 		    if (!m_schedule_ptr)
@@ -122,6 +134,8 @@ void Window::initialize_header_bar() {
 		m_header.bar.pack_start(m_header.user_button);
 		m_header.bar.pack_start(m_header.insert_button);
 		m_header.bar.pack_end(m_header.about_button);
+		m_header.bar.pack_end(m_header.sort_button);
+		m_header.bar.pack_end(m_header.search_entry);
 
 		m_header.user_button.set_always_show_image(true);
 		m_header.user_button.set_image_from_icon_name("user-info", Gtk::ICON_SIZE_DND);
@@ -164,24 +178,40 @@ void Window::initialize_header_bar() {
 		m_header.about_dialog.signal_response().connect([this](int response) { m_header.about_dialog.hide(); });
 		m_header.about_dialog.set_icon_name("help-about");
 
+		// Sort order
+		m_header.sort_button.set_always_show_image(true);
+		m_header.sort_button.set_image_from_icon_name("view-sort-ascending-symbolic", Gtk::ICON_SIZE_DND);
+		m_header.sort_button.set_tooltip_text(std::string{"Sort by "} +
+		                                      GetTaskSortOrderStrings()[(int)m_body.task_flow_box.get_sort_order()]);
+		m_header.sort_button.set_popover(m_header.sort_popover);
+		m_header.sort_popover.signal_selected().connect([this](const char *str) {
+			m_body.task_flow_box.set_sort_order(TaskSortOrderFromStr(str));
+			m_header.sort_button.set_tooltip_text(std::string{"Sort by "} + str);
+		});
+
+		// Search as you type, the entry debounces the changes
+		m_header.search_entry.set_placeholder_text("Search Tasks");
+		m_header.search_entry.signal_search_changed().connect(
+		    [this]() { m_body.task_flow_box.set_search_query(m_header.search_entry.get_text().raw()); });
+
 		// Filters
 		m_header.status_filter_popover.add(m_header.status_filter_box);
 		m_header.status_filter_box.show();
 		m_header.status_filter_box.signal_modified().connect([this](const char *str, bool activate) {
 			m_body.task_flow_box.set_status_filter(backend::TaskStatusFromStr(str), activate);
-			m_body.task_flow_box.refilter();
+			m_body.task_flow_box.invalidate_filter();
 		});
 		m_header.type_filter_popover.add(m_header.type_filter_box);
 		m_header.type_filter_box.show();
 		m_header.type_filter_box.signal_modified().connect([this](const char *str, bool activate) {
 			m_body.task_flow_box.set_type_filter(backend::TaskTypeFromStr(str), activate);
-			m_body.task_flow_box.refilter();
+			m_body.task_flow_box.invalidate_filter();
 		});
 		m_header.priority_filter_popover.add(m_header.priority_filter_box);
 		m_header.priority_filter_box.show();
 		m_header.priority_filter_box.signal_modified().connect([this](const char *str, bool activate) {
 			m_body.task_flow_box.set_priority_filter(backend::TaskPriorityFromStr(str), activate);
-			m_body.task_flow_box.refilter();
+			m_body.task_flow_box.invalidate_filter();
 		});
 
 		// Filter buttons
@@ -277,6 +307,9 @@ void Window::set_schedule(const std::shared_ptr<backend::Schedule> &schedule_ptr
 	m_messages.clear();*/
 	sync_thread_join();
 	remind_thread_join();
+	// Drop the reminders of the previous Schedule
+	while (m_remind_thread.queue.pop())
+		;
 
 	m_schedule_ptr = schedule_ptr;
 
@@ -284,10 +317,12 @@ void Window::set_schedule(const std::shared_ptr<backend::Schedule> &schedule_ptr
 		m_body.user_box.set_current_user(false);
 		m_header.insert_button.set_sensitive(false);
 		m_header.filter_button_box.set_sensitive(false);
+		m_header.search_entry.set_sensitive(false);
 	} else {
 		m_body.user_box.set_current_user(true, m_schedule_ptr->GetUserPtr()->GetName().c_str());
 		m_header.insert_button.set_sensitive(true);
 		m_header.filter_button_box.set_sensitive(true);
+		m_header.search_entry.set_sensitive(true);
 
 		sync_thread_launch();
 		remind_thread_launch();
@@ -357,14 +392,20 @@ void Window::message_error(backend::Error error) {
 }
 
 void Window::sync_thread_func() {
+	backend::SetTraceThreadName("GUI sync");
 	std::mutex cv_mutex;
 	std::shared_ptr<backend::Schedule> schedule = m_schedule_ptr;
+	// Snapshot versions start from 1
+	uint32_t version = 0;
 
 	while (m_sync_thread.run.load(std::memory_order_acquire)) {
-		bool updated;
-		const auto &tasks = schedule->GetTasks(&updated);
-		if (updated) {
-			m_sync_thread.queue.enqueue(tasks);
+		uint32_t snapshot_version;
+		schedule->GetTaskSnapshot(&snapshot_version);
+		if (snapshot_version != version) {
+			version = snapshot_version;
+			backend::TaskSnapshot tasks;
+			auto columns = schedule->GetTaskColumns(&tasks);
+			m_sync_thread.queue.enqueue({std::move(tasks), std::move(columns)});
 			m_sync_thread.dispatcher();
 		}
 		std::unique_lock cv_lock{cv_mutex};
@@ -386,10 +427,16 @@ void Window::sync_thread_launch() {
 
 void Window::sync_thread_init() {
 	m_sync_thread.dispatcher.connect([this]() {
-		std::vector<backend::Task> tasks;
-		if (m_sync_thread.queue.try_dequeue(tasks)) {
-			m_body.task_flow_box.set_tasks(tasks);
-			if (m_body.task_detail_box.have_task() && !m_body.task_detail_box.update_from_tasks(tasks)) {
+		SCHEDULITE_TRACE_SCOPE("Window::sync_dispatch");
+		// Only the newest of the pending snapshots matters
+		std::pair<backend::TaskSnapshot, std::shared_ptr<const backend::TaskColumns>> newer;
+		backend::TaskSnapshot tasks;
+		std::shared_ptr<const backend::TaskColumns> columns;
+		while (m_sync_thread.queue.try_dequeue(newer))
+			std::tie(tasks, columns) = std::move(newer);
+		if (tasks) {
+			m_body.task_flow_box.set_tasks(tasks, std::move(columns));
+			if (m_body.task_detail_box.have_task() && !m_body.task_detail_box.update_from_tasks(*tasks)) {
 				goto_list_page();
 			}
 		}
@@ -439,31 +486,11 @@ void Window::flap_switched(GtkWidget *flap, guint index, gint64 duration, Window
 
 void Window::remind_thread_init() {
 	m_remind_thread.dispatcher.connect([this]() {
-		std::pair<std::shared_ptr<backend::Schedule>, backend::TimeInt> data;
-
-		if (m_remind_thread.queue.try_dequeue(data)) {
-			auto schedule = data.first;
-			if (!schedule)
-				return;
-			auto time_int = data.second;
-			for (const auto &task : schedule->GetTasks()) {
-				if (task.property.done)
-					continue;
-				if (task.property.remind_time == time_int) {
-					message_task(Gtk::MESSAGE_WARNING,
-					             ("Remind task <b>" + task.property.name + "</b> at " +
-					              backend::ToTimeStr(task.property.remind_time))
-					                 .c_str(),
-					             task.id, task.property.priority, task.property.type);
-				} else if (task.property.begin_time == time_int) {
-					message_task(Gtk::MESSAGE_INFO,
-					             ("Task <b>" + task.property.name + "</b> has begun at " +
-					              backend::ToTimeStr(task.property.begin_time))
-					                 .c_str(),
-					             task.id, task.property.priority, task.property.type);
-				}
-			}
-		}
+		SCHEDULITE_TRACE_SCOPE("Window::remind_dispatch");
+		std::vector<decltype(m_remind_thread)::Message> messages;
+		while (m_remind_thread.queue.try_dequeue(messages))
+			for (const auto &msg : messages)
+				message_task(msg.msg_type, msg.str.c_str(), msg.id, msg.priority, msg.type);
 	});
 }
 void Window::remind_thread_launch() {
@@ -478,13 +505,51 @@ void Window::remind_thread_join() {
 	}
 }
 void Window::remind_thread_func() {
+	backend::SetTraceThreadName("GUI remind");
 	std::mutex cv_mutex;
 	backend::TimeInt time_int = backend::GetTimeIntNow();
 	std::shared_ptr<backend::Schedule> schedule = m_schedule_ptr;
+	std::vector<uint64_t> remind_mask, begin_mask;
 
 	while (m_remind_thread.run.load(std::memory_order_acquire)) {
-		m_remind_thread.queue.enqueue({schedule, time_int});
-		m_remind_thread.dispatcher();
+		{
+			SCHEDULITE_TRACE_SCOPE("Window::remind_scan");
+			backend::TaskSnapshot snapshot;
+			auto columns = schedule->GetTaskColumns(&snapshot);
+			const auto &tasks = *snapshot;
+			remind_mask.assign(backend::GetTaskScanMaskSize(columns->size()), 0);
+			begin_mask.assign(remind_mask.size(), 0);
+			backend::TimeEqualScan(columns->remind_times.data(), columns->size(), time_int, remind_mask.data());
+			backend::TimeEqualScan(columns->begin_times.data(), columns->size(), time_int, begin_mask.data());
+			for (std::size_t w = 0; w < remind_mask.size(); ++w)
+				begin_mask[w] |= remind_mask[w];
+			backend::UndoneMaskScan(columns->dones.data(), columns->size(), begin_mask.data());
+
+			std::vector<decltype(m_remind_thread)::Message> messages;
+			const auto add_message = [&messages, time_int](const backend::Task &task) {
+				if (task.property.remind_time == time_int)
+					messages.push_back({Gtk::MESSAGE_WARNING,
+					                    "Remind task <b>" + task.property.name + "</b> at " +
+					                        backend::ToTimeStr(task.property.remind_time),
+					                    task.id, task.property.priority, task.property.type});
+				else if (task.property.begin_time == time_int)
+					messages.push_back({Gtk::MESSAGE_INFO,
+					                    "Task <b>" + task.property.name + "</b> has begun at " +
+					                        backend::ToTimeStr(task.property.begin_time),
+					                    task.id, task.property.priority, task.property.type});
+			};
+			backend::ForEachTaskScanMaskBit(begin_mask.data(), columns->size(), [&tasks, &add_message](uint32_t i) {
+				// Recurring Tasks are reminded by their occurrences
+				if (!tasks[i].property.recurrence.IsRecurring())
+					add_message(tasks[i]);
+			});
+			for (const auto &occurrence : backend::GetRecurringTasksAt(tasks, time_int, true))
+				add_message(occurrence);
+			if (!messages.empty()) {
+				m_remind_thread.queue.enqueue(std::move(messages));
+				m_remind_thread.dispatcher();
+			}
+		}
 		std::unique_lock cv_lock{cv_mutex};
 		m_remind_thread.cv.wait_until(cv_lock, backend::ToTimePoint(++time_int),
 		                              [this]() { return !m_remind_thread.run.load(std::memory_order_acquire); });
@@ -2,6 +2,7 @@
 #define SCHEDULITE_GTK_WINDOW_HPP
 
 #include "EnumFilterBox.hpp"
+#include "EnumSelectPopover.hpp"
 #include "TaskDetailBox.hpp"
 #include "TaskFlowBox.hpp"
 #include "TaskInsertBox.hpp"
@@ -46,7 +47,9 @@ protected:
 		std::atomic_bool run;
 		std::condition_variable cv;
 		std::thread thread;
-		moodycamel::ReaderWriterQueue<std::vector<backend::Task>> queue;
+		// Task snapshots with their scan columns
+		moodycamel::ReaderWriterQueue<std::pair<backend::TaskSnapshot, std::shared_ptr<const backend::TaskColumns>>>
+		    queue;
 	} m_sync_thread;
 	void sync_thread_init();
 	void sync_thread_func();
@@ -58,7 +61,15 @@ protected:
 		std::atomic_bool run;
 		std::condition_variable cv;
 		std::thread thread;
-		moodycamel::ReaderWriterQueue<std::pair<std::shared_ptr<backend::Schedule>, backend::TimeInt>> queue;
+		// Reminders are evaluated by the thread, only the messages to display are posted
+		struct Message {
+			Gtk::MessageType msg_type;
+			std::string str;
+			uint32_t id;
+			backend::TaskPriority priority;
+			backend::TaskType type;
+		};
+		moodycamel::ReaderWriterQueue<std::vector<Message>> queue;
 	} m_remind_thread;
 	void remind_thread_init();
 	void remind_thread_func();
@@ -71,14 +82,16 @@ protected:
 	void goto_detail_page();
 
 	struct {
-		Gtk::MenuButton status_filter_button, priority_filter_button, type_filter_button;
+		Gtk::MenuButton status_filter_button, priority_filter_button, type_filter_button, sort_button;
 		Gtk::Button about_button;
 		Gtk::ToggleButton user_button, insert_button;
 		Gtk::HeaderBar bar;
+		Gtk::SearchEntry search_entry;
 		Gtk::ButtonBox filter_button_box;
 		Gtk::Popover status_filter_popover, priority_filter_popover, type_filter_popover;
 		EnumFilterBox status_filter_box{backend::GetTaskStatusStrings()},
 		    priority_filter_box{backend::GetTaskPriorityStrings()}, type_filter_box{backend::GetTaskTypeStrings()};
+		EnumSelectPopover sort_popover{GetTaskSortOrderStrings()};
 		Gtk::AboutDialog about_dialog;
 	} m_header;
 
@@ -2,7 +2,10 @@
 
 #include "Window.hpp"
 
+#include <backend/Trace.hpp>
+
 int main(int argc, char *argv[]) {
+	backend::SetTraceThreadName("GUI main");
 	Glib::RefPtr<Gtk::Application> app = Gtk::Application::create(argc, argv, "org.adamyuan.schedulite");
 
 	gui::Window window;